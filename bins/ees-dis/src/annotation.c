@@ -0,0 +1,48 @@
+#include "annotation.h"
+
+#include <string.h>
+
+void annotation_init(struct annotation *annotation, const struct coverage *coverage,
+                     i64 image_address) {
+  memset(annotation, 0, sizeof(*annotation));
+
+  annotation->coverage = coverage;
+  annotation->image_address = image_address;
+}
+
+void annotation_print(struct annotation *annotation, FILE *out,
+                      const struct instruction *instruction, u32 offset, const char *text) {
+  const struct coverage *coverage = annotation->coverage;
+
+  // Addresses the guest could not have run at are never marked.
+  i64 address = annotation->image_address + offset;
+  u32 flat = address >= 0 && address < BUS_ADDRESS_END ? (u32)address : BUS_ADDRESS_END;
+
+  bool executed = coverage_is_marked(coverage->executed, flat);
+  annotation->instruction_count += 1;
+  annotation->executed_count += executed;
+
+  const char *branch = "";
+  if (coverage_is_branch(instruction)) {
+    bool taken = coverage_is_marked(coverage->taken, flat);
+    bool not_taken = coverage_is_marked(coverage->not_taken, flat);
+    annotation->branch_count += 1;
+    annotation->direction_count += taken + not_taken;
+
+    if (taken && not_taken) {
+      branch = "  ; taken and not taken";
+    } else if (taken) {
+      branch = "  ; always taken";
+    } else if (not_taken) {
+      branch = "  ; never taken";
+    }
+  }
+
+  fprintf(out, "%c %s%s\n", executed ? '+' : '-', text, branch);
+}
+
+void annotation_print_summary(const struct annotation *annotation, FILE *out) {
+  fprintf(out, "; %u of %u instructions executed, %u of %u branch directions taken\n",
+          annotation->executed_count, annotation->instruction_count, annotation->direction_count,
+          annotation->branch_count * 2);
+}
@@ -0,0 +1,35 @@
+#ifndef EES_DIS_ANNOTATION_H_
+#define EES_DIS_ANNOTATION_H_
+
+#include <base/platform.h>
+#include <cpu/coverage.h>
+#include <instructions/instructions.h>
+#include <stdio.h>
+
+// Coverage collected by ees-emu, shown next to the instructions of a listing.
+//
+// Executed instructions are marked with '+' and the others with '-'. Conditional branches that
+// were executed also tell which ways they went. The summary counts the instructions of the listing
+// and the directions of its branches, two per branch.
+
+struct annotation {
+  const struct coverage *coverage;
+  // Flat address image offset 0 was at when the coverage was collected.
+  i64 image_address;
+
+  u32 instruction_count;
+  u32 executed_count;
+  u32 branch_count;
+  u32 direction_count;
+};
+
+void annotation_init(struct annotation *annotation, const struct coverage *coverage,
+                     i64 image_address);
+
+// Print `text`, the disassembly of the instruction at `offset` in the image, with its coverage.
+void annotation_print(struct annotation *annotation, FILE *out,
+                      const struct instruction *instruction, u32 offset, const char *text);
+
+void annotation_print_summary(const struct annotation *annotation, FILE *out);
+
+#endif // EES_DIS_ANNOTATION_H_
@@ -0,0 +1,301 @@
+#include "cfg.h"
+
+#include <assert.h>
+#include <decoder/decoder.h>
+#include <decoder/length.h>
+#include <disassembler/disassembler.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static u8 cfg_fetch(void *context, u32 position) {
+  struct cfg *cfg = context;
+  return position < cfg->data_size ? cfg->data[position] : 0;
+}
+
+void cfg_init(struct cfg *cfg, const u8 *data, u32 data_size, i32 image_base) {
+  memset(cfg, 0, sizeof(*cfg));
+
+  cfg->data = data;
+  cfg->data_size = data_size;
+  cfg->image_base = image_base;
+  cfg->flags = calloc(data_size, 1);
+
+  reader_init(&cfg->reader, cfg, cfg_fetch);
+}
+
+void cfg_destroy(struct cfg *cfg) {
+  free(cfg->flags);
+  free(cfg->edges);
+  free(cfg->worklist);
+}
+
+static void cfg_push_work(struct cfg *cfg, u32 offset, i32 segment_base) {
+  if (cfg->work_count == cfg->work_capacity) {
+    cfg->work_capacity = cfg->work_capacity ? cfg->work_capacity * 2 : 64;
+    cfg->worklist = realloc(cfg->worklist, cfg->work_capacity * sizeof(*cfg->worklist));
+  }
+
+  struct cfg_work_item *item = &cfg->worklist[cfg->work_count++];
+  item->offset = offset;
+  item->segment_base = segment_base;
+}
+
+static void cfg_add_edge(struct cfg *cfg, u32 from, u32 to, enum cfg_edge_type type) {
+  if (cfg->edge_count == cfg->edge_capacity) {
+    cfg->edge_capacity = cfg->edge_capacity ? cfg->edge_capacity * 2 : 64;
+    cfg->edges = realloc(cfg->edges, cfg->edge_capacity * sizeof(*cfg->edges));
+  }
+
+  struct cfg_edge *edge = &cfg->edges[cfg->edge_count++];
+  edge->from = from;
+  edge->to = to;
+  edge->type = type;
+}
+
+void cfg_add_entry(struct cfg *cfg, u32 offset, i32 segment_base) {
+  if (offset >= cfg->data_size) {
+    return;
+  }
+
+  cfg->flags[offset] |= cbf_label | cbf_block;
+  cfg_push_work(cfg, offset, segment_base);
+}
+
+// Queue the target of the instruction at `from`. Targets outside of the image are dropped.
+static void cfg_add_target(struct cfg *cfg, u32 from, i64 target, i32 segment_base,
+                           enum cfg_edge_type type) {
+  if (target < 0 || target >= cfg->data_size) {
+    return;
+  }
+
+  cfg_add_edge(cfg, from, (u32)target, type);
+  cfg_add_entry(cfg, (u32)target, segment_base);
+}
+
+// Follow the targets of the decoded instruction at `offset` and return whether execution continues
+// with the next instruction.
+static bool cfg_follow(struct cfg *cfg, u32 offset, i32 segment_base,
+                       const struct instruction *instruction) {
+  enum cfg_edge_type type = cet_branch;
+  bool falls_through = true;
+
+  switch (instruction->type) {
+    case it_jmp:
+      type = cet_jump;
+      falls_through = false;
+      break;
+
+    case it_call:
+    case it_callf:
+      type = cet_call;
+      break;
+
+    case it_ret:
+    case it_retf:
+    case it_iret:
+      return false;
+
+    default:
+      break;
+  }
+
+  const struct operand *operand = &instruction->destination;
+  switch (operand->type) {
+    case ot_jump: {
+      // The instruction pointer wraps around inside the segment.
+      u16 ip = (u16)(offset - segment_base + instruction->instruction_size +
+                     operand->data.as_jump.offset);
+      cfg_add_target(cfg, offset, (i64)segment_base + ip, segment_base, type);
+      break;
+    }
+
+    case ot_far_jump: {
+      i32 target_segment_base = operand->data.as_far_jump.segment * 16 - cfg->image_base;
+      cfg_add_target(cfg, offset, (i64)target_segment_base + operand->data.as_far_jump.offset,
+                     target_segment_base, type);
+      break;
+    }
+
+    default:
+      // Indirect targets are only known at run time.
+      break;
+  }
+
+  // The instruction after a branch starts a new block.
+  if (falls_through && type == cet_branch && operand->type == ot_jump) {
+    u32 next = offset + instruction->instruction_size;
+    if (next < cfg->data_size) {
+      cfg->flags[next] |= cbf_block;
+    }
+  }
+
+  return falls_through;
+}
+
+void cfg_explore(struct cfg *cfg) {
+  while (cfg->work_count) {
+    struct cfg_work_item item = cfg->worklist[--cfg->work_count];
+    u32 offset = item.offset;
+
+    // Stop when running into code that was already decoded, or into the middle of an instruction.
+    while (offset < cfg->data_size && !(cfg->flags[offset] & (cbf_instruction | cbf_code))) {
+      // The length decoder is cheaper and also catches instructions cut off by the end of the image.
+      unsigned length = instruction_length(cfg->data + offset, cfg->data_size - offset);
+      if (!length) {
+        break;
+      }
+
+      struct instruction instruction;
+      decode_instruction(&cfg->reader, offset, &instruction);
+      assert(instruction.instruction_size == length);
+
+      cfg->flags[offset] |= cbf_instruction;
+      for (u32 i = 0; i < length; ++i) {
+        cfg->flags[offset + i] |= cbf_code;
+      }
+
+      if (!cfg_follow(cfg, offset, item.segment_base, &instruction)) {
+        cfg->flags[offset] |= cbf_no_fall_through;
+        break;
+      }
+
+      offset += length;
+    }
+  }
+}
+
+// Return the offset of the first instruction at or after `offset`, or the size of the image.
+static u32 cfg_next_instruction(const struct cfg *cfg, u32 offset) {
+  while (offset < cfg->data_size && !(cfg->flags[offset] & cbf_instruction)) {
+    ++offset;
+  }
+  return offset;
+}
+
+void cfg_print_listing(struct cfg *cfg, FILE *out, struct annotation *annotation) {
+  static char buffer[128];
+
+  u32 offset = cfg_next_instruction(cfg, 0);
+  while (offset < cfg->data_size) {
+    if (cfg->flags[offset] & cbf_label) {
+      fprintf(out, "\nloc_%05x:\n", offset);
+    }
+
+    struct instruction instruction;
+    decode_instruction(&cfg->reader, offset, &instruction);
+    disassemble(buffer, sizeof(buffer), &instruction, offset);
+    if (annotation) {
+      annotation_print(annotation, out, &instruction, offset, buffer);
+    } else {
+      fprintf(out, "%s\n", buffer);
+    }
+
+    u32 next = offset + instruction.instruction_size;
+    offset = cfg_next_instruction(cfg, next);
+    if (offset > next) {
+      fprintf(out, "; %u bytes not reached\n", offset - next);
+    }
+  }
+}
+
+static int compare_edges(const void *left, const void *right) {
+  const struct cfg_edge *a = left;
+  const struct cfg_edge *b = right;
+
+  return a->from < b->from ? -1 : a->from > b->from;
+}
+
+// Print `text` as part of a double quoted DOT string.
+static void print_dot_escaped(FILE *out, const char *text) {
+  for (; *text; ++text) {
+    if (*text == '"' || *text == '\\') {
+      fputc('\\', out);
+    }
+    fputc(*text, out);
+  }
+}
+
+// Return whether the instruction at `offset`, followed by `next`, is the last one of its block.
+static bool cfg_ends_block(const struct cfg *cfg, u32 offset, u32 next) {
+  return (cfg->flags[offset] & cbf_no_fall_through) || next >= cfg->data_size ||
+         (cfg->flags[next] & (cbf_instruction | cbf_block)) != cbf_instruction;
+}
+
+void cfg_print_dot(struct cfg *cfg, FILE *out) {
+  static const char *edge_styles[] = {
+      [cet_jump] = "solid",
+      [cet_branch] = "solid",
+      [cet_call] = "dashed",
+  };
+  static char buffer[128];
+
+  fprintf(out, "digraph cfg {\n"
+               "  node [shape=box, fontname=\"monospace\"];\n");
+
+  // One node per block, listing its instructions.
+  bool in_block = false;
+  for (u32 offset = cfg_next_instruction(cfg, 0); offset < cfg->data_size;) {
+    if (!in_block) {
+      fprintf(out, "  loc_%05x [label=\"loc_%05x:\\l", offset, offset);
+      in_block = true;
+    }
+
+    struct instruction instruction;
+    decode_instruction(&cfg->reader, offset, &instruction);
+    disassemble(buffer, sizeof(buffer), &instruction, offset);
+    print_dot_escaped(out, buffer);
+    fprintf(out, "\\l");
+
+    u32 next = offset + instruction.instruction_size;
+    if (cfg_ends_block(cfg, offset, next)) {
+      fprintf(out, "\"];\n");
+      in_block = false;
+    }
+
+    offset = cfg_next_instruction(cfg, next);
+  }
+
+  // Targets that are not the start of a decoded instruction still get a node for their edges.
+  for (u32 offset = 0; offset < cfg->data_size; ++offset) {
+    if ((cfg->flags[offset] & (cbf_label | cbf_instruction)) == cbf_label) {
+      fprintf(out, "  loc_%05x [label=\"loc_%05x:\\l; %s\\l\", style=dashed];\n", offset, offset,
+              cfg->flags[offset] & cbf_code ? "inside an instruction" : "not decoded");
+    }
+  }
+
+  // The edges leave the block of the instruction transferring control.
+  qsort(cfg->edges, cfg->edge_count, sizeof(*cfg->edges), compare_edges);
+  u32 edge_index = 0;
+
+  u32 block = 0;
+  in_block = false;
+  for (u32 offset = cfg_next_instruction(cfg, 0); offset < cfg->data_size;) {
+    if (!in_block) {
+      block = offset;
+      in_block = true;
+    }
+
+    for (; edge_index < cfg->edge_count && cfg->edges[edge_index].from <= offset; ++edge_index) {
+      const struct cfg_edge *edge = &cfg->edges[edge_index];
+      if (edge->from == offset) {
+        fprintf(out, "  loc_%05x -> loc_%05x [style=%s];\n", block, edge->to,
+                edge_styles[edge->type]);
+      }
+    }
+
+    struct instruction instruction;
+    u32 next = offset + decode_instruction(&cfg->reader, offset, &instruction);
+    if (cfg_ends_block(cfg, offset, next)) {
+      if (!(cfg->flags[offset] & cbf_no_fall_through) && next < cfg->data_size &&
+          (cfg->flags[next] & cbf_instruction)) {
+        fprintf(out, "  loc_%05x -> loc_%05x;\n", block, next);
+      }
+      in_block = false;
+    }
+
+    offset = cfg_next_instruction(cfg, next);
+  }
+
+  fprintf(out, "}\n");
+}
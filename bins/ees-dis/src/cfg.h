@@ -0,0 +1,90 @@
+#ifndef EES_DIS_CFG_H_
+#define EES_DIS_CFG_H_
+
+#include "annotation.h"
+
+#include <base/platform.h>
+#include <base/reader.h>
+#include <stdio.h>
+
+// Recursive traversal of the code in a binary image.
+//
+// Starting from the entry points, instructions are decoded until the flow of control stops and the
+// targets of every jump, call and branch are added to a worklist. Bytes that are never reached are
+// never decoded, so data mixed in with the code does not throw the disassembly out of sync.
+//
+// Offsets are into the image. Near targets wrap around inside the 64KiB segment of the instruction
+// and far targets are resolved through the flat address the image is loaded at.
+
+enum cfg_byte_flags {
+  // First byte of a decoded instruction.
+  cbf_instruction = 0x01,
+  // Byte belongs to a decoded instruction.
+  cbf_code = 0x02,
+  // Target of a jump, call or branch.
+  cbf_label = 0x04,
+  // First instruction of a basic block.
+  cbf_block = 0x08,
+  // The instruction never continues with the next one (jmp, ret, iret).
+  cbf_no_fall_through = 0x10,
+};
+
+enum cfg_edge_type {
+  cet_jump,
+  cet_branch,
+  cet_call,
+};
+
+struct cfg_edge {
+  // Offset of the instruction transferring control.
+  u32 from;
+  u32 to;
+  enum cfg_edge_type type;
+};
+
+struct cfg_work_item {
+  u32 offset;
+
+  // Offset of the start of the code segment in the image, which can lie outside of it.
+  i32 segment_base;
+};
+
+struct cfg {
+  const u8 *data;
+  u32 data_size;
+
+  // Flat address of the first byte of the image.
+  i32 image_base;
+
+  struct reader reader;
+
+  // One `cfg_byte_flags` set per byte of the image.
+  u8 *flags;
+
+  struct cfg_edge *edges;
+  u32 edge_count;
+  u32 edge_capacity;
+
+  struct cfg_work_item *worklist;
+  u32 work_count;
+  u32 work_capacity;
+};
+
+void cfg_init(struct cfg *cfg, const u8 *data, u32 data_size, i32 image_base);
+void cfg_destroy(struct cfg *cfg);
+
+// Queue an entry point. It is labeled and starts a basic block.
+void cfg_add_entry(struct cfg *cfg, u32 offset, i32 segment_base);
+
+// Decode everything reachable from the queued entry points.
+void cfg_explore(struct cfg *cfg);
+
+// Print the decoded instructions in address order with a label in front of every target, annotated
+// with their coverage if `annotation` is not null.
+void cfg_print_listing(struct cfg *cfg, FILE *out, struct annotation *annotation);
+
+// Print the basic blocks and the edges between them as a Graphviz DOT graph. Targets in the middle
+// of an instruction get a dashed node of their own.
+void cfg_print_dot(struct cfg *cfg, FILE *out);
+
+#endif // EES_DIS_CFG_H_
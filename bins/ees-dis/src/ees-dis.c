@@ -1,11 +1,21 @@
+#include "annotation.h"
+#include "cfg.h"
+
 #include <base/platform.h>
 #include <base/reader.h>
+#include <cpu/coverage.h>
 #include <decoder/decoder.h>
+#include <decoder/length.h>
 #include <disassembler/disassembler.h>
 #include <getopt.h>
+#include <loader/mz.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// Where ees-emu loads programs: the image follows the PSP at segment 0x0100.
+#define DEFAULT_PROGRAM_LOAD_ADDRESS 0x1100
+
 struct binary_data {
   u8 *data;
   unsigned data_size;
@@ -35,44 +45,36 @@ u8 binary_data_fetch(void *ctx, u32 pos) {
   return data->data[pos];
 }
 
-struct executable_header_mz {
-  u16 id;
-  u16 extra_bytes;
-  u16 pages;
-  u16 relocation_items;
-  u16 header_size;
-  u16 minimum_allocation;
-  u16 maximum_allocation;
-  u16 initial_ss;
-  u16 initial_sp;
-  u16 checksum;
-  u16 initial_ip;
-  u16 initial_cs;
-  u16 relocation_table;
-  u16 overlay;
-  u16 overlay_information;
-};
-
-static void parse_exe_mz(const u8 *data, size_t data_size) {
-  struct executable_header_mz *header = (struct executable_header_mz *)data;
-
-  u32 header_size = header->header_size * 16;
-  u32 extra_start = header->pages * 512 - (512 - header->extra_bytes);
-  u32 code_start = header_size;
-}
-
 void print_usage(const char *app_name) {
-  fprintf(stderr, "USAGE: %s <binary file>", app_name);
+  fprintf(stderr,
+          "USAGE: %s [-o <offset>] [-r <start>-<end>] [-c] [-g <dot file>] "
+          "[-x <coverage file> [-l <load address>]] <binary file>",
+          app_name);
 }
 
 struct options {
   char *filename;
   u32 offset;
+
+  // Only disassemble the instructions starting in [range_start, range_end). The instructions in
+  // front of the range are only measured to stay in sync with the instruction stream.
+  u32 range_start;
+  u32 range_end;
+
+  // Follow the flow of control from the entry point instead of sweeping linearly.
+  bool follow_flow;
+  // Write the control flow graph to this file in DOT format.
+  char *graph_filename;
+
+  // Annotate the listing with the coverage in this file, written by ees-emu for a program loaded at
+  // `load_address`. BIOS images are where they are.
+  char *coverage_filename;
+  u32 load_address;
 };
 
 int parse_options(struct options *options, int argc, char **argv) {
   int opt;
-  while ((opt = getopt(argc, argv, "o:")) != -1) {
+  while ((opt = getopt(argc, argv, "o:r:cg:x:l:")) != -1) {
     if (opt == 'o') {
       char *end;
       options->offset = strtol(optarg, &end, 10);
@@ -80,6 +82,36 @@ int parse_options(struct options *options, int argc, char **argv) {
         print_usage(argv[0]);
         return 1;
       }
+    } else if (opt == 'r') {
+      char *end;
+      options->range_start = strtol(optarg, &end, 0);
+      if (end == optarg || *end != '-') {
+        print_usage(argv[0]);
+        return 1;
+      }
+      char *range_end = end + 1;
+      options->range_end = strtol(range_end, &end, 0);
+      if (end == range_end || options->range_end <= options->range_start) {
+        print_usage(argv[0]);
+        return 1;
+      }
+    } else if (opt == 'c') {
+      options->follow_flow = true;
+    } else if (opt == 'g') {
+      options->follow_flow = true;
+      options->graph_filename = optarg;
+    } else if (opt == 'x') {
+      options->coverage_filename = optarg;
+    } else if (opt == 'l') {
+      char *end;
+      options->load_address = strtol(optarg, &end, 0);
+      if (end == optarg) {
+        print_usage(argv[0]);
+        return 1;
+      }
+    } else {
+      print_usage(argv[0]);
+      return 1;
     }
   }
 
@@ -97,6 +129,12 @@ int main(int argc, char *argv[]) {
   struct options options = {
       .filename = 0,
       .offset = 0,
+      .range_start = 0,
+      .range_end = 0,
+      .follow_flow = false,
+      .graph_filename = 0,
+      .coverage_filename = 0,
+      .load_address = DEFAULT_PROGRAM_LOAD_ADDRESS,
   };
   int result = parse_options(&options, argc, argv);
   if (result != 0) {
@@ -108,15 +146,22 @@ int main(int argc, char *argv[]) {
   struct reader reader;
   reader_init(&reader, &data, binary_data_fetch);
 
-  /* DOS MZ executable format. */
-  if (*(u16 *)data.data == 0x5a4d) {
-    struct executable_header_mz *header = (struct executable_header_mz *)data.data;
+  // Flat address the image is loaded at and the start of the entry point's segment in the image,
+  // used to follow the flow of control.
+  i32 image_base = 0;
+  i32 segment_base = 0;
+  u32 entry = options.offset;
+  bool bios = false;
 
-    u32 header_size = header->header_size * 16;
-    u32 code_start = header_size;
-    // u32 extra_start = header->pages * 512 - (512 - header->extra_bytes);
+  /* DOS MZ executable format. */
+  struct mz_image image;
+  if (mz_parse(&image, data.data, data.data_size)) {
+    options.offset += image.load_module_offset;
 
-    options.offset += code_start;
+    // Segments are relative to the start of the load module before relocation.
+    image_base = -(i32)image.load_module_offset;
+    segment_base = image.load_module_offset + image.header.initial_cs * 16;
+    entry = segment_base + image.header.initial_ip;
   }
 
   /* BIOS file */
@@ -127,18 +172,89 @@ int main(int argc, char *argv[]) {
     u32 offset_in_memory = flat - (0x100000 - data.data_size);
     options.offset = offset_in_memory;
     printf("Detected BIOS file, starting at: 0x%05x\n", offset_in_memory);
+
+    image_base = 0x100000 - data.data_size;
+    segment_base = (segment << 4) - image_base;
+    entry = offset_in_memory;
+    bios = true;
+  }
+
+  struct coverage *coverage = 0;
+  struct annotation annotation;
+  if (options.coverage_filename) {
+    coverage = malloc(sizeof(*coverage));
+    if (!coverage_load(coverage, options.coverage_filename)) {
+      fprintf(stderr, "Could not read coverage from %s\n", options.coverage_filename);
+      free(coverage);
+      return 1;
+    }
+    annotation_init(&annotation, coverage,
+                    bios ? image_base : (i64)options.load_address + image_base);
+  }
+
+  if (options.follow_flow) {
+    struct cfg cfg;
+    cfg_init(&cfg, data.data, data.data_size, image_base);
+    cfg_add_entry(&cfg, entry, segment_base);
+    cfg_explore(&cfg);
+
+    cfg_print_listing(&cfg, stdout, coverage ? &annotation : 0);
+    if (coverage) {
+      annotation_print_summary(&annotation, stdout);
+    }
+
+    if (options.graph_filename) {
+      FILE *graph = fopen(options.graph_filename, "w");
+      if (!graph) {
+        fprintf(stderr, "Could not open %s\n", options.graph_filename);
+        cfg_destroy(&cfg);
+        free(coverage);
+        return 1;
+      }
+      cfg_print_dot(&cfg, graph);
+      fclose(graph);
+    }
+
+    cfg_destroy(&cfg);
+    free(coverage);
+    return 0;
+  }
+
+  u32 end = data.data_size;
+  if (options.range_end) {
+    if (options.range_end < end) {
+      end = options.range_end;
+    }
+
+    while (options.offset < options.range_start) {
+      unsigned length = instruction_length(data.data + options.offset,
+                                           data.data_size - options.offset);
+      if (!length) {
+        break;
+      }
+      options.offset += length;
+    }
   }
 
   static char buffer[128];
   static size_t buffer_size = sizeof(buffer);
 
-  while (options.offset < data.data_size) {
+  while (options.offset < end) {
     struct instruction instruction;
     instruction_init(&instruction);
     decode_instruction(&reader, options.offset, &instruction);
     disassemble(buffer, buffer_size, &instruction, options.offset);
+    if (coverage) {
+      annotation_print(&annotation, stdout, &instruction, options.offset, buffer);
+    } else {
+      printf("%s\n", buffer);
+    }
     options.offset += instruction.instruction_size;
-    printf("%s\n", buffer);
+  }
+
+  if (coverage) {
+    annotation_print_summary(&annotation, stdout);
+    free(coverage);
   }
 
   return 0;
@@ -0,0 +1,59 @@
+#include <devices/disk_image.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Maintenance of overlay disks: every guest writes to its own overlay on top of a shared base
+// image, and the overlays are merged into a new image or committed into the base with this tool.
+
+void print_usage(const char *app_name) {
+  fprintf(stderr,
+          "USAGE: %s create <base image> <overlay>\n"
+          "       %s info <base image> <overlay>\n"
+          "       %s export <base image> <overlay> <output image>\n"
+          "       %s commit <base image> <overlay>\n",
+          app_name, app_name, app_name, app_name);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  const char *command = argv[1];
+  bool export = !strcmp(command, "export");
+  bool known = export || !strcmp(command, "create") || !strcmp(command, "info") ||
+               !strcmp(command, "commit");
+  if (!known || argc != (export ? 5 : 4)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  // Only a new overlay is created, the others must exist.
+  bool create = !strcmp(command, "create");
+  struct disk_image *image = disk_image_open_overlay(argv[2], argv[3], create);
+  if (!image) {
+    fprintf(stderr, "Could not open %s as an overlay of %s\n", argv[3], argv[2]);
+    return 1;
+  }
+
+  int result = 0;
+  if (create) {
+    // Opening the overlay creates it.
+  } else if (!strcmp(command, "info")) {
+    printf("%u sectors, %u written to the overlay in %u records\n", image->sector_count,
+           image->overlay_sectors, image->record_count);
+  } else if (export) {
+    if (!disk_image_export(image, argv[4])) {
+      fprintf(stderr, "Could not write %s\n", argv[4]);
+      result = 1;
+    }
+  } else if (!disk_image_commit(image)) {
+    fprintf(stderr, "Could not commit %s into %s\n", argv[3], argv[2]);
+    result = 1;
+  }
+
+  disk_image_close(image);
+  return result;
+}
@@ -1,9 +1,28 @@
 #include <base/address.h>
 #include <cpu/bus.h>
+#include <cpu/checkpoint.h>
+#include <cpu/coverage.h>
 #include <cpu/cpu.h>
 #include <cpu/ports.h>
+#include <cpu/replay.h>
+#include <devices/capture.h>
+#include <devices/disk_image.h>
+#include <devices/dma.h>
+#include <devices/fdc.h>
+#include <devices/input_script.h>
+#include <devices/pic.h>
+#include <devices/pit.h>
+#include <devices/ppi.h>
+#include <devices/video.h>
+#include <fcntl.h>
+#include <gdb/gdb_stub.h>
+#include <hle/bios.h>
+#include <hle/dos.h>
+#include <loader/loader.h>
 #include <malloc.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
@@ -11,6 +30,29 @@
 // 1Mb of memory
 #define DEFAULT_MEMORY_SIZE 0x100000
 
+// Programs are loaded where DOS would load them on a machine with nothing else resident.
+#define PROGRAM_PSP_SEGMENT 0x0100
+
+// Roughly one second of emulated time on a 4.77MHz machine.
+#define RUN_CYCLES 4772727
+
+// The screen is brought up to date 30 times per emulated second.
+#define VIDEO_REFRESH_CYCLES (RUN_CYCLES / 30)
+
+// State hashes are logged once per emulated second.
+#define REPLAY_HASH_CYCLES RUN_CYCLES
+
+// Memory checkpoints may take unless told otherwise.
+#define DEFAULT_CHECKPOINT_BUDGET_MIB 64
+
+// Switch block 1 of the XT: 640KiB, one floppy drive and CGA in 80 columns.
+#define PPI_SWITCHES 0x2c
+
+#define FDC_IRQ 6
+
+// Writes of the guest to this port capture the screen, as to the debug port of Bochs.
+#define CAPTURE_PORT 0xe9
+
 int kbhit(void) {
   static bool initflag = false;
   static const int STDIN = 0;
@@ -30,7 +72,219 @@ int kbhit(void) {
   return nbbytes;
 }
 
-int main() {
+static bool load_input_script(struct input_script *script, const char *filename) {
+  FILE *handle = fopen(filename, "rb");
+  if (!handle) {
+    fprintf(stderr, "Could not open %s\n", filename);
+    return false;
+  }
+
+  fseek(handle, 0, SEEK_END);
+  long file_size = ftell(handle);
+  fseek(handle, 0, SEEK_SET);
+
+  char *text = malloc(file_size + 1);
+  size_t bytes_read = fread(text, 1, file_size, handle);
+  text[bytes_read] = 0;
+  fclose(handle);
+
+  unsigned error_line;
+  bool parsed = input_script_parse(script, text, &error_line);
+  free(text);
+
+  if (!parsed) {
+    fprintf(stderr, "%s:%u: invalid input event\n", filename, error_line);
+  }
+  return parsed;
+}
+
+static bool load_program(struct bus *bus, struct cpu *cpu, const char *filename,
+                         const char *command_tail, struct loader_program *program) {
+  FILE *handle = fopen(filename, "rb");
+  if (!handle) {
+    fprintf(stderr, "Could not open %s\n", filename);
+    return false;
+  }
+
+  fseek(handle, 0, SEEK_END);
+  long file_size = ftell(handle);
+  fseek(handle, 0, SEEK_SET);
+
+  u8 *data = malloc(file_size);
+  size_t bytes_read = fread(data, 1, file_size, handle);
+  fclose(handle);
+
+  enum loader_result result =
+      loader_load(bus, data, bytes_read, PROGRAM_PSP_SEGMENT, command_tail, program);
+  free(data);
+
+  if (result != lr_ok) {
+    fprintf(stderr, "Could not load %s\n", filename);
+    return false;
+  }
+
+  loader_start(program, cpu);
+  return true;
+}
+
+// Stop recording or replaying, and tell whether the replay went like the recorded run.
+static void end_replay(struct replay *replay) {
+  if (!replay) {
+    return;
+  }
+
+  if (replay->mode == rm_replay) {
+    if (replay->diverged) {
+      fprintf(stderr, "Replay diverged at cycle %llu\n",
+              (unsigned long long)replay->divergence_cycles);
+    } else if (!replay->ended) {
+      fprintf(stderr, "Replay stopped before the end of the log\n");
+    }
+  }
+
+  replay_destroy(replay);
+}
+
+// Wait for a debugger on `address` and let it drive the machine, telling it when the program run
+// by `dos` exits if there is one. Return false if it killed the machine or could not connect.
+static bool debug_with_gdb(struct cpu *cpu, struct checkpoints *checkpoints, const struct dos *dos,
+                           const char *address) {
+  struct gdb_stub stub;
+  gdb_stub_init(&stub, cpu, checkpoints);
+  if (dos) {
+    gdb_stub_report_exit(&stub, &dos->terminated, &dos->exit_code);
+  }
+
+  fprintf(stderr, "Waiting for gdb on %s\n", address);
+  bool detached = gdb_stub_accept(&stub, address) && gdb_stub_serve(&stub);
+
+  gdb_stub_destroy(&stub);
+  return detached;
+}
+
+// Write the coverage collected during the run.
+static void end_coverage(struct coverage *coverage, const char *filename) {
+  if (!coverage) {
+    return;
+  }
+
+  if (!coverage_save(coverage, filename)) {
+    fprintf(stderr, "Could not write %s\n", filename);
+  }
+  free(coverage);
+}
+
+// Put the disk image at `filename` in drive A: of the floppy controller, either a raw image or a
+// base image and an existing overlay as `base:overlay`. Return null if it can not be used, with the
+// controller left empty.
+static struct disk_image *insert_floppy(struct fdc *fdc, const char *filename) {
+  struct disk_image *disk;
+  const char *overlay = strchr(filename, ':');
+  if (overlay) {
+    char *base = strndup(filename, overlay - filename);
+    disk = disk_image_open_overlay(base, overlay + 1, false);
+    free(base);
+  } else {
+    disk = disk_image_open(filename);
+  }
+  if (!disk) {
+    fprintf(stderr, "Could not open %s\n", filename);
+    return 0;
+  }
+
+  if (!fdc_insert_disk(fdc, 0, disk, false)) {
+    fprintf(stderr, "%s is not a floppy disk image\n", filename);
+    disk_image_close(disk);
+    return 0;
+  }
+
+  return disk;
+}
+
+// Write the screenshots still queued, if capturing.
+static void end_capture(struct capture *capture) {
+  if (!capture) {
+    return;
+  }
+
+  capture_destroy(capture);
+  if (capture->failed) {
+    fprintf(stderr, "Could not write %u screenshots\n", capture->failed);
+  }
+}
+
+// Wait for the floppy controller to finish and close its disk, if there is one.
+static void end_floppy(struct fdc *fdc, struct disk_image *disk) {
+  if (!disk) {
+    return;
+  }
+
+  fdc_destroy(fdc);
+  disk_image_close(disk);
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "Usage: %s [-i script] [-r log | -p log] [-c cycles [-m MiB]] [-g port|socket] "
+          "[-C coverage] [-d floppy image[:overlay]] [-S screenshot prefix] "
+          "[program [command tail]]\n",
+          name);
+}
+
+int main(int argc, char *argv[]) {
+  const char *script_file = 0;
+  const char *replay_file = 0;
+  enum replay_mode replay_mode = rm_record;
+  u64 checkpoint_interval = 0;
+  size_t checkpoint_budget_mib = DEFAULT_CHECKPOINT_BUDGET_MIB;
+  const char *gdb_address = 0;
+  const char *coverage_file = 0;
+  const char *floppy_file = 0;
+  const char *capture_prefix = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "i:r:p:c:m:g:C:d:S:")) != -1) {
+    switch (opt) {
+      case 'i':
+        script_file = optarg;
+        break;
+
+      case 'r':
+      case 'p':
+        replay_file = optarg;
+        replay_mode = opt == 'r' ? rm_record : rm_replay;
+        break;
+
+      case 'c':
+        checkpoint_interval = strtoull(optarg, 0, 0);
+        break;
+
+      case 'm':
+        checkpoint_budget_mib = strtoull(optarg, 0, 0);
+        break;
+
+      case 'g':
+        gdb_address = optarg;
+        break;
+
+      case 'C':
+        coverage_file = optarg;
+        break;
+
+      case 'd':
+        floppy_file = optarg;
+        break;
+
+      case 'S':
+        capture_prefix = optarg;
+        break;
+
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
   static struct address reset_vector = {
       .segment = 0xf000,
       .offset = 0xfff0,
@@ -47,6 +301,74 @@ int main() {
   struct cpu cpu;
   cpu_init(&cpu, ports, &bus, reset_vector);
 
+  struct pic pic;
+  pic_init(&pic, &cpu);
+
+  struct pit pit;
+  pit_init(&pit, &cpu);
+  pit_connect_irq(&pit, 0, pic_irq_line(&pic, 0));
+
+  // Recording logs all the inputs of the run, replaying feeds them back from the log.
+  struct replay replay_storage;
+  struct replay *replay = 0;
+  if (replay_file) {
+    if (!replay_init(&replay_storage, &cpu, replay_mode, replay_file)) {
+      fprintf(stderr, "Could not open %s\n", replay_file);
+      return 1;
+    }
+    replay = &replay_storage;
+    replay_hash_every(replay, REPLAY_HASH_CYCLES);
+  }
+
+  struct coverage *coverage = 0;
+  if (coverage_file) {
+    coverage = malloc(sizeof(*coverage));
+    coverage_init(coverage);
+    cpu.coverage = coverage;
+  }
+
+  if (optind < argc) {
+    // Run a DOS program directly, without booting the BIOS or DOS. DOS calls are serviced by the
+    // host, with the current directory as the program's drive.
+    struct loader_program program;
+    if (!load_program(&bus, &cpu, argv[optind], optind + 1 < argc ? argv[optind + 1] : 0,
+                      &program)) {
+      return 1;
+    }
+
+    int root_fd = open(".", O_RDONLY | O_DIRECTORY);
+
+    struct dos dos;
+    dos_init(&dos, &cpu, &program, root_fd, STDIN_FILENO, STDOUT_FILENO);
+
+    // Text the program writes through the BIOS goes to standard output as well. It is flushed after
+    // every batch, so it can come out of order with text written through DOS in the same batch.
+    static u8 video_output[0x1000];
+    struct bios bios;
+    bios_init(&bios, &cpu, bs_video, video_output, sizeof(video_output));
+
+    // A debugger that detaches lets the program run to its end.
+    bool killed = gdb_address && !debug_with_gdb(&cpu, 0, &dos, gdb_address);
+
+    while (!dos.terminated && !killed) {
+      cpu_run(&cpu, RUN_CYCLES);
+
+      fwrite(video_output, 1, bios.output_size, stdout);
+      fflush(stdout);
+      bios.output_size = 0;
+    }
+
+    end_replay(replay);
+    end_coverage(coverage, coverage_file);
+    bios_destroy(&bios);
+    dos_destroy(&dos);
+    close(root_fd);
+    free(memory);
+    free(ports);
+
+    return dos.exit_code;
+  }
+
   // const char *bios_file = "/home/tilo/Code/life-16/life.com";
   const char *bios_file = "/home/tilo/Code/Faux86/data/pcxtbios.bin";
 
@@ -58,7 +380,88 @@ int main() {
   fread(memory + DEFAULT_MEMORY_SIZE - file_size, file_size, 1, handle);
   fclose(handle);
 
-  bool running = true;
+  struct video video;
+  if (!video_init(&video, &cpu, va_cga)) {
+    fprintf(stderr, "Could not attach the video adapter\n");
+    return 1;
+  }
+  video_set_output(&video, stdout, vf_ansi, VIDEO_REFRESH_CYCLES);
+
+  // Screenshots are taken when the guest asks for them, or with a key when interactive.
+  struct capture capture_storage;
+  struct capture *capture = 0;
+  if (capture_prefix) {
+    if (!capture_init(&capture_storage, &video, capture_prefix, cf_png)) {
+      fprintf(stderr, "Could not start writing screenshots\n");
+      return 1;
+    }
+    capture = &capture_storage;
+    if (!capture_watch_port(capture, ports, CAPTURE_PORT)) {
+      fprintf(stderr, "Could not watch port %x for screenshots\n", CAPTURE_PORT);
+      return 1;
+    }
+  }
+
+  struct ppi ppi;
+  ppi_init(&ppi, &cpu, pic_irq_line(&pic, 1), &pit, PPI_SWITCHES);
+
+  // The floppy controller and its DMA controller are only there with a disk in drive A:.
+  struct dma dma;
+  struct fdc fdc;
+  struct disk_image *floppy = 0;
+  if (floppy_file) {
+    if (checkpoint_interval) {
+      fprintf(stderr, "Checkpoints can not be taken with a floppy disk inserted\n");
+      return 1;
+    }
+
+    dma_init(&dma, &cpu);
+    fdc_init(&fdc, &cpu, &dma, pic_irq_line(&pic, FDC_IRQ));
+    floppy = insert_floppy(&fdc, floppy_file);
+    if (!floppy) {
+      return 1;
+    }
+  }
+
+  if (script_file) {
+    // Type the script at the guest and run at full speed until it says to stop.
+    struct input_script script;
+    input_script_init(&script);
+    if (!load_input_script(&script, script_file)) {
+      return 1;
+    }
+
+    input_script_play(&script, &ppi);
+    while (!script.quit) {
+      cpu_run(&cpu, RUN_CYCLES);
+    }
+
+    end_replay(replay);
+    end_coverage(coverage, coverage_file);
+    end_floppy(&fdc, floppy);
+    end_capture(capture);
+    input_script_destroy(&script);
+    ppi_destroy(&ppi);
+    free(memory);
+    free(ports);
+
+    return 0;
+  }
+
+  // Interactively, checkpoints let the machine step back. They hold every device with state, but
+  // not the disk in the floppy drive, so none are taken while one is inserted.
+  struct checkpoints checkpoints;
+  checkpoints_init(&checkpoints, &cpu, checkpoint_interval, checkpoint_budget_mib << 20);
+  checkpoints_add_region(&checkpoints, &pic, sizeof(pic));
+  checkpoints_add_region(&checkpoints, &pit, sizeof(pit));
+  checkpoints_add_region(&checkpoints, &ppi, PPI_CHECKPOINT_SIZE);
+  checkpoints_add_region(&checkpoints, &video, sizeof(video));
+  video_follow_checkpoints(&video, &checkpoints);
+  if (checkpoint_interval) {
+    checkpoints_take(&checkpoints);
+  }
+
+  bool running = !gdb_address || debug_with_gdb(&cpu, floppy ? 0 : &checkpoints, 0, gdb_address);
   while (running) {
     while (!kbhit()) {
       usleep(100);
@@ -73,11 +476,49 @@ int main() {
         cpu_step(&cpu);
         break;
 
+      case 'r':
+        cpu_run(&cpu, RUN_CYCLES);
+        break;
+
+      case 'p':
+        if (capture) {
+          capture_now(capture);
+        }
+        break;
+
+      case 'b':
+        if (!checkpoints_step_back(&checkpoints)) {
+          printf("No checkpoint to go back to\n");
+        }
+        printf("%04x:%04x at cycle %llu\n", cpu.segs[CS], cpu.ip, (unsigned long long)cpu.cycles);
+        break;
+
+      case 'w': {
+        // Back to the last write to a flat address.
+        unsigned address;
+        printf("address: ");
+        fflush(stdout);
+        if (scanf("%x", &address) != 1) {
+          break;
+        }
+        if (!checkpoints_run_back_to_write(&checkpoints, address)) {
+          printf("No write to %05x since the oldest checkpoint\n", address);
+        }
+        printf("%04x:%04x at cycle %llu\n", cpu.segs[CS], cpu.ip, (unsigned long long)cpu.cycles);
+        break;
+      }
+
       default:
         break;
     }
   }
 
+  checkpoints_destroy(&checkpoints);
+  end_replay(replay);
+  end_coverage(coverage, coverage_file);
+  end_floppy(&fdc, floppy);
+  end_capture(capture);
+  ppi_destroy(&ppi);
   free(memory);
   free(ports);
 
@@ -2,31 +2,117 @@
 #define CPU_BUS_H_
 
 #include <base/platform.h>
+#include <stdbool.h>
 
-typedef void (*bus_listener_func)(u32 addr, u8 value, void *context);
+// Observers are indexed by 4KiB page, over the 1MiB address space and the area above it that
+// segment:offset addresses reach.
+#define BUS_PAGE_SHIFT 12
+#define BUS_PAGE_COUNT (0x110000 >> BUS_PAGE_SHIFT)
+#define BUS_ADDRESS_END (BUS_PAGE_COUNT << BUS_PAGE_SHIFT)
 
-struct bus_listener {
+// One bit per observer in the page index.
+#define BUS_OBSERVER_COUNT 16
+
+typedef void (*bus_observer_func)(u32 addr, u8 value, void *context);
+
+// Sees the fetches from and the stores to [start, end), either function can be null. Typically
+// memory mapped device memory, a watchpoint or a tool looking at the whole bus.
+struct bus_observer {
+  u32 start;
+  u32 end;
   void *context;
-  bus_listener_func fetch_func;
-  bus_listener_func store_func;
+  bus_observer_func fetch_func;
+  bus_observer_func store_func;
 };
 
 struct bus {
   byte *memory;
   u32 memory_size;
 
-  struct bus_listener listeners[8];
-  unsigned bus_listener_count;
+  struct bus_observer observers[BUS_OBSERVER_COUNT];
+  // The slots of `observers` in use.
+  u16 observer_slots;
+  // The slots of the observers that see the fetches and the stores of each page. Accesses to other
+  // pages only pay for the lookup.
+  u16 fetch_pages[BUS_PAGE_COUNT];
+  u16 store_pages[BUS_PAGE_COUNT];
+
+  // Pages written since the bits were last cleared. Checkpoints only copy these.
+  u64 dirty_pages[(BUS_PAGE_COUNT + 63) / 64];
 };
 
 void bus_init(struct bus *bus, byte *memory, u32 memory_size);
 
-void bus_add_listener(struct bus *bus, void *context, bus_listener_func fetch_func,
-                      bus_listener_func store_func);
+// Call `fetch_func` after every fetch from, and `store_func` after every store to, [start, end).
+// Return false if there are too many observers already.
+bool bus_add_observer(struct bus *bus, u32 start, u32 end, void *context,
+                      bus_observer_func fetch_func, bus_observer_func store_func);
+
+// Remove the observer added with the same `context` and functions. Return false if there is none.
+bool bus_remove_observer(struct bus *bus, void *context, bus_observer_func fetch_func,
+                         bus_observer_func store_func);
+
+static inline bool bus_add_store_observer(struct bus *bus, u32 start, u32 end, void *context,
+                                          bus_observer_func store_func) {
+  return bus_add_observer(bus, start, end, context, 0, store_func);
+}
+
+static inline bool bus_remove_store_observer(struct bus *bus, void *context,
+                                             bus_observer_func store_func) {
+  return bus_remove_observer(bus, context, 0, store_func);
+}
+
+static inline bool bus_add_fetch_observer(struct bus *bus, u32 start, u32 end, void *context,
+                                          bus_observer_func fetch_func) {
+  return bus_add_observer(bus, start, end, context, fetch_func, 0);
+}
+
+static inline bool bus_remove_fetch_observer(struct bus *bus, void *context,
+                                             bus_observer_func fetch_func) {
+  return bus_remove_observer(bus, context, fetch_func, 0);
+}
 
 byte bus_fetch_byte(struct bus *bus, u32 addr);
 void bus_store_byte(struct bus *bus, u32 addr, byte value);
 word bus_fetch_word(struct bus *bus, u32 addr);
 void bus_store_word(struct bus *bus, u32 addr, word b);
 
+// Record a write to [addr, addr + size) that did not go through `bus_store_byte`.
+static inline void bus_mark_dirty(struct bus *bus, u32 addr, u32 size) {
+  for (u32 page = addr >> BUS_PAGE_SHIFT; size && page <= (addr + size - 1) >> BUS_PAGE_SHIFT;
+       ++page) {
+    if (page < BUS_PAGE_COUNT) {
+      bus->dirty_pages[page / 64] |= 1ull << (page % 64);
+    }
+  }
+}
+
+// Return a pointer to the memory backing [addr, addr + size) if it can be accessed directly, i.e.
+// the range is inside memory and no observer has to see the accesses.
+// Returns 0 otherwise. Writes through the pointer must be reported with `bus_mark_dirty`, or be
+// made through `bus_plain_memory_for_store`.
+static inline byte *bus_plain_memory(struct bus *bus, u32 addr, u32 size) {
+  if (addr > bus->memory_size || size > bus->memory_size - addr) {
+    return 0;
+  }
+
+  if (bus->observer_slots && size) {
+    for (u32 page = addr >> BUS_PAGE_SHIFT; page <= (addr + size - 1) >> BUS_PAGE_SHIFT; ++page) {
+      if (page < BUS_PAGE_COUNT && (bus->fetch_pages[page] | bus->store_pages[page])) {
+        return 0;
+      }
+    }
+  }
+
+  return bus->memory + addr;
+}
+
+static inline byte *bus_plain_memory_for_store(struct bus *bus, u32 addr, u32 size) {
+  byte *memory = bus_plain_memory(bus, addr, size);
+  if (memory) {
+    bus_mark_dirty(bus, addr, size);
+  }
+  return memory;
+}
+
 #endif // CPU_BUS_H_
@@ -0,0 +1,91 @@
+#ifndef CPU_CHECKPOINT_H_
+#define CPU_CHECKPOINT_H_
+
+#include "cpu/cpu.h"
+
+#include <base/platform.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Checkpoints of the machine taken at regular intervals, to go back in time.
+//
+// A checkpoint holds the cpu with its scheduled events, the state of the devices that registered
+// it, and the memory pages written since the previous checkpoint, which the bus keeps track of.
+// The oldest checkpoint instead owns a full copy of memory. Going back restores the nearest
+// checkpoint before the target and runs forward from there. A replay log attached to the cpu is
+// rewound with it, so the guest sees the same inputs on the way as it did the first time.
+//
+// When the checkpoints take more memory than their budget, the oldest ones are merged into the
+// full copy.
+
+#define CHECKPOINT_MAX_REGIONS 8
+
+// Host memory holding the state of a device. It must not point to anything that changes.
+struct checkpoint_region {
+  void *data;
+  size_t size;
+};
+
+struct checkpoint {
+  struct cpu cpu;
+  // Deadlines of the events in the scheduler of `cpu`, in heap order.
+  u64 deadlines[SCHEDULER_MAX_EVENTS];
+  u8 *regions;
+  u64 replay_position;
+
+  // Pages written since the previous checkpoint, with their content at this one.
+  u32 *pages;
+  u8 *page_data;
+  u32 page_count;
+};
+
+struct checkpoints {
+  struct cpu *cpu;
+  u64 interval;
+  size_t budget;
+  size_t used;
+
+  struct checkpoint_region regions[CHECKPOINT_MAX_REGIONS];
+  unsigned region_count;
+  size_t regions_size;
+
+  // Oldest first.
+  struct checkpoint *list;
+  u32 count;
+  u32 capacity;
+  // Memory at the oldest checkpoint.
+  u8 *base;
+
+  struct scheduler_event event;
+  // Going back in time, which takes no checkpoints on the way.
+  bool travelling;
+  // Times the machine was brought back to a checkpoint, for devices to notice.
+  u64 restore_count;
+
+  // Looking for the last write to an address while running forward.
+  u64 instruction_start;
+  bool write_seen;
+  u64 write_cycles;
+};
+
+// Take a checkpoint every `interval` cycles, 0 for only when asked to. `budget` is in bytes and
+// counts the copy of memory.
+void checkpoints_init(struct checkpoints *checkpoints, struct cpu *cpu, u64 interval,
+                      size_t budget);
+void checkpoints_destroy(struct checkpoints *checkpoints);
+
+// Save and restore `size` bytes at `data` with the machine. Must be called before the first
+// checkpoint. Return false if there are too many regions.
+bool checkpoints_add_region(struct checkpoints *checkpoints, void *data, size_t size);
+
+void checkpoints_take(struct checkpoints *checkpoints);
+
+// Go back to the start of the previous instruction. Return false if there is no checkpoint before
+// it.
+bool checkpoints_step_back(struct checkpoints *checkpoints);
+
+// Go back to the last instruction that wrote to `address`, stopping before it executes. Return
+// false and leave the machine where it was if there was no such write since the oldest checkpoint.
+bool checkpoints_run_back_to_write(struct checkpoints *checkpoints, u32 address);
+
+#endif // CPU_CHECKPOINT_H_
@@ -0,0 +1,50 @@
+#ifndef CPU_COVERAGE_H_
+#define CPU_COVERAGE_H_
+
+#include "cpu/bus.h"
+
+#include <base/platform.h>
+#include <instructions/instructions.h>
+#include <stdbool.h>
+
+// Guest code coverage: which instructions the cpu executed and which ways its conditional branches
+// went, one bit per flat address in each bitmap.
+//
+// While coverage is attached to a cpu, the run loop looks at every instruction and sets a bit or
+// two for it. The bitmaps are saved to a file, stored in host byte order, which ees-dis annotates
+// its listings with.
+
+#define COVERAGE_MAGIC "EESCOV1"
+#define COVERAGE_WORDS (BUS_ADDRESS_END / 64)
+
+struct coverage {
+  // First byte of every executed instruction.
+  u64 executed[COVERAGE_WORDS];
+  // Conditional branches that jumped, and that fell through.
+  u64 taken[COVERAGE_WORDS];
+  u64 not_taken[COVERAGE_WORDS];
+};
+
+void coverage_init(struct coverage *coverage);
+
+static inline void coverage_mark(u64 *bits, u32 flat) {
+  if (flat < BUS_ADDRESS_END) {
+    bits[flat / 64] |= 1ull << (flat % 64);
+  }
+}
+
+static inline bool coverage_is_marked(const u64 *bits, u32 flat) {
+  return flat < BUS_ADDRESS_END && (bits[flat / 64] >> (flat % 64)) & 1;
+}
+
+// Conditional branches are the relative jumps that can fall through to the next instruction.
+static inline bool coverage_is_branch(const struct instruction *instruction) {
+  return instruction->destination.type == ot_jump && instruction->type != it_jmp &&
+         instruction->type != it_call;
+}
+
+// Return false if the file could not be written, or read and recognized.
+bool coverage_save(const struct coverage *coverage, const char *path);
+bool coverage_load(struct coverage *coverage, const char *path);
+
+#endif // CPU_COVERAGE_H_
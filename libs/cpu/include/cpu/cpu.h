@@ -4,13 +4,48 @@
 #include "cpu/bus.h"
 #include "cpu/flags.h"
 #include "cpu/ports.h"
+#include "cpu/scheduler.h"
 
 #include <base/address.h>
 #include <base/platform.h>
 #include <instructions/registers.h>
+#include <stdbool.h>
+
+// Acknowledge the pending interrupt request and return its vector, or -1 if the request went away.
+typedef int (*interrupt_ack_func)(void *context);
+
+// Breakpoints can be set at this many addresses at once.
+#define CPU_MAX_BREAKPOINTS 32
+
+struct coverage;
+struct cpu;
+struct replay;
+
+// Service a software interrupt natively instead of the guest's handler. Called by INT with IP
+// already past the instruction. Return false to vector through the interrupt vector table anyway.
+typedef bool (*interrupt_hook_func)(void *context, struct cpu *cpu, u8 vector);
+
+struct interrupt_hook {
+  void *context;
+  interrupt_hook_func func;
+};
+
+// Where a debugger wants the run loop to stop. Only instructions on pages holding a breakpoint are
+// looked up.
+struct cpu_debug {
+  u32 breakpoints[CPU_MAX_BREAKPOINTS];
+  unsigned breakpoint_count;
+  u64 breakpoint_pages[(BUS_PAGE_COUNT + 63) / 64];
+
+  // Watchpoints and the like that call `cpu_stop`. While there are any, the run loop checks for a
+  // stop after every instruction.
+  unsigned stopper_count;
+};
 
 union regs {
-  word word[register_16_count];
+  // The slot after the last register always holds 0. Effective addresses index it in place of a
+  // missing base or index register, see `indirect_memory_registers_table`.
+  word word[register_16_count + 1];
   byte byte[register_8_count];
 };
 
@@ -22,9 +57,58 @@ struct cpu {
   word segs[segment_register_count];
   word ip;
   union flags flags;
+
+  // Number of clock cycles executed since reset. Devices use this as their time base.
+  u64 cycles;
+  struct scheduler scheduler;
+
+  // Driven by the interrupt controller whenever its pending requests change. This is the only
+  // thing the run loop checks between instructions.
+  bool intr;
+  bool halted;
+
+  void *interrupt_controller;
+  interrupt_ack_func interrupt_ack;
+
+  struct interrupt_hook interrupt_hooks[0x100];
+
+  // Records or replays the port reads and interrupts, see "cpu/replay.h".
+  struct replay *replay;
+
+  // Attached by a debugger. When there is none, or it has nothing set, the run loop is unchanged.
+  struct cpu_debug *debug;
+  // Why `cpu_run` returned early.
+  bool stopped;
+
+  // Records the instructions executed and the branches taken, see "cpu/coverage.h".
+  struct coverage *coverage;
 };
 
 void cpu_init(struct cpu *cpu, struct ports *ports, struct bus *bus, struct address reset_vector);
+void cpu_set_interrupt_controller(struct cpu *cpu, void *context, interrupt_ack_func ack_func);
+
+// Intercept INT `vector` before it goes through the interrupt vector table. Hardware interrupts are
+// never intercepted. Passing a null `func` removes the hook.
+void cpu_set_interrupt_hook(struct cpu *cpu, u8 vector, void *context, interrupt_hook_func func);
+
+// Push FLAGS, CS and IP and transfer control through the interrupt vector table.
+void cpu_interrupt(struct cpu *cpu, u8 vector);
+
 void cpu_step(struct cpu *cpu);
 
+// Run for at least `cycles` clock cycles. Instructions are executed in uninterrupted batches up to
+// the next scheduled device event, so devices cost nothing between their deadlines.
+//
+// With breakpoints set in `debug`, the run stops before an instruction at a breakpoint, except for
+// the first one so that it can resume from there. `stopped` is then set.
+void cpu_run(struct cpu *cpu, u64 cycles);
+
+// Stop the run after the current instruction, if `debug` counts a stopper.
+void cpu_stop(struct cpu *cpu);
+
+// Return false if there are too many breakpoints. Setting one twice is fine.
+bool cpu_debug_add_breakpoint(struct cpu_debug *debug, u32 address);
+// Return false if there is no breakpoint at `address`.
+bool cpu_debug_remove_breakpoint(struct cpu_debug *debug, u32 address);
+
 #endif // CPU_CPU_H_
@@ -1,6 +1,8 @@
 #ifndef CPU_FLAGS_H_
 #define CPU_FLAGS_H_
 
+#include <base/platform.h>
+
 union flags {
   struct {
     byte carry;      // 0
@@ -19,4 +21,21 @@ union flags {
   byte flag[16];
 };
 
+// Pack the flags into the layout of the FLAGS register. The reserved bits read as 1 on the 8086.
+static inline word flags_to_word(const union flags *flags) {
+  word result = 0xf002;
+
+  for (unsigned i = 0; i < 12; ++i) {
+    result |= (flags->flag[i] ? 1 : 0) << i;
+  }
+
+  return result;
+}
+
+static inline void flags_from_word(union flags *flags, word value) {
+  for (unsigned i = 0; i < 12; ++i) {
+    flags->flag[i] = (value >> i) & 1;
+  }
+}
+
 #endif // CPU_FLAGS_H_
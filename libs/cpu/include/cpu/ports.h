@@ -4,26 +4,89 @@
 #include <base/platform.h>
 
 #define PORT_COUNT 0x10000
+#define PORT_RANGE_MAX 64
 
-typedef void (*port_out_func)(void *context, word address, byte value);
-typedef byte (*port_in_func)(void *context, word address);
+// Value read from a port that no device is mapped on.
+#define PORT_OPEN_BUS 0xff
 
-struct port {
-  void *context;
+// Port access functions receive the offset of the port from the start of the range it was mapped
+// with.
+typedef void (*port_out_func)(void *context, word offset, byte value);
+typedef byte (*port_in_func)(void *context, word offset);
+typedef void (*port_out_word_func)(void *context, word offset, word value);
+typedef word (*port_in_word_func)(void *context, word offset);
+
+struct port_handler {
   port_out_func out_func;
   port_in_func in_func;
+
+  // Optional. Word accesses are split into two byte accesses when a device does not provide these
+  // or when the word straddles two ranges.
+  port_out_word_func out_word_func;
+  port_in_word_func in_word_func;
+};
+
+struct port_range {
+  word start;
+  word end;
+  // Null for a range that was unmapped, whose slot can be reused.
+  const struct port_handler *handler;
+  void *context;
+
+  // For a port taken by `ports_intercept`, the index + 1 of the range it was taken from.
+  u8 intercepted;
 };
 
 struct ports {
-  struct port map[PORT_COUNT];
-  byte mem[PORT_COUNT];
+  struct port_range ranges[PORT_RANGE_MAX];
+  // Slots in use or freed, below the first one never used.
+  unsigned range_count;
+
+  // For every port the index + 1 of the range it belongs to, or 0 if nothing is mapped there.
+  u8 map[PORT_COUNT];
 };
 
 void ports_init(struct ports *ports);
-void ports_map_address(struct ports *ports, word start, word end, void *context,
-                       port_out_func out_func, port_in_func in_func);
 
-void ports_out(struct ports *ports, word address, byte value);
-byte ports_in(struct ports *ports, word address);
+// Map the inclusive range of ports [start, end] to the device. A range that directly follows a
+// range mapped with the same handler and context is merged into it, and offsets are then relative
+// to the start of the merged range. Ranges left without ports are freed. Returns 0 on success and
+// -1 if there is no room left.
+int ports_map_address(struct ports *ports, word start, word end,
+                      const struct port_handler *handler, void *context);
+
+// Return the range `port` belongs to, or null if nothing is mapped there.
+const struct port_range *ports_lookup(const struct ports *ports, word port);
+
+// Map `port` alone to the device, in front of the range it belonged to, which is copied to
+// `previous` for the device to forward the accesses to. Its handler is null if the port was
+// unmapped. Returns 0 on success and -1 if there is no room left.
+int ports_intercept(struct ports *ports, word port, const struct port_handler *handler,
+                    void *context, struct port_range *previous);
+
+// Unmap the inclusive range of ports [start, end]. Intercepted ports go back to the range they were
+// taken from, the others to nothing.
+void ports_unmap(struct ports *ports, word start, word end);
+
+static inline void ports_out(struct ports *ports, word address, byte value) {
+  u8 index = ports->map[address];
+  if (index) {
+    const struct port_range *range = &ports->ranges[index - 1];
+    range->handler->out_func(range->context, address - range->start, value);
+  }
+}
+
+static inline byte ports_in(struct ports *ports, word address) {
+  u8 index = ports->map[address];
+  if (index) {
+    const struct port_range *range = &ports->ranges[index - 1];
+    return range->handler->in_func(range->context, address - range->start);
+  }
+
+  return PORT_OPEN_BUS;
+}
+
+void ports_out_word(struct ports *ports, word address, word value);
+word ports_in_word(struct ports *ports, word address);
 
 #endif // CPU_PORTS_H_
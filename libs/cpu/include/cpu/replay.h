@@ -0,0 +1,104 @@
+#ifndef CPU_REPLAY_H_
+#define CPU_REPLAY_H_
+
+#include "cpu/cpu.h"
+
+#include <base/platform.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Record and replay of everything the machine takes from outside of itself.
+//
+// Recording logs every input as it is consumed: port reads, interrupts taken by the cpu and host
+// sources such as the clock or the console. Each input is tagged with the cpu cycle it happened
+// at, which identifies a point in the execution as well as an instruction count would, since
+// every instruction takes at least one cycle. Replaying feeds the logged values back in the same
+// order, so a run with the same program, disks and devices goes exactly the same way without its
+// host.
+//
+// Hashes of the machine state can be logged at regular intervals. A replay compares them and stops
+// feeding inputs at the first difference, which is reported in `divergence_cycles`.
+
+#define REPLAY_MAGIC "EESRPL1"
+
+// Set in the detail of word port reads.
+#define REPLAY_WORD_PORT 0x10000
+
+enum replay_mode {
+  rm_record,
+  rm_replay,
+};
+
+enum replay_input {
+  ri_port,
+  ri_interrupt,
+  ri_state_hash,
+  ri_host_time,
+  ri_console_ready,
+  ri_console_read,
+};
+
+// One input in the log, stored in host byte order.
+struct replay_record {
+  u64 cycles;
+  u32 input;
+  // Port number for port reads, vector of interrupts.
+  u32 detail;
+  u64 value;
+};
+
+struct replay {
+  struct cpu *cpu;
+  enum replay_mode mode;
+  FILE *file;
+  u64 record_count;
+
+  // Next record to replay.
+  struct replay_record next;
+  bool ended;
+  // Replaying a log this run recorded after going back in time. Recording resumes at its end.
+  bool resume_recording;
+
+  bool diverged;
+  u64 divergence_cycles;
+
+  struct scheduler_event hash_event;
+  u64 hash_interval;
+};
+
+// Start recording to or replaying from the log at `path`, for all the inputs of `cpu`. Return
+// false if the log can not be opened or is not a replay log.
+bool replay_init(struct replay *replay, struct cpu *cpu, enum replay_mode mode, const char *path);
+
+// Same with an open log, which is closed by `replay_destroy`. Recording needs it readable as well
+// to go back in time.
+bool replay_init_file(struct replay *replay, struct cpu *cpu, enum replay_mode mode, FILE *file);
+
+// Write the rest of the log and detach from the cpu.
+void replay_destroy(struct replay *replay);
+
+// Number of inputs recorded or replayed so far, the position in the log.
+static inline u64 replay_position(const struct replay *replay) {
+  return replay->record_count;
+}
+
+// Go back to `position` after the machine went back to the state it was in there. The inputs are
+// then replayed from the log, and when recording, recording goes on once the end is reached.
+void replay_seek(struct replay *replay, u64 position);
+
+// Log the state hash every `interval` cycles, or check it against the log when replaying.
+void replay_hash_every(struct replay *replay, u64 interval);
+
+// When replaying, store the logged value of the input happening now and return true. Return false
+// when recording, or when the next logged input is a different one. Inputs that must not be taken
+// from the host during a replay are read with this first, then passed to `replay_input`.
+bool replay_fetch(struct replay *replay, enum replay_input input, u32 detail, u64 *value);
+
+// Return the value of the input happening now: when recording `value`, which is logged, and when
+// replaying the logged value.
+u64 replay_input(struct replay *replay, enum replay_input input, u32 detail, u64 value);
+
+// Hash of the registers, the cycle count and the memory.
+u64 replay_state_hash(const struct cpu *cpu);
+
+#endif // CPU_REPLAY_H_
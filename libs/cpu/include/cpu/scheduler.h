@@ -0,0 +1,48 @@
+#ifndef CPU_SCHEDULER_H_
+#define CPU_SCHEDULER_H_
+
+#include <base/platform.h>
+
+#define SCHEDULER_MAX_EVENTS 32
+#define SCHEDULER_NEVER ((u64)-1)
+
+typedef void (*scheduler_event_func)(void *context, u64 deadline);
+
+// Events are owned by the device that schedules them, the scheduler only keeps pointers to them
+// in a binary min-heap ordered by deadline.
+struct scheduler_event {
+  u64 deadline;
+  scheduler_event_func func;
+  void *context;
+
+  // Position in the heap, or -1 if the event is not scheduled.
+  int heap_index;
+};
+
+struct scheduler {
+  struct scheduler_event *heap[SCHEDULER_MAX_EVENTS];
+  unsigned event_count;
+};
+
+void scheduler_init(struct scheduler *scheduler);
+
+void scheduler_event_init(struct scheduler_event *event, scheduler_event_func func, void *context);
+
+// Schedule the event to fire at `deadline` (in CPU cycles). If the event is already scheduled it
+// is moved to the new deadline.
+void scheduler_schedule(struct scheduler *scheduler, struct scheduler_event *event, u64 deadline);
+void scheduler_cancel(struct scheduler *scheduler, struct scheduler_event *event);
+
+// Fire all the events with a deadline at or before `now`, in deadline order. Event functions may
+// schedule events again, including themselves.
+void scheduler_run_due(struct scheduler *scheduler, u64 now);
+
+static inline u64 scheduler_next_deadline(const struct scheduler *scheduler) {
+  return scheduler->event_count ? scheduler->heap[0]->deadline : SCHEDULER_NEVER;
+}
+
+static inline int scheduler_event_is_scheduled(const struct scheduler_event *event) {
+  return event->heap_index >= 0;
+}
+
+#endif // CPU_SCHEDULER_H_
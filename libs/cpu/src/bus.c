@@ -9,20 +9,77 @@ void bus_init(struct bus *bus, byte *memory, u32 memory_size) {
   bus->memory_size = memory_size;
 }
 
-void bus_add_listener(struct bus *bus, void *context, bus_listener_func fetch_func,
-                      bus_listener_func store_func) {
-  struct bus_listener *listener = &bus->listeners[bus->bus_listener_count++];
+// Set or clear the bit of `slot` in the index of the pages [start, end).
+static void bus_index_observer(struct bus *bus, unsigned slot, bool set) {
+  const struct bus_observer *observer = &bus->observers[slot];
+  u16 bit = (u16)(1u << slot);
 
-  listener->context = context;
-  listener->fetch_func = fetch_func;
-  listener->store_func = store_func;
+  u32 last_page = (observer->end - 1) >> BUS_PAGE_SHIFT;
+  for (u32 page = observer->start >> BUS_PAGE_SHIFT; page <= last_page && page < BUS_PAGE_COUNT;
+       ++page) {
+    if (observer->fetch_func) {
+      bus->fetch_pages[page] = set ? bus->fetch_pages[page] | bit : bus->fetch_pages[page] & ~bit;
+    }
+    if (observer->store_func) {
+      bus->store_pages[page] = set ? bus->store_pages[page] | bit : bus->store_pages[page] & ~bit;
+    }
+  }
+}
+
+bool bus_add_observer(struct bus *bus, u32 start, u32 end, void *context,
+                      bus_observer_func fetch_func, bus_observer_func store_func) {
+  if (start >= end || (!fetch_func && !store_func)) {
+    return false;
+  }
+
+  for (unsigned slot = 0; slot < BUS_OBSERVER_COUNT; ++slot) {
+    if (bus->observer_slots & (1u << slot)) {
+      continue;
+    }
+
+    struct bus_observer *observer = &bus->observers[slot];
+    observer->start = start;
+    observer->end = end;
+    observer->context = context;
+    observer->fetch_func = fetch_func;
+    observer->store_func = store_func;
+
+    bus->observer_slots |= (u16)(1u << slot);
+    bus_index_observer(bus, slot, true);
+    return true;
+  }
+
+  return false;
+}
+
+bool bus_remove_observer(struct bus *bus, void *context, bus_observer_func fetch_func,
+                         bus_observer_func store_func) {
+  for (unsigned slot = 0; slot < BUS_OBSERVER_COUNT; ++slot) {
+    const struct bus_observer *observer = &bus->observers[slot];
+    if (!(bus->observer_slots & (1u << slot)) || observer->context != context ||
+        observer->fetch_func != fetch_func || observer->store_func != store_func) {
+      continue;
+    }
+
+    bus_index_observer(bus, slot, false);
+    bus->observer_slots &= (u16) ~(1u << slot);
+    return true;
+  }
+
+  return false;
 }
 
 byte bus_fetch_byte(struct bus *bus, u32 addr) {
   byte value = bus->memory[addr];
 
-  for (unsigned i = 0; i < bus->bus_listener_count; ++i) {
-    bus->listeners[i].fetch_func(addr, value, bus->listeners[i].context);
+  u32 page = addr >> BUS_PAGE_SHIFT;
+  if (page < BUS_PAGE_COUNT && bus->fetch_pages[page]) {
+    for (u16 slots = bus->fetch_pages[page]; slots; slots &= slots - 1) {
+      const struct bus_observer *observer = &bus->observers[__builtin_ctz(slots)];
+      if (addr >= observer->start && addr < observer->end) {
+        observer->fetch_func(addr, value, observer->context);
+      }
+    }
   }
 
   return value;
@@ -31,16 +88,24 @@ byte bus_fetch_byte(struct bus *bus, u32 addr) {
 void bus_store_byte(struct bus *bus, u32 addr, byte value) {
   bus->memory[addr] = value;
 
-  for (unsigned i = 0; i < bus->bus_listener_count; ++i) {
-    bus->listeners[i].store_func(addr, value, bus->listeners[i].context);
+  u32 page = addr >> BUS_PAGE_SHIFT;
+  if (page < BUS_PAGE_COUNT) {
+    bus->dirty_pages[page / 64] |= 1ull << (page % 64);
+
+    for (u16 slots = bus->store_pages[page]; slots; slots &= slots - 1) {
+      const struct bus_observer *observer = &bus->observers[__builtin_ctz(slots)];
+      if (addr >= observer->start && addr < observer->end) {
+        observer->store_func(addr, value, observer->context);
+      }
+    }
   }
 }
 
 word bus_fetch_word(struct bus *bus, u32 addr) {
-  return bus_fetch_byte(bus, addr) | (bus_fetch_byte(bus, addr) << 8);
+  return bus_fetch_byte(bus, addr) | (bus_fetch_byte(bus, addr + 1) << 8);
 }
 
 void bus_store_word(struct bus *bus, u32 addr, word value) {
   bus_store_byte(bus, addr, value);
-  bus_store_byte(bus, addr, value >> 8);
+  bus_store_byte(bus, addr + 1, value >> 8);
 }
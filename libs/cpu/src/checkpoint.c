@@ -0,0 +1,375 @@
+#include "cpu/checkpoint.h"
+
+#include "cpu/replay.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECKPOINT_PAGE_SIZE (1u << BUS_PAGE_SHIFT)
+#define CHECKPOINT_DIRTY_WORDS ((BUS_PAGE_COUNT + 63) / 64)
+
+static u32 memory_page_count(const struct bus *bus) {
+  u32 count = (bus->memory_size + CHECKPOINT_PAGE_SIZE - 1) >> BUS_PAGE_SHIFT;
+  return count < BUS_PAGE_COUNT ? count : BUS_PAGE_COUNT;
+}
+
+// Bytes of memory in `page`, the last one can be partial.
+static u32 page_size(const struct bus *bus, u32 page) {
+  u32 start = page << BUS_PAGE_SHIFT;
+  return bus->memory_size - start < CHECKPOINT_PAGE_SIZE ? bus->memory_size - start
+                                                         : CHECKPOINT_PAGE_SIZE;
+}
+
+static bool page_is_set(const u64 *bits, u32 page) {
+  return bits[page / 64] & (1ull << (page % 64));
+}
+
+static size_t checkpoint_size(const struct checkpoints *checkpoints,
+                              const struct checkpoint *checkpoint) {
+  return sizeof(*checkpoint) + checkpoints->regions_size +
+         checkpoint->page_count * (sizeof(u32) + CHECKPOINT_PAGE_SIZE);
+}
+
+static void checkpoint_free_pages(struct checkpoints *checkpoints, struct checkpoint *checkpoint) {
+  checkpoints->used -= checkpoint->page_count * (sizeof(u32) + CHECKPOINT_PAGE_SIZE);
+
+  free(checkpoint->pages);
+  free(checkpoint->page_data);
+  checkpoint->pages = 0;
+  checkpoint->page_data = 0;
+  checkpoint->page_count = 0;
+}
+
+static void checkpoint_free(struct checkpoints *checkpoints, struct checkpoint *checkpoint) {
+  checkpoint_free_pages(checkpoints, checkpoint);
+  checkpoints->used -= sizeof(*checkpoint) + checkpoints->regions_size;
+  free(checkpoint->regions);
+}
+
+// Drop the oldest checkpoint. The next one becomes the oldest, so its pages go into the copy of
+// memory.
+static void checkpoints_evict(struct checkpoints *checkpoints) {
+  assert(checkpoints->count > 1);
+
+  struct checkpoint *next = &checkpoints->list[1];
+  for (u32 i = 0; i < next->page_count; ++i) {
+    u32 page = next->pages[i];
+    memcpy(checkpoints->base + (page << BUS_PAGE_SHIFT),
+           next->page_data + (size_t)i * CHECKPOINT_PAGE_SIZE,
+           page_size(checkpoints->cpu->bus, page));
+  }
+  checkpoint_free_pages(checkpoints, next);
+
+  checkpoint_free(checkpoints, &checkpoints->list[0]);
+  memmove(checkpoints->list, checkpoints->list + 1,
+          --checkpoints->count * sizeof(*checkpoints->list));
+}
+
+static void checkpoints_event(void *context, u64 deadline) {
+  struct checkpoints *checkpoints = context;
+
+  // Scheduled again first, so that the checkpoint has the event scheduled.
+  scheduler_schedule(&checkpoints->cpu->scheduler, &checkpoints->event,
+                     deadline + checkpoints->interval);
+
+  if (!checkpoints->travelling) {
+    checkpoints_take(checkpoints);
+  }
+}
+
+void checkpoints_init(struct checkpoints *checkpoints, struct cpu *cpu, u64 interval,
+                      size_t budget) {
+  memset(checkpoints, 0, sizeof(*checkpoints));
+
+  checkpoints->cpu = cpu;
+  checkpoints->interval = interval;
+  checkpoints->budget = budget;
+
+  scheduler_event_init(&checkpoints->event, checkpoints_event, checkpoints);
+  if (interval) {
+    scheduler_schedule(&cpu->scheduler, &checkpoints->event, cpu->cycles + interval);
+  }
+}
+
+void checkpoints_destroy(struct checkpoints *checkpoints) {
+  scheduler_cancel(&checkpoints->cpu->scheduler, &checkpoints->event);
+
+  for (u32 i = 0; i < checkpoints->count; ++i) {
+    checkpoint_free(checkpoints, &checkpoints->list[i]);
+  }
+  free(checkpoints->list);
+  free(checkpoints->base);
+}
+
+bool checkpoints_add_region(struct checkpoints *checkpoints, void *data, size_t size) {
+  assert(!checkpoints->count);
+
+  if (checkpoints->region_count == CHECKPOINT_MAX_REGIONS) {
+    return false;
+  }
+
+  struct checkpoint_region *region = &checkpoints->regions[checkpoints->region_count++];
+  region->data = data;
+  region->size = size;
+  checkpoints->regions_size += size;
+
+  return true;
+}
+
+void checkpoints_take(struct checkpoints *checkpoints) {
+  struct cpu *cpu = checkpoints->cpu;
+  struct bus *bus = cpu->bus;
+
+  if (checkpoints->count && checkpoints->list[checkpoints->count - 1].cpu.cycles == cpu->cycles) {
+    return;
+  }
+
+  if (checkpoints->count == checkpoints->capacity) {
+    checkpoints->capacity = checkpoints->capacity ? checkpoints->capacity * 2 : 16;
+    checkpoints->list =
+        realloc(checkpoints->list, checkpoints->capacity * sizeof(*checkpoints->list));
+  }
+
+  struct checkpoint *checkpoint = &checkpoints->list[checkpoints->count++];
+  memset(checkpoint, 0, sizeof(*checkpoint));
+
+  checkpoint->cpu = *cpu;
+  for (unsigned i = 0; i < cpu->scheduler.event_count; ++i) {
+    checkpoint->deadlines[i] = cpu->scheduler.heap[i]->deadline;
+  }
+
+  checkpoint->regions = malloc(checkpoints->regions_size);
+  u8 *position = checkpoint->regions;
+  for (unsigned i = 0; i < checkpoints->region_count; ++i) {
+    memcpy(position, checkpoints->regions[i].data, checkpoints->regions[i].size);
+    position += checkpoints->regions[i].size;
+  }
+
+  checkpoint->replay_position = cpu->replay ? replay_position(cpu->replay) : 0;
+
+  u32 page_count = memory_page_count(bus);
+  if (checkpoints->count == 1) {
+    if (!checkpoints->base) {
+      checkpoints->base = malloc(bus->memory_size);
+      checkpoints->used += bus->memory_size;
+    }
+    memcpy(checkpoints->base, bus->memory, bus->memory_size);
+  } else {
+    for (u32 page = 0; page < page_count; ++page) {
+      checkpoint->page_count += page_is_set(bus->dirty_pages, page);
+    }
+
+    checkpoint->pages = malloc(checkpoint->page_count * sizeof(u32));
+    checkpoint->page_data = malloc((size_t)checkpoint->page_count * CHECKPOINT_PAGE_SIZE);
+
+    u32 index = 0;
+    for (u32 page = 0; page < page_count; ++page) {
+      if (page_is_set(bus->dirty_pages, page)) {
+        checkpoint->pages[index] = page;
+        memcpy(checkpoint->page_data + (size_t)index * CHECKPOINT_PAGE_SIZE,
+               bus->memory + (page << BUS_PAGE_SHIFT), page_size(bus, page));
+        ++index;
+      }
+    }
+  }
+
+  memset(bus->dirty_pages, 0, sizeof(bus->dirty_pages));
+  checkpoints->used += checkpoint_size(checkpoints, checkpoint);
+
+  while (checkpoints->used > checkpoints->budget && checkpoints->count > 1) {
+    checkpoints_evict(checkpoints);
+  }
+}
+
+// Bring the machine back to the checkpoint at `index`. The later ones are kept, the machine can be
+// brought back to them as well until they are forgotten.
+static void checkpoints_restore(struct checkpoints *checkpoints, u32 index) {
+  struct cpu *cpu = checkpoints->cpu;
+  struct bus *bus = cpu->bus;
+  struct checkpoint *checkpoint = &checkpoints->list[index];
+
+  // Pages written since the newest checkpoint, or between this one and the newest.
+  u64 changed[CHECKPOINT_DIRTY_WORDS];
+  memcpy(changed, bus->dirty_pages, sizeof(changed));
+  for (u32 i = index + 1; i < checkpoints->count; ++i) {
+    const struct checkpoint *later = &checkpoints->list[i];
+    for (u32 j = 0; j < later->page_count; ++j) {
+      changed[later->pages[j] / 64] |= 1ull << (later->pages[j] % 64);
+    }
+  }
+
+  // Their content at this checkpoint is the most recent copy up to it.
+  u32 page_count = memory_page_count(bus);
+  for (u32 page = 0; page < page_count; ++page) {
+    if (page_is_set(changed, page)) {
+      memcpy(bus->memory + (page << BUS_PAGE_SHIFT), checkpoints->base + (page << BUS_PAGE_SHIFT),
+             page_size(bus, page));
+    }
+  }
+  for (u32 i = 1; i <= index; ++i) {
+    const struct checkpoint *earlier = &checkpoints->list[i];
+    for (u32 j = 0; j < earlier->page_count; ++j) {
+      u32 page = earlier->pages[j];
+      if (page_is_set(changed, page)) {
+        memcpy(bus->memory + (page << BUS_PAGE_SHIFT),
+               earlier->page_data + (size_t)j * CHECKPOINT_PAGE_SIZE, page_size(bus, page));
+      }
+    }
+  }
+  memset(bus->dirty_pages, 0, sizeof(bus->dirty_pages));
+  ++checkpoints->restore_count;
+
+  // Events scheduled now are unscheduled, the heap of the checkpoint then points back to its own.
+  struct scheduler *scheduler = &cpu->scheduler;
+  for (unsigned i = 0; i < scheduler->event_count; ++i) {
+    scheduler->heap[i]->heap_index = -1;
+  }
+
+  const u8 *position = checkpoint->regions;
+  for (unsigned i = 0; i < checkpoints->region_count; ++i) {
+    memcpy(checkpoints->regions[i].data, position, checkpoints->regions[i].size);
+    position += checkpoints->regions[i].size;
+  }
+
+  struct replay *replay = cpu->replay;
+  struct cpu_debug *debug = cpu->debug;
+  struct coverage *coverage = cpu->coverage;
+  *cpu = checkpoint->cpu;
+  cpu->replay = replay;
+  cpu->debug = debug;
+  cpu->coverage = coverage;
+
+  for (unsigned i = 0; i < scheduler->event_count; ++i) {
+    scheduler->heap[i]->heap_index = (int)i;
+    scheduler->heap[i]->deadline = checkpoint->deadlines[i];
+  }
+
+  if (replay) {
+    replay_seek(replay, checkpoint->replay_position);
+  }
+
+  // A checkpoint taken by its event can have other events due at the same time, which had yet to
+  // fire.
+  scheduler_run_due(scheduler, cpu->cycles);
+}
+
+// Drop the checkpoints after the one at `index`, which the machine was brought back to. Pages are
+// then written relative to it.
+static void checkpoints_forget_after(struct checkpoints *checkpoints, u32 index) {
+  while (checkpoints->count > index + 1) {
+    checkpoint_free(checkpoints, &checkpoints->list[--checkpoints->count]);
+  }
+}
+
+// Index of the newest checkpoint before `cycles`, or -1.
+static int checkpoints_find(const struct checkpoints *checkpoints, u64 cycles) {
+  int index = (int)checkpoints->count - 1;
+  while (index >= 0 && checkpoints->list[index].cpu.cycles >= cycles) {
+    --index;
+  }
+  return index;
+}
+
+// Execute one instruction, or wait for the next event while halted, without going past `limit`.
+static void checkpoints_step(struct checkpoints *checkpoints, u64 limit) {
+  struct cpu *cpu = checkpoints->cpu;
+
+  checkpoints->instruction_start = cpu->cycles;
+
+  u64 cycles = 1;
+  if (cpu->halted) {
+    u64 next = scheduler_next_deadline(&cpu->scheduler);
+    cycles = (next < limit ? next : limit) - cpu->cycles;
+  }
+
+  // Breakpoints were already seen on the way the first time.
+  struct cpu_debug *debug = cpu->debug;
+  cpu->debug = 0;
+  cpu_run(cpu, cycles);
+  cpu->debug = debug;
+}
+
+static void checkpoints_run_to(struct checkpoints *checkpoints, u64 cycles) {
+  while (checkpoints->cpu->cycles < cycles) {
+    checkpoints_step(checkpoints, cycles);
+  }
+}
+
+bool checkpoints_step_back(struct checkpoints *checkpoints) {
+  struct cpu *cpu = checkpoints->cpu;
+  u64 now = cpu->cycles;
+
+  int index = checkpoints_find(checkpoints, now);
+  if (index < 0) {
+    return false;
+  }
+
+  checkpoints->travelling = true;
+
+  // Find where the last instruction started, then run up to there.
+  checkpoints_restore(checkpoints, index);
+  u64 previous = cpu->cycles;
+  while (cpu->cycles < now) {
+    checkpoints_step(checkpoints, now);
+    previous = checkpoints->instruction_start;
+  }
+
+  checkpoints_restore(checkpoints, index);
+  checkpoints_forget_after(checkpoints, index);
+  checkpoints_run_to(checkpoints, previous);
+
+  checkpoints->travelling = false;
+  return true;
+}
+
+static void checkpoints_write_seen(u32 addr, u8 value, void *context) {
+  UNUSED(addr);
+  UNUSED(value);
+
+  struct checkpoints *checkpoints = context;
+  checkpoints->write_seen = true;
+  checkpoints->write_cycles = checkpoints->instruction_start;
+}
+
+bool checkpoints_run_back_to_write(struct checkpoints *checkpoints, u32 address) {
+  struct cpu *cpu = checkpoints->cpu;
+
+  int index = checkpoints_find(checkpoints, cpu->cycles);
+  if (index < 0 || !bus_add_store_observer(cpu->bus, address, address + 1, checkpoints,
+                                           checkpoints_write_seen)) {
+    return false;
+  }
+
+  checkpoints->travelling = true;
+
+  // Search the intervals between checkpoints from the newest, the last write in an interval is
+  // the one that is looked for.
+  u64 now = cpu->cycles;
+  u64 end = now;
+  bool found = false;
+  for (; index >= 0 && !found; --index) {
+    checkpoints_restore(checkpoints, index);
+
+    checkpoints->write_seen = false;
+    checkpoints_run_to(checkpoints, end);
+    found = checkpoints->write_seen;
+
+    end = checkpoints->list[index].cpu.cycles;
+  }
+
+  bus_remove_store_observer(cpu->bus, checkpoints, checkpoints_write_seen);
+
+  if (found) {
+    checkpoints_restore(checkpoints, index + 1);
+    checkpoints_forget_after(checkpoints, index + 1);
+    checkpoints_run_to(checkpoints, checkpoints->write_cycles);
+  } else {
+    // Back to where the search started, from the newest checkpoint.
+    checkpoints_restore(checkpoints, checkpoints->count - 1);
+    checkpoints_run_to(checkpoints, now);
+  }
+
+  checkpoints->travelling = false;
+  return found;
+}
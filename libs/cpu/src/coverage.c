@@ -0,0 +1,33 @@
+#include "cpu/coverage.h"
+
+#include <stdio.h>
+#include <string.h>
+
+void coverage_init(struct coverage *coverage) {
+  memset(coverage, 0, sizeof(*coverage));
+}
+
+bool coverage_save(const struct coverage *coverage, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    return false;
+  }
+
+  bool written = fwrite(COVERAGE_MAGIC, sizeof(COVERAGE_MAGIC), 1, file) == 1 &&
+                 fwrite(coverage, sizeof(*coverage), 1, file) == 1;
+  return fclose(file) == 0 && written;
+}
+
+bool coverage_load(struct coverage *coverage, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+
+  char magic[sizeof(COVERAGE_MAGIC)];
+  bool read = fread(magic, sizeof(magic), 1, file) == 1 &&
+              !memcmp(magic, COVERAGE_MAGIC, sizeof(magic)) &&
+              fread(coverage, sizeof(*coverage), 1, file) == 1;
+  fclose(file);
+  return read;
+}
@@ -1,5 +1,7 @@
 #include "cpu/cpu.h"
 
+#include "cpu/coverage.h"
+#include "cpu/replay.h"
 #include "instr_map.h"
 
 #include <assert.h>
@@ -9,6 +11,10 @@
 #include <stdio.h>
 #include <string.h>
 
+// There is no per-instruction timing table yet, so every instruction is charged the 4 clocks the
+// 8088 needs to fetch each of its bytes.
+#define CYCLES_PER_INSTRUCTION_BYTE 4
+
 static void cpu_exec(struct cpu *cpu, struct instruction *instruction) {
   struct instr_mapping *mapping = &instr_map[instruction->type];
 
@@ -20,6 +26,15 @@ static void cpu_exec(struct cpu *cpu, struct instruction *instruction) {
   mapping->exec_func(cpu, instruction);
 }
 
+// Record `instruction` at `flat` as executed, and which way it branches, before it executes.
+static void cpu_cover(struct cpu *cpu, const struct instruction *instruction, u32 flat) {
+  coverage_mark(cpu->coverage->executed, flat);
+  if (coverage_is_branch(instruction)) {
+    coverage_mark(branch_taken(cpu, instruction) ? cpu->coverage->taken : cpu->coverage->not_taken,
+                  flat);
+  }
+}
+
 void cpu_init(struct cpu *cpu, struct ports *ports, struct bus *bus, struct address reset_vector) {
   memset(cpu, 0, sizeof(*cpu));
 
@@ -28,6 +43,37 @@ void cpu_init(struct cpu *cpu, struct ports *ports, struct bus *bus, struct addr
 
   cpu->segs[CS] = reset_vector.segment;
   cpu->ip = reset_vector.offset;
+
+  scheduler_init(&cpu->scheduler);
+}
+
+void cpu_set_interrupt_controller(struct cpu *cpu, void *context, interrupt_ack_func ack_func) {
+  cpu->interrupt_controller = context;
+  cpu->interrupt_ack = ack_func;
+}
+
+void cpu_set_interrupt_hook(struct cpu *cpu, u8 vector, void *context, interrupt_hook_func func) {
+  cpu->interrupt_hooks[vector].context = context;
+  cpu->interrupt_hooks[vector].func = func;
+}
+
+static void cpu_check_interrupt(struct cpu *cpu) {
+  if (!cpu->flags.interrupt) {
+    return;
+  }
+
+  int vector = cpu->interrupt_ack(cpu->interrupt_controller);
+  if (vector < 0) {
+    return;
+  }
+
+  if (cpu->replay) {
+    // Logged to check that the replay is still in step, the vector comes from the devices.
+    replay_input(cpu->replay, ri_interrupt, (u32)vector, 0);
+  }
+
+  cpu->halted = false;
+  cpu_interrupt(cpu, (u8)vector);
 }
 
 void print_registers(struct cpu *cpu) {
@@ -42,25 +88,203 @@ u8 reader_fetch_from_bus(void *context, u32 position) {
   return bus_fetch_byte(bus, position);
 }
 
-void cpu_step(struct cpu *cpu) {
+static void cpu_decode(struct cpu *cpu, struct instruction *instruction, u32 *flat) {
   struct address cs_ip = segment_offset(cpu->segs[CS], cpu->ip);
-  u32 flat = flatten_address(cs_ip);
+  *flat = flatten_address(cs_ip);
 
   struct reader reader;
   reader_init(&reader, cpu->bus, reader_fetch_from_bus);
 
-  struct instruction instruction;
-  decode_instruction(&reader, flat, &instruction);
+  decode_instruction(&reader, *flat, instruction);
+
+  assert(instruction->instruction_size);
+  cpu->ip += instruction->instruction_size;
+  cpu->cycles += instruction->instruction_size * CYCLES_PER_INSTRUCTION_BYTE;
+}
+
+void cpu_step(struct cpu *cpu) {
+  if (cpu->intr) {
+    cpu_check_interrupt(cpu);
+  }
+
+  if (cpu->halted) {
+    // Nothing to do until an event raises an interrupt.
+    u64 next = scheduler_next_deadline(&cpu->scheduler);
+    if (next != SCHEDULER_NEVER) {
+      cpu->cycles = next;
+      scheduler_run_due(&cpu->scheduler, cpu->cycles);
+    }
+    return;
+  }
 
   print_registers(cpu);
 
-  assert(instruction.instruction_size);
-  cpu->ip += instruction.instruction_size;
+  struct instruction instruction;
+  u32 flat;
+  cpu_decode(cpu, &instruction, &flat);
 
   char buf[128];
   disassemble(buf, sizeof(buf), &instruction, flat);
   puts(buf);
   puts("");
 
+  if (cpu->coverage) {
+    cpu_cover(cpu, &instruction, flat);
+  }
   cpu_exec(cpu, &instruction);
+
+  scheduler_run_due(&cpu->scheduler, cpu->cycles);
+}
+
+static u32 cpu_flat_ip(const struct cpu *cpu) {
+  return flatten_address(segment_offset(cpu->segs[CS], cpu->ip));
+}
+
+static bool cpu_at_breakpoint(const struct cpu *cpu, u32 flat) {
+  const struct cpu_debug *debug = cpu->debug;
+  u32 page = flat >> BUS_PAGE_SHIFT;
+
+  if (!(debug->breakpoint_pages[page / 64] & (1ull << (page % 64)))) {
+    return false;
+  }
+
+  for (unsigned i = 0; i < debug->breakpoint_count; ++i) {
+    if (debug->breakpoints[i] == flat) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The run loop of `cpu_run`, looking for breakpoints and stops between instructions and recording
+// coverage.
+static void cpu_run_checked(struct cpu *cpu, u64 cycles) {
+  u64 end = cpu->cycles + cycles;
+  // Resuming from a breakpoint executes the instruction there.
+  u32 resume_flat = cpu_flat_ip(cpu);
+  bool first = true;
+
+  while (cpu->cycles < end && !cpu->stopped) {
+    u64 batch_end = scheduler_next_deadline(&cpu->scheduler);
+    if (batch_end > end) {
+      batch_end = end;
+    }
+
+    while (cpu->cycles < batch_end) {
+      // Stops and breakpoints come before a pending interrupt, which would move the cpu away.
+      u32 flat = cpu_flat_ip(cpu);
+      if (cpu->stopped || (cpu->debug && !cpu->halted && (!first || flat != resume_flat) &&
+                           cpu_at_breakpoint(cpu, flat))) {
+        cpu->stopped = true;
+        return;
+      }
+      first = false;
+
+      if (cpu->intr) {
+        cpu_check_interrupt(cpu);
+        if (cpu_flat_ip(cpu) != flat) {
+          // Taken, the handler is checked for a breakpoint as well.
+          continue;
+        }
+      }
+
+      if (cpu->halted) {
+        cpu->cycles = batch_end;
+        break;
+      }
+
+      struct instruction instruction;
+      cpu_decode(cpu, &instruction, &flat);
+      if (cpu->coverage) {
+        cpu_cover(cpu, &instruction, flat);
+      }
+      cpu_exec(cpu, &instruction);
+    }
+
+    scheduler_run_due(&cpu->scheduler, cpu->cycles);
+  }
+}
+
+void cpu_run(struct cpu *cpu, u64 cycles) {
+  cpu->stopped = false;
+  if (cpu->coverage ||
+      (cpu->debug && (cpu->debug->breakpoint_count || cpu->debug->stopper_count))) {
+    cpu_run_checked(cpu, cycles);
+    return;
+  }
+
+  u64 end = cpu->cycles + cycles;
+
+  while (cpu->cycles < end) {
+    u64 batch_end = scheduler_next_deadline(&cpu->scheduler);
+    if (batch_end > end) {
+      batch_end = end;
+    }
+
+    while (cpu->cycles < batch_end) {
+      if (cpu->intr) {
+        cpu_check_interrupt(cpu);
+      }
+
+      if (cpu->halted) {
+        // Skip ahead to the next event, only an interrupt can wake the cpu up.
+        cpu->cycles = batch_end;
+        break;
+      }
+
+      struct instruction instruction;
+      u32 flat;
+      cpu_decode(cpu, &instruction, &flat);
+      cpu_exec(cpu, &instruction);
+    }
+
+    scheduler_run_due(&cpu->scheduler, cpu->cycles);
+  }
+}
+
+void cpu_stop(struct cpu *cpu) {
+  if (cpu->debug && cpu->debug->stopper_count) {
+    cpu->stopped = true;
+  }
+}
+
+static void cpu_debug_update_page(struct cpu_debug *debug, u32 page) {
+  u64 bit = 1ull << (page % 64);
+  debug->breakpoint_pages[page / 64] &= ~bit;
+  for (unsigned i = 0; i < debug->breakpoint_count; ++i) {
+    if (debug->breakpoints[i] >> BUS_PAGE_SHIFT == page) {
+      debug->breakpoint_pages[page / 64] |= bit;
+    }
+  }
+}
+
+bool cpu_debug_add_breakpoint(struct cpu_debug *debug, u32 address) {
+  if (address >> BUS_PAGE_SHIFT >= BUS_PAGE_COUNT) {
+    return false;
+  }
+
+  for (unsigned i = 0; i < debug->breakpoint_count; ++i) {
+    if (debug->breakpoints[i] == address) {
+      return true;
+    }
+  }
+
+  if (debug->breakpoint_count == CPU_MAX_BREAKPOINTS) {
+    return false;
+  }
+
+  debug->breakpoints[debug->breakpoint_count++] = address;
+  cpu_debug_update_page(debug, address >> BUS_PAGE_SHIFT);
+  return true;
+}
+
+bool cpu_debug_remove_breakpoint(struct cpu_debug *debug, u32 address) {
+  for (unsigned i = 0; i < debug->breakpoint_count; ++i) {
+    if (debug->breakpoints[i] == address) {
+      debug->breakpoints[i] = debug->breakpoints[--debug->breakpoint_count];
+      cpu_debug_update_page(debug, address >> BUS_PAGE_SHIFT);
+      return true;
+    }
+  }
+  return false;
 }
@@ -1,7 +1,10 @@
 #include "instr_map.h"
 
+#include "cpu/replay.h"
+
 #include <base/print_format.h>
 #include <stdio.h>
+#include <string.h>
 
 static const byte parity_flag_table[0x100] = {
     1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0,
@@ -14,10 +17,56 @@ static const byte parity_flag_table[0x100] = {
     0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1,
 };
 
+// Every memory operand is `segment:(base + index + displacement)`. Operands without a base, index
+// or displacement use the zero register and a displacement of 0, so the address is computed the
+// same way for all of them.
+static u32 operand_address(struct cpu *cpu, const struct operand *operand) {
+  enum segment_register seg_reg;
+  enum indirect_memory_encoding encoding;
+  u16 displacement;
+
+  switch (operand->type) {
+    case ot_indirect:
+      seg_reg = operand->data.as_indirect.seg_reg;
+      encoding = operand->data.as_indirect.encoding;
+      displacement = 0;
+      break;
+
+    case ot_displacement:
+      seg_reg = operand->data.as_displacement.seg_reg;
+      encoding = operand->data.as_displacement.encoding;
+      displacement = operand->data.as_displacement.displacement;
+      break;
+
+    case ot_direct:
+      return flatten_address(segment_offset(cpu->segs[operand->data.as_direct.seg_reg],
+                                            operand->data.as_direct.address));
+
+    case ot_offset:
+      return flatten_address(segment_offset(cpu->segs[operand->data.as_offset.seg_reg],
+                                            operand->data.as_offset.offset));
+
+    default:
+      assert(0);
+      return 0;
+  }
+
+  const struct indirect_memory_registers *registers = &indirect_memory_registers_table[encoding];
+  u16 offset = cpu->regs.word[registers->base] + cpu->regs.word[registers->index] + displacement;
+
+  return flatten_address(segment_offset(cpu->segs[seg_reg], offset));
+}
+
 byte fetch_operand_value_byte(struct cpu *cpu, struct operand *operand) {
   assert(operand->size == os_8);
 
   switch (operand->type) {
+    case ot_indirect:
+    case ot_displacement:
+    case ot_direct:
+    case ot_offset:
+      return bus_fetch_byte(cpu->bus, operand_address(cpu, operand));
+
     case ot_register:
       return cpu->regs.byte[operand->data.as_register.reg_8];
 
@@ -26,7 +75,7 @@ byte fetch_operand_value_byte(struct cpu *cpu, struct operand *operand) {
 
     default:
       assert(0);
-      break;
+      return 0;
   }
 }
 
@@ -34,6 +83,13 @@ void store_operand_value_byte(struct cpu *cpu, struct operand *operand, byte val
   assert(operand->size == os_8);
 
   switch (operand->type) {
+    case ot_indirect:
+    case ot_displacement:
+    case ot_direct:
+    case ot_offset:
+      bus_store_byte(cpu->bus, operand_address(cpu, operand), value);
+      break;
+
     case ot_register:
       cpu->regs.byte[operand->data.as_register.reg_8] = value;
       break;
@@ -48,23 +104,24 @@ word fetch_operand_value_word(struct cpu *cpu, struct operand *operand) {
   assert(operand->size == os_16);
 
   switch (operand->type) {
-    case ot_direct: {
-      u32 address = flatten_address(segment_offset(cpu->segs[operand->data.as_direct.seg_reg],
-                                                   operand->data.as_direct.address));
-      byte low = bus_fetch_byte(cpu->bus, address);
-      byte high = bus_fetch_byte(cpu->bus, address + 1);
-      return low + (high << 8);
-    }
+    case ot_indirect:
+    case ot_displacement:
+    case ot_direct:
+    case ot_offset:
+      return bus_fetch_word(cpu->bus, operand_address(cpu, operand));
 
     case ot_register:
       return cpu->regs.word[operand->data.as_register.reg_16];
 
+    case ot_segment_register:
+      return cpu->segs[operand->data.as_segment_register.reg];
+
     case ot_immediate:
       return operand->data.as_immediate.immediate_16;
 
     default:
       assert(0);
-      break;
+      return 0;
   }
 }
 
@@ -72,54 +129,12 @@ void store_operand_value_word(struct cpu *cpu, struct operand *operand, word val
   assert(operand->size == os_16);
 
   switch (operand->type) {
-    case ot_indirect: {
-      u16 segment = cpu->segs[operand->data.as_indirect.seg_reg];
-      u16 offset = 0;
-
-      switch (operand->data.as_indirect.encoding) {
-        case ime_bx_si:
-          offset = cpu->regs.word[BX] + cpu->regs.word[SI];
-          break;
-
-        case ime_bx_di:
-          offset = cpu->regs.word[BX] + cpu->regs.word[DI];
-          break;
-
-        case ime_bp_si:
-          offset = cpu->regs.word[BP] + cpu->regs.word[SI];
-          break;
-
-        case ime_bp_di:
-          offset = cpu->regs.word[BP] + cpu->regs.word[DI];
-          break;
-
-        case ime_si:
-          offset = cpu->regs.word[SI];
-          break;
-
-        case ime_di:
-          offset = cpu->regs.word[DI];
-          break;
-
-        case ime_bp:
-          offset = cpu->regs.word[BP];
-          break;
-
-        case ime_bx:
-          offset = cpu->regs.word[BX];
-          break;
-
-        default:
-          assert(0);
-          break;
-      }
-
-      u32 address = flatten_address(segment_offset(segment, offset));
-
-      bus_store_byte(cpu->bus, address, value & 0xff);
-      bus_store_byte(cpu->bus, address + 1, value >> 8);
+    case ot_indirect:
+    case ot_displacement:
+    case ot_direct:
+    case ot_offset:
+      bus_store_word(cpu->bus, operand_address(cpu, operand), value);
       break;
-    }
 
     case ot_register:
       cpu->regs.word[operand->data.as_register.reg_16] = value;
@@ -196,6 +211,158 @@ static word pop(struct cpu *cpu) {
   return value;
 }
 
+// The port of an `in` or `out` is either an 8-bit immediate or the DX register.
+static word port_address(struct cpu *cpu, struct operand *operand) {
+  if (operand->type == ot_register && operand->size == os_16 &&
+      operand->data.as_register.reg_16 == DX) {
+    return cpu->regs.word[DX];
+  }
+
+  if (operand->type == ot_immediate && operand->size == os_8) {
+    return operand->data.as_immediate.immediate_8;
+  }
+
+  assert(0);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+// String instructions process all their repetitions in a single execution. When the whole range
+// lies in plain memory inside the segment, the elements are processed directly on host memory,
+// otherwise they go through the bus one element at a time.
+
+// Approximate 8088 clocks per element of a repeated string instruction.
+#define MOVS_ELEMENT_CYCLES 17
+#define CMPS_ELEMENT_CYCLES 22
+#define STOS_ELEMENT_CYCLES 10
+#define LODS_ELEMENT_CYCLES 13
+#define SCAS_ELEMENT_CYCLES 15
+
+static unsigned string_element_size(const struct operand *operand) {
+  return operand->size == os_16 ? 2 : 1;
+}
+
+// Number of elements to process, which is CX for the repeated forms.
+static u32 string_count(struct cpu *cpu, struct instruction *instruction) {
+  return instruction->rep_mode != rm_none ? cpu->regs.word[CX] : 1;
+}
+
+static void string_finish(struct cpu *cpu, struct instruction *instruction, u32 processed) {
+  if (instruction->rep_mode != rm_none) {
+    cpu->regs.word[CX] -= processed;
+  }
+}
+
+static void string_advance(struct cpu *cpu, enum register_16 reg, u32 count, unsigned size) {
+  word delta = (word)(count * size);
+
+  if (cpu->flags.direction) {
+    cpu->regs.word[reg] -= delta;
+  } else {
+    cpu->regs.word[reg] += delta;
+  }
+}
+
+static u32 string_address(struct cpu *cpu, enum segment_register seg, enum register_16 reg) {
+  return flatten_address(segment_offset(cpu->segs[seg], cpu->regs.word[reg]));
+}
+
+// The source of a string instruction is DS:SI unless a segment override prefix selects another
+// segment. The destination ES:DI can not be overridden.
+static enum segment_register string_source_segment(const struct instruction *instruction) {
+  const struct operand *operand = instruction->destination.type == ot_ds_si
+                                      ? &instruction->destination
+                                      : &instruction->source;
+  assert(operand->type == ot_ds_si);
+
+  return operand->data.as_indirect.seg_reg;
+}
+
+// Return host memory for the lowest byte touched by `count` elements starting at seg:reg, or 0 if
+// the elements wrap around the segment or are not plain memory.
+static byte *string_plain_range(struct cpu *cpu, enum segment_register seg, enum register_16 reg,
+                                u32 count, unsigned size) {
+  u32 offset = cpu->regs.word[reg];
+  u32 bytes = count * size;
+
+  if (cpu->flags.direction) {
+    if (offset + size < bytes || offset + size > 0x10000) {
+      return 0;
+    }
+    offset = offset + size - bytes;
+  } else if (offset + bytes > 0x10000) {
+    return 0;
+  }
+
+  return bus_plain_memory(cpu->bus, (cpu->segs[seg] << 4) + offset, bytes);
+}
+
+// Like `string_plain_range`, for elements that are about to be written.
+static byte *string_plain_store_range(struct cpu *cpu, enum segment_register seg,
+                                      enum register_16 reg, u32 count, unsigned size) {
+  byte *range = string_plain_range(cpu, seg, reg, count, size);
+  if (range) {
+    bus_mark_dirty(cpu->bus, (u32)(range - cpu->bus->memory), count * size);
+  }
+  return range;
+}
+
+// Pointer to element `index` in processing order of a range returned by `string_plain_range`.
+static const byte *string_element(struct cpu *cpu, const byte *range, u32 index, u32 count,
+                                  unsigned size) {
+  return cpu->flags.direction ? range + (count - 1 - index) * size : range + index * size;
+}
+
+// Copying one element at a time smears the source when the destination overlaps it ahead of the
+// copy direction, which memmove does not reproduce.
+static bool string_overlaps_ahead(struct cpu *cpu, const byte *source, const byte *destination,
+                                  u32 bytes) {
+  if (cpu->flags.direction) {
+    return destination < source && destination + bytes > source;
+  }
+
+  return destination > source && source + bytes > destination;
+}
+
+static word string_load(const byte *element, unsigned size) {
+  return size == 2 ? element[0] | (element[1] << 8) : element[0];
+}
+
+static word string_fetch(struct cpu *cpu, u32 address, unsigned size) {
+  return size == 2 ? bus_fetch_word(cpu->bus, address) : bus_fetch_byte(cpu->bus, address);
+}
+
+static void string_store(struct cpu *cpu, u32 address, word value, unsigned size) {
+  if (size == 2) {
+    bus_store_word(cpu->bus, address, value);
+  } else {
+    bus_store_byte(cpu->bus, address, value);
+  }
+}
+
+static void string_compare(struct cpu *cpu, word left, word right, unsigned size) {
+  if (size == 2) {
+    flags_sub_word(&cpu->flags, left, right);
+  } else {
+    flags_sub_byte(&cpu->flags, left, right);
+  }
+}
+
+// Whether a repeated compare stops after an element compared with the given zero flag.
+static bool string_compare_stops(struct instruction *instruction, byte zero) {
+  switch (instruction->rep_mode) {
+    case rm_rep:
+      return !zero;
+
+    case rm_repne:
+      return zero;
+
+    default:
+      return true;
+  }
+}
+
 /* ---------------------------------------------------------------------------------------------- */
 
 void exec_add(struct cpu *cpu, struct instruction *instruction) {
@@ -265,6 +432,49 @@ void exec_cmp(struct cpu *cpu, struct instruction *instruction) {
   }
 }
 
+void exec_cmps(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->type == it_cmps);
+
+  unsigned size = string_element_size(&instruction->destination);
+  u32 count = string_count(cpu, instruction);
+  if (!count) {
+    return;
+  }
+
+  enum segment_register source_segment = string_source_segment(instruction);
+
+  u32 processed = 0;
+  word left = 0;
+  word right = 0;
+
+  const byte *source = string_plain_range(cpu, source_segment, SI, count, size);
+  const byte *destination = string_plain_range(cpu, ES, DI, count, size);
+
+  if (count > 1 && source && destination) {
+    do {
+      left = string_load(string_element(cpu, source, processed, count, size), size);
+      right = string_load(string_element(cpu, destination, processed, count, size), size);
+      ++processed;
+    } while (processed < count && ((left == right) == (instruction->rep_mode == rm_rep)));
+
+    string_compare(cpu, left, right, size);
+    string_advance(cpu, SI, processed, size);
+    string_advance(cpu, DI, processed, size);
+  } else {
+    do {
+      left = string_fetch(cpu, string_address(cpu, source_segment, SI), size);
+      right = string_fetch(cpu, string_address(cpu, ES, DI), size);
+      string_compare(cpu, left, right, size);
+      string_advance(cpu, SI, 1, size);
+      string_advance(cpu, DI, 1, size);
+      ++processed;
+    } while (processed < count && !string_compare_stops(instruction, cpu->flags.zero));
+  }
+
+  string_finish(cpu, instruction, processed);
+  cpu->cycles += processed * CMPS_ELEMENT_CYCLES;
+}
+
 void exec_dec(struct cpu *cpu, struct instruction *instruction) {
   assert(instruction->type == it_dec);
 
@@ -336,6 +546,44 @@ void exec_div(struct cpu *cpu, struct instruction *instruction) {
 #undef OP
 }
 
+void exec_hlt(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->type == it_hlt);
+
+  cpu->halted = true;
+}
+
+void exec_in(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->type == it_in);
+
+  word address = port_address(cpu, &instruction->source);
+
+  assert(instruction->destination.type == ot_register);
+
+  switch (instruction->destination.size) {
+    case os_8: {
+      byte value = ports_in(cpu->ports, address);
+      if (cpu->replay) {
+        value = replay_input(cpu->replay, ri_port, address, value);
+      }
+      store_operand_value_byte(cpu, &instruction->destination, value);
+      break;
+    }
+
+    case os_16: {
+      word value = ports_in_word(cpu->ports, address);
+      if (cpu->replay) {
+        value = replay_input(cpu->replay, ri_port, address | REPLAY_WORD_PORT, value);
+      }
+      store_operand_value_word(cpu, &instruction->destination, value);
+      break;
+    }
+
+    default:
+      assert(0);
+      break;
+  }
+}
+
 void exec_inc(struct cpu *cpu, struct instruction *instruction) {
   assert(instruction->type == it_inc);
 
@@ -372,11 +620,38 @@ void exec_inc(struct cpu *cpu, struct instruction *instruction) {
 #undef OP
 }
 
+void cpu_interrupt(struct cpu *cpu, u8 vector) {
+  push_word(cpu, flags_to_word(&cpu->flags));
+  push_word(cpu, cpu->segs[CS]);
+  push_word(cpu, cpu->ip);
+
+  cpu->flags.interrupt = 0;
+  cpu->flags.trap = 0;
+
+  u32 entry = vector * 4;
+  cpu->ip = bus_fetch_word(cpu->bus, entry);
+  cpu->segs[CS] = bus_fetch_word(cpu->bus, entry + 2);
+}
+
 void exec_int(struct cpu *cpu, struct instruction *instruction) {
-  UNUSED(cpu);
   assert(instruction->type == it_int);
 
-  printf("## int " HEX_8 "\n\n", instruction->destination.data.as_immediate.immediate_8);
+  u8 vector = instruction->destination.data.as_immediate.immediate_8;
+
+  const struct interrupt_hook *hook = &cpu->interrupt_hooks[vector];
+  if (hook->func && hook->func(hook->context, cpu, vector)) {
+    return;
+  }
+
+  cpu_interrupt(cpu, vector);
+}
+
+void exec_iret(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->type == it_iret);
+
+  cpu->ip = pop(cpu);
+  cpu->segs[CS] = pop(cpu);
+  flags_from_word(&cpu->flags, pop(cpu));
 }
 
 void exec_jmp(struct cpu *cpu, struct instruction *instruction) {
@@ -402,120 +677,108 @@ void exec_jcxz(struct cpu *cpu, struct instruction *instruction) {
   assert(instruction->type == it_jcxz);
   assert(instruction->destination.type == ot_jump);
 
-  i16 offset = instruction->destination.data.as_jump.offset;
-  if (cpu->regs.word[CX] == 0) {
-    cpu->ip += offset;
+  if (branch_taken(cpu, instruction)) {
+    cpu->ip += instruction->destination.data.as_jump.offset;
   }
 }
 
-void exec_jump_conditional(struct cpu *cpu, struct instruction *instruction) {
-  assert(instruction->destination.size == os_8);
-
-  i16 offset = instruction->destination.data.as_jump.offset;
+bool branch_taken(const struct cpu *cpu, const struct instruction *instruction) {
+  const union flags *flags = &cpu->flags;
 
   switch (instruction->type) {
     case it_jo:
-      if (cpu->flags.overflow) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->overflow;
     case it_jno:
-      if (!cpu->flags.overflow) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return !flags->overflow;
     case it_jb:
-      if (cpu->flags.carry) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->carry;
     case it_jnb:
-      if (!cpu->flags.carry) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return !flags->carry;
     case it_jz:
-      if (cpu->flags.zero) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->zero;
     case it_jnz:
-      if (!cpu->flags.zero) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return !flags->zero;
     case it_jbe:
-      if (cpu->flags.carry || cpu->flags.zero) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->carry || flags->zero;
     case it_jnbe:
-      if (!cpu->flags.carry && !cpu->flags.zero) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return !flags->carry && !flags->zero;
     case it_js:
-      if (cpu->flags.sign) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->sign;
     case it_jns:
-      if (!cpu->flags.sign) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return !flags->sign;
     case it_jp:
-      if (cpu->flags.parity) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->parity;
     case it_jnp:
-      if (!cpu->flags.parity) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return !flags->parity;
     case it_jl:
-      if (cpu->flags.sign != cpu->flags.overflow) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->sign != flags->overflow;
     case it_jnl:
-      if (cpu->flags.sign == cpu->flags.overflow) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return flags->sign == flags->overflow;
     case it_jle:
-      if ((cpu->flags.sign != cpu->flags.overflow) || cpu->flags.zero) {
-        cpu->ip += offset;
-      }
-      break;
-
+      return (flags->sign != flags->overflow) || flags->zero;
     case it_jnle:
-      if (!cpu->flags.zero && (cpu->flags.sign == cpu->flags.overflow)) {
-        cpu->ip += offset;
-      }
-      break;
+      return !flags->zero && (flags->sign == flags->overflow);
+
+    case it_jcxz:
+      return cpu->regs.word[CX] == 0;
+
+    // CX is decremented first.
+    case it_loop:
+      return cpu->regs.word[CX] != 1;
+    case it_loope:
+      return cpu->regs.word[CX] != 1 && flags->zero;
+    case it_loopne:
+      return cpu->regs.word[CX] != 1 && !flags->zero;
 
     default:
       assert(0);
-      break;
+      return false;
   }
 }
 
+void exec_jump_conditional(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->destination.size == os_8);
+
+  if (branch_taken(cpu, instruction)) {
+    cpu->ip += instruction->destination.data.as_jump.offset;
+  }
+}
+
+void exec_lods(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->type == it_lods);
+
+  unsigned size = string_element_size(&instruction->destination);
+  u32 count = string_count(cpu, instruction);
+  if (!count) {
+    return;
+  }
+
+  enum segment_register source_segment = string_source_segment(instruction);
+
+  // Only the last element loaded is visible, so skip straight to it.
+  const byte *source = string_plain_range(cpu, source_segment, SI, count, size);
+  word value;
+
+  if (source) {
+    value = string_load(string_element(cpu, source, count - 1, count, size), size);
+    string_advance(cpu, SI, count, size);
+  } else {
+    for (u32 i = 0; i < count; ++i) {
+      value = string_fetch(cpu, string_address(cpu, source_segment, SI), size);
+      string_advance(cpu, SI, 1, size);
+    }
+  }
+
+  if (size == 2) {
+    cpu->regs.word[AX] = value;
+  } else {
+    cpu->regs.byte[AL] = (byte)value;
+  }
+
+  string_finish(cpu, instruction, count);
+  cpu->cycles += count * LODS_ELEMENT_CYCLES;
+}
+
 void exec_mov(struct cpu *cpu, struct instruction *instruction) {
   assert(instruction->type == it_mov);
 
@@ -538,21 +801,43 @@ void exec_mov(struct cpu *cpu, struct instruction *instruction) {
   }
 }
 
-void exec_out(struct cpu *cpu, struct instruction *instruction) {
-  assert(instruction->type == it_out);
+void exec_movs(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->type == it_movs);
 
-  word address = 0;
-  if (instruction->destination.type == ot_register && instruction->destination.size == os_16 &&
-      instruction->destination.data.as_register.reg_16 == DX) {
-    address = cpu->regs.word[DX];
-  } else if (instruction->destination.type == ot_immediate &&
-             instruction->destination.size == os_8) {
-    address = instruction->destination.data.as_immediate.immediate_8;
-  } else {
-    assert(0);
+  unsigned size = string_element_size(&instruction->destination);
+  u32 count = string_count(cpu, instruction);
+  if (!count) {
     return;
   }
 
+  enum segment_register source_segment = string_source_segment(instruction);
+
+  const byte *source = string_plain_range(cpu, source_segment, SI, count, size);
+  byte *destination = string_plain_store_range(cpu, ES, DI, count, size);
+
+  if (count > 1 && source && destination &&
+      !string_overlaps_ahead(cpu, source, destination, count * size)) {
+    memmove(destination, source, count * size);
+    string_advance(cpu, SI, count, size);
+    string_advance(cpu, DI, count, size);
+  } else {
+    for (u32 i = 0; i < count; ++i) {
+      word value = string_fetch(cpu, string_address(cpu, source_segment, SI), size);
+      string_store(cpu, string_address(cpu, ES, DI), value, size);
+      string_advance(cpu, SI, 1, size);
+      string_advance(cpu, DI, 1, size);
+    }
+  }
+
+  string_finish(cpu, instruction, count);
+  cpu->cycles += count * MOVS_ELEMENT_CYCLES;
+}
+
+void exec_out(struct cpu *cpu, struct instruction *instruction) {
+  assert(instruction->type == it_out);
+
+  word address = port_address(cpu, &instruction->destination);
+
   assert(instruction->source.type == ot_register);
 
   switch (instruction->source.size) {
@@ -560,6 +845,10 @@ void exec_out(struct cpu *cpu, struct instruction *instruction) {
       ports_out(cpu->ports, address, fetch_operand_value_byte(cpu, &instruction->source));
       break;
 
+    case os_16:
+      ports_out_word(cpu->ports, address, fetch_operand_value_word(cpu, &instruction->source));
+      break;
+
     default:
       assert(0);
       break;
@@ -599,51 +888,43 @@ void exec_scas(struct cpu *cpu, struct instruction *instruction) {
   assert(instruction->destination.type == ot_register);
   assert(instruction->source.type == ot_es_di);
 
-  if (instruction->rep_mode != rm_none && cpu->regs.word[CX] == 0) {
+  unsigned size = string_element_size(&instruction->destination);
+  u32 count = string_count(cpu, instruction);
+  if (!count) {
     return;
   }
 
-  u32 es_di = flatten_address(segment_offset(cpu->segs[ES], cpu->regs.word[DI]));
-
-  switch (instruction->destination.size) {
-    case os_8: {
-      byte left = cpu->regs.byte[AL];
-      byte right = bus_fetch_byte(cpu->bus, es_di);
-      flags_sub_byte(&cpu->flags, left, right);
-      break;
+  word left = size == 2 ? cpu->regs.word[AX] : cpu->regs.byte[AL];
+  word right = 0;
+  u32 processed = 0;
+
+  const byte *destination = string_plain_range(cpu, ES, DI, count, size);
+
+  if (count > 1 && destination) {
+    if (size == 1 && !cpu->flags.direction && instruction->rep_mode == rm_repne) {
+      const byte *found = memchr(destination, left, count);
+      processed = found ? (u32)(found - destination) + 1 : count;
+      right = destination[processed - 1];
+    } else {
+      do {
+        right = string_load(string_element(cpu, destination, processed, count, size), size);
+        ++processed;
+      } while (processed < count && ((left == right) == (instruction->rep_mode == rm_rep)));
     }
 
-    case os_16: {
-      word left = cpu->regs.word[AX];
-      word right = bus_fetch_word(cpu->bus, es_di);
-      flags_sub_word(&cpu->flags, left, right);
-      break;
-    }
-
-    default:
-      assert(0);
-      break;
-  }
-
-  if (cpu->flags.direction) {
-    cpu->regs.word[DI] -= 1;
+    string_compare(cpu, left, right, size);
+    string_advance(cpu, DI, processed, size);
   } else {
-    cpu->regs.word[DI] += 1;
+    do {
+      right = string_fetch(cpu, string_address(cpu, ES, DI), size);
+      string_compare(cpu, left, right, size);
+      string_advance(cpu, DI, 1, size);
+      ++processed;
+    } while (processed < count && !string_compare_stops(instruction, cpu->flags.zero));
   }
 
-  if (instruction->rep_mode != rm_none) {
-    cpu->regs.word[CX] -= 1;
-  }
-
-  if (instruction->rep_mode == rm_rep && !cpu->flags.zero) {
-    return;
-  } else if (instruction->rep_mode == rm_repne && cpu->flags.zero) {
-    return;
-  }
-
-  assert(instruction->instruction_size);
-  // Move the IP back to where this instruction started so that it gets repeated.
-  cpu->ip -= instruction->instruction_size;
+  string_finish(cpu, instruction, processed);
+  cpu->cycles += processed * SCAS_ELEMENT_CYCLES;
 }
 
 void exec_stc(struct cpu *cpu, struct instruction *instruction) {
@@ -669,44 +950,34 @@ void exec_stos(struct cpu *cpu, struct instruction *instruction) {
   assert(instruction->destination.type == ot_es_di);
   assert(instruction->source.type == ot_register);
 
-  if (instruction->rep_mode != rm_none && cpu->regs.word[CX] == 0) {
+  unsigned size = string_element_size(&instruction->destination);
+  u32 count = string_count(cpu, instruction);
+  if (!count) {
     return;
   }
 
-  u32 flat = flatten_address(segment_offset(cpu->segs[ES], cpu->regs.word[DI]));
-
-  u8 size_in_bytes;
-
-  switch (instruction->destination.size) {
-    case os_8:
-      bus_store_byte(cpu->bus, flat, cpu->regs.byte[AL]);
-      size_in_bytes = 1;
-      break;
-
-    case os_16:
-      bus_store_byte(cpu->bus, flat, cpu->regs.byte[AL]);
-      bus_store_byte(cpu->bus, flat + 1, cpu->regs.byte[AH]);
-      size_in_bytes = 2;
-      break;
+  byte *destination = string_plain_store_range(cpu, ES, DI, count, size);
 
-    default:
-      assert(0);
-      break;
-  }
-
-  if (cpu->flags.direction) {
-    cpu->regs.word[DI] -= size_in_bytes;
+  if (count > 1 && destination) {
+    if (size == 1 || cpu->regs.byte[AL] == cpu->regs.byte[AH]) {
+      memset(destination, cpu->regs.byte[AL], count * size);
+    } else {
+      for (u32 i = 0; i < count; ++i) {
+        destination[i * 2] = cpu->regs.byte[AL];
+        destination[i * 2 + 1] = cpu->regs.byte[AH];
+      }
+    }
+    string_advance(cpu, DI, count, size);
   } else {
-    cpu->regs.word[DI] += size_in_bytes;
-  }
-
-  if (instruction->rep_mode != rm_none) {
-    cpu->regs.word[CX] -= 1;
+    word value = size == 2 ? cpu->regs.word[AX] : cpu->regs.byte[AL];
+    for (u32 i = 0; i < count; ++i) {
+      string_store(cpu, string_address(cpu, ES, DI), value, size);
+      string_advance(cpu, DI, 1, size);
+    }
   }
 
-  assert(instruction->instruction_size);
-  // Move the IP back to where this instruction started so that it gets repeated.
-  cpu->ip -= instruction->instruction_size;
+  string_finish(cpu, instruction, count);
+  cpu->cycles += count * STOS_ELEMENT_CYCLES;
 }
 
 void exec_xor(struct cpu *cpu, struct instruction *instruction) {
@@ -759,7 +1030,7 @@ struct instr_mapping instr_map[] = {
     {it_cli, exec_cli},              //
     {it_cmc, 0},                     //
     {it_cmp, exec_cmp},              //
-    {it_cmps, 0},                    //
+    {it_cmps, exec_cmps},            //
     {it_cwd, 0},                     //
     {it_daa, 0},                     //
     {it_das, 0},                     //
@@ -767,17 +1038,17 @@ struct instr_mapping instr_map[] = {
     {it_div, exec_div},              //
     {it_enter, 0},                   //
     {it_fwait, 0},                   //
-    {it_hlt, 0},                     //
+    {it_hlt, exec_hlt},              //
     {it_idiv, 0},                    //
     {it_imul, 0},                    //
-    {it_in, 0},                      //
+    {it_in, exec_in},                //
     {it_inc, exec_inc},              //
     {it_ins, 0},                     //
     {it_int, exec_int},              //
     {it_int1, 0},                    //
     {it_int3, 0},                    //
     {it_into, 0},                    //
-    {it_iret, 0},                    //
+    {it_iret, exec_iret},            //
     {it_jb, exec_jump_conditional},  //
     {it_jbe, 0},                     //
     {it_jcxz, exec_jcxz},            //
@@ -801,12 +1072,12 @@ struct instr_mapping instr_map[] = {
     {it_lea, 0},                     //
     {it_leave, 0},                   //
     {it_les, 0},                     //
-    {it_lods, 0},                    //
+    {it_lods, exec_lods},            //
     {it_loop, 0},                    //
     {it_loope, 0},                   //
     {it_loopne, 0},                  //
     {it_mov, exec_mov},              //
-    {it_movs, 0},                    //
+    {it_movs, exec_movs},            //
     {it_mul, 0},                     //
     {it_neg, 0},                     //
     {it_not, 0},                     //
@@ -841,4 +1112,5 @@ struct instr_mapping instr_map[] = {
     {it_xchg, 0},                    //
     {it_xlat, 0},                    //
     {it_xor, exec_xor},              //
+    {it_invalid, 0},                 //
 };
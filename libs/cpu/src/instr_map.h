@@ -4,6 +4,7 @@
 #include "cpu/cpu.h"
 
 #include <instructions/instructions.h>
+#include <stdbool.h>
 
 typedef void (*exec_func)(struct cpu *cpu, struct instruction *instruction);
 
@@ -14,4 +15,8 @@ struct instr_mapping {
 
 extern struct instr_mapping instr_map[];
 
+// Whether the conditional jump or loop `instruction` jumps when executed in the current state of
+// `cpu`.
+bool branch_taken(const struct cpu *cpu, const struct instruction *instruction);
+
 #endif // CPU_INSTR_MAP_H_
@@ -1,34 +1,158 @@
 #include "cpu/ports.h"
 
+#include <assert.h>
+#include <stdbool.h>
 #include <string.h>
 
 void ports_init(struct ports *ports) {
   memset(ports, 0, sizeof(*ports));
 }
 
-void ports_map_address(struct ports *ports, word start, word end, void *context,
-                       port_out_func out_func, port_in_func in_func) {
-  for (word i = start; i <= end; ++i) {
-    ports->map[i].context = context;
-    ports->map[i].in_func = in_func;
-    ports->map[i].out_func = out_func;
+// A free slot for a range, or null if there is no room left.
+static struct port_range *ports_new_range(struct ports *ports) {
+  for (unsigned i = 0; i < ports->range_count; ++i) {
+    if (!ports->ranges[i].handler) {
+      return &ports->ranges[i];
+    }
   }
+
+  if (ports->range_count >= PORT_RANGE_MAX) {
+    return 0;
+  }
+  return &ports->ranges[ports->range_count++];
+}
+
+// Return true if ports of other ranges were taken.
+static bool ports_set_map(struct ports *ports, word start, word end,
+                          const struct port_range *range) {
+  u8 index = (u8)(range - ports->ranges + 1);
+  bool taken = false;
+
+  // `end` may be 0xffff, so the loop counter must be wider than a port number.
+  for (u32 i = start; i <= end; ++i) {
+    taken |= ports->map[i] && ports->map[i] != index;
+    ports->map[i] = index;
+  }
+  return taken;
+}
+
+// Free the ranges left without ports. This is rare, so the map is scanned. A range intercepted
+// from stays, to be given its port back.
+static void ports_free_unused(struct ports *ports) {
+  bool used[PORT_RANGE_MAX] = {false};
+  for (u32 i = 0; i < PORT_COUNT; ++i) {
+    for (u8 index = ports->map[i]; index && !used[index - 1];
+         index = ports->ranges[index - 1].intercepted) {
+      used[index - 1] = true;
+    }
+  }
+  for (unsigned i = 0; i < ports->range_count; ++i) {
+    if (!used[i]) {
+      memset(&ports->ranges[i], 0, sizeof(ports->ranges[i]));
+    }
+  }
+}
+
+int ports_map_address(struct ports *ports, word start, word end,
+                      const struct port_handler *handler, void *context) {
+  assert(start <= end);
+  assert(handler && handler->out_func && handler->in_func);
+
+  struct port_range *range = 0;
+
+  for (unsigned i = 0; i < ports->range_count; ++i) {
+    struct port_range *current = &ports->ranges[i];
+    if (current->handler == handler && current->context == context &&
+        (u32)current->end + 1 == start) {
+      range = current;
+      range->end = end;
+      break;
+    }
+  }
+
+  if (!range) {
+    range = ports_new_range(ports);
+    if (!range) {
+      return -1;
+    }
+
+    range->start = start;
+    range->end = end;
+    range->handler = handler;
+    range->context = context;
+  }
+
+  if (ports_set_map(ports, start, end, range)) {
+    ports_free_unused(ports);
+  }
+  return 0;
+}
+
+const struct port_range *ports_lookup(const struct ports *ports, word port) {
+  u8 index = ports->map[port];
+  return index ? &ports->ranges[index - 1] : 0;
+}
+
+int ports_intercept(struct ports *ports, word port, const struct port_handler *handler,
+                    void *context, struct port_range *previous) {
+  assert(handler && handler->out_func && handler->in_func);
+
+  // Not merged with a neighbour, so that it can be given back on its own.
+  struct port_range *range = ports_new_range(ports);
+  if (!range) {
+    return -1;
+  }
+
+  const struct port_range *below = ports_lookup(ports, port);
+  if (below) {
+    *previous = *below;
+  } else {
+    memset(previous, 0, sizeof(*previous));
+  }
+
+  range->start = port;
+  range->end = port;
+  range->handler = handler;
+  range->context = context;
+  range->intercepted = ports->map[port];
+
+  ports_set_map(ports, port, port, range);
+  return 0;
+}
+
+void ports_unmap(struct ports *ports, word start, word end) {
+  assert(start <= end);
+
+  for (u32 i = start; i <= end; ++i) {
+    u8 index = ports->map[i];
+    ports->map[i] = index ? ports->ranges[index - 1].intercepted : 0;
+  }
+
+  ports_free_unused(ports);
 }
 
-void ports_out(struct ports *ports, word address, byte value) {
-  void *context = ports->map[address].context;
-  if (context) {
-    ports->map[address].out_func(context, address, value);
+void ports_out_word(struct ports *ports, word address, word value) {
+  u8 index = ports->map[address];
+  if (index && ports->map[(word)(address + 1)] == index) {
+    const struct port_range *range = &ports->ranges[index - 1];
+    if (range->handler->out_word_func) {
+      range->handler->out_word_func(range->context, address - range->start, value);
+      return;
+    }
   }
 
-  ports->mem[address] = value;
+  ports_out(ports, address, value & 0xff);
+  ports_out(ports, address + 1, value >> 8);
 }
 
-byte ports_in(struct ports *ports, word address) {
-  void *context = ports->map[address].context;
-  if (context) {
-    return ports->map[address].in_func(context, address);
+word ports_in_word(struct ports *ports, word address) {
+  u8 index = ports->map[address];
+  if (index && ports->map[(word)(address + 1)] == index) {
+    const struct port_range *range = &ports->ranges[index - 1];
+    if (range->handler->in_word_func) {
+      return range->handler->in_word_func(range->context, address - range->start);
+    }
   }
 
-  return ports->mem[address];
+  return ports_in(ports, address) | (ports_in(ports, address + 1) << 8);
 }
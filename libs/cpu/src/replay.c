@@ -0,0 +1,172 @@
+#include "cpu/replay.h"
+
+#include <string.h>
+
+// FNV-1a, over 64-bit words.
+#define REPLAY_HASH_BASIS 0xcbf29ce484222325ull
+#define REPLAY_HASH_PRIME 0x100000001b3ull
+
+static u64 hash_update(u64 hash, const void *data, size_t size) {
+  const u8 *bytes = data;
+
+  for (; size >= 8; bytes += 8, size -= 8) {
+    u64 value;
+    memcpy(&value, bytes, 8);
+    hash = (hash ^ value) * REPLAY_HASH_PRIME;
+  }
+  for (; size; ++bytes, --size) {
+    hash = (hash ^ *bytes) * REPLAY_HASH_PRIME;
+  }
+
+  return hash;
+}
+
+u64 replay_state_hash(const struct cpu *cpu) {
+  word flags = flags_to_word(&cpu->flags);
+
+  u64 hash = REPLAY_HASH_BASIS;
+  hash = hash_update(hash, cpu->regs.word, sizeof(cpu->regs.word));
+  hash = hash_update(hash, cpu->segs, sizeof(cpu->segs));
+  hash = hash_update(hash, &cpu->ip, sizeof(cpu->ip));
+  hash = hash_update(hash, &flags, sizeof(flags));
+  hash = hash_update(hash, &cpu->cycles, sizeof(cpu->cycles));
+  if (cpu->bus) {
+    hash = hash_update(hash, cpu->bus->memory, cpu->bus->memory_size);
+  }
+
+  return hash;
+}
+
+static long replay_record_offset(u64 index) {
+  return (long)(sizeof(REPLAY_MAGIC) + index * sizeof(struct replay_record));
+}
+
+static void replay_read_next(struct replay *replay) {
+  if (replay->ended || fread(&replay->next, sizeof(replay->next), 1, replay->file) == 1) {
+    return;
+  }
+
+  if (replay->resume_recording) {
+    // Caught up with the end of the log, new inputs are appended to it.
+    fseek(replay->file, replay_record_offset(replay->record_count), SEEK_SET);
+    replay->mode = rm_record;
+    replay->resume_recording = false;
+  } else {
+    replay->ended = true;
+  }
+}
+
+static void replay_diverge(struct replay *replay) {
+  if (!replay->diverged) {
+    replay->diverged = true;
+    replay->divergence_cycles = replay->cpu->cycles;
+  }
+}
+
+bool replay_fetch(struct replay *replay, enum replay_input input, u32 detail, u64 *value) {
+  if (replay->mode != rm_replay || replay->ended || replay->diverged) {
+    return false;
+  }
+
+  const struct replay_record *next = &replay->next;
+  if (next->cycles != replay->cpu->cycles || next->input != input || next->detail != detail) {
+    replay_diverge(replay);
+    return false;
+  }
+
+  *value = next->value;
+  ++replay->record_count;
+  replay_read_next(replay);
+
+  return true;
+}
+
+u64 replay_input(struct replay *replay, enum replay_input input, u32 detail, u64 value) {
+  if (replay->mode == rm_record) {
+    struct replay_record record = {
+        .cycles = replay->cpu->cycles,
+        .input = input,
+        .detail = detail,
+        .value = value,
+    };
+    fwrite(&record, sizeof(record), 1, replay->file);
+    ++replay->record_count;
+    return value;
+  }
+
+  u64 logged;
+  return replay_fetch(replay, input, detail, &logged) ? logged : value;
+}
+
+static void replay_hash_event(void *context, u64 deadline) {
+  struct replay *replay = context;
+
+  u64 hash = replay_state_hash(replay->cpu);
+  if (replay_input(replay, ri_state_hash, 0, hash) != hash) {
+    replay_diverge(replay);
+  }
+
+  scheduler_schedule(&replay->cpu->scheduler, &replay->hash_event,
+                     deadline + replay->hash_interval);
+}
+
+void replay_hash_every(struct replay *replay, u64 interval) {
+  struct scheduler *scheduler = &replay->cpu->scheduler;
+
+  replay->hash_interval = interval;
+  if (interval) {
+    scheduler_schedule(scheduler, &replay->hash_event, replay->cpu->cycles + interval);
+  } else {
+    scheduler_cancel(scheduler, &replay->hash_event);
+  }
+}
+
+void replay_seek(struct replay *replay, u64 position) {
+  if (replay->mode == rm_record) {
+    fflush(replay->file);
+    replay->mode = rm_replay;
+    replay->resume_recording = true;
+  }
+
+  replay->record_count = position;
+  replay->ended = false;
+  replay->diverged = false;
+  fseek(replay->file, replay_record_offset(position), SEEK_SET);
+  replay_read_next(replay);
+}
+
+bool replay_init(struct replay *replay, struct cpu *cpu, enum replay_mode mode, const char *path) {
+  // Recorded logs are read back when the machine goes back to a checkpoint.
+  FILE *file = fopen(path, mode == rm_record ? "w+b" : "rb");
+  return file && replay_init_file(replay, cpu, mode, file);
+}
+
+bool replay_init_file(struct replay *replay, struct cpu *cpu, enum replay_mode mode, FILE *file) {
+  memset(replay, 0, sizeof(*replay));
+
+  replay->cpu = cpu;
+  replay->mode = mode;
+  replay->file = file;
+
+  char magic[sizeof(REPLAY_MAGIC)];
+  if (mode == rm_record) {
+    fwrite(REPLAY_MAGIC, sizeof(magic), 1, replay->file);
+  } else if (fread(magic, sizeof(magic), 1, replay->file) != 1 ||
+             memcmp(magic, REPLAY_MAGIC, sizeof(magic))) {
+    fclose(replay->file);
+    return false;
+  } else {
+    replay_read_next(replay);
+  }
+
+  scheduler_event_init(&replay->hash_event, replay_hash_event, replay);
+  cpu->replay = replay;
+
+  return true;
+}
+
+void replay_destroy(struct replay *replay) {
+  scheduler_cancel(&replay->cpu->scheduler, &replay->hash_event);
+  replay->cpu->replay = 0;
+  fclose(replay->file);
+}
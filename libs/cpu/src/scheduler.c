@@ -0,0 +1,111 @@
+#include "cpu/scheduler.h"
+
+#include <assert.h>
+#include <string.h>
+
+static void heap_place(struct scheduler *scheduler, unsigned index, struct scheduler_event *event) {
+  scheduler->heap[index] = event;
+  event->heap_index = (int)index;
+}
+
+static void heap_sift_up(struct scheduler *scheduler, unsigned index) {
+  struct scheduler_event *event = scheduler->heap[index];
+
+  while (index > 0) {
+    unsigned parent = (index - 1) / 2;
+    if (scheduler->heap[parent]->deadline <= event->deadline) {
+      break;
+    }
+
+    heap_place(scheduler, index, scheduler->heap[parent]);
+    index = parent;
+  }
+
+  heap_place(scheduler, index, event);
+}
+
+static void heap_sift_down(struct scheduler *scheduler, unsigned index) {
+  struct scheduler_event *event = scheduler->heap[index];
+
+  for (;;) {
+    unsigned child = index * 2 + 1;
+    if (child >= scheduler->event_count) {
+      break;
+    }
+
+    if (child + 1 < scheduler->event_count &&
+        scheduler->heap[child + 1]->deadline < scheduler->heap[child]->deadline) {
+      child += 1;
+    }
+
+    if (event->deadline <= scheduler->heap[child]->deadline) {
+      break;
+    }
+
+    heap_place(scheduler, index, scheduler->heap[child]);
+    index = child;
+  }
+
+  heap_place(scheduler, index, event);
+}
+
+void scheduler_init(struct scheduler *scheduler) {
+  memset(scheduler, 0, sizeof(*scheduler));
+}
+
+void scheduler_event_init(struct scheduler_event *event, scheduler_event_func func, void *context) {
+  event->deadline = SCHEDULER_NEVER;
+  event->func = func;
+  event->context = context;
+  event->heap_index = -1;
+}
+
+void scheduler_schedule(struct scheduler *scheduler, struct scheduler_event *event, u64 deadline) {
+  if (scheduler_event_is_scheduled(event)) {
+    u64 old_deadline = event->deadline;
+    event->deadline = deadline;
+
+    if (deadline < old_deadline) {
+      heap_sift_up(scheduler, event->heap_index);
+    } else {
+      heap_sift_down(scheduler, event->heap_index);
+    }
+    return;
+  }
+
+  assert(scheduler->event_count < SCHEDULER_MAX_EVENTS);
+
+  event->deadline = deadline;
+  heap_place(scheduler, scheduler->event_count++, event);
+  heap_sift_up(scheduler, event->heap_index);
+}
+
+void scheduler_cancel(struct scheduler *scheduler, struct scheduler_event *event) {
+  if (!scheduler_event_is_scheduled(event)) {
+    return;
+  }
+
+  unsigned index = event->heap_index;
+  event->heap_index = -1;
+
+  struct scheduler_event *last = scheduler->heap[--scheduler->event_count];
+  if (last == event) {
+    return;
+  }
+
+  // Move the last event into the hole and restore the heap property from there.
+  heap_place(scheduler, index, last);
+  if (index > 0 && scheduler->heap[(index - 1) / 2]->deadline > last->deadline) {
+    heap_sift_up(scheduler, index);
+  } else {
+    heap_sift_down(scheduler, index);
+  }
+}
+
+void scheduler_run_due(struct scheduler *scheduler, u64 now) {
+  while (scheduler->event_count && scheduler->heap[0]->deadline <= now) {
+    struct scheduler_event *event = scheduler->heap[0];
+    scheduler_cancel(scheduler, event);
+    event->func(event->context, event->deadline);
+  }
+}
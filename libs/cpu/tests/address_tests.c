@@ -0,0 +1,95 @@
+#include <assert.h>
+#include <cpu/cpu.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMORY_SIZE 0x20000
+#define CODE 0x1000
+
+static byte *memory;
+static struct bus bus;
+static struct cpu cpu;
+
+static void run_code(const byte *code, unsigned code_size) {
+  memset(memory, 0, MEMORY_SIZE);
+  memcpy(memory + CODE, code, code_size);
+
+  bus_init(&bus, memory, MEMORY_SIZE);
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, CODE));
+
+  cpu.segs[DS] = 0x0800;
+  cpu.segs[SS] = 0x0900;
+  cpu.segs[ES] = 0x0a00;
+  cpu.regs.word[BX] = 0x0010;
+  cpu.regs.word[BP] = 0x0020;
+  cpu.regs.word[SI] = 0x0001;
+  cpu.regs.word[DI] = 0x0002;
+  cpu.regs.word[AX] = 0xbeef;
+}
+
+static void step(void) {
+  cpu_run(&cpu, 1);
+}
+
+void test_address_bx_si(void) {
+  // mov [bx+si], ax
+  const byte code[] = {0x89, 0x00};
+  run_code(code, sizeof(code));
+  step();
+
+  assert(memory[0x8011] == 0xef);
+  assert(memory[0x8012] == 0xbe);
+}
+
+void test_address_bp_defaults_to_ss(void) {
+  // mov [bp+di+0x10], al
+  const byte code[] = {0x88, 0x43, 0x10};
+  run_code(code, sizeof(code));
+  step();
+
+  assert(memory[0x9032] == 0xef);
+  assert(memory[0x8032] == 0x00);
+}
+
+void test_address_segment_override(void) {
+  // mov [es:bp-2], ax
+  const byte code[] = {0x26, 0x89, 0x46, 0xfe};
+  run_code(code, sizeof(code));
+  step();
+
+  assert(memory[0xa01e] == 0xef);
+  assert(memory[0xa01f] == 0xbe);
+}
+
+void test_address_direct(void) {
+  // mov [0x1234], ax
+  // mov cx, [0x1234]
+  const byte code[] = {0x89, 0x06, 0x34, 0x12, 0x8b, 0x0e, 0x34, 0x12};
+  run_code(code, sizeof(code));
+  step();
+  step();
+
+  assert(memory[0x9234] == 0xef);
+  assert(cpu.regs.word[CX] == 0xbeef);
+}
+
+void test_address_wraps_offset(void) {
+  // mov [bx+0xfff0], al
+  const byte code[] = {0x88, 0x87, 0xf0, 0xff};
+  run_code(code, sizeof(code));
+  step();
+
+  assert(memory[0x8000] == 0xef);
+}
+
+void address_tests(void) {
+  memory = malloc(MEMORY_SIZE);
+
+  test_address_bx_si();
+  test_address_bp_defaults_to_ss();
+  test_address_segment_override();
+  test_address_direct();
+  test_address_wraps_offset();
+
+  free(memory);
+}
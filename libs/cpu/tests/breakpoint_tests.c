@@ -0,0 +1,154 @@
+#include <assert.h>
+#include <cpu/cpu.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Count in AX forever.
+static const byte program[] = {
+    0x40,       // inc ax
+    0x43,       // inc bx
+    0xeb, 0xfc, // jmp 0x100
+};
+
+void test_run_stops_at_breakpoint(void) {
+  byte *memory = calloc(0x10000, 1);
+  memcpy(memory + 0x100, program, sizeof(program));
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+
+  struct cpu_debug debug;
+  memset(&debug, 0, sizeof(debug));
+  cpu.debug = &debug;
+
+  bool added = cpu_debug_add_breakpoint(&debug, 0x101);
+  assert(added);
+  added = cpu_debug_add_breakpoint(&debug, 0x101);
+  assert(added);
+  assert(debug.breakpoint_count == 1);
+
+  cpu_run(&cpu, 1000);
+  assert(cpu.stopped);
+  assert(cpu.ip == 0x101);
+  assert(cpu.regs.word[AX] == 1);
+
+  // Resuming executes the instruction at the breakpoint.
+  cpu_run(&cpu, 1000);
+  assert(cpu.stopped);
+  assert(cpu.ip == 0x101);
+  assert(cpu.regs.word[AX] == 2);
+  assert(cpu.regs.word[BX] == 1);
+
+  bool removed = cpu_debug_remove_breakpoint(&debug, 0x101);
+  assert(removed);
+  removed = cpu_debug_remove_breakpoint(&debug, 0x101);
+  assert(!removed);
+  assert(!debug.breakpoint_pages[0]);
+
+  u64 start = cpu.cycles;
+  cpu_run(&cpu, 1000);
+  assert(!cpu.stopped);
+  assert(cpu.cycles >= start + 1000);
+
+  free(memory);
+}
+
+static void stop_on_store(u32 addr, u8 value, void *context) {
+  UNUSED(addr);
+  UNUSED(value);
+  cpu_stop(context);
+}
+
+void test_run_stops_when_asked(void) {
+  byte *memory = calloc(0x10000, 1);
+  memcpy(memory + 0x100, program, sizeof(program));
+  memory[0x101] = 0x50; // push ax
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+  cpu.regs.word[SP] = 0x1000;
+  bool added = bus_add_store_observer(&bus, 0x0f00, 0x1000, &cpu, stop_on_store);
+  assert(added);
+
+  // Without a stopper the stores are only observed.
+  struct cpu_debug debug;
+  memset(&debug, 0, sizeof(debug));
+  cpu.debug = &debug;
+  cpu_run(&cpu, 20);
+  assert(!cpu.stopped);
+
+  debug.stopper_count = 1;
+  cpu_run(&cpu, 1000);
+  assert(cpu.stopped);
+  assert(cpu.ip == 0x102);
+
+  free(memory);
+}
+
+// The store that stops the cpu also raises an interrupt.
+static void stop_and_interrupt(u32 addr, u8 value, void *context) {
+  UNUSED(addr);
+  UNUSED(value);
+  struct cpu *cpu = context;
+  cpu_stop(cpu);
+  cpu->intr = true;
+}
+
+static int ack_vector_0x08(void *context) {
+  struct cpu *cpu = context;
+  cpu->intr = false;
+  return 0x08;
+}
+
+void test_run_stops_before_interrupt(void) {
+  byte *memory = calloc(0x10000, 1);
+  memcpy(memory + 0x100, program, sizeof(program));
+  memory[0x101] = 0x50; // push ax
+  memory[0x08 * 4 + 0] = 0x00;
+  memory[0x08 * 4 + 1] = 0x03;
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+  cpu_set_interrupt_controller(&cpu, &cpu, ack_vector_0x08);
+  cpu.regs.word[SP] = 0x1000;
+  cpu.flags.interrupt = 1;
+  bool added = bus_add_store_observer(&bus, 0x0f00, 0x1000, &cpu, stop_and_interrupt);
+  assert(added);
+
+  struct cpu_debug debug;
+  memset(&debug, 0, sizeof(debug));
+  debug.stopper_count = 1;
+  cpu.debug = &debug;
+  added = cpu_debug_add_breakpoint(&debug, 0x300);
+  assert(added);
+
+  // The stop is seen where the store happened, not in the interrupt handler.
+  cpu_run(&cpu, 1000);
+  assert(cpu.stopped);
+  assert(cpu.ip == 0x102);
+  assert(cpu.intr);
+
+  // Resuming takes the interrupt, whose handler has a breakpoint.
+  bus_remove_store_observer(&bus, &cpu, stop_and_interrupt);
+  cpu_run(&cpu, 1000);
+  assert(cpu.stopped);
+  assert(cpu.ip == 0x300);
+  assert(cpu.regs.word[SP] == 0x1000 - 2 - 6);
+
+  free(memory);
+}
+
+void breakpoint_tests(void) {
+  test_run_stops_at_breakpoint();
+  test_run_stops_when_asked();
+  test_run_stops_before_interrupt();
+}
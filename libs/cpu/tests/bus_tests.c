@@ -0,0 +1,92 @@
+#include <assert.h>
+#include <cpu/bus.h>
+#include <stdlib.h>
+
+#define MEMORY_SIZE 0x10000
+
+static void count_access(u32 addr, u8 value, void *context) {
+  UNUSED(addr);
+  UNUSED(value);
+  *(unsigned *)context += 1;
+}
+
+void test_bus_observers_see_their_range(void) {
+  byte *memory = calloc(MEMORY_SIZE, 1);
+  struct bus bus;
+  bus_init(&bus, memory, MEMORY_SIZE);
+
+  unsigned fetches = 0;
+  unsigned stores = 0;
+  unsigned all = 0;
+  bool added = bus_add_fetch_observer(&bus, 0x8000, 0x8010, &fetches, count_access);
+  assert(added);
+  added = bus_add_store_observer(&bus, 0x8008, 0x9008, &stores, count_access);
+  assert(added);
+  added = bus_add_observer(&bus, 0, BUS_ADDRESS_END, &all, count_access, count_access);
+  assert(added);
+
+  bus_store_word(&bus, 0x800f, 0x1234);
+  word value = bus_fetch_word(&bus, 0x800f);
+  assert(value == 0x1234);
+  bus_store_byte(&bus, 0x9008, 0x56);
+  bus_fetch_byte(&bus, 0x9000);
+  assert(fetches == 1);
+  assert(stores == 2);
+  assert(all == 6);
+
+  // Pages are only indexed while an observer covers them.
+  bool removed = bus_remove_fetch_observer(&bus, &all, count_access);
+  assert(!removed);
+  removed = bus_remove_observer(&bus, &all, count_access, count_access);
+  assert(removed);
+  assert(bus.store_pages[9] && !bus.fetch_pages[9]);
+  removed = bus_remove_store_observer(&bus, &stores, count_access);
+  assert(removed);
+  removed = bus_remove_store_observer(&bus, &stores, count_access);
+  assert(!removed);
+  assert(!bus.store_pages[9]);
+  assert(!bus.store_pages[8] && bus.fetch_pages[8]);
+
+  bus_store_byte(&bus, 0x8008, 0x78);
+  assert(stores == 2);
+  assert(all == 6);
+
+  free(memory);
+}
+
+void test_bus_observer_slots(void) {
+  byte *memory = calloc(MEMORY_SIZE, 1);
+  struct bus bus;
+  bus_init(&bus, memory, MEMORY_SIZE);
+
+  unsigned counts[BUS_OBSERVER_COUNT + 1] = {0};
+  for (unsigned i = 0; i < BUS_OBSERVER_COUNT; ++i) {
+    bool added = bus_add_store_observer(&bus, i, i + 1, &counts[i], count_access);
+    assert(added);
+  }
+  bool added =
+      bus_add_store_observer(&bus, 0x100, 0x101, &counts[BUS_OBSERVER_COUNT], count_access);
+  assert(!added);
+  added = bus_add_observer(&bus, 0x100, 0x100, &counts[0], 0, count_access);
+  assert(!added);
+
+  // A removed observer frees its slot.
+  bool removed = bus_remove_store_observer(&bus, &counts[3], count_access);
+  assert(removed);
+  added = bus_add_store_observer(&bus, 0x100, 0x101, &counts[BUS_OBSERVER_COUNT], count_access);
+  assert(added);
+
+  for (u32 addr = 0; addr <= 0x100; ++addr) {
+    bus_store_byte(&bus, addr, 1);
+  }
+  for (unsigned i = 0; i <= BUS_OBSERVER_COUNT; ++i) {
+    assert(counts[i] == (i == 3 ? 0 : 1));
+  }
+
+  free(memory);
+}
+
+void bus_tests(void) {
+  test_bus_observers_see_their_range();
+  test_bus_observer_slots();
+}
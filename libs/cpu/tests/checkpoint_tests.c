@@ -0,0 +1,259 @@
+#include <assert.h>
+#include <cpu/checkpoint.h>
+#include <cpu/replay.h>
+#include <stdlib.h>
+#include <string.h>
+#include <testing/machine.h>
+#include <unistd.h>
+
+#define MEMORY_SIZE 0x10000
+#define STEP_COUNT 100
+
+// Reads of port 0x40 count up.
+struct counter_device {
+  byte next;
+};
+
+static void counter_out(void *context, word offset, byte value) {
+  UNUSED(context);
+  UNUSED(offset);
+  UNUSED(value);
+}
+
+static byte counter_in(void *context, word offset) {
+  UNUSED(offset);
+  struct counter_device *device = context;
+  return device->next++;
+}
+
+static const struct port_handler counter_handler = {
+    .out_func = counter_out,
+    .in_func = counter_in,
+};
+
+// Stores its tick count at 0000:0300 every 10 cycles.
+struct ticker {
+  struct bus *bus;
+  struct scheduler *scheduler;
+  struct scheduler_event event;
+  byte ticks;
+};
+
+static void ticker_event(void *context, u64 deadline) {
+  struct ticker *ticker = context;
+  bus_store_byte(ticker->bus, 0x300, ++ticker->ticks);
+  scheduler_schedule(ticker->scheduler, &ticker->event, deadline + 10);
+}
+
+// Store the values read from port 0x40 from 0000:0200 on, forever.
+static const byte program[] = {
+    0xbb, 0x00, 0x02, // mov bx, 0x200
+    0xe4, 0x40,       // in al, 0x40
+    0x88, 0x07,       // mov [bx], al
+    0x43,             // inc bx
+    0xeb, 0xf9,       // jmp 0x103
+};
+
+struct machine {
+  struct testing_machine core;
+  struct counter_device device;
+  struct ticker ticker;
+  struct checkpoints checkpoints;
+};
+
+// Checkpoint the cpu and the ticker, and also the counter unless its reads are replayed.
+static void machine_init(struct machine *machine, size_t budget, bool checkpoint_device) {
+  testing_machine_init(&machine->core, MEMORY_SIZE, segment_offset(0x0000, 0x0100));
+  memcpy(machine->core.memory + 0x100, program, sizeof(program));
+
+  machine->device.next = 1;
+  ports_map_address(machine->core.ports, 0x40, 0x40, &counter_handler, &machine->device);
+
+  machine->ticker.bus = &machine->core.bus;
+  machine->ticker.scheduler = &machine->core.cpu.scheduler;
+  machine->ticker.ticks = 0;
+  scheduler_event_init(&machine->ticker.event, ticker_event, &machine->ticker);
+  scheduler_schedule(&machine->core.cpu.scheduler, &machine->ticker.event, 10);
+
+  checkpoints_init(&machine->checkpoints, &machine->core.cpu, 40, budget);
+  bool added =
+      checkpoints_add_region(&machine->checkpoints, &machine->ticker, sizeof(machine->ticker));
+  assert(added);
+  if (checkpoint_device) {
+    added =
+        checkpoints_add_region(&machine->checkpoints, &machine->device, sizeof(machine->device));
+    assert(added);
+  }
+  checkpoints_take(&machine->checkpoints);
+}
+
+static void machine_destroy(struct machine *machine) {
+  checkpoints_destroy(&machine->checkpoints);
+  testing_machine_destroy(&machine->core);
+}
+
+struct machine_state {
+  u64 hash;
+  word ip;
+  byte ticks;
+  u64 ticker_deadline;
+};
+
+static void machine_state(struct machine *machine, struct machine_state *state) {
+  state->hash = replay_state_hash(&machine->core.cpu);
+  state->ip = machine->core.cpu.ip;
+  state->ticks = machine->ticker.ticks;
+  state->ticker_deadline = machine->ticker.event.deadline;
+}
+
+static void assert_state(struct machine *machine, const struct machine_state *expected) {
+  struct machine_state state;
+  machine_state(machine, &state);
+
+  assert(state.hash == expected->hash);
+  assert(state.ip == expected->ip);
+  assert(state.ticks == expected->ticks);
+  assert(state.ticker_deadline == expected->ticker_deadline);
+  assert(scheduler_event_is_scheduled(&machine->ticker.event));
+}
+
+// Run forward one instruction at a time, keeping the state before each one.
+static void run_forward(struct machine *machine, struct machine_state *states) {
+  for (unsigned i = 0; i < STEP_COUNT; ++i) {
+    machine_state(machine, &states[i]);
+    cpu_run(&machine->core.cpu, 1);
+  }
+}
+
+void test_checkpoints_step_back(void) {
+  struct machine machine;
+  machine_init(&machine, 1 << 20, true);
+
+  struct machine_state states[STEP_COUNT];
+  run_forward(&machine, states);
+  assert(machine.checkpoints.count > 5);
+
+  for (int i = STEP_COUNT - 1; i >= 0; --i) {
+    bool stepped = checkpoints_step_back(&machine.checkpoints);
+    assert(stepped);
+    assert_state(&machine, &states[i]);
+  }
+  bool stepped = checkpoints_step_back(&machine.checkpoints);
+  assert(!stepped);
+
+  // Going forward again does the same thing.
+  for (unsigned i = 0; i < STEP_COUNT; ++i) {
+    assert_state(&machine, &states[i]);
+    cpu_run(&machine.core.cpu, 1);
+  }
+
+  machine_destroy(&machine);
+}
+
+void test_checkpoints_run_back_to_write(void) {
+  struct machine machine;
+  machine_init(&machine, 1 << 20, true);
+
+  struct machine_state states[STEP_COUNT];
+  run_forward(&machine, states);
+  assert(machine.core.memory[0x205] == 6);
+
+  bool found = checkpoints_run_back_to_write(&machine.checkpoints, 0x205);
+  assert(found);
+  assert(machine.core.cpu.ip == 0x105);
+  assert(machine.core.cpu.regs.word[BX] == 0x205);
+  assert(machine.core.memory[0x205] == 0);
+
+  // The loop stores at 0x205 only once. Not finding an earlier write changes nothing.
+  struct machine_state before;
+  machine_state(&machine, &before);
+  u32 count = machine.checkpoints.count;
+  found = checkpoints_run_back_to_write(&machine.checkpoints, 0x205);
+  assert(!found);
+  assert_state(&machine, &before);
+  assert(machine.core.memory[0x205] == 0);
+  assert(machine.checkpoints.count == count);
+
+  // The ticker writes to 0x300 between instructions.
+  run_forward(&machine, states);
+  found = checkpoints_run_back_to_write(&machine.checkpoints, 0x300);
+  assert(found);
+  assert(machine.ticker.event.deadline > machine.core.cpu.cycles);
+  assert(machine.ticker.event.deadline - machine.core.cpu.cycles <= 10);
+
+  machine_destroy(&machine);
+}
+
+void test_checkpoints_budget(void) {
+  size_t checkpoint_size = sizeof(struct checkpoint) + sizeof(struct ticker) +
+                           sizeof(struct counter_device) + 4 + 0x1000;
+  size_t budget = MEMORY_SIZE + 4 * checkpoint_size;
+
+  struct machine machine;
+  machine_init(&machine, budget, true);
+
+  struct machine_state states[STEP_COUNT];
+  run_forward(&machine, states);
+  assert(machine.checkpoints.count <= 5);
+  assert(machine.checkpoints.used <= budget);
+
+  // The recent past is still there, with the memory of the evicted checkpoints.
+  u64 oldest = machine.checkpoints.list[0].cpu.cycles;
+  int i = STEP_COUNT - 1;
+  for (; i >= 0 && checkpoints_step_back(&machine.checkpoints); --i) {
+    assert_state(&machine, &states[i]);
+  }
+  assert(machine.core.cpu.cycles == oldest);
+  assert(i > 0);
+
+  machine_destroy(&machine);
+}
+
+void test_checkpoints_replay_inputs(void) {
+  char path[64];
+  strcpy(path, "/tmp/checkpoint_tests_XXXXXX");
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  // The counter is not checkpointed, only its reads are logged.
+  struct machine machine;
+  machine_init(&machine, 1 << 20, false);
+
+  struct replay replay;
+  bool started = replay_init(&replay, &machine.core.cpu, rm_record, path);
+  assert(started);
+  checkpoints_destroy(&machine.checkpoints);
+  checkpoints_init(&machine.checkpoints, &machine.core.cpu, 40, 1 << 20);
+  bool added =
+      checkpoints_add_region(&machine.checkpoints, &machine.ticker, sizeof(machine.ticker));
+  assert(added);
+  checkpoints_take(&machine.checkpoints);
+
+  struct machine_state states[STEP_COUNT];
+  run_forward(&machine, states);
+  u64 record_count = replay.record_count;
+
+  for (int i = STEP_COUNT - 1; i >= STEP_COUNT / 2; --i) {
+    bool stepped = checkpoints_step_back(&machine.checkpoints);
+    assert(stepped);
+    assert_state(&machine, &states[i]);
+  }
+  assert(replay.mode == rm_replay && !replay.diverged);
+
+  // Catching up with the log goes back to recording.
+  cpu_run(&machine.core.cpu, 1000);
+  assert(replay.mode == rm_record);
+  assert(replay.record_count > record_count);
+
+  replay_destroy(&replay);
+  machine_destroy(&machine);
+  unlink(path);
+}
+
+void checkpoint_tests(void) {
+  test_checkpoints_step_back();
+  test_checkpoints_run_back_to_write();
+  test_checkpoints_budget();
+  test_checkpoints_replay_inputs();
+}
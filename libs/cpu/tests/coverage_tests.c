@@ -0,0 +1,127 @@
+#include <assert.h>
+#include <cpu/coverage.h>
+#include <cpu/cpu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Count CX down from 3, then skip over the inc.
+static const byte program[] = {
+    0xb9, 0x03, 0x00, // mov cx, 3
+    0x49,             // dec cx
+    0x75, 0xfd,       // jnz 0x103
+    0x72, 0x01,       // jb 0x109
+    0x40,             // inc ax
+    0xe3, 0x01,       // jcxz 0x10c
+    0x40,             // inc ax
+    0xf4,             // hlt
+};
+
+static void run_program(struct coverage *coverage) {
+  byte *memory = calloc(0x10000, 1);
+  memcpy(memory + 0x100, program, sizeof(program));
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+  cpu.coverage = coverage;
+
+  cpu_run(&cpu, 1000);
+  assert(cpu.halted);
+  assert(cpu.regs.word[AX] == 1);
+
+  free(memory);
+}
+
+void test_coverage_records_instructions_and_branches(void) {
+  struct coverage *coverage = malloc(sizeof(struct coverage));
+  coverage_init(coverage);
+  run_program(coverage);
+
+  static const u32 executed[] = {0x100, 0x103, 0x104, 0x106, 0x108, 0x109, 0x10c};
+  for (unsigned i = 0; i < ARRAY_SIZE(executed); ++i) {
+    assert(coverage_is_marked(coverage->executed, executed[i]));
+  }
+  assert(!coverage_is_marked(coverage->executed, 0x101));
+  assert(!coverage_is_marked(coverage->executed, 0x10b));
+
+  // jnz went both ways, jb never jumped and jcxz always did.
+  assert(coverage_is_marked(coverage->taken, 0x104));
+  assert(coverage_is_marked(coverage->not_taken, 0x104));
+  assert(!coverage_is_marked(coverage->taken, 0x106));
+  assert(coverage_is_marked(coverage->not_taken, 0x106));
+  assert(coverage_is_marked(coverage->taken, 0x109));
+  assert(!coverage_is_marked(coverage->not_taken, 0x109));
+  assert(!coverage_is_marked(coverage->taken, 0x100));
+  assert(!coverage_is_marked(coverage->not_taken, 0x100));
+
+  free(coverage);
+}
+
+void test_coverage_jump_to_next_instruction(void) {
+  byte *memory = calloc(0x10000, 1);
+  memory[0x100] = 0x75; // jnz 0x102
+  memory[0x101] = 0x00;
+  memory[0x102] = 0xf4; // hlt
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+
+  struct coverage *coverage = malloc(sizeof(struct coverage));
+  coverage_init(coverage);
+  cpu.coverage = coverage;
+
+  // Single steps are recorded as well. The jump lands where falling through would have.
+  cpu_step(&cpu);
+  cpu_step(&cpu);
+  assert(cpu.halted);
+  assert(coverage_is_marked(coverage->executed, 0x100));
+  assert(coverage_is_marked(coverage->executed, 0x102));
+  assert(coverage_is_marked(coverage->taken, 0x100));
+  assert(!coverage_is_marked(coverage->not_taken, 0x100));
+
+  free(coverage);
+  free(memory);
+}
+
+void test_coverage_save_and_load(void) {
+  char path[64];
+  strcpy(path, "/tmp/coverage_tests_XXXXXX");
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  struct coverage *coverage = malloc(sizeof(struct coverage));
+  coverage_init(coverage);
+  run_program(coverage);
+  bool saved = coverage_save(coverage, path);
+  assert(saved);
+
+  struct coverage *loaded = malloc(sizeof(struct coverage));
+  bool valid = coverage_load(loaded, path);
+  assert(valid);
+  assert(!memcmp(coverage, loaded, sizeof(*coverage)));
+
+  // Not a coverage file.
+  FILE *file = fopen(path, "wb");
+  fputs("EESRPL1", file);
+  fclose(file);
+  valid = coverage_load(loaded, path);
+  assert(!valid);
+
+  free(coverage);
+  free(loaded);
+  unlink(path);
+}
+
+void coverage_tests(void) {
+  test_coverage_records_instructions_and_branches();
+  test_coverage_jump_to_next_instruction();
+  test_coverage_save_and_load();
+}
@@ -0,0 +1,24 @@
+void address_tests(void);
+void breakpoint_tests(void);
+void bus_tests(void);
+void checkpoint_tests(void);
+void coverage_tests(void);
+void interrupt_tests(void);
+void ports_tests(void);
+void replay_tests(void);
+void scheduler_tests(void);
+void string_tests(void);
+
+int main(int argc, char **argv) {
+  address_tests();
+  breakpoint_tests();
+  bus_tests();
+  checkpoint_tests();
+  coverage_tests();
+  interrupt_tests();
+  ports_tests();
+  replay_tests();
+  scheduler_tests();
+  string_tests();
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include <assert.h>
+#include <cpu/cpu.h>
+#include <stdlib.h>
+
+static int ack_vector_0x08(void *context) {
+  UNUSED(context);
+  return 0x08;
+}
+
+void test_int_and_iret(void) {
+  byte *memory = calloc(0x10000, 1);
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+  cpu.regs.word[SP] = 0x1000;
+  cpu.flags.interrupt = 1;
+
+  // int 0x21 at 0000:0100, handler at 0000:0200 is a single iret.
+  memory[0x100] = 0xcd;
+  memory[0x101] = 0x21;
+  memory[0x200] = 0xcf;
+  memory[0x21 * 4 + 0] = 0x00;
+  memory[0x21 * 4 + 1] = 0x02;
+
+  cpu_run(&cpu, 1);
+  assert(cpu.ip == 0x200);
+  assert(cpu.regs.word[SP] == 0x1000 - 6);
+  assert(!cpu.flags.interrupt);
+
+  cpu_run(&cpu, 1);
+  assert(cpu.ip == 0x102);
+  assert(cpu.regs.word[SP] == 0x1000);
+  assert(cpu.flags.interrupt);
+
+  free(memory);
+}
+
+void test_hardware_interrupt_wakes_halted_cpu(void) {
+  byte *memory = calloc(0x10000, 1);
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+  cpu_set_interrupt_controller(&cpu, 0, ack_vector_0x08);
+  cpu.regs.word[SP] = 0x1000;
+  cpu.flags.interrupt = 1;
+
+  // hlt at 0000:0100, handler for vector 8 at 0000:0300 halts again.
+  memory[0x100] = 0xf4;
+  memory[0x300] = 0xf4;
+  memory[0x08 * 4 + 0] = 0x00;
+  memory[0x08 * 4 + 1] = 0x03;
+
+  cpu_run(&cpu, 100);
+  assert(cpu.halted);
+  assert(cpu.ip == 0x101);
+
+  cpu.intr = true;
+  cpu_run(&cpu, 1);
+  assert(cpu.segs[CS] == 0x0000);
+  assert(cpu.ip == 0x301);
+  assert(cpu.regs.word[SP] == 0x1000 - 6);
+
+  free(memory);
+}
+
+static bool hook_only_ah_0(void *context, struct cpu *cpu, u8 vector) {
+  unsigned *calls = context;
+  ++*calls;
+
+  if (cpu->regs.byte[AH] != 0) {
+    return false;
+  }
+
+  cpu->regs.word[AX] = vector;
+  return true;
+}
+
+void test_interrupt_hook(void) {
+  byte *memory = calloc(0x10000, 1);
+
+  struct bus bus;
+  bus_init(&bus, memory, 0x10000);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0x0000, 0x0100));
+  cpu.regs.word[SP] = 0x1000;
+
+  unsigned calls = 0;
+  cpu_set_interrupt_hook(&cpu, 0x21, &calls, hook_only_ah_0);
+
+  // int 0x21 twice at 0000:0100, the guest handler at 0000:0200.
+  memory[0x100] = 0xcd;
+  memory[0x101] = 0x21;
+  memory[0x102] = 0xcd;
+  memory[0x103] = 0x21;
+  memory[0x21 * 4 + 0] = 0x00;
+  memory[0x21 * 4 + 1] = 0x02;
+
+  // Serviced by the hook, nothing is pushed.
+  cpu_run(&cpu, 1);
+  assert(calls == 1);
+  assert(cpu.regs.word[AX] == 0x21);
+  assert(cpu.ip == 0x102);
+  assert(cpu.regs.word[SP] == 0x1000);
+
+  // Declined by the hook, so the guest handler runs.
+  cpu.regs.word[AX] = 0x0100;
+  cpu_run(&cpu, 1);
+  assert(calls == 2);
+  assert(cpu.ip == 0x200);
+  assert(cpu.regs.word[SP] == 0x1000 - 6);
+
+  free(memory);
+}
+
+void interrupt_tests(void) {
+  test_int_and_iret();
+  test_hardware_interrupt_wakes_halted_cpu();
+  test_interrupt_hook();
+}
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <cpu/ports.h>
+#include <stdlib.h>
+
+struct fake_device {
+  word last_offset;
+  word last_value;
+  unsigned byte_calls;
+  unsigned word_calls;
+};
+
+static void fake_out(void *context, word offset, byte value) {
+  struct fake_device *device = context;
+  device->last_offset = offset;
+  device->last_value = value;
+  device->byte_calls += 1;
+}
+
+static byte fake_in(void *context, word offset) {
+  struct fake_device *device = context;
+  device->byte_calls += 1;
+  return (byte)offset;
+}
+
+static void fake_out_word(void *context, word offset, word value) {
+  struct fake_device *device = context;
+  device->last_offset = offset;
+  device->last_value = value;
+  device->word_calls += 1;
+}
+
+static word fake_in_word(void *context, word offset) {
+  struct fake_device *device = context;
+  device->word_calls += 1;
+  return 0x1000 + offset;
+}
+
+static const struct port_handler fake_byte_handler = {
+    .out_func = fake_out,
+    .in_func = fake_in,
+};
+
+static const struct port_handler fake_word_handler = {
+    .out_func = fake_out,
+    .in_func = fake_in,
+    .out_word_func = fake_out_word,
+    .in_word_func = fake_in_word,
+};
+
+void test_ports_unmapped_reads_open_bus(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  ports_out(ports, 0x80, 0x12);
+  assert(ports_in(ports, 0x80) == PORT_OPEN_BUS);
+  assert(ports_in_word(ports, 0x80) == 0xffff);
+
+  free(ports);
+}
+
+void test_ports_offsets_and_merging(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct fake_device device = {0};
+  int result = ports_map_address(ports, 0x3d4, 0x3d5, &fake_byte_handler, &device);
+  assert(result == 0);
+  result = ports_map_address(ports, 0x3d6, 0x3da, &fake_byte_handler, &device);
+  assert(result == 0);
+  assert(ports->range_count == 1);
+
+  ports_out(ports, 0x3d8, 0x09);
+  assert(device.last_offset == 4);
+  assert(device.last_value == 0x09);
+  assert(ports_in(ports, 0x3da) == 6);
+
+  // The last port can be mapped without the mapping loop running forever.
+  result = ports_map_address(ports, 0xfff0, 0xffff, &fake_byte_handler, &device);
+  assert(result == 0);
+  assert(ports_in(ports, 0xffff) == 0x0f);
+
+  free(ports);
+}
+
+void test_ports_word_access(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct fake_device word_device = {0};
+  struct fake_device byte_device = {0};
+  ports_map_address(ports, 0x1f0, 0x1f7, &fake_word_handler, &word_device);
+  ports_map_address(ports, 0x300, 0x301, &fake_byte_handler, &byte_device);
+
+  ports_out_word(ports, 0x1f0, 0xbeef);
+  assert(word_device.word_calls == 1);
+  assert(word_device.byte_calls == 0);
+  assert(word_device.last_value == 0xbeef);
+  assert(ports_in_word(ports, 0x1f2) == 0x1002);
+
+  // Devices without word handlers get two byte accesses.
+  assert(ports_in_word(ports, 0x300) == 0x0100);
+  assert(byte_device.byte_calls == 2);
+
+  // A word straddling the end of a range is split as well.
+  assert(ports_in_word(ports, 0x1f7) == 0xff07);
+
+  free(ports);
+}
+
+void test_ports_intercept_and_unmap(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct fake_device device = {0};
+  struct fake_device watcher = {0};
+  int result = ports_map_address(ports, 0x3d0, 0x3df, &fake_byte_handler, &device);
+  assert(result == 0);
+  assert(!ports_lookup(ports, 0x3e0));
+  assert(ports_lookup(ports, 0x3d8)->context == &device);
+
+  struct port_range previous;
+  result = ports_intercept(ports, 0x3d8, &fake_byte_handler, &watcher, &previous);
+  assert(result == 0);
+  assert(previous.context == &device && previous.start == 0x3d0);
+  ports_out(ports, 0x3d8, 0x01);
+  assert(watcher.byte_calls == 1 && watcher.last_offset == 0);
+  assert(!device.byte_calls);
+
+  // The port goes back to the range it was taken from, with its offset.
+  ports_unmap(ports, 0x3d8, 0x3d8);
+  ports_out(ports, 0x3d8, 0x02);
+  assert(device.byte_calls == 1 && device.last_offset == 8);
+
+  result = ports_intercept(ports, 0xe9, &fake_byte_handler, &watcher, &previous);
+  assert(result == 0);
+  assert(!previous.handler);
+  ports_unmap(ports, 0xe9, 0xe9);
+  assert(ports_in(ports, 0xe9) == PORT_OPEN_BUS);
+
+  // Freed ranges are reused.
+  ports_unmap(ports, 0x3d0, 0x3df);
+  assert(!ports_lookup(ports, 0x3d8));
+  result = ports_map_address(ports, 0x60, 0x63, &fake_byte_handler, &watcher);
+  assert(result == 0);
+  assert(ports->range_count == 2);
+
+  free(ports);
+}
+
+void test_ports_remap_frees_covered_ranges(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct fake_device devices[2] = {{0}};
+  for (unsigned i = 0; i < PORT_RANGE_MAX * 2; ++i) {
+    int result = ports_map_address(ports, 0x3f0, 0x3f7, &fake_byte_handler, &devices[i % 2]);
+    assert(result == 0);
+  }
+  assert(ports->range_count == 2);
+
+  ports_out(ports, 0x3f2, 0x01);
+  assert(devices[1].byte_calls == 1 && devices[1].last_offset == 2);
+  assert(!devices[0].byte_calls);
+
+  free(ports);
+}
+
+void ports_tests(void) {
+  test_ports_unmapped_reads_open_bus();
+  test_ports_offsets_and_merging();
+  test_ports_word_access();
+  test_ports_intercept_and_unmap();
+  test_ports_remap_frees_covered_ranges();
+}
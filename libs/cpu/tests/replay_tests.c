@@ -0,0 +1,190 @@
+#include <assert.h>
+#include <cpu/replay.h>
+#include <stdlib.h>
+#include <string.h>
+#include <testing/machine.h>
+#include <unistd.h>
+
+// A device whose reads depend on the host, like a clock.
+struct noisy_device {
+  byte next;
+};
+
+static void noisy_out(void *context, word offset, byte value) {
+  UNUSED(context);
+  UNUSED(offset);
+  UNUSED(value);
+}
+
+static byte noisy_in(void *context, word offset) {
+  UNUSED(offset);
+  struct noisy_device *device = context;
+  return device->next++;
+}
+
+static const struct port_handler noisy_handler = {
+    .out_func = noisy_out,
+    .in_func = noisy_in,
+};
+
+// Read port 0x40 four times into 0000:0200, then halt.
+static const byte program[] = {
+    0xb9, 0x04, 0x00, // mov cx, 4
+    0xbb, 0x00, 0x02, // mov bx, 0x200
+    0xe4, 0x40,       // in al, 0x40
+    0x88, 0x07,       // mov [bx], al
+    0x43,             // inc bx
+    0x49,             // dec cx
+    0x75, 0xf8,       // jnz
+    0xf4,             // hlt
+};
+
+struct machine {
+  struct testing_machine core;
+  struct noisy_device device;
+};
+
+static void machine_init(struct machine *machine, byte noise) {
+  testing_machine_init(&machine->core, 0x10000, segment_offset(0x0000, 0x0100));
+  memcpy(machine->core.memory + 0x100, program, sizeof(program));
+
+  machine->device.next = noise;
+  ports_map_address(machine->core.ports, 0x40, 0x40, &noisy_handler, &machine->device);
+}
+
+static void machine_destroy(struct machine *machine) {
+  testing_machine_destroy(&machine->core);
+}
+
+static void temp_path(char *path) {
+  strcpy(path, "/tmp/replay_tests_XXXXXX");
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+}
+
+void test_replay_feeds_port_reads_back(void) {
+  char path[64];
+  temp_path(path);
+
+  struct machine recorded;
+  machine_init(&recorded, 0x10);
+
+  struct replay replay;
+  bool started = replay_init(&replay, &recorded.core.cpu, rm_record, path);
+  assert(started);
+  replay_hash_every(&replay, 16);
+  cpu_run(&recorded.core.cpu, 1000);
+  assert(recorded.core.cpu.halted);
+  assert(replay.record_count > 4);
+  u64 record_count = replay.record_count;
+  replay_destroy(&replay);
+
+  assert(!memcmp(recorded.core.memory + 0x200, "\x10\x11\x12\x13", 4));
+  assert(!recorded.core.cpu.replay);
+
+  // The device reads differently, but the program sees what it saw when recorded.
+  struct machine replayed;
+  machine_init(&replayed, 0x80);
+
+  started = replay_init(&replay, &replayed.core.cpu, rm_replay, path);
+  assert(started);
+  replay_hash_every(&replay, 16);
+  cpu_run(&replayed.core.cpu, 1000);
+  assert(!replay.diverged);
+  assert(replay.ended);
+  assert(replay.record_count == record_count);
+  replay_destroy(&replay);
+
+  assert(!memcmp(replayed.core.memory + 0x200, "\x10\x11\x12\x13", 4));
+  assert(replay_state_hash(&replayed.core.cpu) == replay_state_hash(&recorded.core.cpu));
+
+  machine_destroy(&recorded);
+  machine_destroy(&replayed);
+  unlink(path);
+}
+
+void test_replay_detects_divergence(void) {
+  char path[64];
+  temp_path(path);
+
+  struct machine recorded;
+  machine_init(&recorded, 0x10);
+
+  struct replay replay;
+  bool started = replay_init(&replay, &recorded.core.cpu, rm_record, path);
+  assert(started);
+  replay_hash_every(&replay, 16);
+  cpu_run(&recorded.core.cpu, 1000);
+  replay_destroy(&replay);
+
+  // Only 3 reads this time, so the state is different when the loop ends.
+  struct machine replayed;
+  machine_init(&replayed, 0x10);
+  replayed.core.memory[0x101] = 0x03;
+
+  started = replay_init(&replay, &replayed.core.cpu, rm_replay, path);
+  assert(started);
+  replay_hash_every(&replay, 16);
+  cpu_run(&replayed.core.cpu, 1000);
+  assert(replay.diverged);
+  assert(replay.divergence_cycles > 0 && replay.divergence_cycles <= replayed.core.cpu.cycles);
+  replay_destroy(&replay);
+
+  machine_destroy(&recorded);
+  machine_destroy(&replayed);
+  unlink(path);
+}
+
+void test_replay_host_inputs(void) {
+  char path[64];
+  temp_path(path);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, 0, segment_offset(0, 0));
+
+  struct replay replay;
+  bool started = replay_init(&replay, &cpu, rm_record, path);
+  assert(started);
+  u64 value;
+  bool fetched = replay_fetch(&replay, ri_host_time, 0, &value);
+  assert(!fetched);
+  u64 input = replay_input(&replay, ri_host_time, 0, 1234);
+  assert(input == 1234);
+  cpu.cycles = 10;
+  input = replay_input(&replay, ri_console_read, 0, 'a');
+  assert(input == 'a');
+  replay_destroy(&replay);
+
+  cpu_init(&cpu, 0, 0, segment_offset(0, 0));
+  started = replay_init(&replay, &cpu, rm_replay, path);
+  assert(started);
+  fetched = replay_fetch(&replay, ri_host_time, 0, &value);
+  assert(fetched && value == 1234);
+  cpu.cycles = 10;
+  input = replay_input(&replay, ri_console_read, 0, 'b');
+  assert(input == 'a');
+  assert(replay.ended && !replay.diverged);
+
+  // Past the end of the log, inputs come from the host again.
+  fetched = replay_fetch(&replay, ri_console_read, 0, &value);
+  assert(!fetched);
+  input = replay_input(&replay, ri_console_read, 0, 'c');
+  assert(input == 'c');
+  replay_destroy(&replay);
+
+  // Not a replay log.
+  FILE *file = fopen(path, "wb");
+  fputs("garbage", file);
+  fclose(file);
+  started = replay_init(&replay, &cpu, rm_replay, path);
+  assert(!started);
+
+  unlink(path);
+}
+
+void replay_tests(void) {
+  test_replay_feeds_port_reads_back();
+  test_replay_detects_divergence();
+  test_replay_host_inputs();
+}
@@ -0,0 +1,65 @@
+#include <assert.h>
+#include <cpu/scheduler.h>
+
+struct fired_log {
+  u64 deadlines[8];
+  unsigned count;
+};
+
+static void log_fired(void *context, u64 deadline) {
+  struct fired_log *log = context;
+  log->deadlines[log->count++] = deadline;
+}
+
+void test_scheduler_fires_in_deadline_order(void) {
+  struct scheduler scheduler;
+  scheduler_init(&scheduler);
+
+  struct fired_log log = {0};
+  struct scheduler_event events[3];
+  for (unsigned i = 0; i < ARRAY_SIZE(events); ++i) {
+    scheduler_event_init(&events[i], log_fired, &log);
+  }
+
+  scheduler_schedule(&scheduler, &events[0], 300);
+  scheduler_schedule(&scheduler, &events[1], 100);
+  scheduler_schedule(&scheduler, &events[2], 200);
+  assert(scheduler_next_deadline(&scheduler) == 100);
+
+  scheduler_run_due(&scheduler, 250);
+  assert(log.count == 2);
+  assert(log.deadlines[0] == 100);
+  assert(log.deadlines[1] == 200);
+  assert(scheduler_next_deadline(&scheduler) == 300);
+}
+
+void test_scheduler_reschedule_and_cancel(void) {
+  struct scheduler scheduler;
+  scheduler_init(&scheduler);
+
+  struct fired_log log = {0};
+  struct scheduler_event a;
+  struct scheduler_event b;
+  scheduler_event_init(&a, log_fired, &log);
+  scheduler_event_init(&b, log_fired, &log);
+
+  scheduler_schedule(&scheduler, &a, 100);
+  scheduler_schedule(&scheduler, &b, 200);
+  scheduler_schedule(&scheduler, &a, 300);
+  assert(scheduler_next_deadline(&scheduler) == 200);
+
+  scheduler_cancel(&scheduler, &b);
+  assert(!scheduler_event_is_scheduled(&b));
+  assert(scheduler_next_deadline(&scheduler) == 300);
+
+  scheduler_cancel(&scheduler, &a);
+  assert(scheduler_next_deadline(&scheduler) == SCHEDULER_NEVER);
+
+  scheduler_run_due(&scheduler, 1000);
+  assert(log.count == 0);
+}
+
+void scheduler_tests(void) {
+  test_scheduler_fires_in_deadline_order();
+  test_scheduler_reschedule_and_cancel();
+}
@@ -0,0 +1,257 @@
+#include <assert.h>
+#include <cpu/cpu.h>
+#include <string.h>
+#include <testing/machine.h>
+
+#define MEMORY_SIZE 0x20000
+#define CODE 0x1000
+
+static void count_access(u32 addr, u8 value, void *context) {
+  UNUSED(addr);
+  UNUSED(value);
+  *(unsigned *)context += 1;
+}
+
+static void machine_init(struct testing_machine *machine, const byte *code, unsigned code_size) {
+  testing_machine_init(machine, MEMORY_SIZE, segment_offset(0x0000, CODE));
+  memcpy(machine->memory + CODE, code, code_size);
+}
+
+// Run both with the direct memory path and with an observer of the whole bus forcing the
+// per-element path and check that they agree.
+static void run_both_ways(const byte *code, unsigned code_size,
+                          void (*setup)(struct testing_machine *),
+                          void (*check)(struct testing_machine *)) {
+  struct testing_machine fast;
+  machine_init(&fast, code, code_size);
+  setup(&fast);
+  cpu_run(&fast.cpu, 1);
+  check(&fast);
+
+  struct testing_machine slow;
+  machine_init(&slow, code, code_size);
+  unsigned accesses = 0;
+  bool added =
+      bus_add_observer(&slow.bus, 0, BUS_ADDRESS_END, &accesses, count_access, count_access);
+  assert(added);
+  setup(&slow);
+  cpu_run(&slow.cpu, 1);
+  check(&slow);
+  assert(accesses > code_size);
+
+  assert(memcmp(fast.memory, slow.memory, MEMORY_SIZE) == 0);
+  assert(memcmp(&fast.cpu.regs, &slow.cpu.regs, sizeof(fast.cpu.regs)) == 0);
+  assert(memcmp(&fast.cpu.flags, &slow.cpu.flags, sizeof(fast.cpu.flags)) == 0);
+
+  testing_machine_destroy(&fast);
+  testing_machine_destroy(&slow);
+}
+
+static void setup_rep_stosw(struct testing_machine *machine) {
+  machine->cpu.segs[ES] = 0x0800;
+  machine->cpu.regs.word[DI] = 0x0010;
+  machine->cpu.regs.word[CX] = 0x0100;
+  machine->cpu.regs.word[AX] = 0x1234;
+}
+
+static void check_rep_stosw(struct testing_machine *machine) {
+  assert(machine->cpu.regs.word[CX] == 0);
+  assert(machine->cpu.regs.word[DI] == 0x0210);
+  assert(machine->cpu.ip == CODE + 2);
+  assert(machine->memory[0x8010] == 0x34);
+  assert(machine->memory[0x820f] == 0x12);
+  assert(machine->memory[0x8210] == 0x00);
+}
+
+void test_rep_stosw(void) {
+  const byte code[] = {0xf3, 0xab};
+  run_both_ways(code, sizeof(code), setup_rep_stosw, check_rep_stosw);
+}
+
+void test_rep_stosw_store_observer(void) {
+  const byte code[] = {0xf3, 0xab};
+  struct testing_machine machine;
+  machine_init(&machine, code, sizeof(code));
+  setup_rep_stosw(&machine);
+
+  // Only the stores inside the observed range are reported, the rest still hit memory.
+  unsigned stores = 0;
+  bool added = bus_add_store_observer(&machine.bus, 0x8100, 0x8110, &stores, count_access);
+  assert(added);
+  assert(!bus_plain_memory(&machine.bus, 0x8010, 0x200));
+  assert(bus_plain_memory(&machine.bus, 0x9000, 0x200));
+
+  cpu_run(&machine.cpu, 1);
+  check_rep_stosw(&machine);
+  assert(stores == 0x10);
+
+  testing_machine_destroy(&machine);
+}
+
+void test_rep_stosw_marks_pages_dirty(void) {
+  const byte code[] = {0xf3, 0xab};
+  struct testing_machine machine;
+  machine_init(&machine, code, sizeof(code));
+  setup_rep_stosw(&machine);
+
+  // Once the observer is removed the stores go straight to memory, which still records the page.
+  unsigned stores = 0;
+  bool added = bus_add_store_observer(&machine.bus, 0x8100, 0x8110, &stores, count_access);
+  assert(added);
+  bool removed = bus_remove_store_observer(&machine.bus, &stores, count_access);
+  assert(removed);
+  removed = bus_remove_store_observer(&machine.bus, &stores, count_access);
+  assert(!removed);
+  assert(bus_plain_memory(&machine.bus, 0x8010, 0x200));
+  memset(machine.bus.dirty_pages, 0, sizeof(machine.bus.dirty_pages));
+
+  cpu_run(&machine.cpu, 1);
+  check_rep_stosw(&machine);
+  assert(stores == 0);
+  assert(machine.bus.dirty_pages[0] == 1u << 8);
+
+  testing_machine_destroy(&machine);
+}
+
+static void setup_rep_movsb_overlapping(struct testing_machine *machine) {
+  // Copying forward onto the next byte replicates the first byte, a common fill idiom.
+  machine->memory[0x8000] = 0xaa;
+  machine->memory[0x8001] = 0xbb;
+  machine->cpu.segs[DS] = 0x0800;
+  machine->cpu.segs[ES] = 0x0800;
+  machine->cpu.regs.word[SI] = 0x0000;
+  machine->cpu.regs.word[DI] = 0x0001;
+  machine->cpu.regs.word[CX] = 0x0010;
+}
+
+static void check_rep_movsb_overlapping(struct testing_machine *machine) {
+  for (unsigned i = 0; i <= 0x10; ++i) {
+    assert(machine->memory[0x8000 + i] == 0xaa);
+  }
+  assert(machine->cpu.regs.word[SI] == 0x0010);
+  assert(machine->cpu.regs.word[DI] == 0x0011);
+}
+
+void test_rep_movsb_overlapping(void) {
+  const byte code[] = {0xf3, 0xa4};
+  run_both_ways(code, sizeof(code), setup_rep_movsb_overlapping, check_rep_movsb_overlapping);
+}
+
+static void setup_rep_movsw_backwards(struct testing_machine *machine) {
+  for (unsigned i = 0; i < 0x20; ++i) {
+    machine->memory[0x8000 + i] = i;
+  }
+  machine->cpu.flags.direction = 1;
+  machine->cpu.segs[DS] = 0x0800;
+  machine->cpu.segs[ES] = 0x0900;
+  machine->cpu.regs.word[SI] = 0x001e;
+  machine->cpu.regs.word[DI] = 0x001e;
+  machine->cpu.regs.word[CX] = 0x0010;
+}
+
+static void check_rep_movsw_backwards(struct testing_machine *machine) {
+  assert(memcmp(machine->memory + 0x8000, machine->memory + 0x9000, 0x20) == 0);
+  assert(machine->cpu.regs.word[SI] == 0xfffe);
+  assert(machine->cpu.regs.word[DI] == 0xfffe);
+}
+
+void test_rep_movsw_backwards(void) {
+  const byte code[] = {0xf3, 0xa5};
+  run_both_ways(code, sizeof(code), setup_rep_movsw_backwards, check_rep_movsw_backwards);
+}
+
+void test_rep_movsw_fetch_observer(void) {
+  const byte code[] = {0xf3, 0xa5};
+  struct testing_machine machine;
+  machine_init(&machine, code, sizeof(code));
+  setup_rep_movsw_backwards(&machine);
+
+  // Only the fetches inside the observed range are reported, the copy is the same.
+  unsigned fetches = 0;
+  bool added = bus_add_fetch_observer(&machine.bus, 0x8004, 0x8008, &fetches, count_access);
+  assert(added);
+  assert(!bus_plain_memory(&machine.bus, 0x8000, 0x20));
+  assert(bus_plain_memory(&machine.bus, 0x9000, 0x20));
+
+  cpu_run(&machine.cpu, 1);
+  check_rep_movsw_backwards(&machine);
+  assert(fetches == 4);
+
+  bool removed = bus_remove_fetch_observer(&machine.bus, &fetches, count_access);
+  assert(removed);
+  assert(bus_plain_memory(&machine.bus, 0x8000, 0x20));
+
+  testing_machine_destroy(&machine);
+}
+
+static void setup_repne_scasb(struct testing_machine *machine) {
+  memcpy(machine->memory + 0x8000, "hello, world", 12);
+  machine->cpu.segs[ES] = 0x0800;
+  machine->cpu.regs.word[DI] = 0x0000;
+  machine->cpu.regs.word[CX] = 0x0020;
+  machine->cpu.regs.byte[AL] = ',';
+}
+
+static void check_repne_scasb(struct testing_machine *machine) {
+  assert(machine->cpu.regs.word[DI] == 0x0006);
+  assert(machine->cpu.regs.word[CX] == 0x001a);
+  assert(machine->cpu.flags.zero);
+}
+
+void test_repne_scasb(void) {
+  const byte code[] = {0xf2, 0xae};
+  run_both_ways(code, sizeof(code), setup_repne_scasb, check_repne_scasb);
+}
+
+static void setup_repe_cmpsb(struct testing_machine *machine) {
+  memcpy(machine->memory + 0x8000, "abcdef", 6);
+  memcpy(machine->memory + 0x9000, "abcxef", 6);
+  machine->cpu.segs[DS] = 0x0800;
+  machine->cpu.segs[ES] = 0x0900;
+  machine->cpu.regs.word[CX] = 0x0006;
+}
+
+static void check_repe_cmpsb(struct testing_machine *machine) {
+  assert(machine->cpu.regs.word[SI] == 0x0004);
+  assert(machine->cpu.regs.word[DI] == 0x0004);
+  assert(machine->cpu.regs.word[CX] == 0x0002);
+  assert(!machine->cpu.flags.zero);
+  assert(machine->cpu.flags.carry);
+}
+
+void test_repe_cmpsb(void) {
+  const byte code[] = {0xf3, 0xa6};
+  run_both_ways(code, sizeof(code), setup_repe_cmpsb, check_repe_cmpsb);
+}
+
+static void setup_rep_movsb_segment_override(struct testing_machine *machine) {
+  memcpy(machine->memory + 0x9000, "override", 8);
+  machine->cpu.segs[DS] = 0x0800;
+  machine->cpu.segs[ES] = 0x0a00;
+  machine->cpu.segs[SS] = 0x0900;
+  machine->cpu.regs.word[CX] = 0x0008;
+}
+
+static void check_rep_movsb_segment_override(struct testing_machine *machine) {
+  assert(memcmp(machine->memory + 0xa000, "override", 8) == 0);
+  assert(machine->cpu.ip == CODE + 3);
+}
+
+void test_rep_movsb_segment_override(void) {
+  // rep movsb es:[di], ss:[si]
+  const byte code[] = {0x36, 0xf3, 0xa4};
+  run_both_ways(code, sizeof(code), setup_rep_movsb_segment_override,
+                check_rep_movsb_segment_override);
+}
+
+void string_tests(void) {
+  test_rep_stosw();
+  test_rep_stosw_store_observer();
+  test_rep_stosw_marks_pages_dirty();
+  test_rep_movsb_overlapping();
+  test_rep_movsw_backwards();
+  test_rep_movsw_fetch_observer();
+  test_repne_scasb();
+  test_repe_cmpsb();
+  test_rep_movsb_segment_override();
+}
@@ -0,0 +1,401 @@
+// Generates the decoder from the op code table description.
+//
+// Usage: decoder_generator <op_code_table.txt> <output.c>
+//
+// Every op code becomes one case of a switch that decodes its operands with straight-line calls,
+// so nothing about the addressing methods is interpreted while decoding.
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_OPERANDS 3
+#define MAX_TOKEN 16
+#define GROUP_SIZE 8
+
+struct row {
+  bool present;
+  char mnemonic[MAX_TOKEN];
+  char operands[MAX_OPERANDS][MAX_TOKEN];
+  int operand_count;
+};
+
+struct op_code {
+  bool is_group;
+  struct row row;
+  struct row group[GROUP_SIZE];
+};
+
+static struct op_code op_codes[0x100];
+
+static const char *input_path;
+static int line_number;
+
+static void fail(const char *message, const char *detail) {
+  fprintf(stderr, "%s:%d: %s: %s\n", input_path, line_number, message, detail);
+  exit(1);
+}
+
+static void copy_token(char *destination, const char *token) {
+  if (strlen(token) >= MAX_TOKEN) {
+    fail("token too long", token);
+  }
+  strcpy(destination, token);
+}
+
+static void parse_line(char *line) {
+  char *comment = strchr(line, '#');
+  if (comment) {
+    *comment = '\0';
+  }
+
+  const char *separators = " \t\r\n";
+  char *key = strtok(line, separators);
+  if (!key) {
+    return;
+  }
+
+  char *end;
+  unsigned long op_code = strtoul(key, &end, 16);
+  if (end == key || op_code > 0xff) {
+    fail("invalid op code", key);
+  }
+
+  struct op_code *entry = &op_codes[op_code];
+  struct row *row;
+
+  if (*end == '/') {
+    unsigned long reg = strtoul(end + 1, &end, 10);
+    if (reg >= GROUP_SIZE || *end) {
+      fail("invalid group index", key);
+    }
+    if (entry->row.present) {
+      fail("group op code already used by an instruction", key);
+    }
+    entry->is_group = true;
+    row = &entry->group[reg];
+  } else {
+    if (*end) {
+      fail("invalid op code", key);
+    }
+    if (entry->is_group) {
+      fail("instruction op code already used by a group", key);
+    }
+    row = &entry->row;
+  }
+
+  if (row->present) {
+    fail("duplicate op code", key);
+  }
+
+  char *mnemonic = strtok(0, separators);
+  if (!mnemonic) {
+    fail("missing mnemonic", key);
+  }
+
+  row->present = true;
+  copy_token(row->mnemonic, mnemonic);
+
+  char *operand;
+  while ((operand = strtok(0, separators))) {
+    if (row->operand_count == MAX_OPERANDS) {
+      fail("too many operands", operand);
+    }
+    copy_token(row->operands[row->operand_count++], operand);
+  }
+}
+
+// Addressing methods are an upper case letter followed by a lower case operand type, which sets
+// them apart from registers like ES or SS.
+static bool operand_uses_mod_rm(const char *operand) {
+  return strchr("EGMS", operand[0]) && (!operand[1] || islower((unsigned char)operand[1]));
+}
+
+static bool row_uses_mod_rm(const struct row *row) {
+  for (int i = 0; i < row->operand_count; ++i) {
+    if (operand_uses_mod_rm(row->operands[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static const char *operand_size(const char *operand) {
+  switch (operand[1]) {
+    case 'b':
+      return "os_8";
+
+    case 'w':
+    case 'a':
+      return "os_16";
+
+    default:
+      fail("operand without a size", operand);
+      return 0;
+  }
+}
+
+static void emit_operand(FILE *out, const char *indent, const char *slot, const char *operand,
+                         unsigned op_code) {
+  fprintf(out, "%s", indent);
+
+  if (!strcmp(operand, "AL")) {
+    fprintf(out, "operand_from_register_8(%s, os_8, AL);\n", slot);
+  } else if (!strcmp(operand, "AX") || !strcmp(operand, "DX")) {
+    fprintf(out, "operand_from_register_16(%s, os_16, %s);\n", slot, operand);
+  } else if (!strcmp(operand, "ES") || !strcmp(operand, "CS") || !strcmp(operand, "SS") ||
+             !strcmp(operand, "DS")) {
+    fprintf(out, "operand_from_segment_register(%s, %s);\n", slot, operand);
+  } else if (!strcmp(operand, "1")) {
+    fprintf(out, "operand_from_constant(%s, os_8, 1);\n", slot);
+  } else if (!strcmp(operand, "Ap")) {
+    fprintf(out, "operand_from_far_jump(%s, decoder_context);\n", slot);
+  } else if (!strcmp(operand, "Fw")) {
+    fprintf(out, "operand_from_flags_register(%s);\n", slot);
+  } else if (!strcmp(operand, "M") || !strcmp(operand, "Ma")) {
+    fprintf(out, "operand_from_mod_rm_reg_mem(%s, os_16, decoder_context, mrm, true);\n", slot);
+  } else {
+    const char *size = operand_size(operand);
+
+    switch (operand[0]) {
+      case 'E':
+        fprintf(out, "operand_from_mod_rm_reg_mem(%s, %s, decoder_context, mrm, false);\n", slot,
+                size);
+        break;
+
+      case 'G':
+        fprintf(out, "operand_from_mod_rm_reg(%s, %s, mrm.reg);\n", slot, size);
+        break;
+
+      case 'S':
+        fprintf(out, "operand_from_mod_rm_seg_reg(%s, %s, mrm.reg);\n", slot, size);
+        break;
+
+      case 'R':
+        fprintf(out, "operand_from_mod_rm_reg(%s, %s, %u);\n", slot, size, op_code & 0x07);
+        break;
+
+      case 'I':
+        fprintf(out, "operand_from_immediate(%s, %s, decoder_context);\n", slot, size);
+        break;
+
+      case 'J':
+        fprintf(out, "operand_from_jump(%s, %s, decoder_context);\n", slot, size);
+        break;
+
+      case 'O':
+        fprintf(out, "operand_from_offset(%s, %s, decoder_context);\n", slot, size);
+        break;
+
+      case 'X':
+        fprintf(out, "operand_from_ds_si(%s, %s, decoder_context);\n", slot, size);
+        break;
+
+      case 'Y':
+        fprintf(out, "operand_from_es_di(%s, %s);\n", slot, size);
+        break;
+
+      default:
+        fail("unknown addressing method", operand);
+        break;
+    }
+  }
+}
+
+static void emit_row(FILE *out, const char *indent, const struct row *row, unsigned op_code) {
+  static const char *slots[MAX_OPERANDS] = {
+      "&instruction->destination",
+      "&instruction->source",
+      "&instruction->third",
+  };
+
+  fprintf(out, "%sinstruction->type = it_%s;\n", indent, row->mnemonic);
+  for (int i = 0; i < row->operand_count; ++i) {
+    emit_operand(out, indent, slots[i], row->operands[i], op_code);
+  }
+}
+
+// Number of bytes an operand occupies after the op code, not counting the ModR/M byte and its
+// displacement.
+static unsigned operand_immediate_size(const char *operand) {
+  if (!strcmp(operand, "Ap")) {
+    return 4;
+  }
+
+  switch (operand[0]) {
+    case 'I':
+    case 'J':
+      return operand[1] == 'w' ? 2 : 1;
+
+    case 'O':
+      return 2;
+
+    default:
+      return 0;
+  }
+}
+
+static unsigned row_immediate_size(const struct row *row) {
+  unsigned result = 0;
+  for (int i = 0; i < row->operand_count; ++i) {
+    result += operand_immediate_size(row->operands[i]);
+  }
+  return result;
+}
+
+static void emit_lengths(FILE *out) {
+  fprintf(out, "const struct op_code_length op_code_length_table[0x100] = {\n");
+
+  for (unsigned op_code = 0; op_code < 0x100; ++op_code) {
+    const struct op_code *entry = &op_codes[op_code];
+
+    if (entry->is_group) {
+      // Two bits of immediate size for every value of the reg field.
+      unsigned sizes = 0;
+      for (unsigned reg = 0; reg < GROUP_SIZE; ++reg) {
+        sizes |= row_immediate_size(&entry->group[reg]) << (reg * 2);
+      }
+      fprintf(out, "    /* %02x */ {olf_mod_rm | olf_group, 0, 0x%04x},\n", op_code, sizes);
+      continue;
+    }
+
+    const struct row *row = &entry->row;
+    if (!row->present) {
+      fprintf(out, "    /* %02x */ {0, 0, 0},\n", op_code);
+    } else if (!strcmp(row->mnemonic, "prefix")) {
+      fprintf(out, "    /* %02x */ {olf_prefix, 0, 0},\n", op_code);
+    } else {
+      const char *flags = row_uses_mod_rm(row) ? "olf_mod_rm" : "0";
+      fprintf(out, "    /* %02x */ {%s, %u, 0},\n", op_code, flags, row_immediate_size(row));
+    }
+  }
+
+  fprintf(out, "};\n\n");
+}
+
+static void emit_prefixes(FILE *out) {
+  fprintf(out, "u8 decode_prefix(struct decoder_context *decoder_context, u8 op_code) {\n"
+               "  switch (op_code) {\n");
+
+  for (unsigned op_code = 0; op_code < 0x100; ++op_code) {
+    const struct row *row = &op_codes[op_code].row;
+    if (!row->present || strcmp(row->mnemonic, "prefix")) {
+      continue;
+    }
+
+    if (row->operand_count != 1) {
+      fail("prefix needs exactly one argument", row->mnemonic);
+    }
+
+    const char *kind = row->operands[0];
+    fprintf(out, "    case 0x%02x:\n", op_code);
+    if (!strcmp(kind, "lock") || !strcmp(kind, "rep") || !strcmp(kind, "repne")) {
+      fprintf(out, "      return ip_%s;\n\n", kind);
+    } else if (!strcmp(kind, "ES") || !strcmp(kind, "CS") || !strcmp(kind, "SS") ||
+               !strcmp(kind, "DS")) {
+      fprintf(out, "      decoder_context->segment_register_override = %s;\n", kind);
+      fprintf(out, "      return ip_segment;\n\n");
+    } else {
+      fail("unknown prefix", kind);
+    }
+  }
+
+  fprintf(out, "    default:\n"
+               "      return 0;\n"
+               "  }\n"
+               "}\n\n");
+}
+
+static void emit_op_codes(FILE *out) {
+  fprintf(out, "void decode_op_code(struct decoder_context *decoder_context, u8 op_code,\n"
+               "                    struct instruction *instruction) {\n"
+               "  switch (op_code) {\n");
+
+  for (unsigned op_code = 0; op_code < 0x100; ++op_code) {
+    const struct op_code *entry = &op_codes[op_code];
+
+    if (entry->is_group) {
+      fprintf(out, "    case 0x%02x: {\n", op_code);
+      fprintf(out, "      struct mod_rm mrm = decode_mod_rm(decoder_fetch_u8(decoder_context));\n");
+      fprintf(out, "      switch (mrm.reg) {\n");
+      for (unsigned reg = 0; reg < GROUP_SIZE; ++reg) {
+        const struct row *row = &entry->group[reg];
+        if (!row->present) {
+          continue;
+        }
+        fprintf(out, "        case %u:\n", reg);
+        emit_row(out, "          ", row, op_code);
+        fprintf(out, "          break;\n\n");
+      }
+      fprintf(out, "        default:\n"
+                   "          instruction->type = it_invalid;\n"
+                   "          break;\n"
+                   "      }\n"
+                   "      break;\n"
+                   "    }\n\n");
+      continue;
+    }
+
+    const struct row *row = &entry->row;
+    if (!row->present || !strcmp(row->mnemonic, "prefix")) {
+      continue;
+    }
+
+    fprintf(out, "    case 0x%02x: {\n", op_code);
+    if (row_uses_mod_rm(row)) {
+      fprintf(out, "      struct mod_rm mrm = decode_mod_rm(decoder_fetch_u8(decoder_context));\n");
+    }
+    emit_row(out, "      ", row, op_code);
+    fprintf(out, "      break;\n"
+                 "    }\n\n");
+  }
+
+  // Invalid op codes decode to `it_invalid` without operands.
+  fprintf(out, "    default:\n"
+               "      instruction->type = it_invalid;\n"
+               "      break;\n"
+               "  }\n"
+               "}\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <op_code_table.txt> <output.c>\n", argv[0]);
+    return 1;
+  }
+
+  input_path = argv[1];
+  FILE *in = fopen(input_path, "r");
+  if (!in) {
+    perror(input_path);
+    return 1;
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), in)) {
+    ++line_number;
+    parse_line(line);
+  }
+  fclose(in);
+
+  FILE *out = fopen(argv[2], "w");
+  if (!out) {
+    perror(argv[2]);
+    return 1;
+  }
+
+  fprintf(out, "// Generated by decoder_generator from op_code_table.txt. Do not edit.\n\n"
+               "#include \"decoder_generated.h\"\n\n"
+               "#include \"decoder_operands.h\"\n\n"
+               "// clang-format off\n\n");
+  emit_lengths(out);
+  emit_prefixes(out);
+  emit_op_codes(out);
+  fprintf(out, "\n// clang-format on\n");
+
+  fclose(out);
+
+  return 0;
+}
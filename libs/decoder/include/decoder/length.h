@@ -0,0 +1,19 @@
+#ifndef DECODER_LENGTH_H_
+#define DECODER_LENGTH_H_
+
+#include <base/platform.h>
+
+// Length-only decoding for sweeps over large images. Only the op code, ModR/M byte and group are
+// looked at, through tables generated from the same op code table as the decoder, so the lengths
+// always agree with `decode_instruction`.
+
+// Length of the instruction at the start of `data` including its prefixes, or 0 if it does not fit
+// in `size` bytes.
+unsigned instruction_length(const u8 *data, u32 size);
+
+// Walk the instructions from `offset` and store the offset of each one in `starts`. Stops at the end
+// of the buffer, at an instruction that does not fit or after `max_starts` instructions. Returns the
+// number of offsets stored.
+u32 instruction_starts(const u8 *data, u32 size, u32 offset, u32 *starts, u32 max_starts);
+
+#endif // DECODER_LENGTH_H_
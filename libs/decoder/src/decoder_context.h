@@ -4,19 +4,34 @@
 #include "mod_rm.h"
 
 #include <base/reader.h>
-#include <instructions/registers.h>
+#include <instructions/instructions.h>
 #include <string.h>
 
+// An 8086 accepts any number of prefixes, but the instruction buffer has to hold them along with
+// the longest instruction (6 bytes). A longer chain of prefixes decodes as `it_invalid`.
+#define DECODER_MAX_PREFIXES (sizeof(((struct instruction *)0)->buffer) - 6)
+
 struct decoder_context {
   struct reader *reader;
   u32 position;
 
+  // Set by a segment override prefix, `segment_register_count` if there is none.
   enum segment_register segment_register_override;
 };
 
 void decoder_context_init(struct decoder_context *context, struct reader *reader, u32 position,
                           enum segment_register segment_register_override);
 
+// The segment register an operand uses: the override if there is one, otherwise the default of the
+// operand.
+static inline enum segment_register
+decoder_context_segment(const struct decoder_context *decoder_context,
+                        enum segment_register default_segment) {
+  return decoder_context->segment_register_override != segment_register_count
+             ? decoder_context->segment_register_override
+             : default_segment;
+}
+
 #define DECODER_FETCH(TYPE)                                                                        \
   static inline TYPE decoder_fetch_##TYPE(struct decoder_context *decoder_context) {               \
     TYPE result = reader_fetch_##TYPE(decoder_context->reader, decoder_context->position);         \
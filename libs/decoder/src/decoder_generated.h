@@ -0,0 +1,36 @@
+#ifndef DECODER_DECODER_GENERATED_H_
+#define DECODER_DECODER_GENERATED_H_
+
+#include "decoder_context.h"
+
+#include <instructions/instructions.h>
+
+// Implemented in the source generated from op_code_table.txt.
+
+enum op_code_length_flags {
+  olf_mod_rm = 0x01,
+  olf_group = 0x02,
+  olf_prefix = 0x04,
+};
+
+// What the length of an instruction depends on, for each op code.
+struct op_code_length {
+  u8 flags;
+  // Bytes of immediate data, offsets and addresses following the ModR/M byte and displacement.
+  u8 immediate_size;
+  // For groups the immediate size depends on the reg field: 2 bits for each of its values.
+  u16 group_immediate_sizes;
+};
+
+extern const struct op_code_length op_code_length_table[0x100];
+
+// Return the `enum instruction_prefix` bit of `op_code`, or 0 if it is not a prefix. A segment
+// override is stored in the decoder context.
+u8 decode_prefix(struct decoder_context *decoder_context, u8 op_code);
+
+// Decode the instruction with the given op code, which has already been fetched, including its
+// ModR/M byte and operands.
+void decode_op_code(struct decoder_context *decoder_context, u8 op_code,
+                    struct instruction *instruction);
+
+#endif // DECODER_DECODER_GENERATED_H_
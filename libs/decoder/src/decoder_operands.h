@@ -0,0 +1,213 @@
+#ifndef DECODER_DECODER_OPERANDS_H_
+#define DECODER_DECODER_OPERANDS_H_
+
+#include "decoder_context.h"
+#include "mod_rm.h"
+
+#include <instructions/instructions.h>
+#include <stdbool.h>
+
+// Building blocks for the generated decoder. Each one fills in a single operand and fetches the
+// bytes it needs from the instruction stream.
+
+static inline void operand_from_mod_rm_reg(struct operand *operand, enum operand_size size,
+                                           enum mod_rm_reg reg) {
+  static enum register_8 reg_8_mapping[] = {
+      AL, CL, DL, BL, AH, CH, DH, BH,
+  };
+
+  // This mapping is identical to the registers_16 enum, but it is here for completeness.
+  static enum register_16 reg_16_mapping[] = {
+      AX, CX, DX, BX, SP, BP, SI, DI,
+  };
+
+  operand->type = ot_register;
+  operand->size = size;
+  switch (size) {
+    case os_8:
+      operand->data.as_register.reg_8 = reg_8_mapping[reg];
+      break;
+
+    case os_16:
+      operand->data.as_register.reg_16 = reg_16_mapping[reg];
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+}
+
+static inline void operand_from_mod_rm_reg_mem(struct operand *operand, enum operand_size size,
+                                               struct decoder_context *decoder_context,
+                                               struct mod_rm mod_rm, bool mem_only) {
+  const struct mod_rm_info *info = mod_rm.info;
+
+  if (info->is_register) {
+    assert(!mem_only);
+    operand_from_mod_rm_reg(operand, size, info->rm);
+    return;
+  }
+
+  operand->size = size;
+
+  if (info->is_direct) {
+    operand->type = ot_direct;
+    operand->data.as_direct.seg_reg = decoder_context_segment(decoder_context, DS);
+    operand->data.as_direct.address = decoder_fetch_u16(decoder_context);
+    return;
+  }
+
+  enum indirect_memory_encoding encoding = (enum indirect_memory_encoding)info->rm;
+  enum segment_register seg_reg = decoder_context_segment(
+      decoder_context, indirect_memory_registers_table[encoding].default_segment);
+
+  switch (info->displacement_size) {
+    case 0:
+      operand->type = ot_indirect;
+      operand->data.as_indirect.seg_reg = seg_reg;
+      operand->data.as_indirect.encoding = encoding;
+      break;
+
+    case 1:
+      operand->type = ot_displacement;
+      operand->data.as_displacement.seg_reg = seg_reg;
+      operand->data.as_displacement.encoding = encoding;
+      operand->data.as_displacement.displacement = (i16)decoder_fetch_i8(decoder_context);
+      break;
+
+    case 2:
+      operand->type = ot_displacement;
+      operand->data.as_displacement.seg_reg = seg_reg;
+      operand->data.as_displacement.encoding = encoding;
+      operand->data.as_displacement.displacement = decoder_fetch_i16(decoder_context);
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+}
+
+static inline void operand_from_mod_rm_seg_reg(struct operand *operand, enum operand_size size,
+                                               enum mod_rm_reg reg) {
+  operand->type = ot_segment_register;
+  operand->size = size;
+  operand->data.as_segment_register.reg = (enum segment_register)reg;
+}
+
+static inline void operand_from_register_8(struct operand *operand, enum operand_size size,
+                                           enum register_8 reg) {
+  operand->type = ot_register;
+  operand->size = size;
+  operand->data.as_register.reg_8 = reg;
+}
+
+static inline void operand_from_register_16(struct operand *operand, enum operand_size size,
+                                            enum register_16 reg) {
+  operand->type = ot_register;
+  operand->size = size;
+  operand->data.as_register.reg_16 = reg;
+}
+
+static inline void operand_from_segment_register(struct operand *operand,
+                                                 enum segment_register seg_reg) {
+  operand->type = ot_segment_register;
+  operand->data.as_segment_register.reg = seg_reg;
+}
+
+static inline void operand_from_immediate(struct operand *operand, enum operand_size size,
+                                          struct decoder_context *decoder_context) {
+  operand->type = ot_immediate;
+  operand->size = size;
+  switch (size) {
+    case os_8:
+      operand->data.as_immediate.immediate_8 = decoder_fetch_u8(decoder_context);
+      break;
+
+    case os_16:
+      operand->data.as_immediate.immediate_16 = decoder_fetch_u16(decoder_context);
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+}
+
+static inline void operand_from_jump(struct operand *operand, enum operand_size size,
+                                     struct decoder_context *decoder_context) {
+  operand->type = ot_jump;
+  operand->size = size;
+  switch (operand->size) {
+    case os_8:
+      operand->data.as_jump.offset = (i16)decoder_fetch_i8(decoder_context);
+      break;
+
+    case os_16:
+      operand->data.as_jump.offset = decoder_fetch_i16(decoder_context);
+      break;
+
+    default:
+      assert(0);
+  }
+}
+
+static inline void operand_from_far_jump(struct operand *operand,
+                                         struct decoder_context *decoder_context) {
+  operand->type = ot_far_jump;
+  operand->size = os_16;
+
+  operand->data.as_far_jump.offset = decoder_fetch_u16(decoder_context);
+  operand->data.as_far_jump.segment = decoder_fetch_u16(decoder_context);
+}
+
+static inline void operand_from_flags_register(struct operand *operand) {
+  operand->type = ot_flags;
+  operand->size = os_none;
+}
+
+// The offset is always a word, the size is the size of the memory it points to.
+static inline void operand_from_offset(struct operand *operand, enum operand_size size,
+                                       struct decoder_context *decoder_context) {
+  operand->type = ot_offset;
+  operand->size = size;
+
+  operand->data.as_offset.seg_reg = decoder_context_segment(decoder_context, DS);
+  operand->data.as_offset.offset = decoder_fetch_i16(decoder_context);
+}
+
+static inline void operand_from_constant(struct operand *operand, enum operand_size size,
+                                         u16 constant) {
+  operand->type = ot_immediate;
+  operand->size = size;
+  switch (size) {
+    case os_8:
+      operand->data.as_immediate.immediate_8 = constant & 0xff;
+      break;
+
+    case os_16:
+      operand->data.as_immediate.immediate_16 = constant;
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+}
+
+// DS can be overridden by a segment prefix, the segment is stored like the one of an indirect [si].
+static inline void operand_from_ds_si(struct operand *operand, enum operand_size size,
+                                      struct decoder_context *decoder_context) {
+  operand->type = ot_ds_si;
+  operand->size = size;
+  operand->data.as_indirect.seg_reg = decoder_context_segment(decoder_context, DS);
+  operand->data.as_indirect.encoding = ime_si;
+}
+
+static inline void operand_from_es_di(struct operand *operand, enum operand_size size) {
+  operand->type = ot_es_di;
+  operand->size = size;
+}
+
+#endif // DECODER_DECODER_OPERANDS_H_
@@ -0,0 +1,55 @@
+#include "decoder/length.h"
+
+#include "decoder_context.h"
+#include "decoder_generated.h"
+#include "mod_rm.h"
+
+unsigned instruction_length(const u8 *data, u32 size) {
+  unsigned position = 0;
+
+  // Prefixes are part of the instruction that follows them.
+  while (position < size && position < DECODER_MAX_PREFIXES &&
+         (op_code_length_table[data[position]].flags & olf_prefix)) {
+    ++position;
+  }
+
+  if (position >= size) {
+    return 0;
+  }
+
+  const struct op_code_length *entry = &op_code_length_table[data[position++]];
+  unsigned immediate_size = entry->immediate_size;
+
+  if (entry->flags & olf_mod_rm) {
+    if (position >= size) {
+      return 0;
+    }
+
+    u8 mod_rm = data[position++];
+    position += mod_rm_info_table[mod_rm].displacement_size;
+
+    if (entry->flags & olf_group) {
+      immediate_size = (entry->group_immediate_sizes >> (MOD_RM_REG(mod_rm) * 2)) & 0x03;
+    }
+  }
+
+  position += immediate_size;
+
+  return position <= size ? position : 0;
+}
+
+u32 instruction_starts(const u8 *data, u32 size, u32 offset, u32 *starts, u32 max_starts) {
+  u32 count = 0;
+
+  while (offset < size && count < max_starts) {
+    unsigned length = instruction_length(data + offset, size - offset);
+    if (!length) {
+      break;
+    }
+
+    starts[count++] = offset;
+    offset += length;
+  }
+
+  return count;
+}
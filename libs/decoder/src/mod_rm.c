@@ -0,0 +1,31 @@
+#include "mod_rm.h"
+
+#define MEMORY(DISPLACEMENT_SIZE, RM)                                                              \
+  { .is_register = false, .is_direct = false, .displacement_size = DISPLACEMENT_SIZE, .rm = RM }
+
+#define DIRECT                                                                                     \
+  { .is_register = false, .is_direct = true, .displacement_size = 2, .rm = mod_rm_mem_bp }
+
+#define REGISTER(RM) { .is_register = true, .is_direct = false, .displacement_size = 0, .rm = RM }
+
+// The r/m column for the mod values 00, 01 and 10. Mod 00 with r/m 110 is replaced by a direct
+// address.
+#define MEMORY_ROW(DISPLACEMENT_SIZE, RM_110)                                                      \
+  MEMORY(DISPLACEMENT_SIZE, mod_rm_mem_bx_si), MEMORY(DISPLACEMENT_SIZE, mod_rm_mem_bx_di),        \
+      MEMORY(DISPLACEMENT_SIZE, mod_rm_mem_bp_si), MEMORY(DISPLACEMENT_SIZE, mod_rm_mem_bp_di),    \
+      MEMORY(DISPLACEMENT_SIZE, mod_rm_mem_si), MEMORY(DISPLACEMENT_SIZE, mod_rm_mem_di), RM_110,  \
+      MEMORY(DISPLACEMENT_SIZE, mod_rm_mem_bx)
+
+#define REGISTER_ROW                                                                               \
+  REGISTER(0), REGISTER(1), REGISTER(2), REGISTER(3), REGISTER(4), REGISTER(5), REGISTER(6),       \
+      REGISTER(7)
+
+// The reg field does not change the operand, so every row repeats for each of its 8 values.
+#define REPEAT_REG(ROW) ROW, ROW, ROW, ROW, ROW, ROW, ROW, ROW
+
+const struct mod_rm_info mod_rm_info_table[0x100] = {
+    REPEAT_REG(MEMORY_ROW(0, DIRECT)),
+    REPEAT_REG(MEMORY_ROW(1, MEMORY(1, mod_rm_mem_bp))),
+    REPEAT_REG(MEMORY_ROW(2, MEMORY(2, mod_rm_mem_bp))),
+    REPEAT_REG(REGISTER_ROW),
+};
@@ -3,6 +3,8 @@
 
 #include <assert.h>
 #include <base/platform.h>
+#include <instructions/registers.h>
+#include <stdbool.h>
 
 #define MOD_RM_MOD(x) ((x) >> 0x06)
 #define MOD_RM_REG(x) ((x) >> 0x03 & 0x07)
@@ -42,10 +44,30 @@ union mod_rm_reg_mem {
   enum mod_rm_mem as_mem;
 };
 
+// The shape of the operand the mod and r/m fields of a ModR/M byte describe, precomputed for all
+// 256 byte values so decoding an operand is a single table lookup. The registers and default segment
+// of a memory operand come from `indirect_memory_registers_table`, indexed by `rm`.
+struct mod_rm_info {
+  // The operand is the register `rm` instead of a memory location.
+  bool is_register;
+  // The operand is a 16-bit address following the byte (mod 00, r/m 110).
+  bool is_direct;
+
+  // Number of displacement bytes following the ModR/M byte: 0, 1 or 2.
+  u8 displacement_size;
+
+  u8 rm;
+};
+
+extern const struct mod_rm_info mod_rm_info_table[0x100];
+
 struct mod_rm {
   enum mod_rm_mod mod;
   enum mod_rm_reg reg;
   union mod_rm_reg_mem reg_mem;
+
+  // Only set by `decode_mod_rm`.
+  const struct mod_rm_info *info;
 };
 
 static inline struct mod_rm decode_mod_rm(u8 byte) {
@@ -57,6 +79,8 @@ static inline struct mod_rm decode_mod_rm(u8 byte) {
   // We just use the `as_mem` part because the 2 parts of the union occupy the same memory space.
   result.reg_mem.as_mem = MOD_RM_REG_MEM(byte);
 
+  result.info = &mod_rm_info_table[byte];
+
   return result;
 }
 
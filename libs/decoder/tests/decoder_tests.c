@@ -161,6 +161,17 @@ void test_05(void) {
   assert_operand_immediate_16(&i.source, 0xffee);
 }
 
+void test_06(void) {
+  // push es
+  READER(0x06, 0x26);
+
+  struct instruction i;
+  assert(decode_instruction(&reader, 0, &i) == 1);
+  assert(i.type == it_push);
+  assert(i.destination.type == ot_segment_register);
+  assert(i.destination.data.as_segment_register.reg == ES);
+}
+
 void test_40(void) {
   // inc ax
   READER(0x40);
@@ -262,7 +273,6 @@ void test_74(void) {
 }
 
 void test_80(void) {
-#if 0
   // add bl, 3
   READER(0x80, 0xc3, 0x03);
 
@@ -270,12 +280,10 @@ void test_80(void) {
   assert(decode_instruction(&reader, 0, &i) == 3);
   assert(i.type == it_add);
   assert_operand_reg_8(&i.destination, BL);
-  assert_operand_immediate(&i.source, OPERAND_SIZE_8, 0x03);
-#endif // 0
+  assert_operand_immediate_8(&i.source, 0x03);
 }
 
 void test_81(void) {
-#if 0
   // add bx, 0x1007
   READER(0x81, 0xc3, 0x07, 0x10);
 
@@ -283,8 +291,7 @@ void test_81(void) {
   assert(decode_instruction(&reader, 0, &i) == 4);
   assert(i.type == it_add);
   assert_operand_reg_16(&i.destination, BX);
-  assert_operand_immediate(&i.source, OPERAND_SIZE_16, 0x1007);
-#endif // 0
+  assert_operand_immediate_16(&i.source, 0x1007);
 }
 
 void test_88(void) {
@@ -331,6 +338,137 @@ void test_8b(void) {
   assert_operand_indirect_16(&i.source, ime_di);
 }
 
+void test_default_segment(void) {
+  {
+    // mov ax, [bp+2]
+    READER(0x8b, 0x46, 0x02);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 3);
+    assert(i.source.type == ot_displacement);
+    assert(i.source.data.as_displacement.encoding == ime_bp);
+    assert(i.source.data.as_displacement.seg_reg == SS);
+  }
+
+  {
+    // mov ax, [bp+si]
+    READER(0x8b, 0x02);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 2);
+    assert_operand_indirect_16(&i.source, ime_bp_si);
+    assert(i.source.data.as_indirect.seg_reg == SS);
+  }
+
+  {
+    // mov ax, [0x1234]
+    READER(0x8b, 0x06, 0x34, 0x12);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 4);
+    assert_operand_direct_16(&i.source, 0x1234);
+    assert(i.source.data.as_direct.seg_reg == DS);
+  }
+
+  {
+    // mov ax, ds:[bp+2]
+    READER(0x3e, 0x8b, 0x46, 0x02);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 4);
+    assert(i.source.data.as_displacement.seg_reg == DS);
+  }
+
+  {
+    // mov ax, es:[bx]
+    READER(0x26, 0x8b, 0x07);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 3);
+    assert_operand_indirect_16(&i.source, ime_bx);
+    assert(i.source.data.as_indirect.seg_reg == ES);
+  }
+}
+
+void test_a0(void) {
+  // mov al, [0x1234]
+  READER(0xa0, 0x34, 0x12);
+
+  struct instruction i;
+  assert(decode_instruction(&reader, 0, &i) == 3);
+  assert(i.type == it_mov);
+  assert_operand_reg_8(&i.destination, AL);
+  assert(i.source.type == ot_offset);
+  assert(i.source.size == os_8);
+  assert(i.source.data.as_offset.seg_reg == DS);
+  assert(i.source.data.as_offset.offset == 0x1234);
+}
+
+void test_prefixes(void) {
+  {
+    // es rep movsw
+    READER(0x26, 0xf3, 0xa5);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 3);
+    assert(i.type == it_movs);
+    assert(i.prefixes == (ip_segment | ip_rep));
+    assert(i.rep_mode == rm_rep);
+    assert(i.destination.type == ot_ds_si);
+    assert(i.destination.data.as_indirect.seg_reg == ES);
+  }
+
+  {
+    // lock repne and rep: the last repeat prefix wins.
+    READER(0xf0, 0xf2, 0xf3, 0xa6);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 4);
+    assert(i.type == it_cmps);
+    assert(i.prefixes == (ip_lock | ip_rep));
+    assert(i.rep_mode == rm_rep);
+  }
+
+  {
+    // The last segment override wins.
+    READER(0x2e, 0x36, 0x8b, 0x07);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 4);
+    assert(i.type == it_mov);
+    assert(i.source.data.as_indirect.seg_reg == SS);
+  }
+
+  {
+    // One prefix more than the instruction buffer holds.
+    READER(0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0x26, 0xa4);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 11);
+    assert(i.type == it_invalid);
+  }
+
+  {
+    // An invalid op code.
+    READER(0x0f);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 1);
+    assert(i.type == it_invalid);
+  }
+
+  {
+    // Without prefixes.
+    READER(0xa4);
+
+    struct instruction i;
+    assert(decode_instruction(&reader, 0, &i) == 1);
+    assert(i.prefixes == 0);
+    assert(i.rep_mode == rm_none);
+    assert(i.destination.data.as_indirect.seg_reg == DS);
+  }
+}
+
 void test_b0(void) {
   // mov al, 0xb0
   READER(0xb0, 0xb0);
@@ -551,6 +689,28 @@ void test_f7(void) {
   assert_operand_immediate_16(&i.source, 0x0707);
 }
 
+void test_c8(void) {
+  // enter 0x0010, 1
+  READER(0xc8, 0x10, 0x00, 0x01);
+
+  struct instruction i;
+  assert(decode_instruction(&reader, 0, &i) == 4);
+  assert(i.type == it_enter);
+  assert_operand_immediate_16(&i.destination, 0x0010);
+  assert_operand_immediate_8(&i.source, 0x01);
+}
+
+void test_d1(void) {
+  // shl bx, 1
+  READER(0xd1, 0xe3);
+
+  struct instruction i;
+  assert(decode_instruction(&reader, 0, &i) == 2);
+  assert(i.type == it_shl);
+  assert_operand_reg_16(&i.destination, BX);
+  assert_operand_immediate_8(&i.source, 1);
+}
+
 #define NOP_TEST(OpCode)                                                                           \
   void test_##OpCode(void) {                                                                       \
     READER(0x##OpCode);                                                                            \
@@ -563,7 +723,7 @@ void test_f7(void) {
 // NOP_TEST(03)
 // NOP_TEST(04)
 // NOP_TEST(05)
-NOP_TEST(06)
+// NOP_TEST(06)
 NOP_TEST(07)
 NOP_TEST(08)
 NOP_TEST(09)
@@ -727,7 +887,7 @@ NOP_TEST(9d)
 NOP_TEST(9e)
 NOP_TEST(9f)
 
-NOP_TEST(a0)
+// NOP_TEST(a0)
 NOP_TEST(a1)
 NOP_TEST(a2)
 NOP_TEST(a3)
@@ -769,7 +929,7 @@ NOP_TEST(c4)
 NOP_TEST(c5)
 NOP_TEST(c6)
 NOP_TEST(c7)
-NOP_TEST(c8)
+// NOP_TEST(c8)
 NOP_TEST(c9)
 NOP_TEST(ca)
 NOP_TEST(cb)
@@ -779,7 +939,7 @@ NOP_TEST(ce)
 NOP_TEST(cf)
 
 NOP_TEST(d0)
-NOP_TEST(d1)
+// NOP_TEST(d1)
 NOP_TEST(d2)
 NOP_TEST(d3)
 NOP_TEST(d4)
@@ -832,6 +992,9 @@ NOP_TEST(ff)
 #undef NOP_TEST
 
 void decoder_tests(void) {
+  test_default_segment();
+  test_prefixes();
+
   test_00();
   test_01();
   test_02();
@@ -1105,10 +1268,12 @@ void decoder_tests(void) {
   test_ff();
 }
 
+void length_tests(void);
 void mod_rm_tests(void);
 
 int main(int argc, char **argv) {
   decoder_tests();
+  length_tests();
   mod_rm_tests();
   return 0;
 }
@@ -0,0 +1,80 @@
+#include <assert.h>
+#include <base/reader.h>
+#include <decoder/decoder.h>
+#include <decoder/length.h>
+
+static u8 length_buffer_reader(void *context, u32 position) {
+  return ((const u8 *)context)[position];
+}
+
+// The length decoder has to agree with the full decoder for every op code and every kind of
+// ModR/M byte.
+void test_length_matches_decoder(void) {
+  static const u8 mod_rm_bytes[] = {0x00, 0x06, 0x46, 0x86, 0x3e, 0x7f, 0xbf, 0xc0, 0xff};
+
+  for (unsigned op_code = 0; op_code < 0x100; ++op_code) {
+    for (unsigned i = 0; i < ARRAY_SIZE(mod_rm_bytes); ++i) {
+      u8 mod_rm = mod_rm_bytes[i];
+
+      // lea and bound only accept memory operands.
+      if ((op_code == 0x8d || op_code == 0x62) && mod_rm >= 0xc0) {
+        continue;
+      }
+
+      u8 buffer[16] = {op_code, mod_rm, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc};
+
+      struct reader reader;
+      reader_init(&reader, buffer, length_buffer_reader);
+
+      struct instruction instruction;
+      int size = decode_instruction(&reader, 0, &instruction);
+
+      assert(instruction_length(buffer, sizeof(buffer)) == (unsigned)size);
+    }
+  }
+}
+
+void test_length_prefixes(void) {
+  // es rep movsw
+  const u8 buffer[] = {0x26, 0xf3, 0xa5};
+  assert(instruction_length(buffer, sizeof(buffer)) == 3);
+
+  // lock add [bx+0x1234], 0x5678
+  const u8 group[] = {0xf0, 0x81, 0x87, 0x34, 0x12, 0x78, 0x56};
+  assert(instruction_length(group, sizeof(group)) == 7);
+}
+
+void test_length_truncated(void) {
+  // mov ax, [0x1234] without its last byte.
+  const u8 buffer[] = {0x8b, 0x06, 0x34};
+  assert(instruction_length(buffer, sizeof(buffer)) == 0);
+
+  // Only prefixes.
+  const u8 prefixes[] = {0x2e, 0xf3};
+  assert(instruction_length(prefixes, sizeof(prefixes)) == 0);
+}
+
+void test_instruction_starts(void) {
+  // mov ax, 0x1234 / test byte [bx], 0x01 / not byte [bx] / ret / jmp far ...
+  const u8 buffer[] = {0xb8, 0x34, 0x12, 0xf6, 0x07, 0x01, 0xf6, 0x17, 0xc3, 0xea, 0x00, 0x00};
+
+  u32 starts[8];
+  u32 count = instruction_starts(buffer, sizeof(buffer), 0, starts, ARRAY_SIZE(starts));
+
+  // The far jump is truncated and not reported.
+  assert(count == 4);
+  assert(starts[0] == 0);
+  assert(starts[1] == 3);
+  assert(starts[2] == 6);
+  assert(starts[3] == 8);
+
+  assert(instruction_starts(buffer, sizeof(buffer), 3, starts, 1) == 1);
+  assert(starts[0] == 3);
+}
+
+void length_tests(void) {
+  test_length_matches_decoder();
+  test_length_prefixes();
+  test_length_truncated();
+  test_instruction_starts();
+}
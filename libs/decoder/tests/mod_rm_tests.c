@@ -35,9 +35,45 @@ void test_encode_mod_rm(void) {
   EXPECT_U8_EQ(result, 0x02b);
 }
 
+void test_mod_rm_info_table(void) {
+  // mov ax, [bx+si]
+  const struct mod_rm_info *info = &mod_rm_info_table[0x00];
+  EXPECT_U8_EQ(info->is_register, false);
+  EXPECT_U8_EQ(info->displacement_size, 0);
+  EXPECT_U8_EQ(info->rm, mod_rm_mem_bx_si);
+
+  // [disp16]
+  info = &mod_rm_info_table[0x06];
+  EXPECT_U8_EQ(info->is_direct, true);
+  EXPECT_U8_EQ(info->displacement_size, 2);
+
+  // [bp+disp8]
+  info = &mod_rm_info_table[0x46];
+  EXPECT_U8_EQ(info->is_direct, false);
+  EXPECT_U8_EQ(info->displacement_size, 1);
+  EXPECT_U8_EQ(info->rm, mod_rm_mem_bp);
+
+  // [bp+di+disp16], the reg field is ignored.
+  info = &mod_rm_info_table[0xbb];
+  EXPECT_U8_EQ(info->displacement_size, 2);
+  EXPECT_U8_EQ(info->rm, mod_rm_mem_bp_di);
+
+  // Register forms.
+  info = &mod_rm_info_table[0xca];
+  EXPECT_U8_EQ(info->is_register, true);
+  EXPECT_U8_EQ(info->displacement_size, 0);
+  EXPECT_U8_EQ(info->rm, mod_rm_reg_dl_dx);
+
+  for (unsigned i = 0; i < 0x100; ++i) {
+    EXPECT_U8_EQ(mod_rm_info_table[i].rm, MOD_RM_REG_MEM(i));
+    EXPECT_U8_EQ(mod_rm_info_table[i].is_register, MOD_RM_MOD(i) == mod_rm_mod_register);
+  }
+}
+
 void mod_rm_tests(void) {
   test_decoders();
   test_decode_mod_rm();
   test_encode_mod_rm_values();
   test_encode_mod_rm();
+  test_mod_rm_info_table();
 }
@@ -0,0 +1,97 @@
+#ifndef DEVICES_CAPTURE_H_
+#define DEVICES_CAPTURE_H_
+
+#include "devices/screen.h"
+#include "devices/video.h"
+
+#include <base/platform.h>
+#include <pthread.h>
+#include <stdbool.h>
+
+// Screenshots of a video adapter written to numbered image files, for unattended runs.
+//
+// Captures are triggered at points in emulated time, by the guest writing to a watched port, or by
+// the host. The trigger only copies the video memory and registers; rendering, encoding and
+// writing the file happen on a background thread. When the thread falls too far behind, captures
+// are dropped instead of queueing up memory.
+
+#define CAPTURE_MAX_PENDING 8
+
+enum capture_format {
+  cf_ppm,
+  cf_png,
+};
+
+struct capture_job {
+  struct screen_snapshot snapshot;
+  unsigned sequence;
+  struct capture_job *next;
+};
+
+struct capture {
+  struct video *video;
+
+  // Files are named <prefix><sequence>.<ppm or png>.
+  char *prefix;
+  enum capture_format format;
+  unsigned sequence;
+
+  // The font can not change after the first capture. Unless it was set, it is then loaded from the
+  // guest's BIOS.
+  bool font_chosen;
+
+  // Periodic captures.
+  struct scheduler_event event;
+  u64 interval;
+
+  // Watched port and the device mapped there before, which still sees the accesses. The port is
+  // given back to the device when done.
+  struct ports *ports;
+  word watched_port;
+  struct port_range forward;
+
+  // Guards everything below.
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t idle;
+  pthread_t thread;
+  bool stopping;
+
+  struct capture_job *queue_head;
+  struct capture_job *queue_tail;
+  unsigned pending;
+  // Captures that were dropped or could not be written.
+  unsigned dropped;
+  unsigned failed;
+
+  // Owned by the thread.
+  struct screen_renderer renderer;
+  struct screen_image image;
+};
+
+// Initialize capturing the screen of an initialized `video` adapter. Return false if the thread
+// writing the captures could not be started, with nothing left to destroy.
+bool capture_init(struct capture *capture, struct video *video, const char *prefix,
+                  enum capture_format format);
+
+// Write the captures still queued and stop the thread.
+void capture_destroy(struct capture *capture);
+
+// Render text with the glyphs of `data`, see `screen_renderer_set_font`. Must be called before the
+// first capture.
+bool capture_set_font(struct capture *capture, const u8 *data, u32 size);
+
+void capture_now(struct capture *capture);
+
+// Capture when the cpu reaches `cycles`, then every `interval` cycles unless it is 0.
+void capture_at(struct capture *capture, u64 cycles, u64 interval);
+
+// Capture after every write of the guest to `port`. A device already mapped on the port still
+// handles the accesses, so this works for its registers as well as for an otherwise unused debug
+// port. Only one port can be watched.
+bool capture_watch_port(struct capture *capture, struct ports *ports, word port);
+
+// Block until the queued captures are written.
+void capture_flush(struct capture *capture);
+
+#endif // DEVICES_CAPTURE_H_
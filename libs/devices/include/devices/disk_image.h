@@ -0,0 +1,146 @@
+#ifndef DEVICES_DISK_IMAGE_H_
+#define DEVICES_DISK_IMAGE_H_
+
+#include <base/platform.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Disk image files, shared by every device that opens the same file.
+//
+// Raw images are cached in page aligned pages of `DISK_SECTORS_PER_PAGE` sectors, loaded on first
+// use. At most `DISK_CACHE_PAGES` pages are kept, the oldest one is dropped to load another. Requests that can not be served from the cache are queued for a background thread that
+// does the host I/O, so the emulation thread never waits on the disk unless it asks to. Writes go
+// through the cache to the file in the order they were submitted.
+//
+// Overlay images give every guest its own writable view of a read-only base image. The base is
+// mapped once and shared by all the overlays on top of it. The overlay file only holds the sectors
+// written to it, as records of a sector number followed by the data, and they are kept in memory
+// too. Reading a sector that was never written goes to the base.
+
+#define DISK_SECTOR_SIZE 512
+#define DISK_PAGE_SIZE 4096
+#define DISK_SECTORS_PER_PAGE (DISK_PAGE_SIZE / DISK_SECTOR_SIZE)
+#define DISK_CACHE_PAGES 256
+
+// An overlay file starts with the magic and the number of sectors of its base.
+#define DISK_OVERLAY_MAGIC "EESOVL1"
+#define DISK_OVERLAY_HEADER_SIZE 16
+#define DISK_OVERLAY_RECORD_SIZE (4 + DISK_SECTOR_SIZE)
+#define DISK_OVERLAY_EMPTY 0xffffffff
+
+enum disk_request_type {
+  drt_read,
+  drt_write,
+};
+
+struct disk_request {
+  enum disk_request_type type;
+  u32 lba;
+  u32 count;
+  u8 *buffer;
+
+  // Owned by the image while the request is in flight, read them through `disk_request_done`.
+  bool done;
+  bool failed;
+  struct disk_request *next;
+};
+
+// Read-only base of overlay images, mapped once and shared.
+struct disk_base {
+  char *path;
+  const u8 *data;
+  size_t size;
+
+  dev_t device;
+  ino_t inode;
+  unsigned references;
+  struct disk_base *next;
+};
+
+struct disk_overlay_slot {
+  // `DISK_OVERLAY_EMPTY` for unused slots.
+  u32 lba;
+  u32 record;
+};
+
+struct disk_image {
+  // The overlay file for overlay images.
+  int fd;
+  bool writable;
+  u32 sector_count;
+
+  // Identity of the file, to share images.
+  dev_t device;
+  ino_t inode;
+  unsigned references;
+  struct disk_image *next;
+
+  // Guards everything below.
+  pthread_mutex_t lock;
+  pthread_cond_t work;
+  pthread_cond_t completed;
+  pthread_t thread;
+  bool stopping;
+
+  // One pointer per page of the image, null until the page is loaded.
+  u8 **pages;
+  u32 page_count;
+
+  // Ring of the indices of the loaded pages, in the order they were loaded.
+  u32 cached_pages[DISK_CACHE_PAGES];
+  u32 cached_count;
+  u32 oldest_cached;
+
+  struct disk_request *queue_head;
+  struct disk_request *queue_tail;
+
+  // Only set for overlay images, which have no pages.
+  struct disk_base *base;
+
+  // Open addressed hash table from sector numbers to records.
+  struct disk_overlay_slot *slots;
+  u32 slot_capacity;
+  // Number of distinct sectors in the overlay.
+  u32 overlay_sectors;
+
+  // Data of each record, in the order of the overlay file. A sector written again is updated in
+  // place, but older records of a sector may be found when loading a file.
+  u8 *records;
+  u32 record_count;
+  u32 record_capacity;
+};
+
+// Open the image at `path`, or take another reference on it if it is already open. The file is
+// opened for writing if possible. Return null if it can not be opened or its I/O thread can not be
+// started.
+struct disk_image *disk_image_open(const char *path);
+
+// Open the overlay at `overlay_path` on top of the image at `base_path`. An empty file is an empty
+// overlay, and a missing one is created if `create` is set. Opening the same overlay twice shares
+// it like raw images. Return null if either file can not be opened or the overlay does not belong
+// to a base of this size.
+struct disk_image *disk_image_open_overlay(const char *base_path, const char *overlay_path,
+                                           bool create);
+
+// Drop a reference, the last one waits for the queued requests and frees the image.
+void disk_image_close(struct disk_image *image);
+
+// Start a request. Requests served from the cache are done when this returns. Sectors past the end
+// of the image fail the request.
+void disk_image_submit(struct disk_image *image, struct disk_request *request);
+
+bool disk_request_done(struct disk_image *image, struct disk_request *request);
+
+// Block until the request is done.
+void disk_image_wait(struct disk_image *image, struct disk_request *request);
+
+// Write every sector of an overlay image, base and overlay merged, to a new raw image at `path`.
+// Return false on errors or if the image has no overlay.
+bool disk_image_export(struct disk_image *image, const char *path);
+
+// Write the sectors of an overlay image into its base file and empty the overlay. Fails if other
+// overlays share the base, as the sectors they did not write would change under them.
+bool disk_image_commit(struct disk_image *image);
+
+#endif // DEVICES_DISK_IMAGE_H_
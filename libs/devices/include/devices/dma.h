@@ -0,0 +1,60 @@
+#ifndef DEVICES_DMA_H_
+#define DEVICES_DMA_H_
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+
+// Intel 8237 DMA controller on ports 0x00-0x0f with the page registers at 0x81-0x87.
+//
+// Transfers are not performed cycle by cycle. A device moves a whole block at once when its
+// operation completes and the channel's address and count advance as if it had been done a byte
+// at a time, stopping at the terminal count.
+
+#define DMA_PORT_BASE 0x00
+#define DMA_PAGE_PORT_BASE 0x81
+#define DMA_CHANNEL_COUNT 4
+
+enum dma_transfer {
+  dma_transfer_verify,
+  // From the device to memory.
+  dma_transfer_write,
+  // From memory to the device.
+  dma_transfer_read,
+};
+
+struct dma_channel {
+  word base_address;
+  word base_count;
+  word address;
+  word count;
+  byte page;
+  byte mode;
+  bool masked;
+};
+
+struct dma {
+  struct cpu *cpu;
+  struct dma_channel channels[DMA_CHANNEL_COUNT];
+
+  // Selects the high byte of address and count registers.
+  bool flip_flop;
+  bool disabled;
+
+  // Terminal count reached, bits 0-3, cleared by reading the status register.
+  byte status;
+};
+
+// Initialize the controller and map it onto the ports of the cpu. The cpu must be initialized
+// first.
+void dma_init(struct dma *dma, struct cpu *cpu);
+
+// Copy up to `size` bytes from the device to memory through `channel`. Return the number of bytes
+// moved, which is less than `size` if the terminal count is reached first and 0 if the channel is
+// masked or not programmed for writing.
+u32 dma_write_memory(struct dma *dma, unsigned channel, const u8 *data, u32 size);
+
+// Copy up to `size` bytes from memory to the device. Works like `dma_write_memory`.
+u32 dma_read_memory(struct dma *dma, unsigned channel, u8 *data, u32 size);
+
+#endif // DEVICES_DMA_H_
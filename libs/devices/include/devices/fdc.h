@@ -0,0 +1,95 @@
+#ifndef DEVICES_FDC_H_
+#define DEVICES_FDC_H_
+
+#include "devices/disk_image.h"
+#include "devices/dma.h"
+#include "devices/irq.h"
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+
+// NEC 765 floppy disk controller on ports 0x3f0-0x3f7, transferring data over DMA channel 2 and
+// interrupting on IRQ 6.
+//
+// Read and write commands hand the whole transfer to the disk image and complete with a scheduler
+// event some cycles later, moving the data through the DMA controller and raising the interrupt.
+// The guest keeps running while the host does the I/O, the event only blocks if the host has not
+// finished by then.
+//
+// Multi-track transfers continue on head 1 only when they end on the last sector of the track.
+// Formatting and reading whole tracks are not supported.
+
+#define FDC_PORT_BASE 0x3f0
+#define FDC_DRIVE_COUNT 2
+#define FDC_DMA_CHANNEL 2
+
+// Emulated time, far shorter than on a real drive. Guests do not depend on it.
+#define FDC_SEEK_CYCLES_PER_TRACK 500
+#define FDC_CYCLES_PER_SECTOR 2000
+
+// Largest transfer: both sides of a track of a 2.88MB disk.
+#define FDC_MAX_TRANSFER_SECTORS 72
+
+enum fdc_phase {
+  fp_command,
+  fp_execution,
+  fp_result,
+};
+
+struct fdc_drive {
+  struct disk_image *image;
+  bool write_protected;
+
+  u16 cylinders;
+  u8 heads;
+  u8 sectors;
+
+  // Cylinder the head is on.
+  u8 cylinder;
+};
+
+struct fdc {
+  struct cpu *cpu;
+  struct dma *dma;
+  struct irq_line irq;
+
+  // Digital output register: drive select, reset, DMA and interrupt enable, motors.
+  byte dor;
+
+  enum fdc_phase phase;
+  u8 command[9];
+  u8 command_size;
+  u8 command_length;
+  u8 result[7];
+  u8 result_size;
+  u8 result_index;
+
+  // Reported by sense interrupt status after a seek or recalibrate.
+  bool seek_interrupt;
+  u8 seek_st0;
+  // Sense interrupt status commands still to answer after a reset, one per drive.
+  u8 reset_senses;
+
+  struct fdc_drive drives[FDC_DRIVE_COUNT];
+
+  // Transfer in flight.
+  struct scheduler_event event;
+  struct disk_request request;
+  struct fdc_drive *request_drive;
+  u8 buffer[FDC_MAX_TRANSFER_SECTORS * DISK_SECTOR_SIZE];
+};
+
+// Initialize the controller and map it onto the ports of the cpu. The cpu must be initialized
+// first.
+void fdc_init(struct fdc *fdc, struct cpu *cpu, struct dma *dma, struct irq_line irq);
+
+// Wait for the transfer in flight, if any.
+void fdc_destroy(struct fdc *fdc);
+
+// Put the disk `image` in `drive`, or remove the disk with a null image. The geometry is derived
+// from the size of standard floppy formats. Return false for an image of any other size.
+bool fdc_insert_disk(struct fdc *fdc, unsigned drive, struct disk_image *image,
+                     bool write_protected);
+
+#endif // DEVICES_FDC_H_
@@ -0,0 +1,73 @@
+#ifndef DEVICES_INPUT_SCRIPT_H_
+#define DEVICES_INPUT_SCRIPT_H_
+
+#include "devices/ppi.h"
+
+#include <base/platform.h>
+#include <stdbool.h>
+
+// Keyboard input played to the PPI at fixed points in emulated time, so that interactive programs
+// run the same way every time without anybody at the keyboard.
+//
+// A script has one event per line, starting with the cycle it happens at, or with `+` and the
+// cycles since the previous event:
+//
+//   # Comments and blank lines are ignored.
+//   1000000 type dir\n
+//   +500000 key 1d 2e 9d ae
+//   +2000000 quit
+//
+// `type` types the rest of the line on a US keyboard, with `\n`, `\t`, `\e` and `\\` escapes.
+// `key` sends raw scan codes in hex. `quit` marks the end of the run for the host.
+
+#define INPUT_MAX_SCAN_CODES_PER_CHAR 4
+
+enum input_event_type {
+  iet_scan_codes,
+  iet_quit,
+};
+
+struct input_event {
+  u64 cycles;
+  enum input_event_type type;
+
+  // Range of `scan_codes` sent by the event.
+  u32 offset;
+  u32 count;
+};
+
+struct input_script {
+  struct input_event *events;
+  u32 event_count;
+  u32 event_capacity;
+
+  u8 *scan_codes;
+  u32 scan_code_count;
+  u32 scan_code_capacity;
+
+  // Playback.
+  struct ppi *ppi;
+  u32 next_event;
+  struct scheduler_event event;
+  bool quit;
+};
+
+void input_script_init(struct input_script *script);
+void input_script_destroy(struct input_script *script);
+
+// Add the events of `text` to the script. Events must be in order. Return false on a malformed line
+// and store its number in `error_line`.
+bool input_script_parse(struct input_script *script, const char *text, unsigned *error_line);
+
+// Store the scan codes typing `c` on a US keyboard, pressing shift if needed, in `scan_codes`,
+// which holds at least `INPUT_MAX_SCAN_CODES_PER_CHAR`. Return their number, 0 for characters
+// that have no key.
+u32 input_script_scan_codes(char c, u8 *scan_codes);
+
+// Send the events to `ppi` as the cpu reaches their cycle.
+void input_script_play(struct input_script *script, struct ppi *ppi);
+
+// Whether every event was sent.
+bool input_script_finished(const struct input_script *script);
+
+#endif // DEVICES_INPUT_SCRIPT_H_
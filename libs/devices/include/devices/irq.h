@@ -0,0 +1,22 @@
+#ifndef DEVICES_IRQ_H_
+#define DEVICES_IRQ_H_
+
+#include <base/platform.h>
+
+typedef void (*irq_raise_func)(void *context, u8 irq);
+
+// A device's connection to an interrupt controller input. An unconnected line has no `raise`
+// function and raising it does nothing.
+struct irq_line {
+  irq_raise_func raise;
+  void *context;
+  u8 irq;
+};
+
+static inline void irq_line_raise(const struct irq_line *line) {
+  if (line->raise) {
+    line->raise(line->context, line->irq);
+  }
+}
+
+#endif // DEVICES_IRQ_H_
@@ -0,0 +1,55 @@
+#ifndef DEVICES_PIC_H_
+#define DEVICES_PIC_H_
+
+#include "devices/irq.h"
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+
+// Intel 8259A Programmable Interrupt Controller on ports 0x20-0x21, configured as the single
+// controller of a PC/XT. Only fixed priorities are supported, IRQ 0 being the highest.
+//
+// The controller recalculates the cpu's INTR line only when a line is raised, the mask changes or
+// an interrupt is acknowledged or ended, so the cpu never polls it.
+
+#define PIC_PORT_BASE 0x20
+
+struct pic {
+  struct cpu *cpu;
+
+  byte irr;
+  byte isr;
+  byte imr;
+
+  byte vector_base;
+
+  // Number of the next initialization command word expected on the data port, 0 when the
+  // controller is initialized.
+  byte init_step;
+  bool single;
+  bool icw4_needed;
+  bool auto_eoi;
+
+  // Port 0x20 reads the ISR instead of the IRR.
+  bool read_isr;
+};
+
+// Initialize the controller, map it onto the ports of the cpu and connect it to the cpu's INTR
+// line. The cpu must be initialized first.
+void pic_init(struct pic *pic, struct cpu *cpu);
+
+// Signal an edge on the given interrupt request line. Matches `irq_raise_func`.
+void pic_raise_irq(void *context, u8 irq);
+
+static inline struct irq_line pic_irq_line(struct pic *pic, u8 irq) {
+  struct irq_line result;
+
+  result.raise = pic_raise_irq;
+  result.context = pic;
+  result.irq = irq;
+
+  return result;
+}
+
+#endif // DEVICES_PIC_H_
@@ -0,0 +1,74 @@
+#ifndef DEVICES_PIT_H_
+#define DEVICES_PIT_H_
+
+#include "devices/irq.h"
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+
+// Intel 8253/8254 Programmable Interval Timer on ports 0x40-0x43.
+//
+// Counters are never decremented. Each channel remembers the cycle at which its count was loaded
+// and the current value is derived from the elapsed cycles when the guest reads it. Interrupts on
+// the output of a channel are delivered by scheduler events at the cycle the output rises.
+
+#define PIT_PORT_BASE 0x40
+#define PIT_CHANNEL_COUNT 3
+
+// The PIT is clocked at 1.193182MHz, exactly a quarter of the 4.77MHz CPU clock.
+#define PIT_CYCLES_PER_TICK 4
+
+enum pit_access {
+  pit_access_latch,
+  pit_access_low,
+  pit_access_high,
+  pit_access_low_high,
+};
+
+struct pit;
+
+struct pit_channel {
+  struct pit *pit;
+
+  byte mode;
+  enum pit_access access;
+
+  // Count register as written by the guest, 0 means 65536.
+  word reload;
+
+  bool counting;
+  bool gate;
+
+  // Cycle at which the current count was loaded.
+  u64 start;
+  // Value the counter was stopped at while the gate is low.
+  word frozen;
+
+  bool latched;
+  word latch_value;
+
+  bool read_high;
+  bool write_high;
+  byte write_low;
+
+  struct scheduler_event event;
+  struct irq_line irq;
+};
+
+struct pit {
+  struct cpu *cpu;
+  struct pit_channel channels[PIT_CHANNEL_COUNT];
+};
+
+// Initialize the timer and map it onto the ports of the cpu. The cpu must be initialized first.
+void pit_init(struct pit *pit, struct cpu *cpu);
+
+void pit_connect_irq(struct pit *pit, unsigned channel, struct irq_line irq);
+
+void pit_set_gate(struct pit *pit, unsigned channel, bool gate);
+bool pit_get_output(struct pit *pit, unsigned channel);
+
+word pit_read_counter(struct pit *pit, unsigned channel);
+
+#endif // DEVICES_PIT_H_
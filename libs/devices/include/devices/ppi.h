@@ -0,0 +1,65 @@
+#ifndef DEVICES_PPI_H_
+#define DEVICES_PPI_H_
+
+#include "devices/irq.h"
+#include "devices/pit.h"
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Intel 8255 Programmable Peripheral Interface on ports 0x60-0x63, wired as on the PC/XT: port A
+// reads the keyboard's scan codes, port B drives the keyboard, speaker and timer 2 gate and port C
+// reads the configuration switches and the output of timer 2.
+//
+// Scan codes wait in a queue on the keyboard side. Each one is shifted in some cycles after the
+// previous one was acknowledged, raising the keyboard IRQ, so a guest sees keys at the pace of a
+// real keyboard however fast they are queued. The mode set through port 0x63 is ignored.
+
+#define PPI_PORT_BASE 0x60
+
+// Time it takes the keyboard to send a scan code, about 1ms.
+#define PPI_SCAN_CODE_CYCLES 5000
+
+// Sent by the keyboard after it is reset.
+#define PPI_KEYBOARD_SELF_TEST_PASSED 0xaa
+
+struct ppi {
+  struct cpu *cpu;
+  struct irq_line irq;
+  // Timer 2 is gated by port B and read through port C, optional.
+  struct pit *pit;
+
+  byte port_b;
+  // DIP switch block 1 of the XT.
+  byte switches;
+
+  // Shift register of the keyboard interface, read through port A.
+  byte scan_code;
+  bool full;
+
+  struct scheduler_event event;
+
+  // Scan codes the keyboard has yet to send are `queue[queue_head]` to `queue[queue_size - 1]`.
+  // The queue only grows, so the indices saved with a checkpoint stay valid.
+  u32 queue_head;
+  u32 queue_size;
+  // Last, to be left out of checkpoints.
+  u8 *queue;
+  u32 queue_capacity;
+};
+
+// Bytes of `struct ppi` to save with checkpoints. The memory of the queue can move, but a scan
+// code keeps its index.
+#define PPI_CHECKPOINT_SIZE offsetof(struct ppi, queue)
+
+// Initialize the PPI and map it onto the ports of the cpu. The cpu must be initialized first.
+void ppi_init(struct ppi *ppi, struct cpu *cpu, struct irq_line irq, struct pit *pit,
+              byte switches);
+void ppi_destroy(struct ppi *ppi);
+
+// Queue scan codes for the keyboard to send.
+void ppi_push_scan_codes(struct ppi *ppi, const u8 *scan_codes, u32 count);
+
+#endif // DEVICES_PPI_H_
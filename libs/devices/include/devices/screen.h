@@ -0,0 +1,69 @@
+#ifndef DEVICES_SCREEN_H_
+#define DEVICES_SCREEN_H_
+
+#include "devices/video.h"
+
+#include <base/platform.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Rendering of what a CGA or MDA adapter displays into an RGB image, from a copy of its registers
+// and video memory so that it can happen on any thread.
+//
+// Text modes use 8x8 glyphs, on the MDA too. Rendered cells are cached per character and colors,
+// so most of the screen is copied from the cache instead of being expanded bit by bit. Without a
+// font, characters are drawn as boxes. Blinking and the cursor are not drawn.
+
+#define SCREEN_MAX_WIDTH 640
+#define SCREEN_HEIGHT 200
+#define SCREEN_GLYPH_SIZE 8
+#define SCREEN_GLYPH_CACHE_SIZE 1024
+
+// Where IBM compatible BIOSes keep the glyphs of the first 128 characters.
+#define SCREEN_BIOS_FONT 0xffa6e
+
+struct screen_snapshot {
+  enum video_adapter adapter;
+  byte mode;
+  byte color;
+  u32 start_offset;
+  u32 memory_size;
+  u8 memory[VIDEO_CGA_MEMORY_SIZE];
+};
+
+struct screen_glyph {
+  // Character and colors plus one, 0 for an empty entry.
+  u32 key;
+  u8 pixels[SCREEN_GLYPH_SIZE * SCREEN_GLYPH_SIZE * 3];
+};
+
+struct screen_renderer {
+  u8 font[0x100 * SCREEN_GLYPH_SIZE];
+  unsigned glyph_count;
+
+  struct screen_glyph glyphs[SCREEN_GLYPH_CACHE_SIZE];
+};
+
+struct screen_image {
+  u32 width;
+  u32 height;
+  u8 pixels[SCREEN_MAX_WIDTH * SCREEN_HEIGHT * 3];
+};
+
+void screen_snapshot_take(struct screen_snapshot *snapshot, const struct video *video);
+
+void screen_renderer_init(struct screen_renderer *renderer);
+
+// Use the 8x8 glyphs in `data`: 128 or 256 glyphs of 8 bytes, or a dump of the 8KiB character ROM
+// of the CGA. Return false for data of any other size.
+bool screen_renderer_set_font(struct screen_renderer *renderer, const u8 *data, u32 size);
+
+void screen_render(struct screen_renderer *renderer, const struct screen_snapshot *snapshot,
+                   struct screen_image *image);
+
+bool screen_write_ppm(const struct screen_image *image, FILE *out);
+
+// The image data is stored uncompressed, so no compression library is needed.
+bool screen_write_png(const struct screen_image *image, FILE *out);
+
+#endif // DEVICES_SCREEN_H_
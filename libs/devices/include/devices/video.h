@@ -0,0 +1,106 @@
+#ifndef DEVICES_VIDEO_H_
+#define DEVICES_VIDEO_H_
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// CGA and MDA adapters in text mode, with the 6845 CRT controller's start address and cursor.
+//
+// The adapter observes the stores to its video memory and marks the character cells they change in
+// a dirty bitmap. Rendering only visits the dirty cells, so a guest that updates a few characters
+// costs a few escape sequences, and rendering runs from a scheduler event at a configurable
+// interval instead of on every store. Graphics modes are not rendered.
+//
+// Both adapters decode 32KiB of addresses, so their memory repeats up to the end of that window:
+// the CGA's 16KiB shows up again at 0xbc000. Stores to any copy are mirrored to the others.
+
+#define VIDEO_CGA_MEMORY 0xb8000
+#define VIDEO_CGA_MEMORY_SIZE 0x4000
+#define VIDEO_CGA_PORT_BASE 0x3d0
+#define VIDEO_MDA_MEMORY 0xb0000
+#define VIDEO_MDA_MEMORY_SIZE 0x1000
+#define VIDEO_MDA_PORT_BASE 0x3b0
+#define VIDEO_DECODED_SIZE 0x8000
+
+#define VIDEO_MAX_COLUMNS 80
+#define VIDEO_ROWS 25
+#define VIDEO_MAX_CELLS (VIDEO_MAX_COLUMNS * VIDEO_ROWS)
+
+struct checkpoints;
+
+enum video_adapter {
+  va_cga,
+  va_mda,
+};
+
+enum video_format {
+  // Escape sequences updating only the changed cells of a terminal.
+  vf_ansi,
+  // The whole screen as plain text whenever something changed, screens separated by form feeds.
+  vf_text,
+};
+
+struct video {
+  struct cpu *cpu;
+  enum video_adapter adapter;
+
+  u32 memory_base;
+  u32 memory_size;
+
+  // CRT controller.
+  byte crtc_index;
+  byte crtc[0x12];
+
+  // CGA mode control and color select registers.
+  byte mode;
+  byte color;
+
+  // One bit per cell of the displayed page.
+  u64 dirty[(VIDEO_MAX_CELLS + 63) / 64];
+  bool cursor_dirty;
+
+  FILE *out;
+  enum video_format format;
+  u64 interval;
+  struct scheduler_event event;
+
+  // Position and attribute the terminal is at, to skip redundant escape sequences.
+  u16 out_cell;
+  int out_attribute;
+
+  // Rendering pauses while these go back in time, and redraws everything after.
+  const struct checkpoints *checkpoints;
+  u64 restores_seen;
+};
+
+// Initialize the adapter, map it onto the ports of the cpu and observe its video memory. The cpu
+// must be initialized first.
+bool video_init(struct video *video, struct cpu *cpu, enum video_adapter adapter);
+
+// Render to `out` every `interval` cycles, or stop with a null `out`. The first rendering draws the
+// whole screen.
+void video_set_output(struct video *video, FILE *out, enum video_format format, u64 interval);
+
+// Render the cells that changed since the last time, if any.
+void video_render(struct video *video);
+
+// Render nothing while `checkpoints` re-execute the machine, which would show the screen the guest
+// had in the past, and redraw the whole screen once they restored an earlier state.
+void video_follow_checkpoints(struct video *video, const struct checkpoints *checkpoints);
+
+// Draw the whole screen on the next rendering, after video memory changed behind the adapter's
+// back.
+void video_invalidate(struct video *video);
+
+// Columns of the current mode, 40 or 80.
+unsigned video_columns(const struct video *video);
+
+// Offset of the displayed page in video memory.
+u32 video_start_offset(const struct video *video);
+
+// Whether the adapter is in a text mode.
+bool video_text_mode(const struct video *video);
+
+#endif // DEVICES_VIDEO_H_
@@ -0,0 +1,238 @@
+#include "devices/capture.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static bool capture_write(struct capture *capture, const struct capture_job *job) {
+  screen_render(&capture->renderer, &job->snapshot, &capture->image);
+
+  static const char *const extensions[] = {
+      [cf_ppm] = "ppm",
+      [cf_png] = "png",
+  };
+
+  size_t name_size = strlen(capture->prefix) + 16;
+  char *name = malloc(name_size);
+  snprintf(name, name_size, "%s%04u.%s", capture->prefix, job->sequence,
+           extensions[capture->format]);
+
+  FILE *out = fopen(name, "wb");
+  free(name);
+  if (!out) {
+    return false;
+  }
+
+  bool written = capture->format == cf_png ? screen_write_png(&capture->image, out)
+                                           : screen_write_ppm(&capture->image, out);
+  return fclose(out) == 0 && written;
+}
+
+static void *capture_thread(void *context) {
+  struct capture *capture = context;
+
+  pthread_mutex_lock(&capture->lock);
+
+  for (;;) {
+    while (!capture->queue_head && !capture->stopping) {
+      pthread_cond_wait(&capture->work, &capture->lock);
+    }
+
+    struct capture_job *job = capture->queue_head;
+    if (!job) {
+      break;
+    }
+
+    capture->queue_head = job->next;
+    if (!capture->queue_head) {
+      capture->queue_tail = 0;
+    }
+
+    pthread_mutex_unlock(&capture->lock);
+    bool written = capture_write(capture, job);
+    free(job);
+    pthread_mutex_lock(&capture->lock);
+
+    capture->failed += !written;
+    --capture->pending;
+    pthread_cond_broadcast(&capture->idle);
+  }
+
+  pthread_mutex_unlock(&capture->lock);
+  return 0;
+}
+
+// Load the glyphs of the first 128 characters from the guest's BIOS, if it has them.
+static void capture_choose_font(struct capture *capture) {
+  capture->font_chosen = true;
+
+  struct bus *bus = capture->video->cpu->bus;
+  u32 size = 0x80 * SCREEN_GLYPH_SIZE;
+  if (bus->memory_size < SCREEN_BIOS_FONT + size) {
+    return;
+  }
+
+  const u8 *font = bus->memory + SCREEN_BIOS_FONT;
+  for (u32 i = 0; i < size; ++i) {
+    if (font[i]) {
+      screen_renderer_set_font(&capture->renderer, font, size);
+      return;
+    }
+  }
+}
+
+void capture_now(struct capture *capture) {
+  if (!capture->font_chosen) {
+    // The thread does not touch the renderer before it gets the first job.
+    capture_choose_font(capture);
+  }
+
+  pthread_mutex_lock(&capture->lock);
+
+  if (capture->pending == CAPTURE_MAX_PENDING) {
+    ++capture->dropped;
+    pthread_mutex_unlock(&capture->lock);
+    return;
+  }
+  ++capture->pending;
+
+  pthread_mutex_unlock(&capture->lock);
+
+  // Copied outside of the lock, the job is not visible to the thread yet.
+  struct capture_job *job = malloc(sizeof(*job));
+  screen_snapshot_take(&job->snapshot, capture->video);
+  job->sequence = capture->sequence++;
+  job->next = 0;
+
+  pthread_mutex_lock(&capture->lock);
+
+  if (capture->queue_tail) {
+    capture->queue_tail->next = job;
+  } else {
+    capture->queue_head = job;
+  }
+  capture->queue_tail = job;
+  pthread_cond_signal(&capture->work);
+
+  pthread_mutex_unlock(&capture->lock);
+}
+
+static void capture_event(void *context, u64 deadline) {
+  struct capture *capture = context;
+
+  capture_now(capture);
+
+  if (capture->interval) {
+    scheduler_schedule(&capture->video->cpu->scheduler, &capture->event,
+                       deadline + capture->interval);
+  }
+}
+
+void capture_at(struct capture *capture, u64 cycles, u64 interval) {
+  capture->interval = interval;
+  scheduler_schedule(&capture->video->cpu->scheduler, &capture->event, cycles);
+}
+
+static void capture_out(void *context, word offset, byte value) {
+  UNUSED(offset);
+
+  struct capture *capture = context;
+  const struct port_range *forward = &capture->forward;
+  if (forward->handler) {
+    forward->handler->out_func(forward->context, capture->watched_port - forward->start, value);
+  }
+
+  capture_now(capture);
+}
+
+static byte capture_in(void *context, word offset) {
+  UNUSED(offset);
+
+  struct capture *capture = context;
+  const struct port_range *forward = &capture->forward;
+  if (forward->handler) {
+    return forward->handler->in_func(forward->context, capture->watched_port - forward->start);
+  }
+
+  return PORT_OPEN_BUS;
+}
+
+static const struct port_handler capture_port_handler = {
+    .out_func = capture_out,
+    .in_func = capture_in,
+};
+
+bool capture_watch_port(struct capture *capture, struct ports *ports, word port) {
+  if (capture->ports) {
+    return false;
+  }
+
+  if (ports_intercept(ports, port, &capture_port_handler, capture, &capture->forward) < 0) {
+    return false;
+  }
+
+  capture->ports = ports;
+  capture->watched_port = port;
+  return true;
+}
+
+bool capture_set_font(struct capture *capture, const u8 *data, u32 size) {
+  if (capture->font_chosen || !screen_renderer_set_font(&capture->renderer, data, size)) {
+    return false;
+  }
+
+  capture->font_chosen = true;
+  return true;
+}
+
+void capture_flush(struct capture *capture) {
+  pthread_mutex_lock(&capture->lock);
+  while (capture->pending) {
+    pthread_cond_wait(&capture->idle, &capture->lock);
+  }
+  pthread_mutex_unlock(&capture->lock);
+}
+
+bool capture_init(struct capture *capture, struct video *video, const char *prefix,
+                  enum capture_format format) {
+  memset(capture, 0, sizeof(*capture));
+
+  capture->video = video;
+  capture->prefix = strdup(prefix);
+  capture->format = format;
+
+  screen_renderer_init(&capture->renderer);
+  scheduler_event_init(&capture->event, capture_event, capture);
+
+  pthread_mutex_init(&capture->lock, 0);
+  pthread_cond_init(&capture->work, 0);
+  pthread_cond_init(&capture->idle, 0);
+  if (pthread_create(&capture->thread, 0, capture_thread, capture)) {
+    pthread_cond_destroy(&capture->idle);
+    pthread_cond_destroy(&capture->work);
+    pthread_mutex_destroy(&capture->lock);
+    free(capture->prefix);
+    return false;
+  }
+
+  return true;
+}
+
+void capture_destroy(struct capture *capture) {
+  scheduler_cancel(&capture->video->cpu->scheduler, &capture->event);
+
+  if (capture->ports) {
+    ports_unmap(capture->ports, capture->watched_port, capture->watched_port);
+  }
+
+  pthread_mutex_lock(&capture->lock);
+  capture->stopping = true;
+  pthread_cond_signal(&capture->work);
+  pthread_mutex_unlock(&capture->lock);
+  pthread_join(capture->thread, 0);
+
+  pthread_cond_destroy(&capture->idle);
+  pthread_cond_destroy(&capture->work);
+  pthread_mutex_destroy(&capture->lock);
+
+  free(capture->prefix);
+}
@@ -0,0 +1,699 @@
+#include "devices/disk_image.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// All the open images and overlay bases, so that opening a file twice shares it.
+static pthread_mutex_t open_images_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct disk_image *open_images;
+static struct disk_base *open_bases;
+
+static void write_u32(u8 *data, u32 value) {
+  data[0] = value & 0xff;
+  data[1] = (value >> 8) & 0xff;
+  data[2] = (value >> 16) & 0xff;
+  data[3] = value >> 24;
+}
+
+static u32 read_u32(const u8 *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((u32)data[3] << 24);
+}
+
+// Called with `open_images_lock` held.
+static struct disk_base *disk_base_open(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) < 0 || status.st_size < DISK_SECTOR_SIZE) {
+    close(fd);
+    return 0;
+  }
+
+  for (struct disk_base *base = open_bases; base; base = base->next) {
+    if (base->device == status.st_dev && base->inode == status.st_ino) {
+      ++base->references;
+      close(fd);
+      return base;
+    }
+  }
+
+  void *data = mmap(0, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return 0;
+  }
+
+  struct disk_base *base = calloc(1, sizeof(*base));
+  base->path = strdup(path);
+  base->data = data;
+  base->size = status.st_size;
+  base->device = status.st_dev;
+  base->inode = status.st_ino;
+  base->references = 1;
+
+  base->next = open_bases;
+  open_bases = base;
+
+  return base;
+}
+
+// Called with `open_images_lock` held.
+static void disk_base_release(struct disk_base *base) {
+  if (--base->references) {
+    return;
+  }
+
+  for (struct disk_base **link = &open_bases; *link; link = &(*link)->next) {
+    if (*link == base) {
+      *link = base->next;
+      break;
+    }
+  }
+
+  munmap((void *)base->data, base->size);
+  free(base->path);
+  free(base);
+}
+
+static u32 disk_overlay_hash(u32 lba) {
+  return lba * 2654435761u;
+}
+
+// Return the record holding sector `lba`, or `DISK_OVERLAY_EMPTY` if it was never written.
+static u32 disk_overlay_find(const struct disk_image *image, u32 lba) {
+  if (!image->slot_capacity) {
+    return DISK_OVERLAY_EMPTY;
+  }
+
+  u32 mask = image->slot_capacity - 1;
+  for (u32 i = disk_overlay_hash(lba) & mask;; i = (i + 1) & mask) {
+    const struct disk_overlay_slot *slot = &image->slots[i];
+    if (slot->lba == lba) {
+      return slot->record;
+    }
+    if (slot->lba == DISK_OVERLAY_EMPTY) {
+      return DISK_OVERLAY_EMPTY;
+    }
+  }
+}
+
+static void disk_overlay_set(struct disk_image *image, u32 lba, u32 record) {
+  u32 mask = image->slot_capacity - 1;
+  for (u32 i = disk_overlay_hash(lba) & mask;; i = (i + 1) & mask) {
+    struct disk_overlay_slot *slot = &image->slots[i];
+    if (slot->lba == DISK_OVERLAY_EMPTY) {
+      slot->lba = lba;
+      ++image->overlay_sectors;
+    }
+    if (slot->lba == lba) {
+      slot->record = record;
+      return;
+    }
+  }
+}
+
+// Add a record for sector `lba`, replacing the one it had. Return the index of the record.
+static u32 disk_overlay_append(struct disk_image *image, u32 lba) {
+  if (image->record_count == image->record_capacity) {
+    image->record_capacity = image->record_capacity ? image->record_capacity * 2 : 64;
+    image->records = realloc(image->records, (size_t)image->record_capacity * DISK_SECTOR_SIZE);
+  }
+
+  // Keep the table at most three quarters full.
+  if ((image->overlay_sectors + 1) * 4 > image->slot_capacity * 3) {
+    struct disk_overlay_slot *slots = image->slots;
+    u32 capacity = image->slot_capacity;
+
+    image->slot_capacity = capacity ? capacity * 2 : 64;
+    image->slots = malloc(image->slot_capacity * sizeof(*image->slots));
+    memset(image->slots, 0xff, image->slot_capacity * sizeof(*image->slots));
+    image->overlay_sectors = 0;
+
+    for (u32 i = 0; i < capacity; ++i) {
+      if (slots[i].lba != DISK_OVERLAY_EMPTY) {
+        disk_overlay_set(image, slots[i].lba, slots[i].record);
+      }
+    }
+    free(slots);
+  }
+
+  u32 record = image->record_count++;
+  disk_overlay_set(image, lba, record);
+
+  return record;
+}
+
+static off_t disk_overlay_record_offset(u32 record) {
+  return DISK_OVERLAY_HEADER_SIZE + (off_t)record * DISK_OVERLAY_RECORD_SIZE;
+}
+
+// Read the records of the overlay file, or write the header of an empty one.
+static bool disk_overlay_load(struct disk_image *image, off_t size) {
+  u8 header[DISK_OVERLAY_HEADER_SIZE] = {0};
+
+  if (!size) {
+    memcpy(header, DISK_OVERLAY_MAGIC, sizeof(DISK_OVERLAY_MAGIC));
+    write_u32(header + 8, image->sector_count);
+    return pwrite(image->fd, header, sizeof(header), 0) == sizeof(header);
+  }
+
+  if (pread(image->fd, header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(header, DISK_OVERLAY_MAGIC, sizeof(DISK_OVERLAY_MAGIC)) ||
+      read_u32(header + 8) != image->sector_count) {
+    return false;
+  }
+
+  // A record cut short by a crash is dropped and overwritten by the next new sector.
+  u32 record_count = (size - DISK_OVERLAY_HEADER_SIZE) / DISK_OVERLAY_RECORD_SIZE;
+  for (u32 i = 0; i < record_count; ++i) {
+    u8 data[DISK_OVERLAY_RECORD_SIZE];
+    if (pread(image->fd, data, sizeof(data), disk_overlay_record_offset(i)) != sizeof(data)) {
+      return false;
+    }
+
+    u32 lba = read_u32(data);
+    if (lba >= image->sector_count) {
+      return false;
+    }
+
+    u32 record = disk_overlay_append(image, lba);
+    memcpy(image->records + (size_t)record * DISK_SECTOR_SIZE, data + 4, DISK_SECTOR_SIZE);
+  }
+
+  return true;
+}
+
+// Add a loaded page to the cache, dropping the oldest page if it is full. Called with the lock
+// held.
+static void disk_image_cache_page(struct disk_image *image, u32 page_index, u8 *page) {
+  if (image->cached_count < DISK_CACHE_PAGES) {
+    image->cached_pages[image->cached_count++] = page_index;
+  } else {
+    u32 *oldest = &image->cached_pages[image->oldest_cached];
+    free(image->pages[*oldest]);
+    image->pages[*oldest] = 0;
+
+    *oldest = page_index;
+    image->oldest_cached = (image->oldest_cached + 1) % DISK_CACHE_PAGES;
+  }
+
+  image->pages[page_index] = page;
+}
+
+// Return the page holding `lba`, loading it if needed, or null if there is no memory for it. Called
+// with the lock held, which is dropped while reading from the file.
+static u8 *disk_image_page(struct disk_image *image, u32 lba) {
+  u32 page_index = lba / DISK_SECTORS_PER_PAGE;
+  if (image->pages[page_index]) {
+    return image->pages[page_index];
+  }
+
+  u8 *page = aligned_alloc(DISK_PAGE_SIZE, DISK_PAGE_SIZE);
+  if (!page) {
+    return 0;
+  }
+
+  pthread_mutex_unlock(&image->lock);
+
+  ssize_t bytes_read = pread(image->fd, page, DISK_PAGE_SIZE, (off_t)page_index * DISK_PAGE_SIZE);
+  if (bytes_read < DISK_PAGE_SIZE) {
+    // The last page of an image that is not a multiple of the page size.
+    memset(page + (bytes_read > 0 ? bytes_read : 0), 0,
+           DISK_PAGE_SIZE - (bytes_read > 0 ? bytes_read : 0));
+  }
+
+  pthread_mutex_lock(&image->lock);
+
+  // Somebody else might have loaded it in the meantime.
+  if (image->pages[page_index]) {
+    free(page);
+  } else {
+    disk_image_cache_page(image, page_index, page);
+  }
+
+  return image->pages[page_index];
+}
+
+static u8 *disk_image_sector(u8 *page, u32 lba) {
+  return page + (lba % DISK_SECTORS_PER_PAGE) * DISK_SECTOR_SIZE;
+}
+
+// Return the data of sector `lba`, or null if it is not in memory and `load` is false or it could
+// not be loaded. Called with the lock held.
+static const u8 *disk_image_read_sector(struct disk_image *image, u32 lba, bool load) {
+  if (image->base) {
+    u32 record = disk_overlay_find(image, lba);
+    if (record != DISK_OVERLAY_EMPTY) {
+      return image->records + (size_t)record * DISK_SECTOR_SIZE;
+    }
+
+    // Touching the mapping can fault the sector in from the disk, so leave it to the I/O thread.
+    return load ? image->base->data + (size_t)lba * DISK_SECTOR_SIZE : 0;
+  }
+
+  u8 *page = image->pages[lba / DISK_SECTORS_PER_PAGE];
+  if (!page) {
+    if (!load) {
+      return 0;
+    }
+    page = disk_image_page(image, lba);
+  }
+
+  return page ? disk_image_sector(page, lba) : 0;
+}
+
+// Update the cache and the file. Called with the lock held, which is dropped while writing.
+static bool disk_image_write(struct disk_image *image, struct disk_request *request) {
+  if (!image->base) {
+    for (u32 i = 0; i < request->count; ++i) {
+      // A page that could not be loaded is not cached either, the file alone is enough.
+      u32 lba = request->lba + i;
+      u8 *page = disk_image_page(image, lba);
+      if (page) {
+        memcpy(disk_image_sector(page, lba), request->buffer + i * DISK_SECTOR_SIZE,
+               DISK_SECTOR_SIZE);
+      }
+    }
+
+    pthread_mutex_unlock(&image->lock);
+    ssize_t size = (ssize_t)request->count * DISK_SECTOR_SIZE;
+    bool written =
+        pwrite(image->fd, request->buffer, size, (off_t)request->lba * DISK_SECTOR_SIZE) == size;
+    pthread_mutex_lock(&image->lock);
+
+    return written;
+  }
+
+  bool written = true;
+  for (u32 i = 0; i < request->count; ++i) {
+    u32 lba = request->lba + i;
+    u8 *data = request->buffer + i * DISK_SECTOR_SIZE;
+
+    u32 record = disk_overlay_find(image, lba);
+    if (record == DISK_OVERLAY_EMPTY) {
+      record = disk_overlay_append(image, lba);
+    }
+    memcpy(image->records + (size_t)record * DISK_SECTOR_SIZE, data, DISK_SECTOR_SIZE);
+
+    u8 header[4];
+    write_u32(header, lba);
+    struct iovec parts[] = {
+        {header, sizeof(header)},
+        {data, DISK_SECTOR_SIZE},
+    };
+
+    pthread_mutex_unlock(&image->lock);
+    written &= pwritev(image->fd, parts, ARRAY_SIZE(parts), disk_overlay_record_offset(record)) ==
+               DISK_OVERLAY_RECORD_SIZE;
+    pthread_mutex_lock(&image->lock);
+  }
+
+  return written;
+}
+
+// Execute the request with the lock held. Return false if it needs sectors that are not in memory
+// and `load` is false.
+static bool disk_image_execute(struct disk_image *image, struct disk_request *request, bool load) {
+  if (request->lba + request->count > image->sector_count ||
+      (request->type == drt_write && !image->writable)) {
+    request->failed = true;
+    request->done = true;
+    return true;
+  }
+
+  if (request->type == drt_write) {
+    // Only the I/O thread gets here for writes, so the file is written in submission order.
+    request->failed = !disk_image_write(image, request);
+    request->done = true;
+    return true;
+  }
+
+  if (!load) {
+    for (u32 i = 0; i < request->count; ++i) {
+      if (!disk_image_read_sector(image, request->lba + i, false)) {
+        return false;
+      }
+    }
+  }
+
+  for (u32 i = 0; i < request->count && !request->failed; ++i) {
+    const u8 *sector = disk_image_read_sector(image, request->lba + i, true);
+    if (sector) {
+      memcpy(request->buffer + i * DISK_SECTOR_SIZE, sector, DISK_SECTOR_SIZE);
+    } else {
+      request->failed = true;
+    }
+  }
+
+  request->done = true;
+  return true;
+}
+
+static void *disk_image_thread(void *context) {
+  struct disk_image *image = context;
+
+  pthread_mutex_lock(&image->lock);
+
+  for (;;) {
+    while (!image->queue_head && !image->stopping) {
+      pthread_cond_wait(&image->work, &image->lock);
+    }
+
+    struct disk_request *request = image->queue_head;
+    if (!request) {
+      break;
+    }
+
+    disk_image_execute(image, request, true);
+
+    // Only dequeue once done, so that reads submitted meanwhile queue up behind the request.
+    image->queue_head = request->next;
+    if (!image->queue_head) {
+      image->queue_tail = 0;
+    }
+
+    pthread_cond_broadcast(&image->completed);
+  }
+
+  pthread_mutex_unlock(&image->lock);
+  return 0;
+}
+
+// Return the open image of the file, with a new reference. Called with `open_images_lock` held.
+static struct disk_image *disk_image_find(const struct stat *status) {
+  for (struct disk_image *image = open_images; image; image = image->next) {
+    if (image->device == status->st_dev && image->inode == status->st_ino) {
+      ++image->references;
+      return image;
+    }
+  }
+
+  return 0;
+}
+
+static struct disk_image *disk_image_new(int fd, bool writable, u32 sector_count,
+                                         const struct stat *status) {
+  struct disk_image *image = calloc(1, sizeof(*image));
+  image->fd = fd;
+  image->writable = writable;
+  image->sector_count = sector_count;
+  image->device = status->st_dev;
+  image->inode = status->st_ino;
+  image->references = 1;
+
+  pthread_mutex_init(&image->lock, 0);
+  pthread_cond_init(&image->work, 0);
+  pthread_cond_init(&image->completed, 0);
+
+  return image;
+}
+
+// Free an image whose thread is not running. Called with `open_images_lock` held.
+static void disk_image_free(struct disk_image *image) {
+  for (u32 i = 0; i < image->page_count; ++i) {
+    free(image->pages[i]);
+  }
+  free(image->pages);
+
+  if (image->base) {
+    disk_base_release(image->base);
+  }
+  free(image->slots);
+  free(image->records);
+
+  pthread_cond_destroy(&image->completed);
+  pthread_cond_destroy(&image->work);
+  pthread_mutex_destroy(&image->lock);
+
+  close(image->fd);
+  free(image);
+}
+
+// Start the I/O thread and make the image available to others. Return false if the thread could
+// not be started. Called with `open_images_lock` held.
+static bool disk_image_start(struct disk_image *image) {
+  if (pthread_create(&image->thread, 0, disk_image_thread, image)) {
+    return false;
+  }
+
+  image->next = open_images;
+  open_images = image;
+  return true;
+}
+
+struct disk_image *disk_image_open(const char *path) {
+  bool writable = true;
+  int fd = open(path, O_RDWR);
+  if (fd < 0) {
+    writable = false;
+    fd = open(path, O_RDONLY);
+  }
+  if (fd < 0) {
+    return 0;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) < 0) {
+    close(fd);
+    return 0;
+  }
+
+  pthread_mutex_lock(&open_images_lock);
+
+  struct disk_image *image = disk_image_find(&status);
+  if (image) {
+    pthread_mutex_unlock(&open_images_lock);
+    close(fd);
+    return image;
+  }
+
+  image = disk_image_new(fd, writable, status.st_size / DISK_SECTOR_SIZE, &status);
+  image->page_count = (image->sector_count + DISK_SECTORS_PER_PAGE - 1) / DISK_SECTORS_PER_PAGE;
+  image->pages = calloc(image->page_count ? image->page_count : 1, sizeof(*image->pages));
+  if (!disk_image_start(image)) {
+    disk_image_free(image);
+    image = 0;
+  }
+
+  pthread_mutex_unlock(&open_images_lock);
+
+  return image;
+}
+
+struct disk_image *disk_image_open_overlay(const char *base_path, const char *overlay_path,
+                                           bool create) {
+  int fd = open(overlay_path, O_RDWR | (create ? O_CREAT : 0), 0644);
+  if (fd < 0) {
+    return 0;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) < 0) {
+    close(fd);
+    return 0;
+  }
+
+  pthread_mutex_lock(&open_images_lock);
+
+  struct disk_image *image = disk_image_find(&status);
+  if (image) {
+    struct stat base_status;
+    if (!image->base || stat(base_path, &base_status) < 0 ||
+        image->base->device != base_status.st_dev || image->base->inode != base_status.st_ino) {
+      --image->references;
+      image = 0;
+    }
+
+    pthread_mutex_unlock(&open_images_lock);
+    close(fd);
+    return image;
+  }
+
+  struct disk_base *base = disk_base_open(base_path);
+  if (!base) {
+    pthread_mutex_unlock(&open_images_lock);
+    close(fd);
+    return 0;
+  }
+
+  image = disk_image_new(fd, true, base->size / DISK_SECTOR_SIZE, &status);
+  image->base = base;
+
+  if (!disk_overlay_load(image, status.st_size)) {
+    disk_image_free(image);
+    pthread_mutex_unlock(&open_images_lock);
+    return 0;
+  }
+
+  if (!disk_image_start(image)) {
+    disk_image_free(image);
+    image = 0;
+  }
+
+  pthread_mutex_unlock(&open_images_lock);
+
+  return image;
+}
+
+void disk_image_close(struct disk_image *image) {
+  pthread_mutex_lock(&open_images_lock);
+
+  if (--image->references) {
+    pthread_mutex_unlock(&open_images_lock);
+    return;
+  }
+
+  for (struct disk_image **link = &open_images; *link; link = &(*link)->next) {
+    if (*link == image) {
+      *link = image->next;
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&open_images_lock);
+
+  pthread_mutex_lock(&image->lock);
+  image->stopping = true;
+  pthread_cond_signal(&image->work);
+  pthread_mutex_unlock(&image->lock);
+  pthread_join(image->thread, 0);
+
+  // The base stays mapped until the thread is done with it.
+  pthread_mutex_lock(&open_images_lock);
+  disk_image_free(image);
+  pthread_mutex_unlock(&open_images_lock);
+}
+
+void disk_image_submit(struct disk_image *image, struct disk_request *request) {
+  request->done = false;
+  request->failed = false;
+  request->next = 0;
+
+  pthread_mutex_lock(&image->lock);
+
+  // Reads that hit the cache complete right away, unless they have to wait for earlier writes.
+  bool served = !image->queue_head && request->type == drt_read &&
+                disk_image_execute(image, request, false);
+
+  if (!served) {
+    if (image->queue_tail) {
+      image->queue_tail->next = request;
+    } else {
+      image->queue_head = request;
+    }
+    image->queue_tail = request;
+    pthread_cond_signal(&image->work);
+  }
+
+  pthread_mutex_unlock(&image->lock);
+}
+
+bool disk_request_done(struct disk_image *image, struct disk_request *request) {
+  pthread_mutex_lock(&image->lock);
+  bool done = request->done;
+  pthread_mutex_unlock(&image->lock);
+
+  return done;
+}
+
+void disk_image_wait(struct disk_image *image, struct disk_request *request) {
+  pthread_mutex_lock(&image->lock);
+  while (!request->done) {
+    pthread_cond_wait(&image->completed, &image->lock);
+  }
+  pthread_mutex_unlock(&image->lock);
+}
+
+// Take the lock once the queued requests are done.
+static void disk_image_lock_idle(struct disk_image *image) {
+  pthread_mutex_lock(&image->lock);
+  while (image->queue_head) {
+    pthread_cond_wait(&image->completed, &image->lock);
+  }
+}
+
+// Write the sectors of the overlay at their place in `fd`.
+static bool disk_overlay_write_sectors(struct disk_image *image, int fd) {
+  for (u32 i = 0; i < image->slot_capacity; ++i) {
+    const struct disk_overlay_slot *slot = &image->slots[i];
+    if (slot->lba == DISK_OVERLAY_EMPTY) {
+      continue;
+    }
+
+    const u8 *data = image->records + (size_t)slot->record * DISK_SECTOR_SIZE;
+    if (pwrite(fd, data, DISK_SECTOR_SIZE, (off_t)slot->lba * DISK_SECTOR_SIZE) !=
+        DISK_SECTOR_SIZE) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool disk_image_export(struct disk_image *image, const char *path) {
+  if (!image->base) {
+    return false;
+  }
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  disk_image_lock_idle(image);
+
+  size_t size = (size_t)image->sector_count * DISK_SECTOR_SIZE;
+  bool exported = true;
+  for (size_t offset = 0; exported && offset < size;) {
+    ssize_t written = write(fd, image->base->data + offset, size - offset);
+    exported = written > 0;
+    offset += exported ? written : 0;
+  }
+  exported = exported && disk_overlay_write_sectors(image, fd);
+
+  pthread_mutex_unlock(&image->lock);
+
+  return close(fd) == 0 && exported;
+}
+
+bool disk_image_commit(struct disk_image *image) {
+  if (!image->base) {
+    return false;
+  }
+
+  pthread_mutex_lock(&open_images_lock);
+  bool shared = image->base->references > 1;
+  pthread_mutex_unlock(&open_images_lock);
+  if (shared) {
+    return false;
+  }
+
+  int fd = open(image->base->path, O_WRONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  disk_image_lock_idle(image);
+
+  // The mapping of the base sees the new sectors, so the overlay can be emptied right away.
+  bool committed = disk_overlay_write_sectors(image, fd) && fsync(fd) == 0 &&
+                   ftruncate(image->fd, DISK_OVERLAY_HEADER_SIZE) == 0;
+  if (committed) {
+    memset(image->slots, 0xff, image->slot_capacity * sizeof(*image->slots));
+    image->overlay_sectors = 0;
+    image->record_count = 0;
+  }
+
+  pthread_mutex_unlock(&image->lock);
+  close(fd);
+
+  return committed;
+}
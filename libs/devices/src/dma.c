@@ -0,0 +1,209 @@
+#include "devices/dma.h"
+
+#include <assert.h>
+#include <string.h>
+
+// Mode register fields.
+#define DMA_MODE_TRANSFER(Mode) (((Mode) >> 2) & 0x03)
+#define DMA_MODE_AUTO_INIT 0x10
+#define DMA_MODE_DECREMENT 0x20
+
+// Page register port of every channel, relative to 0x81.
+static const byte page_port_channels[] = {[0x00] = 2, [0x01] = 3, [0x02] = 1, [0x06] = 0};
+static const bool page_port_used[] = {[0x00] = true, [0x01] = true, [0x02] = true, [0x06] = true};
+
+static enum dma_transfer dma_channel_transfer(const struct dma_channel *channel) {
+  return (enum dma_transfer)DMA_MODE_TRANSFER(channel->mode);
+}
+
+// Move `size` bytes through the channel, reading memory into `data` or writing `data` to memory.
+static u32 dma_transfer(struct dma *dma, unsigned channel_index, u8 *data, u32 size,
+                        enum dma_transfer transfer) {
+  assert(channel_index < DMA_CHANNEL_COUNT);
+
+  struct dma_channel *channel = &dma->channels[channel_index];
+  if (dma->disabled || channel->masked || dma_channel_transfer(channel) != transfer) {
+    return 0;
+  }
+
+  struct bus *bus = dma->cpu->bus;
+  u32 moved = 0;
+
+  while (moved < size) {
+    // The address wraps around inside the 64KiB page.
+    u32 addr = (channel->page << 16) | channel->address;
+    if (addr < bus->memory_size) {
+      if (transfer == dma_transfer_write) {
+        bus_store_byte(bus, addr, data[moved]);
+      } else {
+        data[moved] = bus_fetch_byte(bus, addr);
+      }
+    }
+    ++moved;
+
+    channel->address += channel->mode & DMA_MODE_DECREMENT ? -1 : 1;
+
+    // The count is one less than the number of bytes, the terminal count is reached when it
+    // rolls over.
+    if (channel->count-- == 0) {
+      dma->status |= 1 << channel_index;
+
+      if (channel->mode & DMA_MODE_AUTO_INIT) {
+        channel->address = channel->base_address;
+        channel->count = channel->base_count;
+      } else {
+        channel->masked = true;
+      }
+      break;
+    }
+  }
+
+  return moved;
+}
+
+u32 dma_write_memory(struct dma *dma, unsigned channel, const u8 *data, u32 size) {
+  return dma_transfer(dma, channel, (u8 *)data, size, dma_transfer_write);
+}
+
+u32 dma_read_memory(struct dma *dma, unsigned channel, u8 *data, u32 size) {
+  return dma_transfer(dma, channel, data, size, dma_transfer_read);
+}
+
+static void dma_write_register(struct dma *dma, word *base, word *current, byte value) {
+  if (dma->flip_flop) {
+    *base = (*base & 0x00ff) | (value << 8);
+  } else {
+    *base = (*base & 0xff00) | value;
+  }
+  *current = *base;
+  dma->flip_flop = !dma->flip_flop;
+}
+
+static byte dma_read_register(struct dma *dma, word value) {
+  byte result = dma->flip_flop ? value >> 8 : value & 0xff;
+  dma->flip_flop = !dma->flip_flop;
+  return result;
+}
+
+static void dma_master_clear(struct dma *dma) {
+  for (unsigned i = 0; i < DMA_CHANNEL_COUNT; ++i) {
+    dma->channels[i].masked = true;
+  }
+  dma->flip_flop = false;
+  dma->status = 0;
+  dma->disabled = false;
+}
+
+static void dma_out(void *context, word offset, byte value) {
+  struct dma *dma = context;
+
+  if (offset < 0x08) {
+    struct dma_channel *channel = &dma->channels[offset / 2];
+    if (offset & 1) {
+      dma_write_register(dma, &channel->base_count, &channel->count, value);
+    } else {
+      dma_write_register(dma, &channel->base_address, &channel->address, value);
+    }
+    return;
+  }
+
+  switch (offset) {
+    case 0x08:
+      // Command register, only the controller disable bit matters without memory to memory
+      // transfers.
+      dma->disabled = value & 0x04;
+      break;
+
+    case 0x09:
+      // Software requests are not supported.
+      break;
+
+    case 0x0a:
+      dma->channels[value & 0x03].masked = value & 0x04;
+      break;
+
+    case 0x0b:
+      dma->channels[value & 0x03].mode = value;
+      break;
+
+    case 0x0c:
+      dma->flip_flop = false;
+      break;
+
+    case 0x0d:
+      dma_master_clear(dma);
+      break;
+
+    case 0x0e:
+      for (unsigned i = 0; i < DMA_CHANNEL_COUNT; ++i) {
+        dma->channels[i].masked = false;
+      }
+      break;
+
+    case 0x0f:
+      for (unsigned i = 0; i < DMA_CHANNEL_COUNT; ++i) {
+        dma->channels[i].masked = value & (1 << i);
+      }
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+}
+
+static byte dma_in(void *context, word offset) {
+  struct dma *dma = context;
+
+  if (offset < 0x08) {
+    struct dma_channel *channel = &dma->channels[offset / 2];
+    return dma_read_register(dma, offset & 1 ? channel->count : channel->address);
+  }
+
+  if (offset == 0x08) {
+    byte status = dma->status;
+    dma->status = 0;
+    return status;
+  }
+
+  return 0xff;
+}
+
+static void dma_page_out(void *context, word offset, byte value) {
+  struct dma *dma = context;
+
+  if (offset < ARRAY_SIZE(page_port_used) && page_port_used[offset]) {
+    dma->channels[page_port_channels[offset]].page = value & 0x0f;
+  }
+}
+
+static byte dma_page_in(void *context, word offset) {
+  struct dma *dma = context;
+
+  if (offset < ARRAY_SIZE(page_port_used) && page_port_used[offset]) {
+    return dma->channels[page_port_channels[offset]].page;
+  }
+
+  return 0xff;
+}
+
+static const struct port_handler dma_port_handler = {
+    .out_func = dma_out,
+    .in_func = dma_in,
+};
+
+static const struct port_handler dma_page_port_handler = {
+    .out_func = dma_page_out,
+    .in_func = dma_page_in,
+};
+
+void dma_init(struct dma *dma, struct cpu *cpu) {
+  memset(dma, 0, sizeof(*dma));
+
+  dma->cpu = cpu;
+  dma_master_clear(dma);
+
+  ports_map_address(cpu->ports, DMA_PORT_BASE, DMA_PORT_BASE + 0x0f, &dma_port_handler, dma);
+  ports_map_address(cpu->ports, DMA_PAGE_PORT_BASE, DMA_PAGE_PORT_BASE + 0x06,
+                    &dma_page_port_handler, dma);
+}
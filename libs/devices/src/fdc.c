@@ -0,0 +1,487 @@
+#include "devices/fdc.h"
+
+#include <assert.h>
+#include <string.h>
+
+// Digital output register.
+#define FDC_DOR_DRIVE 0x03
+#define FDC_DOR_NOT_RESET 0x04
+#define FDC_DOR_DMA_IRQ 0x08
+
+// Main status register.
+#define FDC_MSR_BUSY 0x10
+#define FDC_MSR_DIO 0x40
+#define FDC_MSR_RQM 0x80
+
+// Status register 0.
+#define FDC_ST0_ABNORMAL 0x40
+#define FDC_ST0_INVALID 0x80
+#define FDC_ST0_SEEK_END 0x20
+#define FDC_ST0_NOT_READY 0x08
+#define FDC_ST0_READY_CHANGED 0xc0
+
+// Status register 1.
+#define FDC_ST1_NOT_WRITABLE 0x02
+#define FDC_ST1_NO_DATA 0x04
+#define FDC_ST1_OVERRUN 0x10
+
+// Status register 3.
+#define FDC_ST3_TWO_SIDED 0x08
+#define FDC_ST3_TRACK_0 0x10
+#define FDC_ST3_READY 0x20
+#define FDC_ST3_WRITE_PROTECTED 0x40
+
+// Command byte flags and codes.
+#define FDC_COMMAND_MULTI_TRACK 0x80
+#define FDC_COMMAND_CODE 0x1f
+
+enum fdc_command {
+  fc_specify = 0x03,
+  fc_sense_drive_status = 0x04,
+  fc_write_data = 0x05,
+  fc_read_data = 0x06,
+  fc_recalibrate = 0x07,
+  fc_sense_interrupt_status = 0x08,
+  fc_read_id = 0x0a,
+  fc_seek = 0x0f,
+};
+
+// Sector size code of 512 byte sectors.
+#define FDC_SECTOR_SIZE_CODE 2
+
+static const struct {
+  u32 size;
+  u16 cylinders;
+  u8 heads;
+  u8 sectors;
+} floppy_formats[] = {
+    {160 * 1024, 40, 1, 8},   {180 * 1024, 40, 1, 9},   {320 * 1024, 40, 2, 8},
+    {360 * 1024, 40, 2, 9},   {720 * 1024, 80, 2, 9},   {1200 * 1024, 80, 2, 15},
+    {1440 * 1024, 80, 2, 18}, {2880 * 1024, 80, 2, 36},
+};
+
+static u8 fdc_command_length(u8 code) {
+  switch (code) {
+    case fc_sense_interrupt_status:
+      return 1;
+
+    case fc_sense_drive_status:
+    case fc_recalibrate:
+    case fc_read_id:
+      return 2;
+
+    case fc_specify:
+    case fc_seek:
+      return 3;
+
+    case fc_write_data:
+    case fc_read_data:
+      return 9;
+
+    default:
+      // Answered right away as an invalid command.
+      return 1;
+  }
+}
+
+static void fdc_raise_irq(struct fdc *fdc) {
+  if (fdc->dor & FDC_DOR_DMA_IRQ) {
+    irq_line_raise(&fdc->irq);
+  }
+}
+
+static struct fdc_drive *fdc_drive(struct fdc *fdc, u8 drive_head) {
+  unsigned index = drive_head & 0x03;
+  return index < FDC_DRIVE_COUNT ? &fdc->drives[index] : 0;
+}
+
+static void fdc_start_result(struct fdc *fdc, const u8 *result, u8 size) {
+  memcpy(fdc->result, result, size);
+  fdc->result_size = size;
+  fdc->result_index = 0;
+  fdc->phase = fp_result;
+}
+
+// Result of a read or write: ST0, ST1, ST2 and the sector the transfer stopped at.
+static void fdc_transfer_result(struct fdc *fdc, u8 st0, u8 st1, u8 c, u8 h, u8 r) {
+  u8 result[] = {st0 | (fdc->command[1] & 0x07), st1, 0, c, h, r, FDC_SECTOR_SIZE_CODE};
+  fdc_start_result(fdc, result, sizeof(result));
+  fdc_raise_irq(fdc);
+}
+
+static void fdc_transfer_failed(struct fdc *fdc, u8 st0, u8 st1) {
+  fdc_transfer_result(fdc, FDC_ST0_ABNORMAL | st0, st1, fdc->command[2], fdc->command[3],
+                      fdc->command[4]);
+}
+
+// Wait for the transfer in flight to let go of the buffer.
+static void fdc_finish_request(struct fdc *fdc) {
+  if (fdc->request_drive) {
+    disk_image_wait(fdc->request_drive->image, &fdc->request);
+    fdc->request_drive = 0;
+  }
+}
+
+static void fdc_transfer_event(void *context, u64 deadline) {
+  UNUSED(deadline);
+
+  struct fdc *fdc = context;
+  struct fdc_drive *drive = fdc->request_drive;
+  if (!drive) {
+    // The disk was taken out during the transfer.
+    fdc_transfer_failed(fdc, FDC_ST0_NOT_READY, 0);
+    return;
+  }
+
+  fdc_finish_request(fdc);
+
+  if (fdc->request.failed) {
+    fdc_transfer_failed(fdc, 0, FDC_ST1_NO_DATA);
+    return;
+  }
+
+  u32 count = fdc->request.count;
+  if ((fdc->command[0] & FDC_COMMAND_CODE) == fc_read_data) {
+    // The transfer stops early when the DMA channel reaches its terminal count.
+    u32 moved = dma_write_memory(fdc->dma, FDC_DMA_CHANNEL, fdc->buffer, count * DISK_SECTOR_SIZE);
+    if (!moved) {
+      fdc_transfer_failed(fdc, 0, FDC_ST1_OVERRUN);
+      return;
+    }
+    count = (moved + DISK_SECTOR_SIZE - 1) / DISK_SECTOR_SIZE;
+  }
+
+  // The sector after the last one transferred. Multi-track transfers go from head 0 to head 1 and
+  // then to the next cylinder.
+  bool multi_track = fdc->command[0] & FDC_COMMAND_MULTI_TRACK;
+  u8 c = fdc->command[2];
+  u8 h = fdc->command[3];
+  u8 end_of_track = fdc->command[6];
+  u32 next = fdc->command[4] - 1 + count;
+
+  while (next >= end_of_track) {
+    next -= end_of_track;
+    if (multi_track && h == 0) {
+      h = 1;
+    } else {
+      h = multi_track ? 0 : h;
+      ++c;
+    }
+  }
+
+  drive->cylinder = fdc->command[2];
+  fdc_transfer_result(fdc, 0, 0, c, h, next + 1);
+}
+
+static void fdc_start_transfer(struct fdc *fdc, bool write) {
+  struct fdc_drive *drive = fdc_drive(fdc, fdc->command[1]);
+  if (!drive || !drive->image) {
+    fdc_transfer_failed(fdc, FDC_ST0_NOT_READY, 0);
+    return;
+  }
+
+  if (write && drive->write_protected) {
+    fdc_transfer_failed(fdc, 0, FDC_ST1_NOT_WRITABLE);
+    return;
+  }
+
+  u8 c = fdc->command[2];
+  u8 h = fdc->command[3];
+  u8 r = fdc->command[4];
+  u8 n = fdc->command[5];
+  u8 end_of_track = fdc->command[6];
+  bool multi_track = fdc->command[0] & FDC_COMMAND_MULTI_TRACK;
+
+  if (c >= drive->cylinders || h >= drive->heads || !r || r > end_of_track ||
+      end_of_track > drive->sectors || n != FDC_SECTOR_SIZE_CODE) {
+    fdc_transfer_failed(fdc, 0, FDC_ST1_NO_DATA);
+    return;
+  }
+
+  u32 count = end_of_track - r + 1;
+  if (multi_track && h == 0 && drive->heads > 1 && end_of_track == drive->sectors) {
+    count += end_of_track;
+  }
+
+  if (write) {
+    u32 moved = dma_read_memory(fdc->dma, FDC_DMA_CHANNEL, fdc->buffer, count * DISK_SECTOR_SIZE);
+    if (!moved) {
+      fdc_transfer_failed(fdc, 0, FDC_ST1_OVERRUN);
+      return;
+    }
+
+    // A partial last sector is padded with zeros.
+    count = (moved + DISK_SECTOR_SIZE - 1) / DISK_SECTOR_SIZE;
+    memset(fdc->buffer + moved, 0, count * DISK_SECTOR_SIZE - moved);
+  }
+
+  fdc->request.type = write ? drt_write : drt_read;
+  fdc->request.lba = ((u32)c * drive->heads + h) * drive->sectors + r - 1;
+  fdc->request.count = count;
+  fdc->request.buffer = fdc->buffer;
+  fdc->request_drive = drive;
+  disk_image_submit(drive->image, &fdc->request);
+
+  u32 tracks = c > drive->cylinder ? c - drive->cylinder : drive->cylinder - c;
+  u64 cycles = tracks * FDC_SEEK_CYCLES_PER_TRACK + count * FDC_CYCLES_PER_SECTOR;
+
+  fdc->phase = fp_execution;
+  scheduler_schedule(&fdc->cpu->scheduler, &fdc->event, fdc->cpu->cycles + cycles);
+}
+
+static void fdc_seek(struct fdc *fdc, u8 cylinder) {
+  u8 drive_head = fdc->command[1] & 0x07;
+  struct fdc_drive *drive = fdc_drive(fdc, drive_head);
+
+  fdc->seek_st0 = FDC_ST0_SEEK_END | drive_head;
+  if (drive) {
+    drive->cylinder = cylinder;
+  } else {
+    fdc->seek_st0 |= FDC_ST0_ABNORMAL | FDC_ST0_NOT_READY;
+  }
+
+  // The drive seeks in the background, the controller takes commands right away.
+  fdc->seek_interrupt = true;
+  fdc->phase = fp_command;
+  fdc_raise_irq(fdc);
+}
+
+static void fdc_sense_interrupt_status(struct fdc *fdc) {
+  if (fdc->reset_senses) {
+    unsigned index = 4 - fdc->reset_senses--;
+    u8 cylinder = index < FDC_DRIVE_COUNT ? fdc->drives[index].cylinder : 0;
+    u8 result[] = {FDC_ST0_READY_CHANGED | index, cylinder};
+    fdc_start_result(fdc, result, sizeof(result));
+    return;
+  }
+
+  if (!fdc->seek_interrupt) {
+    u8 result[] = {FDC_ST0_INVALID};
+    fdc_start_result(fdc, result, sizeof(result));
+    return;
+  }
+
+  struct fdc_drive *drive = fdc_drive(fdc, fdc->seek_st0);
+  u8 result[] = {fdc->seek_st0, drive ? drive->cylinder : 0};
+  fdc->seek_interrupt = false;
+  fdc_start_result(fdc, result, sizeof(result));
+}
+
+static void fdc_execute(struct fdc *fdc) {
+  u8 code = fdc->command[0] & FDC_COMMAND_CODE;
+  struct fdc_drive *drive = fdc_drive(fdc, fdc->command[1]);
+
+  switch (code) {
+    case fc_specify:
+      // Step rate, head load and unload times mean nothing here.
+      fdc->phase = fp_command;
+      break;
+
+    case fc_sense_drive_status: {
+      u8 st3 = fdc->command[1] & 0x07;
+      if (drive && drive->image) {
+        st3 |= FDC_ST3_READY;
+        st3 |= drive->heads > 1 ? FDC_ST3_TWO_SIDED : 0;
+        st3 |= drive->write_protected ? FDC_ST3_WRITE_PROTECTED : 0;
+      }
+      st3 |= !drive || !drive->cylinder ? FDC_ST3_TRACK_0 : 0;
+      fdc_start_result(fdc, &st3, 1);
+      break;
+    }
+
+    case fc_write_data:
+    case fc_read_data:
+      fdc_start_transfer(fdc, code == fc_write_data);
+      break;
+
+    case fc_recalibrate:
+      fdc_seek(fdc, 0);
+      break;
+
+    case fc_sense_interrupt_status:
+      fdc_sense_interrupt_status(fdc);
+      break;
+
+    case fc_read_id:
+      if (!drive || !drive->image) {
+        fdc_transfer_failed(fdc, FDC_ST0_NOT_READY, 0);
+      } else {
+        fdc_transfer_result(fdc, (fdc->command[1] & 0x04), 0, drive->cylinder,
+                            (fdc->command[1] >> 2) & 1, 1);
+      }
+      break;
+
+    case fc_seek:
+      fdc_seek(fdc, fdc->command[2]);
+      break;
+
+    default: {
+      u8 st0 = FDC_ST0_INVALID;
+      fdc_start_result(fdc, &st0, 1);
+      break;
+    }
+  }
+}
+
+static void fdc_reset(struct fdc *fdc) {
+  scheduler_cancel(&fdc->cpu->scheduler, &fdc->event);
+  fdc_finish_request(fdc);
+
+  fdc->phase = fp_command;
+  fdc->command_size = 0;
+  fdc->result_size = 0;
+  fdc->seek_interrupt = false;
+}
+
+static void fdc_write_dor(struct fdc *fdc, byte value) {
+  bool was_reset = !(fdc->dor & FDC_DOR_NOT_RESET);
+  fdc->dor = value;
+
+  if (!(value & FDC_DOR_NOT_RESET)) {
+    fdc_reset(fdc);
+    return;
+  }
+
+  // Leaving reset reports a ready change on every drive.
+  if (was_reset) {
+    fdc->reset_senses = 4;
+    fdc_raise_irq(fdc);
+  }
+}
+
+static void fdc_write_data(struct fdc *fdc, byte value) {
+  if (fdc->phase != fp_command) {
+    return;
+  }
+
+  if (!fdc->command_size) {
+    fdc->command_length = fdc_command_length(value & FDC_COMMAND_CODE);
+  }
+
+  fdc->command[fdc->command_size++] = value;
+  if (fdc->command_size == fdc->command_length) {
+    fdc->command_size = 0;
+    fdc_execute(fdc);
+  }
+}
+
+static byte fdc_read_data(struct fdc *fdc) {
+  if (fdc->phase != fp_result) {
+    return 0xff;
+  }
+
+  byte value = fdc->result[fdc->result_index++];
+  if (fdc->result_index == fdc->result_size) {
+    fdc->phase = fp_command;
+  }
+
+  return value;
+}
+
+static byte fdc_main_status(struct fdc *fdc) {
+  switch (fdc->phase) {
+    case fp_command:
+      return FDC_MSR_RQM | (fdc->command_size ? FDC_MSR_BUSY : 0);
+
+    case fp_execution:
+      return FDC_MSR_BUSY;
+
+    case fp_result:
+      return FDC_MSR_RQM | FDC_MSR_DIO | FDC_MSR_BUSY;
+
+    default:
+      assert(0);
+      return 0;
+  }
+}
+
+static void fdc_out(void *context, word offset, byte value) {
+  struct fdc *fdc = context;
+
+  switch (offset) {
+    case 2:
+      fdc_write_dor(fdc, value);
+      break;
+
+    case 5:
+      fdc_write_data(fdc, value);
+      break;
+
+    default:
+      // The configuration control register only selects the data rate.
+      break;
+  }
+}
+
+static byte fdc_in(void *context, word offset) {
+  struct fdc *fdc = context;
+
+  switch (offset) {
+    case 2:
+      return fdc->dor;
+
+    case 4:
+      return fdc_main_status(fdc);
+
+    case 5:
+      return fdc_read_data(fdc);
+
+    case 7:
+      // Digital input register, disks are never changed behind the guest's back.
+      return 0x00;
+
+    default:
+      return 0xff;
+  }
+}
+
+static const struct port_handler fdc_port_handler = {
+    .out_func = fdc_out,
+    .in_func = fdc_in,
+};
+
+void fdc_init(struct fdc *fdc, struct cpu *cpu, struct dma *dma, struct irq_line irq) {
+  memset(fdc, 0, sizeof(*fdc));
+
+  fdc->cpu = cpu;
+  fdc->dma = dma;
+  fdc->irq = irq;
+
+  scheduler_event_init(&fdc->event, fdc_transfer_event, fdc);
+
+  ports_map_address(cpu->ports, FDC_PORT_BASE, FDC_PORT_BASE + 7, &fdc_port_handler, fdc);
+}
+
+void fdc_destroy(struct fdc *fdc) {
+  scheduler_cancel(&fdc->cpu->scheduler, &fdc->event);
+  fdc_finish_request(fdc);
+}
+
+bool fdc_insert_disk(struct fdc *fdc, unsigned drive_index, struct disk_image *image,
+                     bool write_protected) {
+  assert(drive_index < FDC_DRIVE_COUNT);
+
+  struct fdc_drive *drive = &fdc->drives[drive_index];
+  if (fdc->request_drive == drive) {
+    fdc_finish_request(fdc);
+  }
+
+  drive->image = 0;
+  if (!image) {
+    return true;
+  }
+
+  u32 size = image->sector_count * DISK_SECTOR_SIZE;
+  for (unsigned i = 0; i < ARRAY_SIZE(floppy_formats); ++i) {
+    if (floppy_formats[i].size == size) {
+      drive->image = image;
+      drive->write_protected = write_protected || !image->writable;
+      drive->cylinders = floppy_formats[i].cylinders;
+      drive->heads = floppy_formats[i].heads;
+      drive->sectors = floppy_formats[i].sectors;
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,281 @@
+#include "devices/input_script.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INPUT_LEFT_SHIFT 0x2a
+#define INPUT_BREAK 0x80
+
+// Set 1 scan code of the key typing each ASCII character, with the top bit set when shift has to be
+// held down.
+static const u8 ascii_scan_codes[0x80] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x0f, 0x1c, 0x00,
+    0x00, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x39, 0x82, 0xa8, 0x84,
+    0x85, 0x86, 0x88, 0x28, 0x8a, 0x8b, 0x89, 0x8d, 0x33, 0x0c, 0x34, 0x35,
+    0x0b, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0xa7, 0x27,
+    0xb3, 0x0d, 0xb4, 0xb5, 0x83, 0x9e, 0xb0, 0xae, 0xa0, 0x92, 0xa1, 0xa2,
+    0xa3, 0x97, 0xa4, 0xa5, 0xa6, 0xb2, 0xb1, 0x98, 0x99, 0x90, 0x93, 0x9f,
+    0x94, 0x96, 0xaf, 0x91, 0xad, 0x95, 0xac, 0x1a, 0x2b, 0x1b, 0x87, 0x8c,
+    0x29, 0x1e, 0x30, 0x2e, 0x20, 0x12, 0x21, 0x22, 0x23, 0x17, 0x24, 0x25,
+    0x26, 0x32, 0x31, 0x18, 0x19, 0x10, 0x13, 0x1f, 0x14, 0x16, 0x2f, 0x11,
+    0x2d, 0x15, 0x2c, 0x9a, 0xab, 0x9b, 0xa9, 0x00,
+};
+
+void input_script_init(struct input_script *script) {
+  memset(script, 0, sizeof(*script));
+}
+
+void input_script_destroy(struct input_script *script) {
+  if (script->ppi) {
+    scheduler_cancel(&script->ppi->cpu->scheduler, &script->event);
+  }
+
+  free(script->events);
+  free(script->scan_codes);
+}
+
+u32 input_script_scan_codes(char c, u8 *scan_codes) {
+  u8 code = (u8)c < 0x80 ? ascii_scan_codes[(u8)c] : 0;
+  if (!code) {
+    return 0;
+  }
+
+  u32 count = 0;
+  bool shift = code & 0x80;
+  code &= 0x7f;
+
+  if (shift) {
+    scan_codes[count++] = INPUT_LEFT_SHIFT;
+  }
+  scan_codes[count++] = code;
+  scan_codes[count++] = code | INPUT_BREAK;
+  if (shift) {
+    scan_codes[count++] = INPUT_LEFT_SHIFT | INPUT_BREAK;
+  }
+
+  return count;
+}
+
+static void input_script_add_scan_codes(struct input_script *script, const u8 *scan_codes,
+                                        u32 count) {
+  if (script->scan_code_count + count > script->scan_code_capacity) {
+    u32 capacity = script->scan_code_capacity ? script->scan_code_capacity : 256;
+    while (script->scan_code_count + count > capacity) {
+      capacity *= 2;
+    }
+    script->scan_code_capacity = capacity;
+    script->scan_codes = realloc(script->scan_codes, script->scan_code_capacity);
+  }
+
+  memcpy(script->scan_codes + script->scan_code_count, scan_codes, count);
+  script->scan_code_count += count;
+}
+
+static struct input_event *input_script_add_event(struct input_script *script, u64 cycles,
+                                                  enum input_event_type type) {
+  if (script->event_count == script->event_capacity) {
+    script->event_capacity = script->event_capacity ? script->event_capacity * 2 : 64;
+    script->events = realloc(script->events, script->event_capacity * sizeof(*script->events));
+  }
+
+  struct input_event *event = &script->events[script->event_count++];
+  event->cycles = cycles;
+  event->type = type;
+  event->offset = script->scan_code_count;
+  event->count = 0;
+
+  return event;
+}
+
+// Type the text in [text, end) with its escapes.
+static bool input_script_parse_text(struct input_script *script, struct input_event *event,
+                                    const char *text, const char *end) {
+  for (; text < end; ++text) {
+    char c = *text;
+    if (c == '\\') {
+      if (++text == end) {
+        return false;
+      }
+
+      switch (*text) {
+        case 'n':
+          c = '\n';
+          break;
+
+        case 't':
+          c = '\t';
+          break;
+
+        case 'e':
+          c = '\x1b';
+          break;
+
+        case '\\':
+          c = '\\';
+          break;
+
+        default:
+          return false;
+      }
+    }
+
+    u8 scan_codes[INPUT_MAX_SCAN_CODES_PER_CHAR];
+    u32 count = input_script_scan_codes(c, scan_codes);
+    if (!count) {
+      return false;
+    }
+    input_script_add_scan_codes(script, scan_codes, count);
+    event->count += count;
+  }
+
+  return true;
+}
+
+// Send the hex scan codes in [text, end).
+static bool input_script_parse_keys(struct input_script *script, struct input_event *event,
+                                    const char *text, const char *end) {
+  while (text < end) {
+    char *number_end;
+    unsigned long code = strtoul(text, &number_end, 16);
+    if (number_end == text || number_end > end || code > 0xff) {
+      return false;
+    }
+
+    u8 scan_code = code;
+    input_script_add_scan_codes(script, &scan_code, 1);
+    event->count += 1;
+
+    for (text = number_end; text < end && isspace((unsigned char)*text); ++text) {
+    }
+  }
+
+  return event->count > 0;
+}
+
+static bool input_script_parse_line(struct input_script *script, const char *line,
+                                    const char *end) {
+  while (line < end && isspace((unsigned char)*line)) {
+    ++line;
+  }
+  if (line == end || *line == '#') {
+    return true;
+  }
+
+  u64 previous = script->event_count ? script->events[script->event_count - 1].cycles : 0;
+  bool relative = *line == '+';
+  if (relative) {
+    ++line;
+  }
+
+  char *number_end;
+  u64 cycles = strtoull(line, &number_end, 10);
+  if (number_end == line || number_end >= end || !isspace((unsigned char)*number_end)) {
+    return false;
+  }
+  cycles += relative ? previous : 0;
+  if (cycles < previous) {
+    return false;
+  }
+
+  const char *command = number_end + 1;
+  while (command < end && *command == ' ') {
+    ++command;
+  }
+
+  const char *command_end = command;
+  while (command_end < end && !isspace((unsigned char)*command_end)) {
+    ++command_end;
+  }
+
+  // Arguments start after a single space, so typed text can start with spaces.
+  const char *arguments = command_end < end ? command_end + 1 : end;
+  size_t length = command_end - command;
+
+  if (length == 4 && !strncmp(command, "type", 4)) {
+    struct input_event *event = input_script_add_event(script, cycles, iet_scan_codes);
+    return input_script_parse_text(script, event, arguments, end);
+  }
+
+  if (length == 3 && !strncmp(command, "key", 3)) {
+    struct input_event *event = input_script_add_event(script, cycles, iet_scan_codes);
+    return input_script_parse_keys(script, event, arguments, end);
+  }
+
+  if (length == 4 && !strncmp(command, "quit", 4)) {
+    input_script_add_event(script, cycles, iet_quit);
+    return true;
+  }
+
+  return false;
+}
+
+bool input_script_parse(struct input_script *script, const char *text, unsigned *error_line) {
+  unsigned line_number = 1;
+
+  while (*text) {
+    const char *end = strchr(text, '\n');
+    if (!end) {
+      end = text + strlen(text);
+    }
+
+    // Lines may end with CR LF.
+    const char *line_end = end > text && end[-1] == '\r' ? end - 1 : end;
+    if (!input_script_parse_line(script, text, line_end)) {
+      *error_line = line_number;
+      return false;
+    }
+
+    text = *end ? end + 1 : end;
+    ++line_number;
+  }
+
+  return true;
+}
+
+static void input_script_schedule(struct input_script *script) {
+  if (script->next_event < script->event_count) {
+    scheduler_schedule(&script->ppi->cpu->scheduler, &script->event,
+                       script->events[script->next_event].cycles);
+  }
+}
+
+static void input_script_event(void *context, u64 deadline) {
+  struct input_script *script = context;
+
+  while (script->next_event < script->event_count &&
+         script->events[script->next_event].cycles <= deadline) {
+    const struct input_event *event = &script->events[script->next_event++];
+
+    switch (event->type) {
+      case iet_scan_codes:
+        ppi_push_scan_codes(script->ppi, script->scan_codes + event->offset, event->count);
+        break;
+
+      case iet_quit:
+        script->quit = true;
+        break;
+
+      default:
+        assert(0);
+        break;
+    }
+  }
+
+  input_script_schedule(script);
+}
+
+void input_script_play(struct input_script *script, struct ppi *ppi) {
+  script->ppi = ppi;
+  script->next_event = 0;
+  script->quit = false;
+
+  scheduler_event_init(&script->event, input_script_event, script);
+  input_script_schedule(script);
+}
+
+bool input_script_finished(const struct input_script *script) {
+  return script->next_event == script->event_count;
+}
@@ -0,0 +1,144 @@
+#include "devices/pic.h"
+
+#include <string.h>
+
+// Return the bit of the highest priority request in `mask`, or 0 if there is none.
+static byte highest_priority(byte mask) {
+  return mask & -mask;
+}
+
+static void pic_update(struct pic *pic) {
+  byte pending = highest_priority(pic->irr & ~pic->imr);
+  byte in_service = highest_priority(pic->isr);
+
+  // A request only interrupts the cpu if it has a higher priority than everything in service.
+  pic->cpu->intr = pending && (!in_service || pending < in_service);
+}
+
+static int pic_acknowledge(void *context) {
+  struct pic *pic = context;
+
+  byte pending = highest_priority(pic->irr & ~pic->imr);
+  if (!pending) {
+    pic->cpu->intr = false;
+    return -1;
+  }
+
+  pic->irr &= ~pending;
+  if (!pic->auto_eoi) {
+    pic->isr |= pending;
+  }
+
+  pic_update(pic);
+
+  u8 irq = 0;
+  while (!(pending & (1 << irq))) {
+    ++irq;
+  }
+
+  return pic->vector_base + irq;
+}
+
+void pic_raise_irq(void *context, u8 irq) {
+  struct pic *pic = context;
+
+  pic->irr |= 1 << (irq & 0x07);
+  pic_update(pic);
+}
+
+static void pic_command(struct pic *pic, byte value) {
+  if (value & 0x10) {
+    // ICW1 starts the initialization sequence.
+    pic->single = value & 0x02;
+    pic->icw4_needed = value & 0x01;
+    pic->auto_eoi = false;
+    pic->imr = 0;
+    pic->isr = 0;
+    pic->irr = 0;
+    pic->read_isr = false;
+    pic->init_step = 2;
+  } else if (value & 0x08) {
+    // OCW3, only the register read select is supported.
+    if (value & 0x02) {
+      pic->read_isr = value & 0x01;
+    }
+  } else {
+    // OCW2, end of interrupt commands.
+    switch (value & 0xe0) {
+      case 0x20:
+        pic->isr &= ~highest_priority(pic->isr);
+        break;
+
+      case 0x60:
+        pic->isr &= ~(1 << (value & 0x07));
+        break;
+
+      default:
+        // Priority rotation is not supported.
+        break;
+    }
+  }
+
+  pic_update(pic);
+}
+
+static void pic_data(struct pic *pic, byte value) {
+  switch (pic->init_step) {
+    case 2:
+      pic->vector_base = value & 0xf8;
+      pic->init_step = pic->single ? (pic->icw4_needed ? 4 : 0) : 3;
+      break;
+
+    case 3:
+      // ICW3 describes the cascade, which has no effect on a single controller.
+      pic->init_step = pic->icw4_needed ? 4 : 0;
+      break;
+
+    case 4:
+      pic->auto_eoi = value & 0x02;
+      pic->init_step = 0;
+      break;
+
+    default:
+      // OCW1 sets the mask.
+      pic->imr = value;
+      break;
+  }
+
+  pic_update(pic);
+}
+
+static void pic_out(void *context, word offset, byte value) {
+  struct pic *pic = context;
+
+  if (offset == 0) {
+    pic_command(pic, value);
+  } else {
+    pic_data(pic, value);
+  }
+}
+
+static byte pic_in(void *context, word offset) {
+  struct pic *pic = context;
+
+  if (offset == 0) {
+    return pic->read_isr ? pic->isr : pic->irr;
+  }
+
+  return pic->imr;
+}
+
+static const struct port_handler pic_port_handler = {
+    .out_func = pic_out,
+    .in_func = pic_in,
+};
+
+void pic_init(struct pic *pic, struct cpu *cpu) {
+  memset(pic, 0, sizeof(*pic));
+
+  pic->cpu = cpu;
+  pic->single = true;
+
+  cpu_set_interrupt_controller(cpu, pic, pic_acknowledge);
+  ports_map_address(cpu->ports, PIC_PORT_BASE, PIC_PORT_BASE + 1, &pic_port_handler, pic);
+}
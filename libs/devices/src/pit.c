@@ -0,0 +1,294 @@
+#include "devices/pit.h"
+
+#include <assert.h>
+#include <string.h>
+
+static u32 channel_period(const struct pit_channel *channel) {
+  return channel->reload ? channel->reload : 0x10000;
+}
+
+static u64 channel_elapsed_ticks(const struct pit_channel *channel) {
+  return (channel->pit->cpu->cycles - channel->start) / PIT_CYCLES_PER_TICK;
+}
+
+static bool channel_is_periodic(const struct pit_channel *channel) {
+  return channel->mode == 2 || channel->mode == 3;
+}
+
+static void channel_schedule(struct pit_channel *channel) {
+  struct scheduler *scheduler = &channel->pit->cpu->scheduler;
+
+  // Nobody listens to the output, so there is no reason to wake up for it.
+  if (!channel->irq.raise || !channel->counting) {
+    scheduler_cancel(scheduler, &channel->event);
+    return;
+  }
+
+  u64 period_cycles = (u64)channel_period(channel) * PIT_CYCLES_PER_TICK;
+  u64 deadline = channel->start + period_cycles;
+
+  if (channel_is_periodic(channel)) {
+    // Skip the periods that passed while the channel was not scheduled.
+    u64 now = channel->pit->cpu->cycles;
+    if (deadline <= now) {
+      deadline += ((now - deadline) / period_cycles + 1) * period_cycles;
+    }
+  } else if (deadline <= channel->pit->cpu->cycles) {
+    // One shot modes only fire once, at the terminal count.
+    scheduler_cancel(scheduler, &channel->event);
+    return;
+  }
+
+  scheduler_schedule(scheduler, &channel->event, deadline);
+}
+
+static void channel_event(void *context, u64 deadline) {
+  struct pit_channel *channel = context;
+
+  irq_line_raise(&channel->irq);
+
+  if (channel_is_periodic(channel)) {
+    u64 period_cycles = (u64)channel_period(channel) * PIT_CYCLES_PER_TICK;
+    scheduler_schedule(&channel->pit->cpu->scheduler, &channel->event, deadline + period_cycles);
+  }
+}
+
+static void channel_load(struct pit_channel *channel) {
+  channel->start = channel->pit->cpu->cycles;
+  channel->frozen = channel->reload;
+  channel->counting = channel->gate;
+
+  channel_schedule(channel);
+}
+
+word pit_read_counter(struct pit *pit, unsigned channel_index) {
+  assert(channel_index < PIT_CHANNEL_COUNT);
+
+  struct pit_channel *channel = &pit->channels[channel_index];
+  if (!channel->counting) {
+    return channel->frozen;
+  }
+
+  u32 period = channel_period(channel);
+  u64 elapsed = channel_elapsed_ticks(channel);
+
+  switch (channel->mode) {
+    case 2:
+      // Counts from the period down to 1 and reloads.
+      return (word)(period - (elapsed % period));
+
+    case 3:
+      // Counts down by 2, twice per period: once with the output high and once with it low.
+      return (word)(period - ((elapsed * 2) % period)) & 0xfffe;
+
+    default:
+      // One shot modes keep counting down and wrap around after the terminal count.
+      return (word)((u64)period - elapsed);
+  }
+}
+
+bool pit_get_output(struct pit *pit, unsigned channel_index) {
+  assert(channel_index < PIT_CHANNEL_COUNT);
+
+  struct pit_channel *channel = &pit->channels[channel_index];
+  if (!channel->counting) {
+    return channel->mode != 0;
+  }
+
+  u32 period = channel_period(channel);
+  u64 elapsed = channel_elapsed_ticks(channel);
+
+  switch (channel->mode) {
+    case 0:
+    case 1:
+      return elapsed >= period;
+
+    case 2:
+      return (elapsed % period) != period - 1;
+
+    case 3:
+      return (elapsed % period) < (period + 1) / 2;
+
+    default:
+      return elapsed != period;
+  }
+}
+
+void pit_set_gate(struct pit *pit, unsigned channel_index, bool gate) {
+  assert(channel_index < PIT_CHANNEL_COUNT);
+
+  struct pit_channel *channel = &pit->channels[channel_index];
+  if (channel->gate == gate) {
+    return;
+  }
+
+  if (!gate) {
+    if (channel->counting) {
+      channel->frozen = pit_read_counter(pit, channel_index);
+      channel->counting = false;
+      scheduler_cancel(&pit->cpu->scheduler, &channel->event);
+    }
+    channel->gate = false;
+    return;
+  }
+
+  channel->gate = true;
+
+  if (channel->mode == 0 || channel->mode == 4) {
+    // Counting resumes from where it stopped.
+    u32 consumed = (channel_period(channel) - channel->frozen) & 0xffff;
+    channel->start = pit->cpu->cycles - (u64)consumed * PIT_CYCLES_PER_TICK;
+    channel->counting = true;
+    channel_schedule(channel);
+  } else {
+    // A rising gate retriggers the count in all the other modes.
+    channel_load(channel);
+  }
+}
+
+void pit_connect_irq(struct pit *pit, unsigned channel_index, struct irq_line irq) {
+  assert(channel_index < PIT_CHANNEL_COUNT);
+
+  struct pit_channel *channel = &pit->channels[channel_index];
+  channel->irq = irq;
+  channel_schedule(channel);
+}
+
+static void pit_control(struct pit *pit, byte value) {
+  unsigned channel_index = value >> 6;
+
+  if (channel_index == 3) {
+    // 8254 read-back command, only the latch count part is supported.
+    if (!(value & 0x20)) {
+      for (unsigned i = 0; i < PIT_CHANNEL_COUNT; ++i) {
+        struct pit_channel *channel = &pit->channels[i];
+        if ((value & (0x02 << i)) && !channel->latched) {
+          channel->latched = true;
+          channel->latch_value = pit_read_counter(pit, i);
+        }
+      }
+    }
+    return;
+  }
+
+  struct pit_channel *channel = &pit->channels[channel_index];
+  enum pit_access access = (value >> 4) & 0x03;
+
+  if (access == pit_access_latch) {
+    if (!channel->latched) {
+      channel->latched = true;
+      channel->latch_value = pit_read_counter(pit, channel_index);
+    }
+    return;
+  }
+
+  // The channel stops and waits for a new count after being programmed.
+  channel->frozen = pit_read_counter(pit, channel_index);
+  channel->counting = false;
+  scheduler_cancel(&pit->cpu->scheduler, &channel->event);
+
+  // BCD counting (bit 0) is not emulated.
+  channel->access = access;
+  channel->mode = (value >> 1) & 0x07;
+  if (channel->mode > 5) {
+    // Modes 6 and 7 are aliases for 2 and 3.
+    channel->mode -= 4;
+  }
+
+  channel->latched = false;
+  channel->read_high = false;
+  channel->write_high = false;
+}
+
+static void pit_out(void *context, word offset, byte value) {
+  struct pit *pit = context;
+
+  if (offset == 3) {
+    pit_control(pit, value);
+    return;
+  }
+
+  struct pit_channel *channel = &pit->channels[offset];
+
+  switch (channel->access) {
+    case pit_access_low:
+      channel->reload = value;
+      break;
+
+    case pit_access_high:
+      channel->reload = value << 8;
+      break;
+
+    case pit_access_low_high:
+      if (!channel->write_high) {
+        channel->write_low = value;
+        channel->write_high = true;
+        return;
+      }
+      channel->reload = channel->write_low | (value << 8);
+      channel->write_high = false;
+      break;
+
+    default:
+      assert(0);
+      return;
+  }
+
+  channel_load(channel);
+}
+
+static byte pit_in(void *context, word offset) {
+  struct pit *pit = context;
+
+  if (offset == 3) {
+    // The control register is write only.
+    return 0xff;
+  }
+
+  struct pit_channel *channel = &pit->channels[offset];
+  word value = channel->latched ? channel->latch_value : pit_read_counter(pit, offset);
+
+  switch (channel->access) {
+    case pit_access_low:
+      channel->latched = false;
+      return value & 0xff;
+
+    case pit_access_high:
+      channel->latched = false;
+      return value >> 8;
+
+    case pit_access_low_high:
+      if (!channel->read_high) {
+        channel->read_high = true;
+        return value & 0xff;
+      }
+      channel->read_high = false;
+      channel->latched = false;
+      return value >> 8;
+
+    default:
+      assert(0);
+      return 0xff;
+  }
+}
+
+static const struct port_handler pit_port_handler = {
+    .out_func = pit_out,
+    .in_func = pit_in,
+};
+
+void pit_init(struct pit *pit, struct cpu *cpu) {
+  memset(pit, 0, sizeof(*pit));
+
+  pit->cpu = cpu;
+
+  for (unsigned i = 0; i < PIT_CHANNEL_COUNT; ++i) {
+    struct pit_channel *channel = &pit->channels[i];
+    channel->pit = pit;
+    channel->access = pit_access_low_high;
+    channel->gate = true;
+    scheduler_event_init(&channel->event, channel_event, channel);
+  }
+
+  ports_map_address(cpu->ports, PIT_PORT_BASE, PIT_PORT_BASE + 3, &pit_port_handler, pit);
+}
@@ -0,0 +1,140 @@
+#include "devices/ppi.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Port B.
+#define PPI_B_TIMER_2_GATE 0x01
+#define PPI_B_HIGH_SWITCHES 0x08
+#define PPI_B_KEYBOARD_CLOCK 0x40
+#define PPI_B_KEYBOARD_CLEAR 0x80
+
+// Port C.
+#define PPI_C_TIMER_2_OUTPUT 0x20
+
+static bool ppi_keyboard_enabled(const struct ppi *ppi) {
+  return (ppi->port_b & PPI_B_KEYBOARD_CLOCK) && !(ppi->port_b & PPI_B_KEYBOARD_CLEAR);
+}
+
+// Start sending the next scan code, if the interface can take it.
+static void ppi_schedule(struct ppi *ppi) {
+  struct scheduler *scheduler = &ppi->cpu->scheduler;
+
+  if (ppi->full || ppi->queue_head >= ppi->queue_size || !ppi_keyboard_enabled(ppi)) {
+    scheduler_cancel(scheduler, &ppi->event);
+    return;
+  }
+
+  if (!scheduler_event_is_scheduled(&ppi->event)) {
+    scheduler_schedule(scheduler, &ppi->event, ppi->cpu->cycles + PPI_SCAN_CODE_CYCLES);
+  }
+}
+
+static void ppi_event(void *context, u64 deadline) {
+  UNUSED(deadline);
+
+  struct ppi *ppi = context;
+
+  // Going back to a checkpoint can leave the event scheduled with nothing to send.
+  if (ppi->queue_head >= ppi->queue_size) {
+    return;
+  }
+
+  ppi->scan_code = ppi->queue[ppi->queue_head++];
+  ppi->full = true;
+
+  irq_line_raise(&ppi->irq);
+}
+
+void ppi_push_scan_codes(struct ppi *ppi, const u8 *scan_codes, u32 count) {
+  if (ppi->queue_size + count > ppi->queue_capacity) {
+    while (ppi->queue_size + count > ppi->queue_capacity) {
+      ppi->queue_capacity = ppi->queue_capacity ? ppi->queue_capacity * 2 : 64;
+    }
+    ppi->queue = realloc(ppi->queue, ppi->queue_capacity);
+  }
+
+  memcpy(ppi->queue + ppi->queue_size, scan_codes, count);
+  ppi->queue_size += count;
+
+  ppi_schedule(ppi);
+}
+
+static void ppi_write_port_b(struct ppi *ppi, byte value) {
+  byte previous = ppi->port_b;
+  ppi->port_b = value;
+
+  if (ppi->pit) {
+    pit_set_gate(ppi->pit, 2, value & PPI_B_TIMER_2_GATE);
+  }
+
+  if (value & PPI_B_KEYBOARD_CLEAR) {
+    ppi->full = false;
+  }
+
+  // Releasing the clock line after holding it low resets the keyboard, which forgets the keys it
+  // had yet to send and answers with its self test result.
+  if (!(previous & PPI_B_KEYBOARD_CLOCK) && (value & PPI_B_KEYBOARD_CLOCK)) {
+    static const u8 self_test = PPI_KEYBOARD_SELF_TEST_PASSED;
+    ppi->queue_head = ppi->queue_size;
+    ppi_push_scan_codes(ppi, &self_test, 1);
+  }
+
+  ppi_schedule(ppi);
+}
+
+static void ppi_out(void *context, word offset, byte value) {
+  struct ppi *ppi = context;
+
+  if (offset == 1) {
+    ppi_write_port_b(ppi, value);
+  }
+}
+
+static byte ppi_in(void *context, word offset) {
+  struct ppi *ppi = context;
+
+  switch (offset) {
+    case 0:
+      return ppi->scan_code;
+
+    case 1:
+      return ppi->port_b;
+
+    case 2: {
+      byte value = ppi->port_b & PPI_B_HIGH_SWITCHES ? ppi->switches >> 4 : ppi->switches & 0x0f;
+      if (ppi->pit && pit_get_output(ppi->pit, 2)) {
+        value |= PPI_C_TIMER_2_OUTPUT;
+      }
+      return value;
+    }
+
+    default:
+      return 0xff;
+  }
+}
+
+static const struct port_handler ppi_port_handler = {
+    .out_func = ppi_out,
+    .in_func = ppi_in,
+};
+
+void ppi_init(struct ppi *ppi, struct cpu *cpu, struct irq_line irq, struct pit *pit,
+              byte switches) {
+  memset(ppi, 0, sizeof(*ppi));
+
+  ppi->cpu = cpu;
+  ppi->irq = irq;
+  ppi->pit = pit;
+  ppi->switches = switches;
+  ppi->port_b = PPI_B_KEYBOARD_CLOCK;
+
+  scheduler_event_init(&ppi->event, ppi_event, ppi);
+
+  ports_map_address(cpu->ports, PPI_PORT_BASE, PPI_PORT_BASE + 3, &ppi_port_handler, ppi);
+}
+
+void ppi_destroy(struct ppi *ppi) {
+  scheduler_cancel(&ppi->cpu->scheduler, &ppi->event);
+  free(ppi->queue);
+}
@@ -0,0 +1,286 @@
+#include "devices/screen.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Mode control register.
+#define SCREEN_MODE_80_COLUMNS 0x01
+#define SCREEN_MODE_GRAPHICS 0x02
+#define SCREEN_MODE_MONOCHROME 0x04
+#define SCREEN_MODE_BLINK 0x20
+#define SCREEN_MODE_HIGH_RESOLUTION 0x10
+
+// Color select register.
+#define SCREEN_COLOR_INTENSITY 0x10
+#define SCREEN_COLOR_PALETTE 0x20
+
+// Interleaved banks of the graphics modes: even lines first, odd lines 8KiB further.
+#define SCREEN_BANK_SIZE 0x2000
+#define SCREEN_BYTES_PER_LINE 80
+
+// Offset of the 8x8 glyphs in the CGA character ROM.
+#define SCREEN_CGA_ROM_SIZE 0x2000
+#define SCREEN_CGA_ROM_FONT 0x1800
+
+static const u8 cga_palette[16][3] = {
+    {0x00, 0x00, 0x00}, {0x00, 0x00, 0xaa}, {0x00, 0xaa, 0x00}, {0x00, 0xaa, 0xaa},
+    {0xaa, 0x00, 0x00}, {0xaa, 0x00, 0xaa}, {0xaa, 0x55, 0x00}, {0xaa, 0xaa, 0xaa},
+    {0x55, 0x55, 0x55}, {0x55, 0x55, 0xff}, {0x55, 0xff, 0x55}, {0x55, 0xff, 0xff},
+    {0xff, 0x55, 0x55}, {0xff, 0x55, 0xff}, {0xff, 0xff, 0x55}, {0xff, 0xff, 0xff},
+};
+
+// Drawn for characters the font has no glyph for.
+static const u8 missing_glyph[SCREEN_GLYPH_SIZE] = {0x00, 0x7e, 0x42, 0x42, 0x42, 0x42, 0x7e, 0x00};
+
+void screen_snapshot_take(struct screen_snapshot *snapshot, const struct video *video) {
+  snapshot->adapter = video->adapter;
+  snapshot->mode = video->mode;
+  snapshot->color = video->color;
+  snapshot->start_offset = video_start_offset(video);
+  snapshot->memory_size = video->memory_size;
+  memcpy(snapshot->memory, video->cpu->bus->memory + video->memory_base, video->memory_size);
+}
+
+void screen_renderer_init(struct screen_renderer *renderer) {
+  memset(renderer, 0, sizeof(*renderer));
+}
+
+bool screen_renderer_set_font(struct screen_renderer *renderer, const u8 *data, u32 size) {
+  if (size == SCREEN_CGA_ROM_SIZE) {
+    data += SCREEN_CGA_ROM_FONT;
+    size = 0x100 * SCREEN_GLYPH_SIZE;
+  }
+
+  if (size != 0x80 * SCREEN_GLYPH_SIZE && size != 0x100 * SCREEN_GLYPH_SIZE) {
+    return false;
+  }
+
+  memcpy(renderer->font, data, size);
+  renderer->glyph_count = size / SCREEN_GLYPH_SIZE;
+
+  // Cached glyphs were drawn with the old font.
+  for (unsigned i = 0; i < SCREEN_GLYPH_CACHE_SIZE; ++i) {
+    renderer->glyphs[i].key = 0;
+  }
+
+  return true;
+}
+
+static const u8 *screen_glyph_rows(const struct screen_renderer *renderer, u8 c) {
+  if (c < renderer->glyph_count) {
+    return renderer->font + c * SCREEN_GLYPH_SIZE;
+  }
+
+  static const u8 blank[SCREEN_GLYPH_SIZE];
+  return c == 0x00 || c == 0x20 || c == 0xff ? blank : missing_glyph;
+}
+
+// Return the pixels of character `c` in the given colors, drawing them if they are not cached.
+static const u8 *screen_glyph(struct screen_renderer *renderer, u8 c, u8 foreground, u8 background,
+                              bool underline) {
+  u32 key = (c | (foreground << 8) | (background << 12) | (underline << 16)) + 1;
+  struct screen_glyph *glyph = &renderer->glyphs[(key * 2654435761u) >> 22];
+  if (glyph->key == key) {
+    return glyph->pixels;
+  }
+
+  const u8 *rows = screen_glyph_rows(renderer, c);
+  u8 *pixel = glyph->pixels;
+  for (unsigned y = 0; y < SCREEN_GLYPH_SIZE; ++y) {
+    u8 row = underline && y == SCREEN_GLYPH_SIZE - 1 ? 0xff : rows[y];
+    for (unsigned x = 0; x < SCREEN_GLYPH_SIZE; ++x, pixel += 3) {
+      memcpy(pixel, cga_palette[row & (0x80 >> x) ? foreground : background], 3);
+    }
+  }
+
+  glyph->key = key;
+  return glyph->pixels;
+}
+
+static void screen_render_text(struct screen_renderer *renderer,
+                               const struct screen_snapshot *snapshot, struct screen_image *image) {
+  bool mda = snapshot->adapter == va_mda;
+  unsigned columns =
+      mda || (snapshot->mode & SCREEN_MODE_80_COLUMNS) ? VIDEO_MAX_COLUMNS : VIDEO_MAX_COLUMNS / 2;
+
+  image->width = columns * SCREEN_GLYPH_SIZE;
+  image->height = SCREEN_HEIGHT;
+
+  for (unsigned cell = 0; cell < columns * VIDEO_ROWS; ++cell) {
+    u32 offset = (snapshot->start_offset + cell * 2) & (snapshot->memory_size - 1);
+    u8 c = snapshot->memory[offset];
+    u8 attribute = snapshot->memory[offset + 1];
+
+    u8 foreground;
+    u8 background;
+    bool underline = false;
+
+    if (mda) {
+      // The monochrome attributes in shades of gray.
+      if (!(attribute & 0x77)) {
+        foreground = background = 0;
+      } else if ((attribute & 0x77) == 0x70) {
+        foreground = 0;
+        background = 7;
+      } else {
+        foreground = attribute & 0x08 ? 15 : 7;
+        background = 0;
+        underline = (attribute & 0x07) == 0x01;
+      }
+    } else {
+      foreground = attribute & 0x0f;
+      background = attribute >> 4;
+      if (snapshot->mode & SCREEN_MODE_BLINK) {
+        background &= 0x07;
+      }
+    }
+
+    const u8 *pixels = screen_glyph(renderer, c, foreground, background, underline);
+
+    unsigned x = (cell % columns) * SCREEN_GLYPH_SIZE;
+    unsigned y = (cell / columns) * SCREEN_GLYPH_SIZE;
+    for (unsigned row = 0; row < SCREEN_GLYPH_SIZE; ++row) {
+      memcpy(image->pixels + ((y + row) * image->width + x) * 3,
+             pixels + row * SCREEN_GLYPH_SIZE * 3, SCREEN_GLYPH_SIZE * 3);
+    }
+  }
+}
+
+static void screen_render_graphics(const struct screen_snapshot *snapshot,
+                                   struct screen_image *image) {
+  bool high_resolution = snapshot->mode & SCREEN_MODE_HIGH_RESOLUTION;
+  unsigned bits = high_resolution ? 1 : 2;
+
+  u8 colors[4];
+  if (high_resolution) {
+    colors[0] = 0;
+    colors[1] = snapshot->color & 0x0f;
+  } else {
+    u8 intensity = snapshot->color & SCREEN_COLOR_INTENSITY ? 8 : 0;
+    colors[0] = snapshot->color & 0x0f;
+    if (snapshot->mode & SCREEN_MODE_MONOCHROME) {
+      // Cyan, red and white.
+      colors[1] = 3 | intensity;
+      colors[2] = 4 | intensity;
+      colors[3] = 7 | intensity;
+    } else {
+      bool cyan = snapshot->color & SCREEN_COLOR_PALETTE;
+      colors[1] = (cyan ? 3 : 2) | intensity;
+      colors[2] = (cyan ? 5 : 4) | intensity;
+      colors[3] = (cyan ? 7 : 6) | intensity;
+    }
+  }
+
+  image->width = SCREEN_BYTES_PER_LINE * 8 / bits;
+  image->height = SCREEN_HEIGHT;
+
+  u8 *pixel = image->pixels;
+  for (unsigned y = 0; y < SCREEN_HEIGHT; ++y) {
+    const u8 *line = snapshot->memory + (y & 1) * SCREEN_BANK_SIZE + (y >> 1) * SCREEN_BYTES_PER_LINE;
+    for (unsigned x = 0; x < image->width; ++x, pixel += 3) {
+      unsigned bit = x * bits;
+      u8 value = (line[bit / 8] >> (8 - bits - bit % 8)) & ((1 << bits) - 1);
+      memcpy(pixel, cga_palette[colors[value]], 3);
+    }
+  }
+}
+
+void screen_render(struct screen_renderer *renderer, const struct screen_snapshot *snapshot,
+                   struct screen_image *image) {
+  if (snapshot->adapter == va_mda || !(snapshot->mode & SCREEN_MODE_GRAPHICS)) {
+    screen_render_text(renderer, snapshot, image);
+  } else {
+    screen_render_graphics(snapshot, image);
+  }
+}
+
+bool screen_write_ppm(const struct screen_image *image, FILE *out) {
+  size_t size = (size_t)image->width * image->height * 3;
+
+  return fprintf(out, "P6\n%u %u\n255\n", image->width, image->height) > 0 &&
+         fwrite(image->pixels, 1, size, out) == size;
+}
+
+static u32 crc32_update(u32 crc, const u8 *data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (unsigned bit = 0; bit < 8; ++bit) {
+      crc = crc & 1 ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+  }
+  return crc;
+}
+
+static void write_u32_big_endian(u8 *data, u32 value) {
+  data[0] = value >> 24;
+  data[1] = (value >> 16) & 0xff;
+  data[2] = (value >> 8) & 0xff;
+  data[3] = value & 0xff;
+}
+
+static bool png_write_chunk(FILE *out, const char *type, const u8 *data, u32 size) {
+  u8 header[8];
+  write_u32_big_endian(header, size);
+  memcpy(header + 4, type, 4);
+
+  u8 crc[4];
+  write_u32_big_endian(crc, ~crc32_update(crc32_update(~0u, header + 4, 4), data, size));
+
+  return fwrite(header, 1, sizeof(header), out) == sizeof(header) &&
+         fwrite(data, 1, size, out) == size && fwrite(crc, 1, sizeof(crc), out) == sizeof(crc);
+}
+
+bool screen_write_png(const struct screen_image *image, FILE *out) {
+  static const u8 signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+  // Width, height, 8 bits per channel, RGB, no interlacing.
+  u8 header[13] = {0};
+  write_u32_big_endian(header, image->width);
+  write_u32_big_endian(header + 4, image->height);
+  header[8] = 8;
+  header[9] = 2;
+
+  // Every line starts with filter type 0.
+  u32 line_size = image->width * 3 + 1;
+  u32 raw_size = line_size * image->height;
+
+  // A zlib stream of stored deflate blocks of at most 64KiB.
+  u32 block_count = (raw_size + 0xffff - 1) / 0xffff;
+  u32 data_size = 2 + block_count * 5 + raw_size + 4;
+  u8 *data = malloc(data_size);
+  u8 *position = data;
+
+  *position++ = 0x78;
+  *position++ = 0x01;
+
+  u32 adler_a = 1;
+  u32 adler_b = 0;
+  u32 raw_offset = 0;
+  for (u32 block = 0; block < block_count; ++block) {
+    u32 size = raw_size - raw_offset < 0xffff ? raw_size - raw_offset : 0xffff;
+    position[0] = block == block_count - 1;
+    position[1] = size & 0xff;
+    position[2] = size >> 8;
+    position[3] = ~size & 0xff;
+    position[4] = (~size >> 8) & 0xff;
+    position += 5;
+
+    for (u32 i = 0; i < size; ++i, ++raw_offset) {
+      u32 x = raw_offset % line_size;
+      u8 value = x ? image->pixels[(raw_offset / line_size) * (line_size - 1) + x - 1] : 0;
+      *position++ = value;
+
+      adler_a = (adler_a + value) % 65521;
+      adler_b = (adler_b + adler_a) % 65521;
+    }
+  }
+
+  write_u32_big_endian(position, (adler_b << 16) | adler_a);
+
+  bool written = fwrite(signature, 1, sizeof(signature), out) == sizeof(signature) &&
+                 png_write_chunk(out, "IHDR", header, sizeof(header)) &&
+                 png_write_chunk(out, "IDAT", data, data_size) && png_write_chunk(out, "IEND", 0, 0);
+
+  free(data);
+  return written;
+}
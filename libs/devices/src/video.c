@@ -0,0 +1,438 @@
+#include "devices/video.h"
+
+#include <assert.h>
+#include <cpu/checkpoint.h>
+#include <string.h>
+
+// 6845 registers.
+#define VIDEO_CRTC_CURSOR_START 0x0a
+#define VIDEO_CRTC_START_HIGH 0x0c
+#define VIDEO_CRTC_START_LOW 0x0d
+#define VIDEO_CRTC_CURSOR_HIGH 0x0e
+#define VIDEO_CRTC_CURSOR_LOW 0x0f
+
+// Mode control register.
+#define VIDEO_MODE_80_COLUMNS 0x01
+#define VIDEO_MODE_GRAPHICS 0x02
+#define VIDEO_MODE_BLINK 0x20
+
+// Status register.
+#define VIDEO_STATUS_RETRACE 0x01
+#define VIDEO_STATUS_VERTICAL_RETRACE 0x08
+
+// Timing of the status register at 60 frames a second of 262 lines, close enough for guests that
+// wait for the retrace before touching video memory.
+#define VIDEO_CYCLES_PER_FRAME 79545
+#define VIDEO_CYCLES_PER_LINE (VIDEO_CYCLES_PER_FRAME / 262)
+#define VIDEO_VISIBLE_CYCLES (200 * VIDEO_CYCLES_PER_LINE)
+#define VIDEO_VISIBLE_LINE_CYCLES (VIDEO_CYCLES_PER_LINE * 4 / 5)
+
+#define VIDEO_NO_CELL 0xffff
+
+// Code page 437 in UTF-8, with the glyphs of the control characters.
+static const char *const cp437[0x100] = {
+    " ", "\u263a", "\u263b", "\u2665", "\u2666", "\u2663", "\u2660", "\u2022",
+    "\u25d8", "\u25cb", "\u25d9", "\u2642", "\u2640", "\u266a", "\u266b", "\u263c",
+    "\u25ba", "\u25c4", "\u2195", "\u203c", "\u00b6", "\u00a7", "\u25ac", "\u21a8",
+    "\u2191", "\u2193", "\u2192", "\u2190", "\u221f", "\u2194", "\u25b2", "\u25bc",
+    " ", "!", "\"", "#", "$", "%", "&", "'",
+    "(", ")", "*", "+", ",", "-", ".", "/",
+    "0", "1", "2", "3", "4", "5", "6", "7",
+    "8", "9", ":", ";", "<", "=", ">", "?",
+    "@", "A", "B", "C", "D", "E", "F", "G",
+    "H", "I", "J", "K", "L", "M", "N", "O",
+    "P", "Q", "R", "S", "T", "U", "V", "W",
+    "X", "Y", "Z", "[", "\\", "]", "^", "_",
+    "`", "a", "b", "c", "d", "e", "f", "g",
+    "h", "i", "j", "k", "l", "m", "n", "o",
+    "p", "q", "r", "s", "t", "u", "v", "w",
+    "x", "y", "z", "{", "|", "}", "~", "\u2302",
+    "\u00c7", "\u00fc", "\u00e9", "\u00e2", "\u00e4", "\u00e0", "\u00e5", "\u00e7",
+    "\u00ea", "\u00eb", "\u00e8", "\u00ef", "\u00ee", "\u00ec", "\u00c4", "\u00c5",
+    "\u00c9", "\u00e6", "\u00c6", "\u00f4", "\u00f6", "\u00f2", "\u00fb", "\u00f9",
+    "\u00ff", "\u00d6", "\u00dc", "\u00a2", "\u00a3", "\u00a5", "\u20a7", "\u0192",
+    "\u00e1", "\u00ed", "\u00f3", "\u00fa", "\u00f1", "\u00d1", "\u00aa", "\u00ba",
+    "\u00bf", "\u2310", "\u00ac", "\u00bd", "\u00bc", "\u00a1", "\u00ab", "\u00bb",
+    "\u2591", "\u2592", "\u2593", "\u2502", "\u2524", "\u2561", "\u2562", "\u2556",
+    "\u2555", "\u2563", "\u2551", "\u2557", "\u255d", "\u255c", "\u255b", "\u2510",
+    "\u2514", "\u2534", "\u252c", "\u251c", "\u2500", "\u253c", "\u255e", "\u255f",
+    "\u255a", "\u2554", "\u2569", "\u2566", "\u2560", "\u2550", "\u256c", "\u2567",
+    "\u2568", "\u2564", "\u2565", "\u2559", "\u2558", "\u2552", "\u2553", "\u256b",
+    "\u256a", "\u2518", "\u250c", "\u2588", "\u2584", "\u258c", "\u2590", "\u2580",
+    "\u03b1", "\u00df", "\u0393", "\u03c0", "\u03a3", "\u03c3", "\u00b5", "\u03c4",
+    "\u03a6", "\u0398", "\u03a9", "\u03b4", "\u221e", "\u03c6", "\u03b5", "\u2229",
+    "\u2261", "\u00b1", "\u2265", "\u2264", "\u2320", "\u2321", "\u00f7", "\u2248",
+    "\u00b0", "\u2219", "\u00b7", "\u221a", "\u207f", "\u00b2", "\u25a0", " ",
+};
+
+// CGA colors in the order of the ANSI ones.
+static const u8 ansi_colors[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+unsigned video_columns(const struct video *video) {
+  if (video->adapter == va_mda || (video->mode & VIDEO_MODE_80_COLUMNS)) {
+    return VIDEO_MAX_COLUMNS;
+  }
+  return VIDEO_MAX_COLUMNS / 2;
+}
+
+bool video_text_mode(const struct video *video) {
+  return video->adapter == va_mda || !(video->mode & VIDEO_MODE_GRAPHICS);
+}
+
+u32 video_start_offset(const struct video *video) {
+  u32 start = (video->crtc[VIDEO_CRTC_START_HIGH] << 8) | video->crtc[VIDEO_CRTC_START_LOW];
+  return (start * 2) & (video->memory_size - 1);
+}
+
+static u16 video_cursor_cell(const struct video *video) {
+  u32 start = (video->crtc[VIDEO_CRTC_START_HIGH] << 8) | video->crtc[VIDEO_CRTC_START_LOW];
+  u32 cursor = (video->crtc[VIDEO_CRTC_CURSOR_HIGH] << 8) | video->crtc[VIDEO_CRTC_CURSOR_LOW];
+  u32 cell = (cursor - start) & ((video->memory_size / 2) - 1);
+
+  return cell < video_columns(video) * VIDEO_ROWS ? cell : VIDEO_NO_CELL;
+}
+
+static void video_mark_all_dirty(struct video *video) {
+  memset(video->dirty, 0xff, sizeof(video->dirty));
+  video->cursor_dirty = true;
+}
+
+static void video_store(u32 addr, u8 value, void *context) {
+  struct video *video = context;
+  struct bus *bus = video->cpu->bus;
+
+  u32 end = video->memory_base + VIDEO_DECODED_SIZE;
+  for (u32 copy = video->memory_base + ((addr - video->memory_base) & (video->memory_size - 1));
+       copy < end; copy += video->memory_size) {
+    if (copy != addr) {
+      bus->memory[copy] = value;
+      bus_mark_dirty(bus, copy, 1);
+    }
+  }
+
+  u32 offset = (addr - video->memory_base - video_start_offset(video)) & (video->memory_size - 1);
+  u32 cell = offset / 2;
+
+  if (cell < video_columns(video) * VIDEO_ROWS) {
+    video->dirty[cell / 64] |= (u64)1 << (cell % 64);
+  }
+}
+
+// Character and attribute of `cell` of the displayed page.
+static const byte *video_cell(const struct video *video, u32 cell) {
+  u32 offset = (video_start_offset(video) + cell * 2) & (video->memory_size - 1);
+  return video->cpu->bus->memory + video->memory_base + offset;
+}
+
+static void video_print_attribute(struct video *video, byte attribute) {
+  if (video->adapter == va_mda) {
+    fputs("\x1b[0", video->out);
+    if (!(attribute & 0x77)) {
+      fputs(";8", video->out);
+    } else if ((attribute & 0x77) == 0x70) {
+      fputs(";7", video->out);
+    } else if ((attribute & 0x07) == 0x01) {
+      fputs(";4", video->out);
+    }
+    if (attribute & 0x08) {
+      fputs(";1", video->out);
+    }
+    fputs(attribute & 0x80 ? ";5m" : "m", video->out);
+    return;
+  }
+
+  unsigned foreground = attribute & 0x0f;
+  unsigned background = attribute >> 4;
+  bool blink = false;
+  if (video->mode & VIDEO_MODE_BLINK) {
+    // The top bit blinks instead of selecting a bright background.
+    blink = background & 0x08;
+    background &= 0x07;
+  }
+
+  fprintf(video->out, "\x1b[0;%u;%u%sm",
+          (foreground & 0x08 ? 90 : 30) + ansi_colors[foreground & 0x07],
+          (background & 0x08 ? 100 : 40) + ansi_colors[background & 0x07], blink ? ";5" : "");
+}
+
+static void video_render_ansi(struct video *video) {
+  unsigned columns = video_columns(video);
+  unsigned cell_count = columns * VIDEO_ROWS;
+
+  for (unsigned i = 0; i < ARRAY_SIZE(video->dirty); ++i) {
+    u64 dirty = video->dirty[i];
+    video->dirty[i] = 0;
+
+    while (dirty) {
+      unsigned cell = i * 64 + __builtin_ctzll(dirty);
+      dirty &= dirty - 1;
+      if (cell >= cell_count) {
+        break;
+      }
+
+      if (cell != video->out_cell) {
+        fprintf(video->out, "\x1b[%u;%uH", cell / columns + 1, cell % columns + 1);
+      }
+
+      const byte *data = video_cell(video, cell);
+      if (data[1] != video->out_attribute) {
+        video_print_attribute(video, data[1]);
+        video->out_attribute = data[1];
+      }
+      fputs(cp437[data[0]], video->out);
+
+      // The terminal's cursor stays on the last column, it does not move to the next line.
+      video->out_cell = (cell + 1) % columns ? cell + 1 : VIDEO_NO_CELL;
+      video->cursor_dirty = true;
+    }
+  }
+
+  if (video->cursor_dirty) {
+    u16 cursor = video_cursor_cell(video);
+    bool hidden = (video->crtc[VIDEO_CRTC_CURSOR_START] & 0x60) == 0x20 || cursor == VIDEO_NO_CELL;
+
+    if (hidden) {
+      fputs("\x1b[?25l", video->out);
+    } else {
+      fprintf(video->out, "\x1b[%u;%uH\x1b[?25h", cursor / columns + 1, cursor % columns + 1);
+      video->out_cell = cursor;
+    }
+    video->cursor_dirty = false;
+  }
+}
+
+static void video_render_text(struct video *video) {
+  bool dirty = false;
+  for (unsigned i = 0; i < ARRAY_SIZE(video->dirty); ++i) {
+    dirty |= video->dirty[i] != 0;
+    video->dirty[i] = 0;
+  }
+  video->cursor_dirty = false;
+
+  if (!dirty) {
+    return;
+  }
+
+  // The position only tells whether a screen was written before.
+  if (video->out_cell != VIDEO_NO_CELL) {
+    fputs("\f\n", video->out);
+  }
+  video->out_cell = 0;
+
+  unsigned columns = video_columns(video);
+  for (unsigned row = 0; row < VIDEO_ROWS; ++row) {
+    // Trailing blanks are left out.
+    unsigned length = columns;
+    while (length && cp437[video_cell(video, row * columns + length - 1)[0]][0] == ' ') {
+      --length;
+    }
+
+    for (unsigned column = 0; column < length; ++column) {
+      fputs(cp437[video_cell(video, row * columns + column)[0]], video->out);
+    }
+    fputc('\n', video->out);
+  }
+}
+
+void video_invalidate(struct video *video) {
+  video_mark_all_dirty(video);
+}
+
+void video_render(struct video *video) {
+  if (!video->out || !video_text_mode(video)) {
+    return;
+  }
+
+  const struct checkpoints *checkpoints = video->checkpoints;
+  if (checkpoints) {
+    if (checkpoints->travelling) {
+      return;
+    }
+    if (video->restores_seen != checkpoints->restore_count) {
+      // The adapter may have been restored with them, but the terminal is where it was left.
+      video->restores_seen = checkpoints->restore_count;
+      video->out_attribute = -1;
+      if (video->format == vf_ansi) {
+        video->out_cell = VIDEO_NO_CELL;
+      }
+      video_mark_all_dirty(video);
+    }
+  }
+
+  switch (video->format) {
+    case vf_ansi:
+      video_render_ansi(video);
+      break;
+
+    case vf_text:
+      video_render_text(video);
+      break;
+
+    default:
+      assert(0);
+      break;
+  }
+
+  fflush(video->out);
+}
+
+void video_follow_checkpoints(struct video *video, const struct checkpoints *checkpoints) {
+  video->checkpoints = checkpoints;
+  video->restores_seen = checkpoints ? checkpoints->restore_count : 0;
+}
+
+static void video_event(void *context, u64 deadline) {
+  struct video *video = context;
+
+  video_render(video);
+  scheduler_schedule(&video->cpu->scheduler, &video->event, deadline + video->interval);
+}
+
+void video_set_output(struct video *video, FILE *out, enum video_format format, u64 interval) {
+  scheduler_cancel(&video->cpu->scheduler, &video->event);
+
+  video->out = out;
+  video->format = format;
+  video->interval = interval;
+  video->out_cell = VIDEO_NO_CELL;
+  video->out_attribute = -1;
+  video_mark_all_dirty(video);
+
+  if (out && format == vf_ansi) {
+    fputs("\x1b[2J", out);
+  }
+
+  if (out && interval) {
+    scheduler_schedule(&video->cpu->scheduler, &video->event, video->cpu->cycles + interval);
+  }
+}
+
+static byte video_status(struct video *video) {
+  u64 position = video->cpu->cycles % VIDEO_CYCLES_PER_FRAME;
+  if (position >= VIDEO_VISIBLE_CYCLES) {
+    return VIDEO_STATUS_RETRACE | VIDEO_STATUS_VERTICAL_RETRACE;
+  }
+
+  return position % VIDEO_CYCLES_PER_LINE >= VIDEO_VISIBLE_LINE_CYCLES ? VIDEO_STATUS_RETRACE : 0;
+}
+
+static void video_write_crtc(struct video *video, byte value) {
+  if (video->crtc_index >= ARRAY_SIZE(video->crtc)) {
+    return;
+  }
+
+  video->crtc[video->crtc_index] = value;
+
+  switch (video->crtc_index) {
+    case VIDEO_CRTC_START_HIGH:
+    case VIDEO_CRTC_START_LOW:
+      // Another page is displayed.
+      video_mark_all_dirty(video);
+      break;
+
+    case VIDEO_CRTC_CURSOR_START:
+    case VIDEO_CRTC_CURSOR_HIGH:
+    case VIDEO_CRTC_CURSOR_LOW:
+      video->cursor_dirty = true;
+      break;
+
+    default:
+      break;
+  }
+}
+
+static void video_out(void *context, word offset, byte value) {
+  struct video *video = context;
+
+  switch (offset) {
+    case 0x0:
+    case 0x2:
+    case 0x4:
+    case 0x6:
+      video->crtc_index = value;
+      break;
+
+    case 0x1:
+    case 0x3:
+    case 0x5:
+    case 0x7:
+      video_write_crtc(video, value);
+      break;
+
+    case 0x8:
+      if (video->mode != value) {
+        video->mode = value;
+        video_mark_all_dirty(video);
+      }
+      break;
+
+    case 0x9:
+      video->color = value;
+      break;
+
+    default:
+      break;
+  }
+}
+
+static byte video_in(void *context, word offset) {
+  struct video *video = context;
+
+  switch (offset) {
+    case 0x1:
+    case 0x3:
+    case 0x5:
+    case 0x7:
+      // Only the start address and cursor registers can be read back.
+      if (video->crtc_index < VIDEO_CRTC_START_HIGH ||
+          video->crtc_index >= ARRAY_SIZE(video->crtc)) {
+        return 0x00;
+      }
+      return video->crtc[video->crtc_index];
+
+    case 0xa:
+      return video_status(video);
+
+    default:
+      return 0xff;
+  }
+}
+
+static const struct port_handler video_port_handler = {
+    .out_func = video_out,
+    .in_func = video_in,
+};
+
+bool video_init(struct video *video, struct cpu *cpu, enum video_adapter adapter) {
+  memset(video, 0, sizeof(*video));
+
+  video->cpu = cpu;
+  video->adapter = adapter;
+  video->out_cell = VIDEO_NO_CELL;
+  video->out_attribute = -1;
+
+  word port_base;
+  if (adapter == va_cga) {
+    video->memory_base = VIDEO_CGA_MEMORY;
+    video->memory_size = VIDEO_CGA_MEMORY_SIZE;
+    port_base = VIDEO_CGA_PORT_BASE;
+    // 80x25 text with blinking, as left by the BIOS.
+    video->mode = 0x29;
+  } else {
+    video->memory_base = VIDEO_MDA_MEMORY;
+    video->memory_size = VIDEO_MDA_MEMORY_SIZE;
+    port_base = VIDEO_MDA_PORT_BASE;
+  }
+
+  scheduler_event_init(&video->event, video_event, video);
+
+  struct bus *bus = cpu->bus;
+  if (bus->memory_size < video->memory_base + VIDEO_DECODED_SIZE ||
+      !bus_add_store_observer(bus, video->memory_base, video->memory_base + VIDEO_DECODED_SIZE,
+                              video, video_store)) {
+    return false;
+  }
+
+  ports_map_address(cpu->ports, port_base, port_base + 0x0f, &video_port_handler, video);
+  return true;
+}
@@ -0,0 +1,93 @@
+#include <assert.h>
+#include <devices/capture.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MEMORY_SIZE 0x100000
+
+// Return whether the capture `sequence` in `directory` is a PPM image of the given size, and remove
+// it.
+static bool has_capture(const char *directory, unsigned sequence, unsigned width) {
+  char name[64];
+  snprintf(name, sizeof(name), "%s/screen%04u.ppm", directory, sequence);
+
+  FILE *file = fopen(name, "rb");
+  if (!file) {
+    return false;
+  }
+
+  unsigned file_width;
+  unsigned file_height;
+  bool matches = fscanf(file, "P6 %u %u", &file_width, &file_height) == 2 &&
+                 file_width == width && file_height == 200;
+  fclose(file);
+  unlink(name);
+
+  return matches;
+}
+
+void test_capture_triggers(void) {
+  byte *memory = calloc(MEMORY_SIZE, 1);
+  struct bus bus;
+  bus_init(&bus, memory, MEMORY_SIZE);
+
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, &bus, segment_offset(0, 0));
+
+  struct video video;
+  bool attached = video_init(&video, &cpu, va_cga);
+  assert(attached);
+
+  char directory[] = "/tmp/capture_tests_XXXXXX";
+  char *created = mkdtemp(directory);
+  assert(created);
+  char prefix[64];
+  snprintf(prefix, sizeof(prefix), "%s/screen", directory);
+
+  struct capture capture;
+  bool started = capture_init(&capture, &video, prefix, cf_ppm);
+  assert(started);
+
+  // The mode register still reaches the adapter.
+  bool watched = capture_watch_port(&capture, ports, 0x3d8);
+  assert(watched);
+  watched = capture_watch_port(&capture, ports, 0xe9);
+  assert(!watched);
+  ports_out(ports, 0x3d8, 0x28);
+  assert(video.mode == 0x28);
+  capture_flush(&capture);
+  bool captured = has_capture(directory, 0, 320);
+  assert(captured);
+
+  capture_at(&capture, 1000, 500);
+  cpu.cycles = 1600;
+  scheduler_run_due(&cpu.scheduler, cpu.cycles);
+  capture_flush(&capture);
+  captured = has_capture(directory, 1, 320);
+  assert(captured);
+  captured = has_capture(directory, 2, 320);
+  assert(captured);
+  captured = has_capture(directory, 3, 320);
+  assert(!captured);
+
+  capture_destroy(&capture);
+  assert(!capture.failed && !capture.dropped);
+
+  // The port is handed back.
+  ports_out(ports, 0x3d8, 0x29);
+  assert(video.mode == 0x29);
+  captured = has_capture(directory, 3, 640);
+  assert(!captured);
+
+  rmdir(directory);
+  free(ports);
+  free(memory);
+}
+
+void capture_tests(void) {
+  test_capture_triggers();
+}
@@ -0,0 +1,24 @@
+void capture_tests(void);
+void disk_image_tests(void);
+void dma_tests(void);
+void fdc_tests(void);
+void input_script_tests(void);
+void pic_tests(void);
+void pit_tests(void);
+void ppi_tests(void);
+void screen_tests(void);
+void video_tests(void);
+
+int main(int argc, char **argv) {
+  capture_tests();
+  disk_image_tests();
+  dma_tests();
+  fdc_tests();
+  input_script_tests();
+  pic_tests();
+  pit_tests();
+  ppi_tests();
+  screen_tests();
+  video_tests();
+  return 0;
+}
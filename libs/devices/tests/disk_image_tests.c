@@ -0,0 +1,292 @@
+#include <assert.h>
+#include <devices/disk_image.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Create an image of `sector_count` sectors, each filled with its number, and return its path.
+static void create_image(char *path, u32 sector_count) {
+  strcpy(path, "/tmp/disk_image_tests_XXXXXX");
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+
+  for (u32 lba = 0; lba < sector_count; ++lba) {
+    u8 sector[DISK_SECTOR_SIZE];
+    memset(sector, lba & 0xff, sizeof(sector));
+    ssize_t written = write(fd, sector, sizeof(sector));
+    assert(written == sizeof(sector));
+  }
+
+  close(fd);
+}
+
+void test_disk_image_is_shared(void) {
+  char path[32];
+  create_image(path, 20);
+
+  struct disk_image *image = disk_image_open(path);
+  assert(image);
+  assert(image->sector_count == 20);
+  assert(image->writable);
+
+  struct disk_image *other = disk_image_open(path);
+  assert(other == image);
+  assert(image->references == 2);
+
+  disk_image_close(other);
+  disk_image_close(image);
+  unlink(path);
+}
+
+void test_disk_image_read_and_write(void) {
+  char path[32];
+  create_image(path, 20);
+  struct disk_image *image = disk_image_open(path);
+
+  u8 buffer[2 * DISK_SECTOR_SIZE];
+  struct disk_request request = {
+      .type = drt_read,
+      .lba = 7,
+      .count = 2,
+      .buffer = buffer,
+  };
+
+  disk_image_submit(image, &request);
+  disk_image_wait(image, &request);
+  assert(!request.failed);
+  assert(buffer[0] == 7 && buffer[DISK_SECTOR_SIZE] == 8);
+
+  // The pages are cached now.
+  memset(buffer, 0, sizeof(buffer));
+  disk_image_submit(image, &request);
+  assert(disk_request_done(image, &request));
+  assert(buffer[0] == 7 && buffer[DISK_SECTOR_SIZE] == 8);
+
+  memset(buffer, 0xaa, DISK_SECTOR_SIZE);
+  struct disk_request write_request = {
+      .type = drt_write,
+      .lba = 8,
+      .count = 1,
+      .buffer = buffer,
+  };
+  disk_image_submit(image, &write_request);
+
+  // Queued behind the write, so it sees the new data.
+  u8 read_back[DISK_SECTOR_SIZE];
+  struct disk_request read_request = {
+      .type = drt_read,
+      .lba = 8,
+      .count = 1,
+      .buffer = read_back,
+  };
+  disk_image_submit(image, &read_request);
+  disk_image_wait(image, &read_request);
+  assert(disk_request_done(image, &write_request));
+  assert(!write_request.failed);
+  assert(read_back[0] == 0xaa);
+
+  int fd = open(path, O_RDONLY);
+  u8 on_disk;
+  ssize_t size = pread(fd, &on_disk, 1, 8 * DISK_SECTOR_SIZE);
+  assert(size == 1);
+  assert(on_disk == 0xaa);
+  close(fd);
+
+  // Past the end of the image.
+  request.lba = 19;
+  disk_image_submit(image, &request);
+  disk_image_wait(image, &request);
+  assert(request.failed);
+
+  disk_image_close(image);
+  unlink(path);
+}
+
+static void create_overlay_path(char *path) {
+  strcpy(path, "/tmp/disk_image_tests_XXXXXX");
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+}
+
+static void read_sector(struct disk_image *image, u32 lba, u8 *buffer) {
+  struct disk_request request = {
+      .type = drt_read,
+      .lba = lba,
+      .count = 1,
+      .buffer = buffer,
+  };
+  disk_image_submit(image, &request);
+  disk_image_wait(image, &request);
+  assert(!request.failed);
+}
+
+static void write_sector(struct disk_image *image, u32 lba, u8 value) {
+  u8 buffer[DISK_SECTOR_SIZE];
+  memset(buffer, value, sizeof(buffer));
+
+  struct disk_request request = {
+      .type = drt_write,
+      .lba = lba,
+      .count = 1,
+      .buffer = buffer,
+  };
+  disk_image_submit(image, &request);
+  disk_image_wait(image, &request);
+  assert(!request.failed);
+}
+
+void test_disk_image_cache_is_bounded(void) {
+  char path[32];
+  u32 page_count = DISK_CACHE_PAGES + 2;
+  create_image(path, page_count * DISK_SECTORS_PER_PAGE);
+  struct disk_image *image = disk_image_open(path);
+
+  u8 buffer[DISK_SECTOR_SIZE];
+  for (u32 page = 0; page < page_count; ++page) {
+    read_sector(image, page * DISK_SECTORS_PER_PAGE, buffer);
+  }
+
+  // The two pages loaded first made room for the last two.
+  assert(image->cached_count == DISK_CACHE_PAGES);
+  assert(!image->pages[0] && !image->pages[1]);
+  assert(image->pages[2] && image->pages[page_count - 1]);
+
+  // Writes go to the file, so a dropped page reads back what was written to it.
+  write_sector(image, 1, 0x55);
+  read_sector(image, DISK_SECTORS_PER_PAGE, buffer);
+  read_sector(image, 1, buffer);
+  assert(buffer[0] == 0x55);
+  read_sector(image, 0, buffer);
+  assert(buffer[0] == 0);
+
+  disk_image_close(image);
+  unlink(path);
+}
+
+static u8 file_byte(const char *path, off_t offset) {
+  int fd = open(path, O_RDONLY);
+  u8 value;
+  ssize_t size = pread(fd, &value, 1, offset);
+  assert(size == 1);
+  close(fd);
+  return value;
+}
+
+void test_disk_image_overlays_share_base(void) {
+  char base_path[32];
+  char first_path[32];
+  char second_path[32];
+  create_image(base_path, 20);
+  create_overlay_path(first_path);
+  create_overlay_path(second_path);
+
+  struct disk_image *first = disk_image_open_overlay(base_path, first_path, false);
+  struct disk_image *second = disk_image_open_overlay(base_path, second_path, false);
+  assert(first && second && first != second);
+  assert(first->base == second->base && first->base->references == 2);
+  assert(first->sector_count == 20);
+
+  write_sector(first, 3, 0xaa);
+  write_sector(first, 3, 0xbb);
+  write_sector(first, 19, 0xcc);
+  assert(first->overlay_sectors == 2 && first->record_count == 2);
+
+  u8 buffer[DISK_SECTOR_SIZE];
+  read_sector(first, 3, buffer);
+  assert(buffer[0] == 0xbb);
+  read_sector(first, 4, buffer);
+  assert(buffer[0] == 4);
+  read_sector(second, 3, buffer);
+  assert(buffer[0] == 3);
+
+  // The base is never written and the overlay only holds the written sectors.
+  assert(file_byte(base_path, 3 * DISK_SECTOR_SIZE) == 3);
+  struct stat status;
+  stat(first_path, &status);
+  assert(status.st_size == DISK_OVERLAY_HEADER_SIZE + 2 * DISK_OVERLAY_RECORD_SIZE);
+
+  disk_image_close(second);
+  disk_image_close(first);
+
+  // The overlay is loaded back from its file.
+  first = disk_image_open_overlay(base_path, first_path, false);
+  assert(first->overlay_sectors == 2);
+  read_sector(first, 19, buffer);
+  assert(buffer[0] == 0xcc);
+
+  // An overlay of another base is refused, whether it is open or not.
+  char other_path[32];
+  create_image(other_path, 30);
+  struct disk_image *other = disk_image_open_overlay(other_path, first_path, false);
+  assert(!other);
+  disk_image_close(first);
+  other = disk_image_open_overlay(other_path, first_path, false);
+  assert(!other);
+
+  // A missing overlay is only created when asked to.
+  unlink(second_path);
+  second = disk_image_open_overlay(base_path, second_path, false);
+  assert(!second && access(second_path, F_OK) < 0);
+  second = disk_image_open_overlay(base_path, second_path, true);
+  assert(second && second->overlay_sectors == 0);
+  disk_image_close(second);
+
+  unlink(other_path);
+  unlink(second_path);
+  unlink(first_path);
+  unlink(base_path);
+}
+
+void test_disk_image_overlay_export_and_commit(void) {
+  char base_path[32];
+  char overlay_path[32];
+  char export_path[32];
+  create_image(base_path, 20);
+  create_overlay_path(overlay_path);
+  create_overlay_path(export_path);
+
+  struct disk_image *image = disk_image_open_overlay(base_path, overlay_path, false);
+  write_sector(image, 5, 0xaa);
+
+  bool exported = disk_image_export(image, export_path);
+  assert(exported);
+  assert(file_byte(export_path, 4 * DISK_SECTOR_SIZE) == 4);
+  assert(file_byte(export_path, 5 * DISK_SECTOR_SIZE) == 0xaa);
+  assert(file_byte(export_path, 20 * DISK_SECTOR_SIZE - 1) == 19);
+
+  // Committing is refused while another overlay uses the base.
+  struct disk_image *other = disk_image_open_overlay(base_path, export_path, false);
+  assert(!other);
+  unlink(export_path);
+  other = disk_image_open_overlay(base_path, export_path, true);
+  bool committed = disk_image_commit(other);
+  assert(!committed);
+  committed = disk_image_commit(image);
+  assert(!committed);
+  disk_image_close(other);
+
+  committed = disk_image_commit(image);
+  assert(committed);
+  assert(file_byte(base_path, 5 * DISK_SECTOR_SIZE) == 0xaa);
+  assert(image->overlay_sectors == 0);
+
+  u8 buffer[DISK_SECTOR_SIZE];
+  read_sector(image, 5, buffer);
+  assert(buffer[0] == 0xaa);
+
+  disk_image_close(image);
+  unlink(export_path);
+  unlink(overlay_path);
+  unlink(base_path);
+}
+
+void disk_image_tests(void) {
+  test_disk_image_is_shared();
+  test_disk_image_read_and_write();
+  test_disk_image_cache_is_bounded();
+  test_disk_image_overlays_share_base();
+  test_disk_image_overlay_export_and_commit();
+}
@@ -0,0 +1,71 @@
+#include <assert.h>
+#include <devices/dma.h>
+#include <stdlib.h>
+
+#define MEMORY_SIZE 0x20000
+
+// Program `channel` for a transfer of `size` bytes at `addr`.
+static void program_channel(struct ports *ports, unsigned channel, byte mode, u32 addr, u16 size) {
+  static const word page_ports[] = {0x87, 0x83, 0x81, 0x82};
+
+  ports_out(ports, 0x0a, 0x04 | channel);
+  ports_out(ports, 0x0c, 0x00);
+  ports_out(ports, 0x0b, mode | channel);
+  ports_out(ports, channel * 2, addr & 0xff);
+  ports_out(ports, channel * 2, (addr >> 8) & 0xff);
+  ports_out(ports, page_ports[channel], addr >> 16);
+  ports_out(ports, channel * 2 + 1, (size - 1) & 0xff);
+  ports_out(ports, channel * 2 + 1, (size - 1) >> 8);
+  ports_out(ports, 0x0a, channel);
+}
+
+void test_dma_stops_at_terminal_count(void) {
+  byte *memory = calloc(MEMORY_SIZE, 1);
+  struct bus bus;
+  bus_init(&bus, memory, MEMORY_SIZE);
+
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, &bus, segment_offset(0, 0));
+
+  struct dma dma;
+  dma_init(&dma, &cpu);
+
+  // Single mode, write to memory.
+  program_channel(ports, 2, 0x44, 0x11234, 4);
+
+  static const u8 data[] = {1, 2, 3, 4, 5, 6};
+  u32 transferred = dma_write_memory(&dma, 2, data, sizeof(data));
+  assert(transferred == 4);
+  assert(memory[0x11234] == 1 && memory[0x11237] == 4 && memory[0x11238] == 0);
+
+  // Terminal count is reported once and masks the channel.
+  assert(ports_in(ports, 0x08) == 0x04);
+  assert(ports_in(ports, 0x08) == 0x00);
+  transferred = dma_write_memory(&dma, 2, data, sizeof(data));
+  assert(transferred == 0);
+
+  // The channel only transfers in the direction it is programmed for.
+  program_channel(ports, 2, 0x48, 0x11234, 2);
+  transferred = dma_write_memory(&dma, 2, data, sizeof(data));
+  assert(transferred == 0);
+
+  u8 read[4] = {0};
+  transferred = dma_read_memory(&dma, 2, read, sizeof(read));
+  assert(transferred == 2);
+  assert(read[0] == 1 && read[1] == 2 && read[2] == 0);
+
+  // The address registers advanced.
+  ports_out(ports, 0x0c, 0x00);
+  assert(ports_in(ports, 0x04) == 0x36);
+  assert(ports_in(ports, 0x04) == 0x12);
+
+  free(ports);
+  free(memory);
+}
+
+void dma_tests(void) {
+  test_dma_stops_at_terminal_count();
+}
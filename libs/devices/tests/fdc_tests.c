@@ -0,0 +1,201 @@
+#include <assert.h>
+#include <devices/fdc.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <testing/machine.h>
+#include <unistd.h>
+
+#define MEMORY_SIZE 0x10000
+#define IMAGE_SIZE (360 * 1024)
+
+struct machine {
+  struct testing_machine core;
+  struct dma dma;
+  struct fdc fdc;
+  struct testing_irq_count irqs;
+
+  char path[32];
+  struct disk_image *image;
+};
+
+// A 360KiB disk whose sectors are filled with the low byte of their number.
+static void machine_init(struct machine *machine, bool write_protected) {
+  strcpy(machine->path, "/tmp/fdc_tests_XXXXXX");
+  int fd = mkstemp(machine->path);
+  assert(fd >= 0);
+  for (u32 lba = 0; lba < IMAGE_SIZE / DISK_SECTOR_SIZE; ++lba) {
+    u8 sector[DISK_SECTOR_SIZE];
+    memset(sector, lba & 0xff, sizeof(sector));
+    ssize_t written = write(fd, sector, sizeof(sector));
+    assert(written == sizeof(sector));
+  }
+  close(fd);
+
+  testing_machine_init(&machine->core, MEMORY_SIZE, segment_offset(0, 0));
+  dma_init(&machine->dma, &machine->core.cpu);
+
+  machine->irqs = (struct testing_irq_count){.irq = 6};
+  struct irq_line line = {testing_count_irq, &machine->irqs, 6};
+  fdc_init(&machine->fdc, &machine->core.cpu, &machine->dma, line);
+
+  machine->image = disk_image_open(machine->path);
+  assert(machine->image);
+  bool inserted = fdc_insert_disk(&machine->fdc, 0, machine->image, write_protected);
+  assert(inserted);
+}
+
+static void machine_destroy(struct machine *machine) {
+  fdc_destroy(&machine->fdc);
+  disk_image_close(machine->image);
+  unlink(machine->path);
+
+  testing_machine_destroy(&machine->core);
+}
+
+static void send(struct machine *machine, const u8 *command, unsigned size) {
+  for (unsigned i = 0; i < size; ++i) {
+    assert(ports_in(machine->core.ports, 0x3f4) & 0x80);
+    ports_out(machine->core.ports, 0x3f5, command[i]);
+  }
+}
+
+static void receive(struct machine *machine, u8 *result, unsigned size) {
+  for (unsigned i = 0; i < size; ++i) {
+    assert((ports_in(machine->core.ports, 0x3f4) & 0xc0) == 0xc0);
+    result[i] = ports_in(machine->core.ports, 0x3f5);
+  }
+  assert(ports_in(machine->core.ports, 0x3f4) == 0x80);
+}
+
+// Channel 2 in single mode, transferring `size` bytes at `addr` in the given direction.
+static void program_dma(struct machine *machine, bool to_memory, u16 addr, u16 size) {
+  struct ports *ports = machine->core.ports;
+
+  ports_out(ports, 0x0a, 0x06);
+  ports_out(ports, 0x0c, 0x00);
+  ports_out(ports, 0x0b, to_memory ? 0x46 : 0x4a);
+  ports_out(ports, 0x04, addr & 0xff);
+  ports_out(ports, 0x04, addr >> 8);
+  ports_out(ports, 0x81, 0x00);
+  ports_out(ports, 0x05, (size - 1) & 0xff);
+  ports_out(ports, 0x05, (size - 1) >> 8);
+  ports_out(ports, 0x0a, 0x02);
+}
+
+static void reset(struct machine *machine) {
+  ports_out(machine->core.ports, 0x3f2, 0x00);
+  ports_out(machine->core.ports, 0x3f2, 0x0c);
+  assert(machine->irqs.count == 1);
+
+  for (u8 drive = 0; drive < 4; ++drive) {
+    static const u8 sense[] = {0x08};
+    send(machine, sense, sizeof(sense));
+
+    u8 result[2];
+    receive(machine, result, sizeof(result));
+    assert(result[0] == (0xc0 | drive) && result[1] == 0);
+  }
+}
+
+void test_fdc_seek(void) {
+  struct machine machine;
+  machine_init(&machine, false);
+  reset(&machine);
+
+  static const u8 seek[] = {0x0f, 0x00, 12};
+  send(&machine, seek, sizeof(seek));
+  assert(machine.irqs.count == 2);
+
+  static const u8 sense[] = {0x08};
+  send(&machine, sense, sizeof(sense));
+  u8 result[2];
+  receive(&machine, result, sizeof(result));
+  assert(result[0] == 0x20 && result[1] == 12);
+
+  // Nothing left to report.
+  send(&machine, sense, sizeof(sense));
+  receive(&machine, result, 1);
+  assert(result[0] == 0x80);
+
+  machine_destroy(&machine);
+}
+
+void test_fdc_read_data(void) {
+  struct machine machine;
+  machine_init(&machine, false);
+  reset(&machine);
+
+  // Two sectors from the end of track 1 on head 0, a multi-track read that the DMA channel stops.
+  program_dma(&machine, true, 0x2000, 2 * DISK_SECTOR_SIZE);
+  static const u8 read[] = {0xe6, 0x00, 1, 0, 8, 0x02, 9, 0x2a, 0xff};
+  send(&machine, read, sizeof(read));
+  assert(ports_in(machine.core.ports, 0x3f4) == 0x10);
+
+  testing_advance(&machine.core.cpu, 100000);
+  assert(machine.irqs.count == 2);
+
+  // Sectors 8 and 9 of cylinder 1, head 0.
+  assert(machine.core.memory[0x2000] == 25 && machine.core.memory[0x21ff] == 25);
+  assert(machine.core.memory[0x2200] == 26 && machine.core.memory[0x23ff] == 26);
+  assert(machine.core.memory[0x2400] == 0);
+
+  u8 result[7];
+  receive(&machine, result, sizeof(result));
+  static const u8 expected[] = {0x00, 0x00, 0x00, 1, 1, 1, 0x02};
+  assert(!memcmp(result, expected, sizeof(expected)));
+
+  machine_destroy(&machine);
+}
+
+void test_fdc_write_data(void) {
+  struct machine machine;
+  machine_init(&machine, false);
+  reset(&machine);
+
+  memset(machine.core.memory + 0x3000, 0x5a, DISK_SECTOR_SIZE);
+  program_dma(&machine, false, 0x3000, DISK_SECTOR_SIZE);
+  static const u8 write_command[] = {0x45, 0x00, 0, 0, 3, 0x02, 3, 0x2a, 0xff};
+  send(&machine, write_command, sizeof(write_command));
+
+  testing_advance(&machine.core.cpu, 100000);
+  assert(machine.irqs.count == 2);
+
+  u8 result[7];
+  receive(&machine, result, sizeof(result));
+  static const u8 expected[] = {0x00, 0x00, 0x00, 1, 0, 1, 0x02};
+  assert(!memcmp(result, expected, sizeof(expected)));
+
+  int fd = open(machine.path, O_RDONLY);
+  u8 on_disk;
+  ssize_t size = pread(fd, &on_disk, 1, 2 * DISK_SECTOR_SIZE);
+  assert(size == 1);
+  assert(on_disk == 0x5a);
+  close(fd);
+
+  machine_destroy(&machine);
+}
+
+void test_fdc_write_protected(void) {
+  struct machine machine;
+  machine_init(&machine, true);
+  reset(&machine);
+
+  program_dma(&machine, false, 0x3000, DISK_SECTOR_SIZE);
+  static const u8 write_command[] = {0x45, 0x00, 0, 0, 1, 0x02, 1, 0x2a, 0xff};
+  send(&machine, write_command, sizeof(write_command));
+  assert(machine.irqs.count == 2);
+
+  u8 result[7];
+  receive(&machine, result, sizeof(result));
+  assert(result[0] == 0x40 && result[1] == 0x02);
+
+  machine_destroy(&machine);
+}
+
+void fdc_tests(void) {
+  test_fdc_seek();
+  test_fdc_read_data();
+  test_fdc_write_data();
+  test_fdc_write_protected();
+}
@@ -0,0 +1,124 @@
+#include <assert.h>
+#include <devices/input_script.h>
+#include <stdlib.h>
+#include <string.h>
+#include <testing/machine.h>
+
+static void ignore_irq(void *context, u8 irq) {
+  UNUSED(context);
+  UNUSED(irq);
+}
+
+void test_input_script_scan_codes(void) {
+  u8 codes[INPUT_MAX_SCAN_CODES_PER_CHAR];
+
+  assert(input_script_scan_codes('a', codes) == 2);
+  assert(codes[0] == 0x1e && codes[1] == 0x9e);
+
+  assert(input_script_scan_codes('A', codes) == 4);
+  assert(codes[0] == 0x2a && codes[1] == 0x1e && codes[2] == 0x9e && codes[3] == 0xaa);
+
+  assert(input_script_scan_codes('\n', codes) == 2);
+  assert(codes[0] == 0x1c);
+
+  assert(input_script_scan_codes('\x01', codes) == 0);
+  assert(input_script_scan_codes((char)0xe9, codes) == 0);
+}
+
+void test_input_script_parse(void) {
+  struct input_script script;
+  input_script_init(&script);
+
+  unsigned error_line = 0;
+  bool parsed = input_script_parse(&script,
+                                   "# Start.\n"
+                                   "\n"
+                                   "1000 type D \\e\\\\\n"
+                                   "+500 key 1d 2e 9d ae\r\n"
+                                   "+2000 quit",
+                                   &error_line);
+  assert(parsed);
+
+  assert(script.event_count == 3);
+
+  assert(script.events[0].cycles == 1000);
+  assert(script.events[0].type == iet_scan_codes);
+  static const u8 typed[] = {0x2a, 0x20, 0xa0, 0xaa, 0x39, 0xb9, 0x01, 0x81, 0x2b, 0xab};
+  assert(script.events[0].count == sizeof(typed));
+  assert(!memcmp(script.scan_codes + script.events[0].offset, typed, sizeof(typed)));
+
+  assert(script.events[1].cycles == 1500);
+  static const u8 keys[] = {0x1d, 0x2e, 0x9d, 0xae};
+  assert(script.events[1].count == sizeof(keys));
+  assert(!memcmp(script.scan_codes + script.events[1].offset, keys, sizeof(keys)));
+
+  assert(script.events[2].cycles == 3500);
+  assert(script.events[2].type == iet_quit);
+
+  input_script_destroy(&script);
+}
+
+void test_input_script_parse_errors(void) {
+  static const char *const scripts[] = {
+      "100 type a\n200 jump\n",
+      "100 type a\n50 type b\n",
+      "100 type a\n+10 key 1x\n",
+      "100 type a\n+10 type \\q\n",
+      "100 type a\ntype b\n",
+  };
+
+  for (unsigned i = 0; i < sizeof(scripts) / sizeof(scripts[0]); ++i) {
+    struct input_script script;
+    input_script_init(&script);
+
+    unsigned error_line = 0;
+    bool parsed = input_script_parse(&script, scripts[i], &error_line);
+    assert(!parsed);
+    assert(error_line == 2);
+
+    input_script_destroy(&script);
+  }
+}
+
+void test_input_script_play(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct ppi ppi;
+  ppi_init(&ppi, &cpu, (struct irq_line){ignore_irq, 0, 1}, 0, 0);
+
+  struct input_script script;
+  input_script_init(&script);
+
+  unsigned error_line;
+  bool parsed = input_script_parse(&script, "10000 type a\n+100000 quit\n", &error_line);
+  assert(parsed);
+  input_script_play(&script, &ppi);
+
+  testing_advance(&cpu, 10000);
+  assert(!ppi.full);
+  testing_advance(&cpu, PPI_SCAN_CODE_CYCLES - 1);
+  assert(!ppi.full);
+  testing_advance(&cpu, 1);
+  assert(ppi.full);
+  assert(ports_in(ports, 0x60) == 0x1e);
+  assert(!input_script_finished(&script));
+
+  testing_advance(&cpu, 100000);
+  assert(script.quit);
+  assert(input_script_finished(&script));
+
+  input_script_destroy(&script);
+  ppi_destroy(&ppi);
+  free(ports);
+}
+
+void input_script_tests(void) {
+  test_input_script_scan_codes();
+  test_input_script_parse();
+  test_input_script_parse_errors();
+  test_input_script_play();
+}
@@ -0,0 +1,67 @@
+#include <assert.h>
+#include <devices/pic.h>
+#include <stdlib.h>
+
+static void initialize(struct ports *ports) {
+  // ICW1: edge triggered, single, ICW4 needed. ICW2: vectors at 0x08. ICW4: 8086 mode.
+  ports_out(ports, 0x20, 0x13);
+  ports_out(ports, 0x21, 0x08);
+  ports_out(ports, 0x21, 0x01);
+}
+
+void test_pic_delivers_highest_priority(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct pic pic;
+  pic_init(&pic, &cpu);
+  initialize(ports);
+
+  assert(!cpu.intr);
+
+  pic_raise_irq(&pic, 1);
+  pic_raise_irq(&pic, 0);
+  assert(cpu.intr);
+
+  assert(cpu.interrupt_ack(cpu.interrupt_controller) == 0x08);
+
+  // IRQ 1 has a lower priority than the IRQ 0 in service.
+  assert(!cpu.intr);
+
+  // Non-specific EOI.
+  ports_out(ports, 0x20, 0x20);
+  assert(cpu.intr);
+  assert(cpu.interrupt_ack(cpu.interrupt_controller) == 0x09);
+
+  free(ports);
+}
+
+void test_pic_masked_lines_do_not_interrupt(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct pic pic;
+  pic_init(&pic, &cpu);
+  initialize(ports);
+
+  ports_out(ports, 0x21, 0x01);
+  pic_raise_irq(&pic, 0);
+  assert(!cpu.intr);
+  assert(ports_in(ports, 0x20) == 0x01);
+
+  ports_out(ports, 0x21, 0x00);
+  assert(cpu.intr);
+
+  free(ports);
+}
+
+void pic_tests(void) {
+  test_pic_delivers_highest_priority();
+  test_pic_masked_lines_do_not_interrupt();
+}
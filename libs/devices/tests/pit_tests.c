@@ -0,0 +1,68 @@
+#include <assert.h>
+#include <devices/pit.h>
+#include <stdlib.h>
+#include <testing/machine.h>
+
+void test_pit_counter_is_computed_on_read(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct pit pit;
+  pit_init(&pit, &cpu);
+
+  // Channel 0, low/high, mode 2, count 1000.
+  ports_out(ports, 0x43, 0x34);
+  ports_out(ports, 0x40, 1000 & 0xff);
+  ports_out(ports, 0x40, 1000 >> 8);
+
+  testing_advance(&cpu, 10 * PIT_CYCLES_PER_TICK);
+
+  // Latch and read the counter.
+  ports_out(ports, 0x43, 0x00);
+  testing_advance(&cpu, 5 * PIT_CYCLES_PER_TICK);
+  word value = ports_in(ports, 0x40) | (ports_in(ports, 0x40) << 8);
+  assert(value == 990);
+
+  assert(pit_read_counter(&pit, 0) == 985);
+
+  free(ports);
+}
+
+void test_pit_raises_periodic_irq(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct pit pit;
+  pit_init(&pit, &cpu);
+
+  struct testing_irq_count counter = {.irq = 0};
+  struct irq_line line = {testing_count_irq, &counter, 0};
+  pit_connect_irq(&pit, 0, line);
+
+  // Channel 0, low/high, mode 3, count 100.
+  ports_out(ports, 0x43, 0x36);
+  ports_out(ports, 0x40, 100);
+  ports_out(ports, 0x40, 0);
+
+  testing_advance(&cpu, 99 * PIT_CYCLES_PER_TICK);
+  assert(counter.count == 0);
+
+  testing_advance(&cpu, 1 * PIT_CYCLES_PER_TICK);
+  assert(counter.count == 1);
+
+  testing_advance(&cpu, 250 * PIT_CYCLES_PER_TICK);
+  assert(counter.count == 3);
+
+  free(ports);
+}
+
+void pit_tests(void) {
+  test_pit_counter_is_computed_on_read();
+  test_pit_raises_periodic_irq();
+}
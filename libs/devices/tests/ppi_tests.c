@@ -0,0 +1,180 @@
+#include <assert.h>
+#include <cpu/checkpoint.h>
+#include <devices/ppi.h>
+#include <stdlib.h>
+#include <testing/machine.h>
+
+// Acknowledge the scan code the way the BIOS does, by pulsing bit 7 of port B.
+static void acknowledge(struct ports *ports) {
+  byte port_b = ports_in(ports, 0x61);
+  ports_out(ports, 0x61, port_b | 0x80);
+  ports_out(ports, 0x61, port_b);
+}
+
+void test_ppi_sends_scan_codes_one_at_a_time(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct testing_irq_count counter = {.irq = 1};
+  struct ppi ppi;
+  ppi_init(&ppi, &cpu, (struct irq_line){testing_count_irq, &counter, 1}, 0, 0);
+
+  static const u8 codes[] = {0x1e, 0x9e, 0x30};
+  ppi_push_scan_codes(&ppi, codes, sizeof(codes));
+
+  testing_advance(&cpu, PPI_SCAN_CODE_CYCLES - 1);
+  assert(counter.count == 0);
+  testing_advance(&cpu, 1);
+  assert(counter.count == 1);
+  assert(ports_in(ports, 0x60) == 0x1e);
+
+  // The next code waits until the guest took the first one.
+  testing_advance(&cpu, 10 * PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 1);
+  assert(ports_in(ports, 0x60) == 0x1e);
+
+  acknowledge(ports);
+  testing_advance(&cpu, PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 2);
+  assert(ports_in(ports, 0x60) == 0x9e);
+
+  acknowledge(ports);
+  testing_advance(&cpu, PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 3);
+  assert(ports_in(ports, 0x60) == 0x30);
+
+  acknowledge(ports);
+  testing_advance(&cpu, 10 * PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 3);
+
+  ppi_destroy(&ppi);
+  free(ports);
+}
+
+void test_ppi_keyboard_reset(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct testing_irq_count counter = {.irq = 1};
+  struct ppi ppi;
+  ppi_init(&ppi, &cpu, (struct irq_line){testing_count_irq, &counter, 1}, 0, 0);
+
+  static const u8 codes[] = {0x1e, 0x9e};
+  ppi_push_scan_codes(&ppi, codes, sizeof(codes));
+
+  // Holding the clock low keeps the keyboard quiet.
+  ports_out(ports, 0x61, 0x00);
+  testing_advance(&cpu, 10 * PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 0);
+
+  // Releasing it resets the keyboard, which drops the pending codes.
+  ports_out(ports, 0x61, 0x40);
+  testing_advance(&cpu, PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 1);
+  assert(ports_in(ports, 0x60) == PPI_KEYBOARD_SELF_TEST_PASSED);
+
+  acknowledge(ports);
+  testing_advance(&cpu, 10 * PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 1);
+
+  ppi_destroy(&ppi);
+  free(ports);
+}
+
+void test_ppi_checkpoint_with_pending_scan_codes(void) {
+  // jmp $
+  struct testing_machine machine;
+  testing_machine_init(&machine, 0x10000, segment_offset(0, 0));
+  machine.memory[0] = 0xeb;
+  machine.memory[1] = 0xfe;
+
+  struct testing_irq_count counter = {.irq = 1};
+  struct ppi ppi;
+  ppi_init(&ppi, &machine.cpu, (struct irq_line){testing_count_irq, &counter, 1}, 0, 0);
+
+  struct checkpoints checkpoints;
+  checkpoints_init(&checkpoints, &machine.cpu, 0, 1 << 24);
+  bool added = checkpoints_add_region(&checkpoints, &ppi, PPI_CHECKPOINT_SIZE);
+  assert(added);
+
+  static const u8 codes[] = {0x1e, 0x9e};
+  ppi_push_scan_codes(&ppi, codes, sizeof(codes));
+  checkpoints_take(&checkpoints);
+
+  // Both codes are sent, then the keyboard goes back to when neither was.
+  cpu_run(&machine.cpu, 2 * PPI_SCAN_CODE_CYCLES);
+  acknowledge(machine.ports);
+  cpu_run(&machine.cpu, 2 * PPI_SCAN_CODE_CYCLES);
+  assert(counter.count == 2 && ppi.queue_head == 2);
+  bool stepped = checkpoints_step_back(&checkpoints);
+  assert(stepped);
+  assert(ppi.queue_head == 1 && ppi.queue_size == 2);
+  assert(ports_in(machine.ports, 0x60) == 0x1e);
+
+  // The codes pushed later come after the ones still queued.
+  static const u8 more[] = {0x30};
+  ppi_push_scan_codes(&ppi, more, sizeof(more));
+  acknowledge(machine.ports);
+  cpu_run(&machine.cpu, 2 * PPI_SCAN_CODE_CYCLES);
+  assert(ports_in(machine.ports, 0x60) == 0x9e);
+  acknowledge(machine.ports);
+  cpu_run(&machine.cpu, 2 * PPI_SCAN_CODE_CYCLES);
+  assert(ports_in(machine.ports, 0x60) == 0x30);
+  acknowledge(machine.ports);
+  cpu_run(&machine.cpu, 2 * PPI_SCAN_CODE_CYCLES);
+  assert(ppi.queue_head == ppi.queue_size && !ppi.full);
+
+  checkpoints_destroy(&checkpoints);
+  ppi_destroy(&ppi);
+  testing_machine_destroy(&machine);
+}
+
+void test_ppi_switches_and_timer_2(void) {
+  struct ports *ports = malloc(sizeof(struct ports));
+  ports_init(ports);
+
+  struct cpu cpu;
+  cpu_init(&cpu, ports, 0, segment_offset(0, 0));
+
+  struct pit pit;
+  pit_init(&pit, &cpu);
+
+  struct testing_irq_count counter = {.irq = 1};
+  struct ppi ppi;
+  ppi_init(&ppi, &cpu, (struct irq_line){testing_count_irq, &counter, 1}, &pit, 0x2c);
+
+  assert((ports_in(ports, 0x62) & 0x0f) == 0x0c);
+  ports_out(ports, 0x61, 0x48);
+  assert((ports_in(ports, 0x62) & 0x0f) == 0x02);
+
+  // Timer 2 in mode 0 with the gate low does not count.
+  ports_out(ports, 0x61, 0x40);
+  ports_out(ports, 0x43, 0xb0);
+  ports_out(ports, 0x42, 10);
+  ports_out(ports, 0x42, 0);
+  testing_advance(&cpu, 20 * PIT_CYCLES_PER_TICK);
+  assert(!(ports_in(ports, 0x62) & 0x20));
+
+  // Its output goes high once it counted down with the gate high.
+  ports_out(ports, 0x61, 0x41);
+  testing_advance(&cpu, 9 * PIT_CYCLES_PER_TICK);
+  assert(!(ports_in(ports, 0x62) & 0x20));
+  testing_advance(&cpu, 2 * PIT_CYCLES_PER_TICK);
+  assert(ports_in(ports, 0x62) & 0x20);
+
+  ppi_destroy(&ppi);
+  free(ports);
+}
+
+void ppi_tests(void) {
+  test_ppi_sends_scan_codes_one_at_a_time();
+  test_ppi_keyboard_reset();
+  test_ppi_checkpoint_with_pending_scan_codes();
+  test_ppi_switches_and_timer_2();
+}
@@ -0,0 +1,133 @@
+#include <assert.h>
+#include <devices/screen.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void assert_pixel(const struct screen_image *image, u32 x, u32 y, u32 rgb) {
+  const u8 *pixel = image->pixels + (y * image->width + x) * 3;
+  assert(pixel[0] == (rgb >> 16) && pixel[1] == ((rgb >> 8) & 0xff) && pixel[2] == (rgb & 0xff));
+}
+
+static struct screen_snapshot *create_snapshot(byte mode, byte color) {
+  struct screen_snapshot *snapshot = calloc(1, sizeof(*snapshot));
+  snapshot->adapter = va_cga;
+  snapshot->mode = mode;
+  snapshot->color = color;
+  snapshot->memory_size = VIDEO_CGA_MEMORY_SIZE;
+  return snapshot;
+}
+
+void test_screen_render_text(void) {
+  struct screen_snapshot *snapshot = create_snapshot(0x29, 0x00);
+  snapshot->memory[0] = 'A';
+  snapshot->memory[1] = 0x1e;
+  snapshot->memory[2] = 0x90;
+  snapshot->memory[3] = 0x07;
+
+  // Only the leftmost column of 'A' is set.
+  u8 font[0x80 * SCREEN_GLYPH_SIZE] = {0};
+  memset(font + 'A' * SCREEN_GLYPH_SIZE, 0x80, SCREEN_GLYPH_SIZE);
+
+  struct screen_renderer *renderer = malloc(sizeof(*renderer));
+  screen_renderer_init(renderer);
+  bool loaded = screen_renderer_set_font(renderer, font, 100);
+  assert(!loaded);
+  loaded = screen_renderer_set_font(renderer, font, sizeof(font));
+  assert(loaded);
+
+  struct screen_image *image = malloc(sizeof(*image));
+  screen_render(renderer, snapshot, image);
+  assert(image->width == 640 && image->height == 200);
+  assert_pixel(image, 0, 7, 0xffff55);
+  assert_pixel(image, 1, 0, 0x0000aa);
+  assert_pixel(image, 639, 199, 0x000000);
+
+  // Characters missing from the font are drawn as boxes.
+  assert_pixel(image, 8 + 1, 1, 0xaaaaaa);
+  assert_pixel(image, 8 + 2, 2, 0x000000);
+
+  // A new font replaces the cached glyphs.
+  memset(font + 'A' * SCREEN_GLYPH_SIZE, 0x01, SCREEN_GLYPH_SIZE);
+  loaded = screen_renderer_set_font(renderer, font, sizeof(font));
+  assert(loaded);
+  screen_render(renderer, snapshot, image);
+  assert_pixel(image, 0, 0, 0x0000aa);
+  assert_pixel(image, 7, 0, 0xffff55);
+
+  // 40 columns.
+  snapshot->mode = 0x28;
+  screen_render(renderer, snapshot, image);
+  assert(image->width == 320);
+
+  free(image);
+  free(renderer);
+  free(snapshot);
+}
+
+void test_screen_render_graphics(void) {
+  // 320x200 with the cyan, magenta and white palette.
+  struct screen_snapshot *snapshot = create_snapshot(0x0a, 0x20);
+  snapshot->memory[0] = 0x1b;
+  snapshot->memory[0x2000] = 0xc0;
+
+  struct screen_renderer *renderer = malloc(sizeof(*renderer));
+  screen_renderer_init(renderer);
+  struct screen_image *image = malloc(sizeof(*image));
+
+  screen_render(renderer, snapshot, image);
+  assert(image->width == 320 && image->height == 200);
+  assert_pixel(image, 0, 0, 0x000000);
+  assert_pixel(image, 1, 0, 0x00aaaa);
+  assert_pixel(image, 2, 0, 0xaa00aa);
+  assert_pixel(image, 3, 0, 0xaaaaaa);
+  assert_pixel(image, 0, 1, 0xaaaaaa);
+
+  // 640x200 in white.
+  snapshot->mode = 0x1a;
+  snapshot->color = 0x0f;
+  screen_render(renderer, snapshot, image);
+  assert(image->width == 640);
+  assert_pixel(image, 0, 0, 0x000000);
+  assert_pixel(image, 3, 0, 0xffffff);
+
+  free(image);
+  free(renderer);
+  free(snapshot);
+}
+
+void test_screen_write_images(void) {
+  struct screen_image *image = calloc(1, sizeof(*image));
+  image->width = 2;
+  image->height = 1;
+  memset(image->pixels, 0xff, 3);
+
+  char *data;
+  size_t size;
+  FILE *out = open_memstream(&data, &size);
+
+  bool written = screen_write_ppm(image, out);
+  assert(written);
+  fflush(out);
+  assert(size == 11 + 6 && !memcmp(data, "P6\n2 1\n255\n\xff\xff\xff\0\0\0", size));
+
+  rewind(out);
+  written = screen_write_png(image, out);
+  assert(written);
+  fflush(out);
+
+  // Signature, header, one stored block of 7 bytes, end.
+  assert(size == 8 + 25 + 30 + 12);
+  assert(!memcmp(data, "\x89PNG\r\n\x1a\n\0\0\0\x0dIHDR\0\0\0\x02\0\0\0\x01\x08\x02", 26));
+  assert(!memcmp(data + 33 + 8, "\x78\x01\x01\x07\x00\xf8\xff\0\xff\xff\xff\0\0\0", 14));
+  assert(!memcmp(data + size - 12, "\0\0\0\0IEND\xae\x42\x60\x82", 12));
+
+  fclose(out);
+  free(data);
+  free(image);
+}
+
+void screen_tests(void) {
+  test_screen_render_text();
+  test_screen_render_graphics();
+  test_screen_write_images();
+}
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <cpu/checkpoint.h>
+#include <devices/video.h>
+#include <stdlib.h>
+#include <string.h>
+#include <testing/machine.h>
+
+#define MEMORY_SIZE 0x100000
+
+struct machine {
+  struct testing_machine core;
+  struct video video;
+
+  char *output;
+  size_t output_size;
+  FILE *out;
+  size_t seen;
+};
+
+static void machine_init(struct machine *machine, enum video_adapter adapter) {
+  testing_machine_init(&machine->core, MEMORY_SIZE, segment_offset(0, 0));
+  bool attached = video_init(&machine->video, &machine->core.cpu, adapter);
+  assert(attached);
+
+  machine->out = open_memstream(&machine->output, &machine->output_size);
+  machine->seen = 0;
+}
+
+static void machine_destroy(struct machine *machine) {
+  fclose(machine->out);
+  free(machine->output);
+  testing_machine_destroy(&machine->core);
+}
+
+// Return the output written since the last call.
+static const char *new_output(struct machine *machine) {
+  fflush(machine->out);
+  const char *result = machine->output + machine->seen;
+  machine->seen = machine->output_size;
+  return result;
+}
+
+static void put_char(struct machine *machine, u32 address, char c, byte attribute) {
+  bus_store_byte(&machine->core.bus, address, c);
+  bus_store_byte(&machine->core.bus, address + 1, attribute);
+}
+
+void test_video_renders_changed_cells(void) {
+  struct machine machine;
+  machine_init(&machine, va_cga);
+
+  video_set_output(&machine.video, machine.out, vf_ansi, 0);
+  video_render(&machine.video);
+  assert(strlen(new_output(&machine)) > 2000);
+
+  // Row 2, column 5.
+  put_char(&machine, VIDEO_CGA_MEMORY + (2 * 80 + 5) * 2, 'A', 0x1f);
+  video_render(&machine.video);
+  const char *output = new_output(&machine);
+  assert(strstr(output, "\x1b[3;6H\x1b[0;97;44mA"));
+  assert(strlen(output) < 40);
+
+  // Nothing changed.
+  video_render(&machine.video);
+  assert(!*new_output(&machine));
+
+  // Storing to memory outside of the displayed page does not render anything.
+  bus_store_byte(&machine.core.bus, VIDEO_CGA_MEMORY + 0x1000, 'B');
+  bus_store_byte(&machine.core.bus, 0x1000, 'B');
+  video_render(&machine.video);
+  assert(!*new_output(&machine));
+
+  // Flipping to that page redraws the screen.
+  ports_out(machine.core.ports, 0x3d4, 0x0c);
+  ports_out(machine.core.ports, 0x3d5, 0x08);
+  ports_out(machine.core.ports, 0x3d4, 0x0d);
+  ports_out(machine.core.ports, 0x3d5, 0x00);
+  video_render(&machine.video);
+  output = new_output(&machine);
+  assert(!strncmp(output, "\x1b[0;30;40mB", 11));
+
+  machine_destroy(&machine);
+}
+
+void test_video_text_dump(void) {
+  struct machine machine;
+  machine_init(&machine, va_mda);
+
+  put_char(&machine, VIDEO_MDA_MEMORY, 'H', 0x07);
+  put_char(&machine, VIDEO_MDA_MEMORY + 2, 'I', 0x07);
+  put_char(&machine, VIDEO_MDA_MEMORY + 80 * 2 + 2, 0x01, 0x07);
+
+  // Rendering is driven by the scheduler.
+  video_set_output(&machine.video, machine.out, vf_text, 1000);
+  machine.core.cpu.cycles += 1000;
+  scheduler_run_due(&machine.core.cpu.scheduler, machine.core.cpu.cycles);
+
+  const char *output = new_output(&machine);
+  assert(!strncmp(output, "HI\n \u263a\n\n", 9));
+  assert(strlen(output) == 3 + 5 + 23);
+
+  machine.core.cpu.cycles += 1000;
+  scheduler_run_due(&machine.core.cpu.scheduler, machine.core.cpu.cycles);
+  assert(!*new_output(&machine));
+
+  put_char(&machine, VIDEO_MDA_MEMORY, 'Y', 0x07);
+  machine.core.cpu.cycles += 1000;
+  scheduler_run_due(&machine.core.cpu.scheduler, machine.core.cpu.cycles);
+  assert(!strncmp(new_output(&machine), "\f\nYI\n", 5));
+
+  machine_destroy(&machine);
+}
+
+void test_video_memory_mirror(void) {
+  struct machine machine;
+  machine_init(&machine, va_cga);
+
+  video_set_output(&machine.video, machine.out, vf_ansi, 0);
+  video_render(&machine.video);
+  new_output(&machine);
+
+  // The second copy of video memory is the same memory.
+  put_char(&machine, VIDEO_CGA_MEMORY + VIDEO_CGA_MEMORY_SIZE + 2, 'M', 0x07);
+  assert(machine.core.memory[VIDEO_CGA_MEMORY + 2] == 'M');
+  u32 page = VIDEO_CGA_MEMORY >> BUS_PAGE_SHIFT;
+  assert(machine.core.bus.dirty_pages[page / 64] & (1ull << (page % 64)));
+  video_render(&machine.video);
+  assert(strstr(new_output(&machine), "\x1b[1;2H\x1b[0;37;40mM"));
+
+  put_char(&machine, VIDEO_CGA_MEMORY + 4, 'N', 0x07);
+  assert(machine.core.memory[VIDEO_CGA_MEMORY + VIDEO_CGA_MEMORY_SIZE + 4] == 'N');
+
+  machine_destroy(&machine);
+}
+
+void test_video_pauses_while_going_back(void) {
+  struct machine machine;
+  machine_init(&machine, va_mda);
+
+  struct checkpoints checkpoints;
+  checkpoints_init(&checkpoints, &machine.core.cpu, 0, 1 << 24);
+  checkpoints_take(&checkpoints);
+  video_follow_checkpoints(&machine.video, &checkpoints);
+
+  video_set_output(&machine.video, machine.out, vf_text, 0);
+  video_render(&machine.video);
+  new_output(&machine);
+
+  put_char(&machine, VIDEO_MDA_MEMORY, 'X', 0x07);
+  checkpoints.travelling = true;
+  video_render(&machine.video);
+  assert(!*new_output(&machine));
+  checkpoints.travelling = false;
+  video_render(&machine.video);
+  assert(!strncmp(new_output(&machine), "\f\nX\n", 4));
+
+  // Nothing changed since the last rendering as far as the adapter saw, the screen is drawn again.
+  machine.core.cpu.cycles += 10;
+  bool stepped = checkpoints_step_back(&checkpoints);
+  assert(stepped);
+  assert(machine.core.memory[VIDEO_MDA_MEMORY] == 0);
+  video_render(&machine.video);
+  assert(!strncmp(new_output(&machine), "\f\n\n", 3));
+
+  checkpoints_destroy(&checkpoints);
+  machine_destroy(&machine);
+}
+
+void video_tests(void) {
+  test_video_renders_changed_cells();
+  test_video_text_dump();
+  test_video_memory_mirror();
+  test_video_pauses_while_going_back();
+}
@@ -16,12 +16,18 @@ const char *indirect_memory_encoding_to_string(enum indirect_memory_encoding enc
 }
 
 int print_prefix(char *buffer, size_t buffer_size, const struct instruction *instruction) {
+  int inc = 0;
+
+  if (instruction->prefixes & ip_lock) {
+    inc += snprintf(buffer, buffer_size, "lock ");
+  }
+
   switch (instruction->rep_mode) {
     case rm_rep:
-      return snprintf(buffer, buffer_size, "rep ");
+      return inc + snprintf(buffer + inc, buffer_size - inc, "rep ");
 
     case rm_repne:
-      return snprintf(buffer, buffer_size, "repne ");
+      return inc + snprintf(buffer + inc, buffer_size - inc, "repne ");
 
     case rm_none:
       break;
@@ -31,7 +37,7 @@ int print_prefix(char *buffer, size_t buffer_size, const struct instruction *ins
       break;
   }
 
-  return 0;
+  return inc;
 }
 
 int print_mnemonic(char *buffer, size_t buffer_size, const struct instruction *instruction) {
@@ -178,7 +184,8 @@ int print_operand(char *buffer, size_t buffer_size, const struct operand *operan
 
     case ot_ds_si: {
       int inc = print_pointer_size(buffer, buffer_size, operand->size);
-      return inc + snprintf(buffer + inc, buffer_size - inc, "ds:[si]");
+      return inc + snprintf(buffer + inc, buffer_size - inc, "%s:[si]",
+                            segment_register_to_string(operand->data.as_indirect.seg_reg));
     }
 
     case ot_es_di: {
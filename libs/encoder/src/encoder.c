@@ -621,6 +621,12 @@ static int encode_xor(const struct instruction *instruction, u8 *buffer, usize b
   return 0;
 }
 
+static int encode_invalid(const struct instruction *instruction, u8 *buffer, usize buffer_size) {
+  assert(instruction->type == it_invalid);
+
+  return 0;
+}
+
 typedef int (*encode_func)(const struct instruction *instruction, u8 *buffer, usize buffer_size);
 
 static const encode_func encode_funcs[] = {
@@ -638,7 +644,7 @@ static const encode_func encode_funcs[] = {
     encode_rcl,  encode_rcr,   encode_ret,   encode_retf,  encode_rol,  encode_ror,   encode_sahf,
     encode_salc, encode_sar,   encode_sbb,   encode_scas,  encode_shl,  encode_shr,   encode_stc,
     encode_std,  encode_sti,   encode_stos,  encode_sub,   encode_test, encode_xchg,  encode_xlat,
-    encode_xor,
+    encode_xor,  encode_invalid,
 };
 
 int encode(const struct instruction *instruction, u8 *buffer, usize buffer_size) {
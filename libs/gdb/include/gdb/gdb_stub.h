@@ -0,0 +1,86 @@
+#ifndef GDB_GDB_STUB_H_
+#define GDB_GDB_STUB_H_
+
+#include <base/platform.h>
+#include <cpu/checkpoint.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+
+// Server side of the GDB remote serial protocol, debugging the machine from a connected GDB.
+//
+// The registers are presented as an i386: eax ecx edx ebx esp ebp esi edi eip eflags cs ss ds es fs
+// gs, each 32 bits wide with the 16-bit value of the cpu in the low half. Memory is addressed flat,
+// and so is eip: it holds the flat address of CS:IP, and setting it moves IP within the current
+// code segment when the address is in there.
+// Software breakpoints and hardware breakpoints are both set in the cpu. Watchpoints observe the
+// stores to, the fetches from, or both, their range through the bus, so that only accesses to the
+// pages they are on are slowed down. With checkpoints the debugger can also step back.
+
+#define GDB_STUB_PACKET_SIZE 0x1000
+#define GDB_STUB_MAX_WATCHPOINTS 4
+
+// Cycles run between checks for an interrupt from the debugger.
+#define GDB_STUB_POLL_CYCLES 100000
+
+struct gdb_stub;
+
+// In the order of the Z packets.
+enum gdb_watch_type {
+  gw_write,
+  gw_read,
+  gw_access,
+};
+
+struct gdb_watchpoint {
+  struct gdb_stub *stub;
+  enum gdb_watch_type type;
+  u32 address;
+  u32 length;
+  bool set;
+};
+
+struct gdb_stub {
+  struct cpu *cpu;
+  struct checkpoints *checkpoints;
+  struct cpu_debug debug;
+
+  int fd;
+  bool no_ack;
+
+  // Set by the caller when the program exits, optional.
+  const bool *exited;
+  const u8 *exit_code;
+
+  struct gdb_watchpoint watchpoints[GDB_STUB_MAX_WATCHPOINTS];
+  // The first access that triggered a watchpoint during the last run.
+  bool watch_hit;
+  enum gdb_watch_type watch_type;
+  u32 watch_address;
+
+  u8 input[GDB_STUB_PACKET_SIZE];
+  size_t input_size;
+  size_t input_position;
+  char packet[GDB_STUB_PACKET_SIZE + 1];
+};
+
+// Debug `cpu`, stepping back through `checkpoints` if not null. The stub is attached to the cpu
+// until destroyed.
+void gdb_stub_init(struct gdb_stub *stub, struct cpu *cpu, struct checkpoints *checkpoints);
+void gdb_stub_destroy(struct gdb_stub *stub);
+
+// Tell the debugger that the program exited with `*exit_code` once `*exited` is set, instead of
+// running a machine with nothing left to do.
+void gdb_stub_report_exit(struct gdb_stub *stub, const bool *exited, const u8 *exit_code);
+
+// Talk to the debugger over the connected socket `fd`, which the stub then owns.
+void gdb_stub_attach(struct gdb_stub *stub, int fd);
+
+// Wait for a debugger to connect to `address`, a TCP port on the local host if it is a number and
+// the path of a Unix socket otherwise. Return false if listening or accepting failed.
+bool gdb_stub_accept(struct gdb_stub *stub, const char *address);
+
+// Serve the debugger, running the machine when it says so. Return true when it detaches, with the
+// breakpoints and watchpoints removed, and false when it kills the machine or goes away.
+bool gdb_stub_serve(struct gdb_stub *stub);
+
+#endif // GDB_GDB_STUB_H_
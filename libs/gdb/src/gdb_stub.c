@@ -0,0 +1,706 @@
+#include "gdb/gdb_stub.h"
+
+#include <base/address.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define GDB_STUB_REGISTER_COUNT 16
+#define GDB_STUB_INTERRUPT 0x03
+
+// Signals reported when the machine stops.
+#define GDB_SIGINT 2
+#define GDB_SIGTRAP 5
+
+enum gdb_register {
+  gr_eip = 8,
+  gr_eflags,
+  gr_cs,
+  gr_ss,
+  gr_ds,
+  gr_es,
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Parse hex digits at `*text`, moving past them.
+static u32 parse_hex(const char **text) {
+  u32 value = 0;
+  for (int digit; (digit = hex_value(**text)) >= 0; ++*text) {
+    value = value << 4 | (u32)digit;
+  }
+  return value;
+}
+
+// Parse "address,length" as found in memory and breakpoint packets.
+static void parse_range(const char **text, u32 *address, u32 *length) {
+  *address = parse_hex(text);
+  if (**text == ',') {
+    ++*text;
+  }
+  *length = parse_hex(text);
+}
+
+// Registers go over the wire as little endian 32-bit values.
+static char *format_register(char *out, u32 value) {
+  for (unsigned i = 0; i < 4; ++i, value >>= 8) {
+    *out++ = hex_digits[(value >> 4) & 0xf];
+    *out++ = hex_digits[value & 0xf];
+  }
+  *out = 0;
+  return out;
+}
+
+static u32 parse_register(const char **text) {
+  u32 value = 0;
+  for (unsigned i = 0; i < 4 && hex_value((*text)[0]) >= 0 && hex_value((*text)[1]) >= 0; ++i) {
+    value |= (u32)(hex_value((*text)[0]) << 4 | hex_value((*text)[1])) << (i * 8);
+    *text += 2;
+  }
+  return value;
+}
+
+static u32 get_register(const struct cpu *cpu, unsigned number) {
+  if (number < register_16_count) {
+    return cpu->regs.word[number];
+  }
+
+  switch (number) {
+    case gr_eip:
+      return flatten_address(segment_offset(cpu->segs[CS], cpu->ip));
+    case gr_eflags:
+      return flags_to_word(&cpu->flags);
+    case gr_cs:
+      return cpu->segs[CS];
+    case gr_ss:
+      return cpu->segs[SS];
+    case gr_ds:
+      return cpu->segs[DS];
+    case gr_es:
+      return cpu->segs[ES];
+    default:
+      // fs and gs do not exist.
+      return 0;
+  }
+}
+
+static void set_register(struct cpu *cpu, unsigned number, u32 value) {
+  if (number < register_16_count) {
+    cpu->regs.word[number] = (word)value;
+    return;
+  }
+
+  switch (number) {
+    case gr_eip: {
+      // Within the current code segment if possible, the debugger only knows flat addresses.
+      u32 base = (u32)cpu->segs[CS] << 4;
+      if (value >= base && value - base <= 0xffff) {
+        cpu->ip = (word)(value - base);
+      } else {
+        cpu->segs[CS] = (word)((value >> 4) & 0xffff);
+        cpu->ip = value & 0x0f;
+      }
+      break;
+    }
+    case gr_eflags:
+      flags_from_word(&cpu->flags, (word)value);
+      break;
+    case gr_cs:
+      cpu->segs[CS] = (word)value;
+      break;
+    case gr_ss:
+      cpu->segs[SS] = (word)value;
+      break;
+    case gr_ds:
+      cpu->segs[DS] = (word)value;
+      break;
+    case gr_es:
+      cpu->segs[ES] = (word)value;
+      break;
+    default:
+      break;
+  }
+}
+
+// Return the next byte from the debugger, or -1 if it went away.
+static int gdb_stub_read_byte(struct gdb_stub *stub) {
+  if (stub->input_position == stub->input_size) {
+    ssize_t size = read(stub->fd, stub->input, sizeof(stub->input));
+    if (size <= 0) {
+      return -1;
+    }
+    stub->input_size = (size_t)size;
+    stub->input_position = 0;
+  }
+  return stub->input[stub->input_position++];
+}
+
+static bool gdb_stub_write(struct gdb_stub *stub, const void *data, size_t size) {
+  const u8 *bytes = data;
+  while (size) {
+    ssize_t written = send(stub->fd, bytes, size, MSG_NOSIGNAL);
+    if (written <= 0) {
+      return false;
+    }
+    bytes += written;
+    size -= (size_t)written;
+  }
+  return true;
+}
+
+// Frame `payload` as "$payload#checksum" and send it. Acknowledgements from the debugger are
+// ignored, the connection is reliable.
+static bool gdb_stub_send(struct gdb_stub *stub, const char *payload) {
+  static char frame[GDB_STUB_PACKET_SIZE + 4];
+
+  size_t length = strlen(payload);
+  u8 checksum = 0;
+  frame[0] = '$';
+  for (size_t i = 0; i < length; ++i) {
+    frame[i + 1] = payload[i];
+    checksum += (u8)payload[i];
+  }
+  frame[length + 1] = '#';
+  frame[length + 2] = hex_digits[checksum >> 4];
+  frame[length + 3] = hex_digits[checksum & 0xf];
+
+  return gdb_stub_write(stub, frame, length + 4);
+}
+
+// Receive the next packet into `packet`. Return its length, or -1 if the debugger went away.
+static int gdb_stub_receive(struct gdb_stub *stub) {
+  for (;;) {
+    int c;
+    do {
+      // Acknowledgements and interrupts while stopped are skipped.
+      c = gdb_stub_read_byte(stub);
+      if (c < 0) {
+        return -1;
+      }
+    } while (c != '$');
+
+    size_t length = 0;
+    u8 checksum = 0;
+    while ((c = gdb_stub_read_byte(stub)) != '#') {
+      if (c < 0) {
+        return -1;
+      }
+      if (length < GDB_STUB_PACKET_SIZE) {
+        stub->packet[length++] = (char)c;
+      }
+      checksum += (u8)c;
+    }
+    stub->packet[length] = 0;
+
+    int high = gdb_stub_read_byte(stub);
+    int low = gdb_stub_read_byte(stub);
+    if (high < 0 || low < 0) {
+      return -1;
+    }
+
+    bool valid = hex_value((char)high) >= 0 && hex_value((char)low) >= 0 &&
+                 (hex_value((char)high) << 4 | hex_value((char)low)) == checksum;
+    if (!stub->no_ack && !gdb_stub_write(stub, valid ? "+" : "-", 1)) {
+      return -1;
+    }
+    if (valid) {
+      return (int)length;
+    }
+  }
+}
+
+// Return 1 if the debugger asked to stop, -1 if it went away and 0 otherwise. Does not block.
+static int gdb_stub_interrupted(struct gdb_stub *stub) {
+  struct pollfd poll_fd = {.fd = stub->fd, .events = POLLIN};
+
+  while (stub->input_position < stub->input_size || poll(&poll_fd, 1, 0) > 0) {
+    int c = gdb_stub_read_byte(stub);
+    if (c < 0) {
+      return -1;
+    }
+    if (c == GDB_STUB_INTERRUPT) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void gdb_stub_watch_hit(struct gdb_watchpoint *watchpoint, u32 addr) {
+  struct gdb_stub *stub = watchpoint->stub;
+  if (!stub->watch_hit) {
+    stub->watch_hit = true;
+    stub->watch_type = watchpoint->type;
+    stub->watch_address = addr;
+  }
+  cpu_stop(stub->cpu);
+}
+
+static void gdb_stub_watch_store(u32 addr, u8 value, void *context) {
+  UNUSED(value);
+  gdb_stub_watch_hit(context, addr);
+}
+
+static void gdb_stub_watch_fetch(u32 addr, u8 value, void *context) {
+  UNUSED(value);
+  gdb_stub_watch_hit(context, addr);
+}
+
+static bool gdb_stub_add_watchpoint(struct gdb_stub *stub, enum gdb_watch_type type, u32 address,
+                                    u32 length) {
+  struct bus *bus = stub->cpu->bus;
+
+  for (unsigned i = 0; i < GDB_STUB_MAX_WATCHPOINTS; ++i) {
+    struct gdb_watchpoint *watchpoint = &stub->watchpoints[i];
+    if (watchpoint->set) {
+      continue;
+    }
+
+    u32 end = address + length;
+    bool stores = type != gw_read;
+    bool fetches = type != gw_write;
+    if (!length ||
+        (stores && !bus_add_store_observer(bus, address, end, watchpoint, gdb_stub_watch_store))) {
+      return false;
+    }
+    if (fetches && !bus_add_fetch_observer(bus, address, end, watchpoint, gdb_stub_watch_fetch)) {
+      if (stores) {
+        bus_remove_store_observer(bus, watchpoint, gdb_stub_watch_store);
+      }
+      return false;
+    }
+
+    watchpoint->type = type;
+    watchpoint->address = address;
+    watchpoint->length = length;
+    watchpoint->set = true;
+    ++stub->debug.stopper_count;
+    return true;
+  }
+  return false;
+}
+
+static void gdb_stub_remove_watchpoint(struct gdb_stub *stub, struct gdb_watchpoint *watchpoint) {
+  bus_remove_store_observer(stub->cpu->bus, watchpoint, gdb_stub_watch_store);
+  bus_remove_fetch_observer(stub->cpu->bus, watchpoint, gdb_stub_watch_fetch);
+  watchpoint->set = false;
+  --stub->debug.stopper_count;
+}
+
+static bool gdb_stub_find_and_remove_watchpoint(struct gdb_stub *stub, enum gdb_watch_type type,
+                                                u32 address, u32 length) {
+  for (unsigned i = 0; i < GDB_STUB_MAX_WATCHPOINTS; ++i) {
+    struct gdb_watchpoint *watchpoint = &stub->watchpoints[i];
+    if (watchpoint->set && watchpoint->type == type && watchpoint->address == address &&
+        watchpoint->length == length) {
+      gdb_stub_remove_watchpoint(stub, watchpoint);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void gdb_stub_remove_all(struct gdb_stub *stub) {
+  for (unsigned i = 0; i < GDB_STUB_MAX_WATCHPOINTS; ++i) {
+    if (stub->watchpoints[i].set) {
+      gdb_stub_remove_watchpoint(stub, &stub->watchpoints[i]);
+    }
+  }
+
+  stub->debug.breakpoint_count = 0;
+  memset(stub->debug.breakpoint_pages, 0, sizeof(stub->debug.breakpoint_pages));
+}
+
+void gdb_stub_init(struct gdb_stub *stub, struct cpu *cpu, struct checkpoints *checkpoints) {
+  memset(stub, 0, sizeof(*stub));
+
+  stub->cpu = cpu;
+  stub->checkpoints = checkpoints;
+  stub->fd = -1;
+  for (unsigned i = 0; i < GDB_STUB_MAX_WATCHPOINTS; ++i) {
+    stub->watchpoints[i].stub = stub;
+  }
+
+  cpu->debug = &stub->debug;
+}
+
+void gdb_stub_report_exit(struct gdb_stub *stub, const bool *exited, const u8 *exit_code) {
+  stub->exited = exited;
+  stub->exit_code = exit_code;
+}
+
+void gdb_stub_destroy(struct gdb_stub *stub) {
+  gdb_stub_remove_all(stub);
+  stub->cpu->debug = 0;
+
+  if (stub->fd >= 0) {
+    close(stub->fd);
+  }
+}
+
+void gdb_stub_attach(struct gdb_stub *stub, int fd) {
+  if (stub->fd >= 0) {
+    close(stub->fd);
+  }
+
+  stub->fd = fd;
+  stub->no_ack = false;
+  stub->input_size = 0;
+  stub->input_position = 0;
+}
+
+bool gdb_stub_accept(struct gdb_stub *stub, const char *address) {
+  char *end;
+  long port = strtol(address, &end, 10);
+  bool tcp = *address && !*end;
+
+  int listener;
+  if (tcp) {
+    struct sockaddr_in socket_address;
+    memset(&socket_address, 0, sizeof(socket_address));
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_port = htons((u16)port);
+    socket_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    if (listener < 0 ||
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(listener, (struct sockaddr *)&socket_address, sizeof(socket_address)) < 0) {
+      goto failed;
+    }
+  } else {
+    struct sockaddr_un socket_address;
+    memset(&socket_address, 0, sizeof(socket_address));
+    socket_address.sun_family = AF_UNIX;
+    if (strlen(address) >= sizeof(socket_address.sun_path)) {
+      return false;
+    }
+    strcpy(socket_address.sun_path, address);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 ||
+        bind(listener, (struct sockaddr *)&socket_address, sizeof(socket_address)) < 0) {
+      goto failed;
+    }
+  }
+
+  if (listen(listener, 1) < 0) {
+    goto failed;
+  }
+
+  int fd = accept(listener, 0, 0);
+  close(listener);
+  if (!tcp) {
+    unlink(address);
+  }
+  if (fd < 0) {
+    return false;
+  }
+
+  if (tcp) {
+    // Packets are small and answered one at a time.
+    int no_delay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  }
+
+  gdb_stub_attach(stub, fd);
+  return true;
+
+failed:
+  if (listener >= 0) {
+    close(listener);
+  }
+  return false;
+}
+
+static bool gdb_stub_exited(const struct gdb_stub *stub) {
+  return stub->exited && *stub->exited;
+}
+
+static void format_stop(struct gdb_stub *stub, char *reply, int signal) {
+  static const char *const watch_names[] = {"watch", "rwatch", "awatch"};
+
+  if (gdb_stub_exited(stub)) {
+    sprintf(reply, "W%02x", *stub->exit_code);
+  } else if (stub->watch_hit) {
+    sprintf(reply, "T%02x%s:%x;", GDB_SIGTRAP, watch_names[stub->watch_type], stub->watch_address);
+  } else {
+    sprintf(reply, "S%02x", signal);
+  }
+}
+
+// Run until a breakpoint, a watchpoint or the debugger stops the machine, or the program exits.
+// Return false if the debugger went away.
+static bool gdb_stub_continue(struct gdb_stub *stub, char *reply) {
+  stub->watch_hit = false;
+
+  for (;;) {
+    if (gdb_stub_exited(stub)) {
+      format_stop(stub, reply, GDB_SIGTRAP);
+      return true;
+    }
+
+    cpu_run(stub->cpu, GDB_STUB_POLL_CYCLES);
+    if (stub->cpu->stopped) {
+      format_stop(stub, reply, GDB_SIGTRAP);
+      return true;
+    }
+
+    int interrupted = gdb_stub_interrupted(stub);
+    if (interrupted < 0) {
+      return false;
+    }
+    if (interrupted) {
+      format_stop(stub, reply, GDB_SIGINT);
+      return true;
+    }
+  }
+}
+
+static void gdb_stub_step(struct gdb_stub *stub, char *reply) {
+  stub->watch_hit = false;
+  cpu_run(stub->cpu, 1);
+  format_stop(stub, reply, GDB_SIGTRAP);
+}
+
+static void gdb_stub_read_memory(struct gdb_stub *stub, const char *arguments, char *reply) {
+  struct bus *bus = stub->cpu->bus;
+
+  u32 address, length;
+  parse_range(&arguments, &address, &length);
+  if (length > GDB_STUB_PACKET_SIZE / 2 || address > bus->memory_size ||
+      length > bus->memory_size - address) {
+    strcpy(reply, "E01");
+    return;
+  }
+
+  for (u32 i = 0; i < length; ++i) {
+    u8 value = bus->memory[address + i];
+    *reply++ = hex_digits[value >> 4];
+    *reply++ = hex_digits[value & 0xf];
+  }
+  *reply = 0;
+}
+
+static void gdb_stub_write_memory(struct gdb_stub *stub, const char *arguments, char *reply) {
+  struct bus *bus = stub->cpu->bus;
+
+  u32 address, length;
+  parse_range(&arguments, &address, &length);
+  if (*arguments++ != ':' || strlen(arguments) != (size_t)length * 2 ||
+      address > bus->memory_size || length > bus->memory_size - address) {
+    strcpy(reply, "E01");
+    return;
+  }
+
+  // Through the bus, so that devices and checkpoints see the change.
+  for (u32 i = 0; i < length; ++i, arguments += 2) {
+    int high = hex_value(arguments[0]);
+    int low = hex_value(arguments[1]);
+    if (high < 0 || low < 0) {
+      strcpy(reply, "E01");
+      return;
+    }
+    bus_store_byte(bus, address + i, (byte)(high << 4 | low));
+  }
+  strcpy(reply, "OK");
+}
+
+// Handle "Z" and "z" packets.
+static void gdb_stub_breakpoint(struct gdb_stub *stub, const char *packet, char *reply) {
+  bool insert = packet[0] == 'Z';
+  char type = packet[1];
+  const char *arguments = packet + 2;
+  if (*arguments == ',') {
+    ++arguments;
+  }
+
+  u32 address, length;
+  parse_range(&arguments, &address, &length);
+
+  bool done;
+  switch (type) {
+    case '0':
+    case '1':
+      if (insert) {
+        done = cpu_debug_add_breakpoint(&stub->debug, address);
+      } else {
+        // Removing a breakpoint that is not there is not an error.
+        cpu_debug_remove_breakpoint(&stub->debug, address);
+        done = true;
+      }
+      break;
+
+    case '2':
+    case '3':
+    case '4': {
+      enum gdb_watch_type watch_type = (enum gdb_watch_type)(type - '2');
+      done = insert ? gdb_stub_add_watchpoint(stub, watch_type, address, length)
+                    : gdb_stub_find_and_remove_watchpoint(stub, watch_type, address, length);
+      break;
+    }
+
+    default:
+      reply[0] = 0;
+      return;
+  }
+
+  strcpy(reply, done ? "OK" : "E01");
+}
+
+bool gdb_stub_serve(struct gdb_stub *stub) {
+  static char reply[GDB_STUB_PACKET_SIZE + 1];
+  struct cpu *cpu = stub->cpu;
+
+  for (;;) {
+    if (gdb_stub_receive(stub) < 0) {
+      return false;
+    }
+
+    const char *packet = stub->packet;
+    const char *arguments = packet + 1;
+    reply[0] = 0;
+
+    switch (packet[0]) {
+      case '?':
+        format_stop(stub, reply, GDB_SIGTRAP);
+        break;
+
+      case 'g': {
+        char *out = reply;
+        for (unsigned i = 0; i < GDB_STUB_REGISTER_COUNT; ++i) {
+          out = format_register(out, get_register(cpu, i));
+        }
+        break;
+      }
+
+      case 'G':
+        for (unsigned i = 0; i < GDB_STUB_REGISTER_COUNT && *arguments; ++i) {
+          set_register(cpu, i, parse_register(&arguments));
+        }
+        strcpy(reply, "OK");
+        break;
+
+      case 'p': {
+        u32 number = parse_hex(&arguments);
+        if (number < GDB_STUB_REGISTER_COUNT) {
+          format_register(reply, get_register(cpu, number));
+        } else {
+          strcpy(reply, "E01");
+        }
+        break;
+      }
+
+      case 'P': {
+        u32 number = parse_hex(&arguments);
+        if (number < GDB_STUB_REGISTER_COUNT && *arguments++ == '=') {
+          set_register(cpu, number, parse_register(&arguments));
+          strcpy(reply, "OK");
+        } else {
+          strcpy(reply, "E01");
+        }
+        break;
+      }
+
+      case 'm':
+        gdb_stub_read_memory(stub, arguments, reply);
+        break;
+
+      case 'M':
+        gdb_stub_write_memory(stub, arguments, reply);
+        break;
+
+      case 'c':
+        if (!gdb_stub_continue(stub, reply)) {
+          return false;
+        }
+        break;
+
+      case 's':
+        gdb_stub_step(stub, reply);
+        break;
+
+      case 'b':
+        // Reverse step, reverse continue is not supported.
+        if (packet[1] == 's' && stub->checkpoints) {
+          stub->watch_hit = false;
+          if (checkpoints_step_back(stub->checkpoints)) {
+            format_stop(stub, reply, GDB_SIGTRAP);
+          } else {
+            sprintf(reply, "T%02xreplaylog:begin;", GDB_SIGTRAP);
+          }
+        }
+        break;
+
+      case 'Z':
+      case 'z':
+        gdb_stub_breakpoint(stub, packet, reply);
+        break;
+
+      case 'H':
+        // There is a single thread.
+        strcpy(reply, "OK");
+        break;
+
+      case 'q':
+        if (!strncmp(packet, "qSupported", 10)) {
+          sprintf(reply, "PacketSize=%x;QStartNoAckMode+%s", GDB_STUB_PACKET_SIZE,
+                  stub->checkpoints ? ";ReverseStep+" : "");
+        } else if (!strcmp(packet, "qAttached")) {
+          strcpy(reply, "1");
+        } else if (!strcmp(packet, "qC")) {
+          strcpy(reply, "QC1");
+        } else if (!strcmp(packet, "qfThreadInfo")) {
+          strcpy(reply, "m1");
+        } else if (!strcmp(packet, "qsThreadInfo")) {
+          strcpy(reply, "l");
+        }
+        break;
+
+      case 'Q':
+        if (!strcmp(packet, "QStartNoAckMode")) {
+          if (!gdb_stub_send(stub, "OK")) {
+            return false;
+          }
+          stub->no_ack = true;
+          continue;
+        }
+        break;
+
+      case 'D':
+        gdb_stub_remove_all(stub);
+        gdb_stub_send(stub, "OK");
+        return true;
+
+      case 'k':
+        return false;
+
+      default:
+        // An empty reply tells the debugger that the packet is not supported.
+        break;
+    }
+
+    if (!gdb_stub_send(stub, reply)) {
+      return false;
+    }
+  }
+}
@@ -0,0 +1,303 @@
+#include <assert.h>
+#include <gdb/gdb_stub.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <testing/machine.h>
+#include <unistd.h>
+
+#define MEMORY_SIZE 0x10000
+
+// Count in AX, store it at 0000:0200 and load it back into BX, forever.
+static const byte program[] = {
+    0x40,                   // inc ax
+    0xa3, 0x00, 0x02,       // mov [0x200], ax
+    0x8b, 0x1e, 0x00, 0x02, // mov bx, [0x200]
+    0xeb, 0xf6,             // jmp 0x100
+};
+
+struct machine {
+  struct testing_machine core;
+  struct gdb_stub stub;
+  // The debugger's end of the connection.
+  int fd;
+};
+
+static void machine_init(struct machine *machine, struct checkpoints *checkpoints) {
+  testing_machine_init(&machine->core, MEMORY_SIZE, segment_offset(0x0000, 0x0100));
+  memcpy(machine->core.memory + 0x100, program, sizeof(program));
+
+  int fds[2];
+  int result = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  assert(result == 0);
+  gdb_stub_init(&machine->stub, &machine->core.cpu, checkpoints);
+  gdb_stub_attach(&machine->stub, fds[0]);
+  machine->fd = fds[1];
+}
+
+static void machine_destroy(struct machine *machine) {
+  gdb_stub_destroy(&machine->stub);
+  close(machine->fd);
+  testing_machine_destroy(&machine->core);
+}
+
+static void send_packet(struct machine *machine, const char *payload) {
+  u8 checksum = 0;
+  for (const char *c = payload; *c; ++c) {
+    checksum += (u8)*c;
+  }
+
+  char frame[256];
+  int length = snprintf(frame, sizeof(frame), "$%s#%02x", payload, checksum);
+  ssize_t written = write(machine->fd, frame, (size_t)length);
+  assert(written == length);
+}
+
+// Read the next reply, skipping acknowledgements.
+static void read_reply(struct machine *machine, char *reply) {
+  char c;
+  do {
+    ssize_t size = read(machine->fd, &c, 1);
+    assert(size == 1);
+  } while (c == '+');
+  assert(c == '$');
+
+  while (read(machine->fd, &c, 1) == 1 && c != '#') {
+    *reply++ = c;
+  }
+  *reply = 0;
+
+  char checksum[2];
+  ssize_t size = read(machine->fd, checksum, 2);
+  assert(size == 2);
+}
+
+static void expect_reply(struct machine *machine, const char *expected) {
+  char reply[1024];
+  read_reply(machine, reply);
+  assert(!strcmp(reply, expected));
+}
+
+void test_gdb_stub_registers_and_memory(void) {
+  struct machine machine;
+  machine_init(&machine, 0);
+  machine.core.cpu.regs.word[AX] = 0x1234;
+  machine.core.cpu.segs[SS] = 0x0050;
+  // eip is flat.
+  machine.core.cpu.segs[CS] = 0x0010;
+  machine.core.cpu.ip = 0x0000;
+  machine.core.memory[0x300] = 0xab;
+
+  send_packet(&machine, "qSupported:multiprocess+");
+  send_packet(&machine, "?");
+  send_packet(&machine, "p8");
+  send_packet(&machine, "g");
+  send_packet(&machine, "P3=cdab0000");
+  send_packet(&machine, "m300,2");
+  send_packet(&machine, "M301,2:cdef");
+  send_packet(&machine, "m300,3");
+  send_packet(&machine, "m20000,1");
+  send_packet(&machine, "P8=00020000");
+  send_packet(&machine, "P8=45230100");
+  send_packet(&machine, "vMustReplyEmpty");
+  send_packet(&machine, "D");
+
+  bool detached = gdb_stub_serve(&machine.stub);
+  assert(detached);
+
+  char reply[1024];
+  read_reply(&machine, reply);
+  assert(!strncmp(reply, "PacketSize=", 11));
+  assert(!strstr(reply, "ReverseStep"));
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "00010000");
+  read_reply(&machine, reply);
+  assert(strlen(reply) == 16 * 8);
+  assert(!strncmp(reply, "34120000", 8));
+  assert(!strncmp(reply + 10 * 8, "10000000", 8));
+  assert(!strncmp(reply + 11 * 8, "50000000", 8));
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "ab00");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "abcdef");
+  expect_reply(&machine, "E01");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "");
+  expect_reply(&machine, "OK");
+
+  assert(machine.core.cpu.regs.word[BX] == 0xabcd);
+  // 0x12345 is outside of segment 0x0010.
+  assert(machine.core.cpu.segs[CS] == 0x1234 && machine.core.cpu.ip == 0x0005);
+  assert(machine.core.bus.dirty_pages[0] & 1);
+
+  machine_destroy(&machine);
+}
+
+void test_gdb_stub_breakpoints(void) {
+  struct machine machine;
+  machine_init(&machine, 0);
+
+  send_packet(&machine, "Z0,101,1");
+  send_packet(&machine, "c");
+  send_packet(&machine, "p0");
+  send_packet(&machine, "c");
+  send_packet(&machine, "p0");
+  send_packet(&machine, "z0,101,1");
+  send_packet(&machine, "s");
+  send_packet(&machine, "p8");
+  // Stopped by the debugger.
+  send_packet(&machine, "c");
+  ssize_t written = write(machine.fd, "\x03", 1);
+  assert(written == 1);
+  send_packet(&machine, "D");
+
+  bool detached = gdb_stub_serve(&machine.stub);
+  assert(detached);
+
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "01000000");
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "02000000");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "04010000");
+  expect_reply(&machine, "S02");
+  expect_reply(&machine, "OK");
+
+  assert(!machine.stub.debug.breakpoint_count);
+
+  machine_destroy(&machine);
+}
+
+void test_gdb_stub_watchpoints(void) {
+  struct machine machine;
+  machine_init(&machine, 0);
+
+  send_packet(&machine, "QStartNoAckMode");
+  send_packet(&machine, "Z2,201,1");
+  send_packet(&machine, "c");
+  send_packet(&machine, "p8");
+  send_packet(&machine, "z2,201,1");
+  send_packet(&machine, "Z3,200,2");
+  send_packet(&machine, "c");
+  send_packet(&machine, "p8");
+  send_packet(&machine, "z3,200,2");
+  send_packet(&machine, "Z4,200,1");
+  send_packet(&machine, "c");
+  send_packet(&machine, "p8");
+  send_packet(&machine, "z4,200,1");
+  send_packet(&machine, "k");
+
+  // Each run stops after the instruction that made the access.
+  bool detached = gdb_stub_serve(&machine.stub);
+  assert(!detached);
+
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "T05watch:201;");
+  expect_reply(&machine, "04010000");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "T05rwatch:200;");
+  expect_reply(&machine, "08010000");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "OK");
+  expect_reply(&machine, "T05awatch:200;");
+  expect_reply(&machine, "04010000");
+  expect_reply(&machine, "OK");
+
+  // No acknowledgement after the first packet.
+  char c;
+  ssize_t size = recv(machine.fd, &c, 1, MSG_DONTWAIT);
+  assert(size < 0);
+  assert(!machine.stub.debug.stopper_count);
+  assert(!machine.core.bus.observer_slots);
+
+  machine_destroy(&machine);
+}
+
+void test_gdb_stub_reverse_step(void) {
+  struct checkpoints checkpoints;
+  struct machine machine;
+  machine_init(&machine, &checkpoints);
+  checkpoints_init(&checkpoints, &machine.core.cpu, 0, 1 << 20);
+  checkpoints_take(&checkpoints);
+
+  send_packet(&machine, "qSupported");
+  send_packet(&machine, "bs");
+  send_packet(&machine, "s");
+  send_packet(&machine, "s");
+  send_packet(&machine, "bs");
+  send_packet(&machine, "p8");
+  send_packet(&machine, "D");
+
+  bool detached = gdb_stub_serve(&machine.stub);
+  assert(detached);
+
+  char reply[1024];
+  read_reply(&machine, reply);
+  assert(strstr(reply, "ReverseStep+"));
+  expect_reply(&machine, "T05replaylog:begin;");
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "01010000");
+
+  checkpoints_destroy(&checkpoints);
+  machine_destroy(&machine);
+}
+
+void test_gdb_stub_program_exit(void) {
+  struct machine machine;
+  machine_init(&machine, 0);
+
+  bool exited = false;
+  u8 exit_code = 3;
+  gdb_stub_report_exit(&machine.stub, &exited, &exit_code);
+
+  send_packet(&machine, "s");
+  send_packet(&machine, "p8");
+  send_packet(&machine, "k");
+
+  bool detached = gdb_stub_serve(&machine.stub);
+  assert(!detached);
+  expect_reply(&machine, "S05");
+  expect_reply(&machine, "01010000");
+
+  // Continuing a program that ended reports its exit instead of running forever.
+  exited = true;
+  send_packet(&machine, "c");
+  send_packet(&machine, "?");
+  send_packet(&machine, "k");
+
+  detached = gdb_stub_serve(&machine.stub);
+  assert(!detached);
+  expect_reply(&machine, "W03");
+  expect_reply(&machine, "W03");
+
+  machine_destroy(&machine);
+}
+
+void test_gdb_stub_connection_lost(void) {
+  struct machine machine;
+  machine_init(&machine, 0);
+
+  send_packet(&machine, "c");
+  shutdown(machine.fd, SHUT_WR);
+
+  bool detached = gdb_stub_serve(&machine.stub);
+  assert(!detached);
+
+  machine_destroy(&machine);
+}
+
+void gdb_stub_tests(void) {
+  test_gdb_stub_registers_and_memory();
+  test_gdb_stub_breakpoints();
+  test_gdb_stub_watchpoints();
+  test_gdb_stub_reverse_step();
+  test_gdb_stub_program_exit();
+  test_gdb_stub_connection_lost();
+}
@@ -0,0 +1,6 @@
+void gdb_stub_tests(void);
+
+int main(int argc, char **argv) {
+  gdb_stub_tests();
+  return 0;
+}
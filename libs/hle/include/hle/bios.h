@@ -0,0 +1,89 @@
+#ifndef HLE_BIOS_H_
+#define HLE_BIOS_H_
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <stdbool.h>
+
+// High level emulation of the BIOS video (INT 10h), disk (INT 13h) and keyboard (INT 16h)
+// services, for guests whose output is all that matters.
+//
+// Text written to the screen is appended to a host buffer instead of going to video memory. Disks
+// are image files on the host, read and written with pread and pwrite. Keys come from a queue the
+// host fills. A guest waiting for a key with an empty queue executes the INT instruction again
+// until the host provides one.
+
+#define BIOS_KEY_QUEUE_SIZE 64
+#define BIOS_DISK_COUNT 2
+#define BIOS_SECTOR_SIZE 512
+
+#define BIOS_SCREEN_COLUMNS 80
+#define BIOS_SCREEN_ROWS 25
+
+enum bios_services {
+  bs_video = 0x01,
+  bs_disk = 0x02,
+  bs_keyboard = 0x04,
+};
+
+// INT 13h status codes returned in AH.
+enum bios_disk_status {
+  bds_ok = 0x00,
+  bds_invalid_function = 0x01,
+  bds_sector_not_found = 0x04,
+  bds_write_fault = 0xcc,
+  bds_not_ready = 0x80,
+};
+
+struct bios_disk {
+  // Host image file, -1 when no disk is attached.
+  int fd;
+
+  u16 cylinders;
+  u8 heads;
+  u8 sectors;
+};
+
+struct bios {
+  struct cpu *cpu;
+
+  // Characters written through INT 10h. Once `output_size` reaches `output_capacity`, further output
+  // is dropped until the host empties the buffer.
+  u8 *output;
+  u32 output_size;
+  u32 output_capacity;
+
+  u8 video_mode;
+  u8 cursor_row;
+  u8 cursor_column;
+
+  // Floppy drive A: and the first hard disk, drive numbers 00h and 80h.
+  struct bios_disk disks[BIOS_DISK_COUNT];
+  u8 disk_status;
+
+  // Scan code in the high byte and character in the low byte, like INT 16h returns them.
+  u16 keys[BIOS_KEY_QUEUE_SIZE];
+  unsigned key_head;
+  unsigned key_count;
+};
+
+// Install hooks for the given `bios_services` on the cpu. Video output goes to `output`.
+void bios_init(struct bios *bios, struct cpu *cpu, unsigned services, u8 *output,
+               u32 output_capacity);
+
+// Remove the hooks. Disk images stay open, they belong to the host.
+void bios_destroy(struct bios *bios);
+
+// Attach the image file `fd` as drive 00h or 80h. The geometry of floppies is derived from the
+// size of standard formats, anything else is a hard disk with 16 heads and 63 sectors per track.
+// Return false if there is no such drive or the size of the image can not be read.
+bool bios_attach_disk(struct bios *bios, u8 drive, int fd);
+
+// Queue a key, return false if the queue is full.
+bool bios_push_key(struct bios *bios, u16 key);
+
+// Queue the characters of `text` with the scan codes of a US keyboard. Return the number of
+// characters queued.
+unsigned bios_push_text(struct bios *bios, const char *text);
+
+#endif // HLE_BIOS_H_
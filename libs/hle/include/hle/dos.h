@@ -0,0 +1,80 @@
+#ifndef HLE_DOS_H_
+#define HLE_DOS_H_
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+#include <loader/loader.h>
+#include <stdbool.h>
+
+// High level emulation of the DOS services on INT 20h and INT 21h.
+//
+// The calls are serviced natively by the host when the guest executes the INT instruction, so no
+// DOS has to be booted and file I/O does not go through an emulated disk. Files are opened in a
+// sandbox directory on the host. Drive letters are ignored, backslashes become slashes, names are
+// lowercased and paths leaving the sandbox with ".." are refused. Symbolic links are never
+// followed, so they cannot lead out of the sandbox either.
+//
+// Memory is managed in a native list of blocks over the memory given to the program by the loader.
+// There are no memory control blocks in guest memory.
+
+#define DOS_MAX_HANDLES 20
+#define DOS_MAX_MEMORY_BLOCKS 32
+
+// Version reported by function 30h.
+#define DOS_VERSION_MAJOR 3
+#define DOS_VERSION_MINOR 30
+
+enum dos_error {
+  de_invalid_function = 0x01,
+  de_file_not_found = 0x02,
+  de_path_not_found = 0x03,
+  de_too_many_open_files = 0x04,
+  de_access_denied = 0x05,
+  de_invalid_handle = 0x06,
+  de_insufficient_memory = 0x08,
+  de_invalid_block = 0x09,
+  de_invalid_access = 0x0c,
+};
+
+struct dos_memory_block {
+  u16 segment;
+  u16 paragraphs;
+};
+
+struct dos {
+  struct cpu *cpu;
+
+  // Host directory the guest's files live in.
+  int root_fd;
+
+  // Host file descriptors of the DOS handles, -1 for a closed handle. Handles 0 to 4 start out on
+  // the console. Only the descriptors in `owned_handles` were opened for the guest and are closed on
+  // the host.
+  int handles[DOS_MAX_HANDLES];
+  u32 owned_handles;
+  // Device information word of IOCTL 4400h for the handles on the console, 0 for files.
+  u16 device_info[DOS_MAX_HANDLES];
+
+  u16 psp_segment;
+  struct address dta;
+
+  // Allocated blocks, sorted by segment, and the memory they are allocated from.
+  struct dos_memory_block blocks[DOS_MAX_MEMORY_BLOCKS];
+  unsigned block_count;
+  u16 memory_start;
+  u16 memory_end;
+
+  bool terminated;
+  u8 exit_code;
+};
+
+// Install the INT 20h and INT 21h hooks for the program the loader just loaded. `root_fd` is an
+// open directory serving as the guest's drive, the console uses the host's `console_in` and
+// `console_out` descriptors.
+void dos_init(struct dos *dos, struct cpu *cpu, const struct loader_program *program, int root_fd,
+              int console_in, int console_out);
+
+// Close all the files the guest left open.
+void dos_destroy(struct dos *dos);
+
+#endif // HLE_DOS_H_
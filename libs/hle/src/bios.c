@@ -0,0 +1,382 @@
+#include "hle/bios.h"
+
+#include "guest.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Video mode 03h, 80x25 color text.
+#define BIOS_DEFAULT_VIDEO_MODE 0x03
+
+// Rows of a US keyboard, unshifted and shifted, with the scan code of their first key.
+static const struct {
+  u8 first_scan_code;
+  const char *keys;
+} keyboard_rows[] = {
+    {0x02, "1234567890-="}, {0x10, "qwertyuiop[]"}, {0x1e, "asdfghjkl;'`"}, {0x2b, "\\zxcvbnm,./"},
+    {0x02, "!@#$%^&*()_+"}, {0x10, "QWERTYUIOP{}"}, {0x1e, "ASDFGHJKL:\"~"}, {0x2b, "|ZXCVBNM<>?"},
+};
+
+static void bios_output(struct bios *bios, u8 c) {
+  if (bios->output_size < bios->output_capacity) {
+    bios->output[bios->output_size++] = c;
+  }
+}
+
+static void bios_teletype(struct bios *bios, u8 c) {
+  bios_output(bios, c);
+
+  switch (c) {
+    case '\r':
+      bios->cursor_column = 0;
+      return;
+
+    case '\n':
+      break;
+
+    case '\b':
+      if (bios->cursor_column) {
+        --bios->cursor_column;
+      }
+      return;
+
+    case 0x07:
+      // Bell.
+      return;
+
+    default:
+      if (++bios->cursor_column < BIOS_SCREEN_COLUMNS) {
+        return;
+      }
+      bios->cursor_column = 0;
+      break;
+  }
+
+  // The screen scrolls instead of the cursor moving past the last row.
+  if (bios->cursor_row < BIOS_SCREEN_ROWS - 1) {
+    ++bios->cursor_row;
+  }
+}
+
+static bool bios_int10(void *context, struct cpu *cpu, u8 vector) {
+  UNUSED(vector);
+
+  struct bios *bios = context;
+
+  switch (cpu->regs.byte[AH]) {
+    case 0x00:
+      bios->video_mode = cpu->regs.byte[AL] & 0x7f;
+      bios->cursor_row = 0;
+      bios->cursor_column = 0;
+      break;
+
+    case 0x02:
+      bios->cursor_row = cpu->regs.byte[DH];
+      bios->cursor_column = cpu->regs.byte[DL];
+      break;
+
+    case 0x03:
+      cpu->regs.byte[DH] = bios->cursor_row;
+      cpu->regs.byte[DL] = bios->cursor_column;
+      cpu->regs.word[CX] = 0x0607;
+      break;
+
+    case 0x09:
+    case 0x0a:
+      // Written at the cursor without moving it.
+      for (u16 i = 0; i < cpu->regs.word[CX]; ++i) {
+        bios_output(bios, cpu->regs.byte[AL]);
+      }
+      break;
+
+    case 0x0e:
+      bios_teletype(bios, cpu->regs.byte[AL]);
+      break;
+
+    case 0x0f:
+      cpu->regs.byte[AL] = bios->video_mode;
+      cpu->regs.byte[AH] = BIOS_SCREEN_COLUMNS;
+      cpu->regs.byte[BH] = 0;
+      break;
+
+    default:
+      // Nothing to do without a screen.
+      break;
+  }
+
+  return true;
+}
+
+// Floppy drives come first in `disks`, followed by the hard disks.
+static unsigned bios_disk_index(u8 drive) {
+  return drive & 0x80 ? BIOS_DISK_COUNT / 2 + (drive & 0x7f) : drive;
+}
+
+static struct bios_disk *bios_disk(struct bios *bios, u8 drive) {
+  unsigned index = bios_disk_index(drive);
+  if (index >= BIOS_DISK_COUNT || bios->disks[index].fd < 0) {
+    return 0;
+  }
+
+  return &bios->disks[index];
+}
+
+static void bios_disk_done(struct bios *bios, struct cpu *cpu, enum bios_disk_status status) {
+  bios->disk_status = status;
+  cpu->regs.byte[AH] = status;
+  cpu->flags.carry = status != bds_ok;
+}
+
+// Functions 02h and 03h.
+static enum bios_disk_status bios_disk_transfer(struct bios *bios, struct cpu *cpu,
+                                                struct bios_disk *disk, bool write) {
+  u8 count = cpu->regs.byte[AL];
+  u16 cylinder = cpu->regs.byte[CH] | ((cpu->regs.byte[CL] & 0xc0) << 2);
+  u8 sector = cpu->regs.byte[CL] & 0x3f;
+  u8 head = cpu->regs.byte[DH];
+
+  cpu->regs.byte[AL] = 0;
+
+  if (!sector || sector > disk->sectors || head >= disk->heads || cylinder >= disk->cylinders) {
+    return bds_sector_not_found;
+  }
+
+  u32 lba = ((u32)cylinder * disk->heads + head) * disk->sectors + sector - 1;
+  u32 addr = guest_address(cpu->segs[ES], cpu->regs.word[BX]);
+
+  for (u8 i = 0; i < count; ++i) {
+    u8 buffer[BIOS_SECTOR_SIZE];
+    off_t offset = (off_t)(lba + i) * BIOS_SECTOR_SIZE;
+    u32 sector_addr = addr + i * BIOS_SECTOR_SIZE;
+
+    if (write) {
+      guest_read(cpu->bus, sector_addr, buffer, sizeof(buffer));
+      if (pwrite(disk->fd, buffer, sizeof(buffer), offset) != sizeof(buffer)) {
+        return bds_write_fault;
+      }
+    } else {
+      if (pread(disk->fd, buffer, sizeof(buffer), offset) != sizeof(buffer)) {
+        return bds_sector_not_found;
+      }
+      guest_write(cpu->bus, sector_addr, buffer, sizeof(buffer));
+    }
+
+    ++cpu->regs.byte[AL];
+  }
+
+  return bds_ok;
+}
+
+static bool bios_int13(void *context, struct cpu *cpu, u8 vector) {
+  UNUSED(vector);
+
+  struct bios *bios = context;
+  u8 function = cpu->regs.byte[AH];
+
+  if (function == 0x01) {
+    cpu->regs.byte[AL] = bios->disk_status;
+    bios_disk_done(bios, cpu, bds_ok);
+    return true;
+  }
+
+  struct bios_disk *disk = bios_disk(bios, cpu->regs.byte[DL]);
+  if (!disk) {
+    bios_disk_done(bios, cpu, bds_not_ready);
+    return true;
+  }
+
+  switch (function) {
+    case 0x00:
+      bios_disk_done(bios, cpu, bds_ok);
+      break;
+
+    case 0x02:
+    case 0x03:
+      bios_disk_done(bios, cpu, bios_disk_transfer(bios, cpu, disk, function == 0x03));
+      break;
+
+    case 0x08: {
+      u16 last_cylinder = disk->cylinders - 1;
+      cpu->regs.byte[CH] = last_cylinder & 0xff;
+      cpu->regs.byte[CL] = disk->sectors | ((last_cylinder >> 2) & 0xc0);
+      cpu->regs.byte[DH] = disk->heads - 1;
+      // There is one drive of each kind.
+      cpu->regs.byte[DL] = 1;
+      cpu->regs.byte[BL] = 0;
+      bios_disk_done(bios, cpu, bds_ok);
+      break;
+    }
+
+    default:
+      bios_disk_done(bios, cpu, bds_invalid_function);
+      break;
+  }
+
+  return true;
+}
+
+static bool bios_int16(void *context, struct cpu *cpu, u8 vector) {
+  UNUSED(vector);
+
+  struct bios *bios = context;
+
+  switch (cpu->regs.byte[AH]) {
+    case 0x00:
+    case 0x10:
+      if (!bios->key_count) {
+        // Wait by executing the INT instruction again.
+        cpu->ip -= 2;
+        break;
+      }
+      cpu->regs.word[AX] = bios->keys[bios->key_head];
+      bios->key_head = (bios->key_head + 1) % BIOS_KEY_QUEUE_SIZE;
+      --bios->key_count;
+      break;
+
+    case 0x01:
+    case 0x11:
+      cpu->flags.zero = !bios->key_count;
+      if (bios->key_count) {
+        cpu->regs.word[AX] = bios->keys[bios->key_head];
+      }
+      break;
+
+    case 0x02:
+      // No shift keys are ever held.
+      cpu->regs.byte[AL] = 0;
+      break;
+
+    default:
+      break;
+  }
+
+  return true;
+}
+
+void bios_init(struct bios *bios, struct cpu *cpu, unsigned services, u8 *output,
+               u32 output_capacity) {
+  memset(bios, 0, sizeof(*bios));
+
+  bios->cpu = cpu;
+  bios->output = output;
+  bios->output_capacity = output_capacity;
+  bios->video_mode = BIOS_DEFAULT_VIDEO_MODE;
+
+  for (unsigned i = 0; i < BIOS_DISK_COUNT; ++i) {
+    bios->disks[i].fd = -1;
+  }
+
+  if (services & bs_video) {
+    cpu_set_interrupt_hook(cpu, 0x10, bios, bios_int10);
+  }
+  if (services & bs_disk) {
+    cpu_set_interrupt_hook(cpu, 0x13, bios, bios_int13);
+  }
+  if (services & bs_keyboard) {
+    cpu_set_interrupt_hook(cpu, 0x16, bios, bios_int16);
+  }
+}
+
+void bios_destroy(struct bios *bios) {
+  static const u8 vectors[] = {0x10, 0x13, 0x16};
+
+  for (unsigned i = 0; i < ARRAY_SIZE(vectors); ++i) {
+    if (bios->cpu->interrupt_hooks[vectors[i]].context == bios) {
+      cpu_set_interrupt_hook(bios->cpu, vectors[i], 0, 0);
+    }
+  }
+}
+
+bool bios_attach_disk(struct bios *bios, u8 drive, int fd) {
+  static const struct {
+    u32 size;
+    u16 cylinders;
+    u8 heads;
+    u8 sectors;
+  } floppy_formats[] = {
+      {160 * 1024, 40, 1, 8},  {180 * 1024, 40, 1, 9},   {320 * 1024, 40, 2, 8},
+      {360 * 1024, 40, 2, 9},  {720 * 1024, 80, 2, 9},   {1200 * 1024, 80, 2, 15},
+      {1440 * 1024, 80, 2, 18}, {2880 * 1024, 80, 2, 36},
+  };
+
+  unsigned index = bios_disk_index(drive);
+  if (index >= BIOS_DISK_COUNT) {
+    return false;
+  }
+
+  struct stat status;
+  if (fstat(fd, &status) < 0) {
+    return false;
+  }
+
+  struct bios_disk *disk = &bios->disks[index];
+  disk->fd = fd;
+
+  for (unsigned i = 0; i < ARRAY_SIZE(floppy_formats); ++i) {
+    if (status.st_size == floppy_formats[i].size) {
+      disk->cylinders = floppy_formats[i].cylinders;
+      disk->heads = floppy_formats[i].heads;
+      disk->sectors = floppy_formats[i].sectors;
+      return true;
+    }
+  }
+
+  disk->heads = 16;
+  disk->sectors = 63;
+  u32 cylinders = status.st_size / (16 * 63 * BIOS_SECTOR_SIZE);
+  disk->cylinders = cylinders > 1024 ? 1024 : (cylinders ? cylinders : 1);
+
+  return true;
+}
+
+bool bios_push_key(struct bios *bios, u16 key) {
+  if (bios->key_count == BIOS_KEY_QUEUE_SIZE) {
+    return false;
+  }
+
+  bios->keys[(bios->key_head + bios->key_count) % BIOS_KEY_QUEUE_SIZE] = key;
+  ++bios->key_count;
+
+  return true;
+}
+
+static u8 scan_code(char c) {
+  switch (c) {
+    case '\r':
+    case '\n':
+      return 0x1c;
+    case '\b':
+      return 0x0e;
+    case '\t':
+      return 0x0f;
+    case 0x1b:
+      return 0x01;
+    case ' ':
+      return 0x39;
+    default:
+      break;
+  }
+
+  for (unsigned i = 0; i < ARRAY_SIZE(keyboard_rows); ++i) {
+    const char *key = strchr(keyboard_rows[i].keys, c);
+    if (key && c) {
+      return keyboard_rows[i].first_scan_code + (u8)(key - keyboard_rows[i].keys);
+    }
+  }
+
+  return 0;
+}
+
+unsigned bios_push_text(struct bios *bios, const char *text) {
+  unsigned count = 0;
+
+  for (; *text; ++text, ++count) {
+    u8 c = *text == '\n' ? '\r' : (u8)*text;
+    if (!bios_push_key(bios, (scan_code(*text) << 8) | c)) {
+      break;
+    }
+  }
+
+  return count;
+}
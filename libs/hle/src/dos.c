@@ -0,0 +1,843 @@
+#include "hle/dos.h"
+
+#include "guest.h"
+
+#include <cpu/replay.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Longest path DOS accepts, including the terminating 0.
+#define DOS_MAX_PATH 128
+
+// Size of the host buffer file data is moved through.
+#define DOS_TRANSFER_CHUNK 0x1000
+
+#define DOS_DEFAULT_DRIVE 2 // C:
+#define DOS_DRIVE_COUNT 3
+
+// Device information word of function 4400h.
+#define DOS_DEVICE_IS_DEVICE 0x80
+#define DOS_DEVICE_IS_STDIN 0x01
+#define DOS_DEVICE_IS_STDOUT 0x02
+
+static void dos_fail(struct cpu *cpu, enum dos_error error) {
+  cpu->flags.carry = 1;
+  cpu->regs.word[AX] = error;
+}
+
+static void dos_succeed(struct cpu *cpu) {
+  cpu->flags.carry = 0;
+}
+
+static enum dos_error dos_error_from_errno(int error) {
+  switch (error) {
+    case ENOENT:
+      return de_file_not_found;
+
+    case ENOTDIR:
+    case ENAMETOOLONG:
+      return de_path_not_found;
+
+    case EMFILE:
+    case ENFILE:
+      return de_too_many_open_files;
+
+    case EBADF:
+      return de_invalid_handle;
+
+    default:
+      return de_access_denied;
+  }
+}
+
+static void dos_terminate(struct dos *dos, u8 exit_code) {
+  dos->terminated = true;
+  dos->exit_code = exit_code;
+
+  // Nothing runs after the program, not even interrupts.
+  dos->cpu->halted = true;
+  dos->cpu->flags.interrupt = 0;
+}
+
+// Read the ASCIIZ path at `addr` and turn it into a path relative to the sandbox. Return false if
+// it is empty or leaves the sandbox.
+static bool dos_host_path(struct dos *dos, u32 addr, char *path) {
+  char raw[DOS_MAX_PATH];
+  guest_read(dos->cpu->bus, addr, raw, sizeof(raw));
+  raw[sizeof(raw) - 1] = 0;
+
+  const char *in = raw;
+  if (in[0] && in[1] == ':') {
+    in += 2;
+  }
+  while (*in == '\\' || *in == '/') {
+    ++in;
+  }
+
+  char *out = path;
+  for (; *in; ++in) {
+    *out++ = *in == '\\' ? '/' : (char)tolower((unsigned char)*in);
+  }
+  *out = 0;
+
+  if (!path[0]) {
+    return false;
+  }
+
+  for (const char *component = path; component; component = strchr(component, '/')) {
+    if (*component == '/') {
+      ++component;
+    }
+    if (component[0] == '.' && component[1] == '.' && (!component[2] || component[2] == '/')) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Open the directory holding the last component of `path` without following symbolic links, so
+// that no link leads out of the sandbox, and point `name` at that component. Return -1 and leave
+// the error in errno on failure.
+static int dos_open_parent(struct dos *dos, char *path, const char **name) {
+  int dir = dup(dos->root_fd);
+
+  char *component = path;
+  for (char *slash; dir >= 0 && (slash = strchr(component, '/')); component = slash + 1) {
+    *slash = 0;
+    if (!*component) {
+      continue;
+    }
+
+    int next = openat(dir, component, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    int error = errno;
+    close(dir);
+    errno = error;
+    dir = next;
+  }
+
+  *name = component;
+  return dir;
+}
+
+// Give the guest a handle on `fd`, a host descriptor it owns, which is a file unless
+// `device_info` says otherwise.
+static int dos_allocate_handle(struct dos *dos, int fd, u16 device_info) {
+  for (int handle = 0; handle < DOS_MAX_HANDLES; ++handle) {
+    if (dos->handles[handle] < 0) {
+      dos->handles[handle] = fd;
+      dos->owned_handles |= 1u << handle;
+      dos->device_info[handle] = device_info;
+      return handle;
+    }
+  }
+
+  return -1;
+}
+
+// Return the host descriptor of the handle in BX, or fail the call and return -1.
+static int dos_handle_fd(struct dos *dos) {
+  u16 handle = dos->cpu->regs.word[BX];
+  if (handle >= DOS_MAX_HANDLES || dos->handles[handle] < 0) {
+    dos_fail(dos->cpu, de_invalid_handle);
+    return -1;
+  }
+
+  return dos->handles[handle];
+}
+
+static void dos_open(struct dos *dos, int flags) {
+  struct cpu *cpu = dos->cpu;
+
+  char path[DOS_MAX_PATH];
+  if (!dos_host_path(dos, guest_address(cpu->segs[DS], cpu->regs.word[DX]), path)) {
+    dos_fail(cpu, de_path_not_found);
+    return;
+  }
+
+  const char *name;
+  int dir = dos_open_parent(dos, path, &name);
+  if (dir < 0) {
+    dos_fail(cpu, dos_error_from_errno(errno));
+    return;
+  }
+
+  int fd = openat(dir, name, flags | O_NOFOLLOW, 0666);
+  int error = errno;
+  close(dir);
+  if (fd < 0) {
+    dos_fail(cpu, dos_error_from_errno(error));
+    return;
+  }
+
+  int handle = dos_allocate_handle(dos, fd, 0);
+  if (handle < 0) {
+    close(fd);
+    dos_fail(cpu, de_too_many_open_files);
+    return;
+  }
+
+  cpu->regs.word[AX] = handle;
+  dos_succeed(cpu);
+}
+
+static void dos_close(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int fd = dos_handle_fd(dos);
+  if (fd < 0) {
+    return;
+  }
+
+  u16 handle = cpu->regs.word[BX];
+  if (dos->owned_handles & (1u << handle)) {
+    close(fd);
+  }
+  dos->handles[handle] = -1;
+  dos->owned_handles &= ~(1u << handle);
+  dos->device_info[handle] = 0;
+
+  dos_succeed(cpu);
+}
+
+static void dos_read(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int fd = dos_handle_fd(dos);
+  if (fd < 0) {
+    return;
+  }
+
+  u32 addr = guest_address(cpu->segs[DS], cpu->regs.word[DX]);
+  u16 count = cpu->regs.word[CX];
+  u16 total = 0;
+
+  while (total < count) {
+    u8 buffer[DOS_TRANSFER_CHUNK];
+    size_t remaining = (size_t)(count - total);
+    size_t wanted = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+
+    ssize_t bytes_read = read(fd, buffer, wanted);
+    if (bytes_read < 0) {
+      dos_fail(cpu, dos_error_from_errno(errno));
+      return;
+    }
+
+    guest_write(cpu->bus, addr + total, buffer, bytes_read);
+    total += bytes_read;
+
+    // End of file, or the end of a line on the console.
+    if ((size_t)bytes_read < wanted) {
+      break;
+    }
+  }
+
+  cpu->regs.word[AX] = total;
+  dos_succeed(cpu);
+}
+
+static void dos_write(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int fd = dos_handle_fd(dos);
+  if (fd < 0) {
+    return;
+  }
+
+  u32 addr = guest_address(cpu->segs[DS], cpu->regs.word[DX]);
+  u16 count = cpu->regs.word[CX];
+
+  // Writing nothing truncates the file at the current position.
+  if (!count) {
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    if (position >= 0 && ftruncate(fd, position) < 0) {
+      dos_fail(cpu, dos_error_from_errno(errno));
+      return;
+    }
+    cpu->regs.word[AX] = 0;
+    dos_succeed(cpu);
+    return;
+  }
+
+  u16 total = 0;
+  while (total < count) {
+    u8 buffer[DOS_TRANSFER_CHUNK];
+    size_t remaining = (size_t)(count - total);
+    size_t wanted = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+    guest_read(cpu->bus, addr + total, buffer, wanted);
+
+    ssize_t bytes_written = write(fd, buffer, wanted);
+    if (bytes_written < 0) {
+      dos_fail(cpu, dos_error_from_errno(errno));
+      return;
+    }
+
+    total += bytes_written;
+    if ((size_t)bytes_written < wanted) {
+      // The disk is full.
+      break;
+    }
+  }
+
+  cpu->regs.word[AX] = total;
+  dos_succeed(cpu);
+}
+
+static void dos_seek(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int fd = dos_handle_fd(dos);
+  if (fd < 0) {
+    return;
+  }
+
+  static const int whences[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+  u8 method = cpu->regs.byte[AL];
+  if (method >= ARRAY_SIZE(whences)) {
+    dos_fail(cpu, de_invalid_function);
+    return;
+  }
+
+  i32 offset = (i32)(((u32)cpu->regs.word[CX] << 16) | cpu->regs.word[DX]);
+  off_t position = lseek(fd, offset, whences[method]);
+  if (position < 0) {
+    dos_fail(cpu, dos_error_from_errno(errno));
+    return;
+  }
+
+  cpu->regs.word[AX] = position & 0xffff;
+  cpu->regs.word[DX] = (position >> 16) & 0xffff;
+  dos_succeed(cpu);
+}
+
+static void dos_ioctl(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int fd = dos_handle_fd(dos);
+  if (fd < 0) {
+    return;
+  }
+
+  u16 handle = cpu->regs.word[BX];
+
+  switch (cpu->regs.byte[AL]) {
+    case 0x00:
+      cpu->regs.word[DX] =
+          dos->device_info[handle] ? dos->device_info[handle] : DOS_DEFAULT_DRIVE;
+      dos_succeed(cpu);
+      break;
+
+    case 0x01:
+      // Device information can be set but changes nothing.
+      dos_succeed(cpu);
+      break;
+
+    default:
+      dos_fail(cpu, de_invalid_function);
+      break;
+  }
+}
+
+static void dos_duplicate_handle(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int fd = dos_handle_fd(dos);
+  if (fd < 0) {
+    return;
+  }
+
+  int duplicate = dup(fd);
+  if (duplicate < 0) {
+    dos_fail(cpu, dos_error_from_errno(errno));
+    return;
+  }
+
+  // A duplicate is on the same file or device as the original.
+  int handle = dos_allocate_handle(dos, duplicate, dos->device_info[cpu->regs.word[BX]]);
+  if (handle < 0) {
+    close(duplicate);
+    dos_fail(cpu, de_too_many_open_files);
+    return;
+  }
+
+  cpu->regs.word[AX] = handle;
+  dos_succeed(cpu);
+}
+
+static void dos_delete(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  char path[DOS_MAX_PATH];
+  if (!dos_host_path(dos, guest_address(cpu->segs[DS], cpu->regs.word[DX]), path)) {
+    dos_fail(cpu, de_path_not_found);
+    return;
+  }
+
+  const char *name;
+  int dir = dos_open_parent(dos, path, &name);
+  if (dir < 0) {
+    dos_fail(cpu, dos_error_from_errno(errno));
+    return;
+  }
+
+  int result = unlinkat(dir, name, 0);
+  int error = errno;
+  close(dir);
+  if (result < 0) {
+    dos_fail(cpu, dos_error_from_errno(error));
+    return;
+  }
+
+  dos_succeed(cpu);
+}
+
+static int dos_find_block(struct dos *dos, u16 segment) {
+  for (unsigned i = 0; i < dos->block_count; ++i) {
+    if (dos->blocks[i].segment == segment) {
+      return (int)i;
+    }
+  }
+
+  return -1;
+}
+
+// First segment after block `index`, up to which it could grow.
+static u16 dos_block_limit(struct dos *dos, unsigned index) {
+  return index + 1 < dos->block_count ? dos->blocks[index + 1].segment : dos->memory_end;
+}
+
+static void dos_allocate(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+  u16 wanted = cpu->regs.word[BX];
+
+  u16 largest = 0;
+  u16 start = dos->memory_start;
+
+  for (unsigned i = 0; i <= dos->block_count; ++i) {
+    u16 end = i < dos->block_count ? dos->blocks[i].segment : dos->memory_end;
+    u16 gap = end - start;
+
+    if (gap >= wanted && dos->block_count < DOS_MAX_MEMORY_BLOCKS) {
+      memmove(&dos->blocks[i + 1], &dos->blocks[i], (dos->block_count - i) * sizeof(*dos->blocks));
+      dos->blocks[i].segment = start;
+      dos->blocks[i].paragraphs = wanted;
+      ++dos->block_count;
+
+      cpu->regs.word[AX] = start;
+      dos_succeed(cpu);
+      return;
+    }
+
+    if (gap > largest) {
+      largest = gap;
+    }
+
+    if (i < dos->block_count) {
+      start = dos->blocks[i].segment + dos->blocks[i].paragraphs;
+    }
+  }
+
+  dos_fail(cpu, de_insufficient_memory);
+  cpu->regs.word[BX] = largest;
+}
+
+static void dos_free(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int index = dos_find_block(dos, cpu->segs[ES]);
+  if (index < 0) {
+    dos_fail(cpu, de_invalid_block);
+    return;
+  }
+
+  --dos->block_count;
+  memmove(&dos->blocks[index], &dos->blocks[index + 1],
+          (dos->block_count - index) * sizeof(*dos->blocks));
+
+  dos_succeed(cpu);
+}
+
+static void dos_resize(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+
+  int index = dos_find_block(dos, cpu->segs[ES]);
+  if (index < 0) {
+    dos_fail(cpu, de_invalid_block);
+    return;
+  }
+
+  struct dos_memory_block *block = &dos->blocks[index];
+  u16 available = dos_block_limit(dos, index) - block->segment;
+  if (cpu->regs.word[BX] > available) {
+    dos_fail(cpu, de_insufficient_memory);
+    cpu->regs.word[BX] = available;
+    return;
+  }
+
+  block->paragraphs = cpu->regs.word[BX];
+  dos_succeed(cpu);
+}
+
+typedef u64 (*dos_host_func)(struct dos *dos);
+
+// Take an input from the host, unless it is replayed from a log.
+static u64 dos_host_input(struct dos *dos, enum replay_input input, dos_host_func func) {
+  struct replay *replay = dos->cpu->replay;
+  if (!replay) {
+    return func(dos);
+  }
+
+  u64 value;
+  if (replay_fetch(replay, input, 0, &value)) {
+    return value;
+  }
+  return replay_input(replay, input, 0, func(dos));
+}
+
+static u64 dos_host_console_ready(struct dos *dos) {
+  struct pollfd poll_fd = {
+      .fd = dos->handles[0],
+      .events = POLLIN,
+  };
+
+  return dos->handles[0] >= 0 && poll(&poll_fd, 1, 0) > 0;
+}
+
+// Read a character from standard input, end of file reads as Ctrl-Z.
+static u64 dos_host_console_read(struct dos *dos) {
+  u8 c;
+  if (dos->handles[0] < 0 || read(dos->handles[0], &c, 1) != 1) {
+    return 0x1a;
+  }
+
+  return c;
+}
+
+// Seconds since the epoch in the local time zone, so that a replay does not depend on the zone.
+static u64 dos_host_time(struct dos *dos) {
+  UNUSED(dos);
+
+  time_t now = time(0);
+  struct tm local;
+  localtime_r(&now, &local);
+  return (u64)(now + local.tm_gmtoff);
+}
+
+static bool dos_console_ready(struct dos *dos) {
+  return dos_host_input(dos, ri_console_ready, dos_host_console_ready);
+}
+
+static u8 dos_console_read(struct dos *dos) {
+  return (u8)dos_host_input(dos, ri_console_read, dos_host_console_read);
+}
+
+static void dos_console_write(struct dos *dos, const void *data, size_t size) {
+  if (dos->handles[1] >= 0) {
+    ssize_t result = write(dos->handles[1], data, size);
+    UNUSED(result);
+  }
+}
+
+// Function 0Ah. The buffer holds its size, receives the length of the line and then the line,
+// terminated by a carriage return that is not counted.
+static void dos_buffered_input(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+  u32 addr = guest_address(cpu->segs[DS], cpu->regs.word[DX]);
+
+  u8 size;
+  guest_read(cpu->bus, addr, &size, 1);
+  if (!size) {
+    return;
+  }
+
+  u8 line[0x100];
+  u8 length = 0;
+  for (;;) {
+    u8 c = dos_console_read(dos);
+    if (c == '\n' || c == 0x1a) {
+      break;
+    }
+    if (c != '\r' && length < size - 1) {
+      line[length++] = c;
+    }
+  }
+  line[length] = '\r';
+
+  guest_write(cpu->bus, addr + 1, &length, 1);
+  guest_write(cpu->bus, addr + 2, line, length + 1);
+}
+
+// Function 09h writes the string up to the first '$'.
+static void dos_print_string(struct dos *dos) {
+  struct cpu *cpu = dos->cpu;
+  u32 addr = guest_address(cpu->segs[DS], cpu->regs.word[DX]);
+
+  for (u32 total = 0; total < 0x10000;) {
+    char buffer[0x100];
+    guest_read(cpu->bus, addr + total, buffer, sizeof(buffer));
+
+    char *end = memchr(buffer, '$', sizeof(buffer));
+    dos_console_write(dos, buffer, end ? (size_t)(end - buffer) : sizeof(buffer));
+    if (end) {
+      break;
+    }
+
+    total += sizeof(buffer);
+  }
+
+  cpu->regs.byte[AL] = '$';
+}
+
+static void dos_date_time(struct dos *dos, u8 function) {
+  struct cpu *cpu = dos->cpu;
+
+  time_t now = (time_t)dos_host_input(dos, ri_host_time, dos_host_time);
+  struct tm local;
+  gmtime_r(&now, &local);
+
+  if (function == 0x2a) {
+    cpu->regs.word[CX] = local.tm_year + 1900;
+    cpu->regs.byte[DH] = local.tm_mon + 1;
+    cpu->regs.byte[DL] = local.tm_mday;
+    cpu->regs.byte[AL] = local.tm_wday;
+  } else {
+    cpu->regs.byte[CH] = local.tm_hour;
+    cpu->regs.byte[CL] = local.tm_min;
+    cpu->regs.byte[DH] = local.tm_sec;
+    cpu->regs.byte[DL] = 0;
+  }
+}
+
+static bool dos_int20(void *context, struct cpu *cpu, u8 vector) {
+  UNUSED(cpu);
+  UNUSED(vector);
+
+  dos_terminate(context, 0);
+  return true;
+}
+
+static bool dos_int21(void *context, struct cpu *cpu, u8 vector) {
+  UNUSED(vector);
+
+  struct dos *dos = context;
+  u8 function = cpu->regs.byte[AH];
+
+  switch (function) {
+    case 0x00:
+      dos_terminate(dos, 0);
+      break;
+
+    case 0x01: {
+      u8 c = dos_console_read(dos);
+      dos_console_write(dos, &c, 1);
+      cpu->regs.byte[AL] = c;
+      break;
+    }
+
+    case 0x02:
+      dos_console_write(dos, &cpu->regs.byte[DL], 1);
+      cpu->regs.byte[AL] = cpu->regs.byte[DL];
+      break;
+
+    case 0x06:
+      if (cpu->regs.byte[DL] != 0xff) {
+        dos_console_write(dos, &cpu->regs.byte[DL], 1);
+        cpu->regs.byte[AL] = cpu->regs.byte[DL];
+      } else if (dos_console_ready(dos)) {
+        cpu->regs.byte[AL] = dos_console_read(dos);
+        cpu->flags.zero = 0;
+      } else {
+        cpu->regs.byte[AL] = 0;
+        cpu->flags.zero = 1;
+      }
+      break;
+
+    case 0x07:
+    case 0x08:
+      cpu->regs.byte[AL] = dos_console_read(dos);
+      break;
+
+    case 0x09:
+      dos_print_string(dos);
+      break;
+
+    case 0x0a:
+      dos_buffered_input(dos);
+      break;
+
+    case 0x0b:
+      cpu->regs.byte[AL] = dos_console_ready(dos) ? 0xff : 0x00;
+      break;
+
+    case 0x0e:
+      cpu->regs.byte[AL] = DOS_DRIVE_COUNT;
+      break;
+
+    case 0x19:
+      cpu->regs.byte[AL] = DOS_DEFAULT_DRIVE;
+      break;
+
+    case 0x1a:
+      dos->dta = segment_offset(cpu->segs[DS], cpu->regs.word[DX]);
+      break;
+
+    case 0x25: {
+      u16 vector_entry[2] = {cpu->regs.word[DX], cpu->segs[DS]};
+      guest_write(cpu->bus, cpu->regs.byte[AL] * 4, vector_entry, sizeof(vector_entry));
+      break;
+    }
+
+    case 0x2a:
+    case 0x2c:
+      dos_date_time(dos, function);
+      break;
+
+    case 0x2f:
+      cpu->segs[ES] = dos->dta.segment;
+      cpu->regs.word[BX] = dos->dta.offset;
+      break;
+
+    case 0x30:
+      cpu->regs.byte[AL] = DOS_VERSION_MAJOR;
+      cpu->regs.byte[AH] = DOS_VERSION_MINOR;
+      cpu->regs.word[BX] = 0;
+      cpu->regs.word[CX] = 0;
+      break;
+
+    case 0x35: {
+      u16 vector_entry[2];
+      guest_read(cpu->bus, cpu->regs.byte[AL] * 4, vector_entry, sizeof(vector_entry));
+      cpu->regs.word[BX] = vector_entry[0];
+      cpu->segs[ES] = vector_entry[1];
+      break;
+    }
+
+    case 0x3c:
+      dos_open(dos, O_RDWR | O_CREAT | O_TRUNC);
+      break;
+
+    case 0x3d: {
+      static const int access_modes[] = {O_RDONLY, O_WRONLY, O_RDWR};
+      u8 access = cpu->regs.byte[AL] & 0x07;
+      if (access >= ARRAY_SIZE(access_modes)) {
+        dos_fail(cpu, de_invalid_access);
+        break;
+      }
+      dos_open(dos, access_modes[access]);
+      break;
+    }
+
+    case 0x3e:
+      dos_close(dos);
+      break;
+
+    case 0x3f:
+      dos_read(dos);
+      break;
+
+    case 0x40:
+      dos_write(dos);
+      break;
+
+    case 0x41:
+      dos_delete(dos);
+      break;
+
+    case 0x42:
+      dos_seek(dos);
+      break;
+
+    case 0x44:
+      dos_ioctl(dos);
+      break;
+
+    case 0x45:
+      dos_duplicate_handle(dos);
+      break;
+
+    case 0x47: {
+      // The current directory is always the root of the drive.
+      u8 empty = 0;
+      guest_write(cpu->bus, guest_address(cpu->segs[DS], cpu->regs.word[SI]), &empty, 1);
+      dos_succeed(cpu);
+      break;
+    }
+
+    case 0x48:
+      dos_allocate(dos);
+      break;
+
+    case 0x49:
+      dos_free(dos);
+      break;
+
+    case 0x4a:
+      dos_resize(dos);
+      break;
+
+    case 0x4c:
+      dos_terminate(dos, cpu->regs.byte[AL]);
+      break;
+
+    case 0x51:
+    case 0x62:
+      cpu->regs.word[BX] = dos->psp_segment;
+      break;
+
+    default:
+      dos_fail(cpu, de_invalid_function);
+      break;
+  }
+
+  return true;
+}
+
+void dos_init(struct dos *dos, struct cpu *cpu, const struct loader_program *program, int root_fd,
+              int console_in, int console_out) {
+  memset(dos, 0, sizeof(*dos));
+
+  dos->cpu = cpu;
+  dos->root_fd = root_fd;
+
+  for (unsigned i = 0; i < DOS_MAX_HANDLES; ++i) {
+    dos->handles[i] = -1;
+  }
+  // Standard input, output and error, then AUX and PRN, which also go to the console so that the
+  // first file gets handle 5 like on DOS.
+  dos->handles[0] = console_in;
+  dos->device_info[0] = DOS_DEVICE_IS_DEVICE | DOS_DEVICE_IS_STDIN;
+  for (unsigned i = 1; i < 5; ++i) {
+    dos->handles[i] = console_out;
+    dos->device_info[i] = DOS_DEVICE_IS_DEVICE;
+  }
+  dos->device_info[1] |= DOS_DEVICE_IS_STDOUT;
+
+  dos->psp_segment = program->psp_segment;
+  dos->dta = segment_offset(program->psp_segment, 0x80);
+
+  // The program owns all of its memory until it gives some back.
+  dos->memory_start = program->psp_segment;
+  dos->memory_end = program->end_segment;
+  dos->blocks[0].segment = program->psp_segment;
+  dos->blocks[0].paragraphs = program->end_segment - program->psp_segment;
+  dos->block_count = 1;
+
+  cpu_set_interrupt_hook(cpu, 0x20, dos, dos_int20);
+  cpu_set_interrupt_hook(cpu, 0x21, dos, dos_int21);
+}
+
+void dos_destroy(struct dos *dos) {
+  for (unsigned i = 0; i < DOS_MAX_HANDLES; ++i) {
+    if (dos->owned_handles & (1u << i)) {
+      close(dos->handles[i]);
+    }
+  }
+
+  cpu_set_interrupt_hook(dos->cpu, 0x20, 0, 0);
+  cpu_set_interrupt_hook(dos->cpu, 0x21, 0, 0);
+}
@@ -0,0 +1,43 @@
+#ifndef HLE_GUEST_H_
+#define HLE_GUEST_H_
+
+#include <base/address.h>
+#include <cpu/bus.h>
+#include <string.h>
+
+// Block transfers between host buffers and guest memory. They go straight to memory when no bus
+// observer is watching and byte by byte over the bus otherwise. Bytes outside of memory read as 0
+// and writes to them are dropped.
+
+static inline void guest_read(struct bus *bus, u32 addr, void *data, u32 size) {
+  byte *memory = bus_plain_memory(bus, addr, size);
+  if (memory) {
+    memcpy(data, memory, size);
+    return;
+  }
+
+  for (u32 i = 0; i < size; ++i) {
+    ((u8 *)data)[i] = addr + i < bus->memory_size ? bus_fetch_byte(bus, addr + i) : 0;
+  }
+}
+
+static inline void guest_write(struct bus *bus, u32 addr, const void *data, u32 size) {
+  byte *memory = bus_plain_memory_for_store(bus, addr, size);
+  if (memory) {
+    memcpy(memory, data, size);
+    return;
+  }
+
+  for (u32 i = 0; i < size; ++i) {
+    if (addr + i < bus->memory_size) {
+      bus_store_byte(bus, addr + i, ((const u8 *)data)[i]);
+    }
+  }
+}
+
+// Flat address of a segment:offset pair.
+static inline u32 guest_address(u16 segment, u16 offset) {
+  return flatten_address(segment_offset(segment, offset));
+}
+
+#endif // HLE_GUEST_H_
@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <hle/bios.h>
+#include <stdlib.h>
+#include <string.h>
+#include <testing/machine.h>
+#include <unistd.h>
+
+#define MEMORY_SIZE 0x10000
+
+struct machine {
+  struct testing_machine core;
+  struct bios bios;
+  u8 output[16];
+};
+
+static void machine_init(struct machine *machine) {
+  testing_machine_init(&machine->core, MEMORY_SIZE, segment_offset(0x0000, 0x0100));
+  machine->core.cpu.regs.word[SP] = 0x1000;
+
+  bios_init(&machine->bios, &machine->core.cpu, bs_video | bs_disk | bs_keyboard, machine->output,
+            sizeof(machine->output));
+}
+
+static void machine_destroy(struct machine *machine) {
+  bios_destroy(&machine->bios);
+  testing_machine_destroy(&machine->core);
+}
+
+// Execute INT `vector` placed at the current instruction.
+static void interrupt(struct machine *machine, u8 vector) {
+  u32 addr = (machine->core.cpu.segs[CS] << 4) + machine->core.cpu.ip;
+  machine->core.memory[addr] = 0xcd;
+  machine->core.memory[addr + 1] = vector;
+
+  cpu_run(&machine->core.cpu, 1);
+}
+
+void test_bios_teletype(void) {
+  struct machine machine;
+  machine_init(&machine);
+  struct cpu *cpu = &machine.core.cpu;
+
+  static const char text[] = "ab\r\nc";
+  for (const char *c = text; *c; ++c) {
+    cpu->regs.word[AX] = 0x0e00 | *c;
+    interrupt(&machine, 0x10);
+  }
+
+  assert(machine.bios.output_size == 5);
+  assert(memcmp(machine.output, text, 5) == 0);
+
+  cpu->regs.word[AX] = 0x0300;
+  interrupt(&machine, 0x10);
+  assert(cpu->regs.byte[DH] == 1);
+  assert(cpu->regs.byte[DL] == 1);
+
+  // Output beyond the buffer is dropped.
+  cpu->regs.word[AX] = 0x0a00 | 'x';
+  cpu->regs.word[CX] = 100;
+  interrupt(&machine, 0x10);
+  assert(machine.bios.output_size == sizeof(machine.output));
+
+  machine_destroy(&machine);
+}
+
+void test_bios_disk_read(void) {
+  struct machine machine;
+  machine_init(&machine);
+  struct cpu *cpu = &machine.core.cpu;
+
+  // A 360KiB floppy whose sectors are filled with their LBA.
+  char path[] = "/tmp/bios_tests_XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  unlink(path);
+  for (u32 lba = 0; lba < 720; ++lba) {
+    u8 sector[BIOS_SECTOR_SIZE];
+    memset(sector, lba & 0xff, sizeof(sector));
+    ssize_t written = write(fd, sector, sizeof(sector));
+    assert(written == sizeof(sector));
+  }
+
+  bool attached = bios_attach_disk(&machine.bios, 0x00, fd);
+  assert(attached);
+
+  // Cylinder 1, head 1, sector 3 is LBA (1 * 2 + 1) * 9 + 2 = 29. Read 2 sectors to 0000:2000.
+  cpu->regs.word[AX] = 0x0202;
+  cpu->regs.word[CX] = 0x0103;
+  cpu->regs.word[DX] = 0x0100;
+  cpu->regs.word[BX] = 0x2000;
+  interrupt(&machine, 0x13);
+  assert(!cpu->flags.carry);
+  assert(cpu->regs.byte[AH] == bds_ok);
+  assert(cpu->regs.byte[AL] == 2);
+  assert(machine.core.memory[0x2000] == 29);
+  assert(machine.core.memory[0x2000 + BIOS_SECTOR_SIZE] == 30);
+
+  // Past the last sector of a track.
+  cpu->regs.word[AX] = 0x0201;
+  cpu->regs.word[CX] = 0x000a;
+  cpu->regs.word[DX] = 0x0000;
+  interrupt(&machine, 0x13);
+  assert(cpu->flags.carry);
+  assert(cpu->regs.byte[AH] == bds_sector_not_found);
+
+  // No hard disk.
+  cpu->regs.word[AX] = 0x0201;
+  cpu->regs.word[CX] = 0x0001;
+  cpu->regs.word[DX] = 0x0080;
+  interrupt(&machine, 0x13);
+  assert(cpu->flags.carry);
+  assert(cpu->regs.byte[AH] == bds_not_ready);
+
+  cpu->regs.word[AX] = 0x0800;
+  cpu->regs.word[DX] = 0x0000;
+  interrupt(&machine, 0x13);
+  assert(!cpu->flags.carry);
+  assert(cpu->regs.byte[CH] == 39 && cpu->regs.byte[CL] == 9 && cpu->regs.byte[DH] == 1);
+
+  close(fd);
+  machine_destroy(&machine);
+}
+
+void test_bios_keyboard_waits_for_keys(void) {
+  struct machine machine;
+  machine_init(&machine);
+  struct cpu *cpu = &machine.core.cpu;
+
+  cpu->regs.word[AX] = 0x0100;
+  interrupt(&machine, 0x16);
+  assert(cpu->flags.zero);
+
+  // Reading with an empty queue stays on the INT instruction.
+  u16 ip = cpu->ip;
+  cpu->regs.word[AX] = 0x0000;
+  interrupt(&machine, 0x16);
+  assert(cpu->ip == ip);
+
+  unsigned pushed = bios_push_text(&machine.bios, "A\n");
+  assert(pushed == 2);
+
+  cpu->regs.word[AX] = 0x0100;
+  interrupt(&machine, 0x16);
+  assert(!cpu->flags.zero);
+  assert(cpu->regs.word[AX] == 0x1e41);
+
+  cpu->regs.word[AX] = 0x0000;
+  interrupt(&machine, 0x16);
+  assert(cpu->regs.word[AX] == 0x1e41);
+  assert(cpu->ip == ip + 4);
+
+  cpu->regs.word[AX] = 0x0000;
+  interrupt(&machine, 0x16);
+  assert(cpu->regs.word[AX] == 0x1c0d);
+
+  machine_destroy(&machine);
+}
+
+void bios_tests(void) {
+  test_bios_teletype();
+  test_bios_disk_read();
+  test_bios_keyboard_waits_for_keys();
+}
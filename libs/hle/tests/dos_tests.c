@@ -0,0 +1,371 @@
+#include <assert.h>
+#include <cpu/replay.h>
+#include <fcntl.h>
+#include <hle/dos.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <testing/machine.h>
+#include <unistd.h>
+
+#define MEMORY_SIZE 0x100000
+#define PSP_SEGMENT 0x0100
+
+struct machine {
+  struct testing_machine core;
+  struct dos dos;
+
+  char root[32];
+  int root_fd;
+  int console_in[2];
+  int console_out[2];
+};
+
+static void machine_init(struct machine *machine, const u8 *program, u32 program_size) {
+  testing_machine_init(&machine->core, MEMORY_SIZE, segment_offset(0xf000, 0xfff0));
+
+  struct loader_program loaded;
+  enum loader_result loaded_result =
+      loader_load(&machine->core.bus, program, program_size, PSP_SEGMENT, 0, &loaded);
+  assert(loaded_result == lr_ok);
+  loader_start(&loaded, &machine->core.cpu);
+
+  strcpy(machine->root, "/tmp/dos_tests_XXXXXX");
+  char *root = mkdtemp(machine->root);
+  assert(root);
+  machine->root_fd = open(machine->root, O_RDONLY | O_DIRECTORY);
+  assert(machine->root_fd >= 0);
+
+  int result = pipe(machine->console_in);
+  assert(result == 0);
+  result = pipe(machine->console_out);
+  assert(result == 0);
+
+  dos_init(&machine->dos, &machine->core.cpu, &loaded, machine->root_fd, machine->console_in[0],
+           machine->console_out[1]);
+}
+
+static void machine_destroy(struct machine *machine) {
+  dos_destroy(&machine->dos);
+
+  close(machine->console_in[0]);
+  close(machine->console_in[1]);
+  close(machine->console_out[0]);
+  close(machine->console_out[1]);
+
+  unlinkat(machine->root_fd, "out.txt", 0);
+  close(machine->root_fd);
+  rmdir(machine->root);
+
+  testing_machine_destroy(&machine->core);
+}
+
+// Execute an INT 21h placed at the current instruction.
+static void int21(struct machine *machine) {
+  u32 addr = (machine->core.cpu.segs[CS] << 4) + machine->core.cpu.ip;
+  machine->core.memory[addr] = 0xcd;
+  machine->core.memory[addr + 1] = 0x21;
+
+  cpu_run(&machine->core.cpu, 1);
+}
+
+static void store_string(struct machine *machine, u16 offset, const char *text) {
+  strcpy((char *)machine->core.memory + (PSP_SEGMENT << 4) + offset, text);
+}
+
+void test_dos_print_and_exit(void) {
+  // mov ah, 09h; mov dx, 010ch; int 21h; mov ax, 4c07h; int 21h; db "hi$"
+  static const u8 program[] = {0xb4, 0x09, 0xba, 0x0c, 0x01, 0xcd, 0x21, 0xb8,
+                               0x07, 0x4c, 0xcd, 0x21, 'h',  'i',  '$'};
+
+  struct machine machine;
+  machine_init(&machine, program, sizeof(program));
+
+  for (unsigned i = 0; i < 10 && !machine.dos.terminated; ++i) {
+    cpu_run(&machine.core.cpu, 1);
+  }
+
+  assert(machine.dos.terminated);
+  assert(machine.dos.exit_code == 7);
+  assert(machine.core.cpu.halted);
+
+  char output[8];
+  ssize_t size = read(machine.console_out[0], output, sizeof(output));
+  assert(size == 2);
+  assert(memcmp(output, "hi", 2) == 0);
+
+  machine_destroy(&machine);
+}
+
+void test_dos_file_round_trip(void) {
+  static const u8 program[] = {0x90};
+
+  struct machine machine;
+  machine_init(&machine, program, sizeof(program));
+  struct cpu *cpu = &machine.core.cpu;
+
+  store_string(&machine, 0x200, "C:\\OUT.TXT");
+  store_string(&machine, 0x300, "hello");
+
+  // Create and write.
+  cpu->regs.word[AX] = 0x3c00;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  u16 handle = cpu->regs.word[AX];
+  assert(handle == 5);
+
+  cpu->regs.word[AX] = 0x4000;
+  cpu->regs.word[BX] = handle;
+  cpu->regs.word[CX] = 5;
+  cpu->regs.word[DX] = 0x300;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  assert(cpu->regs.word[AX] == 5);
+
+  cpu->regs.word[AX] = 0x3e00;
+  cpu->regs.word[BX] = handle;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+
+  // The file is on the host, lowercased.
+  int fd = openat(machine.root_fd, "out.txt", O_RDONLY);
+  assert(fd >= 0);
+  close(fd);
+
+  // Open, seek and read it back.
+  cpu->regs.word[AX] = 0x3d00;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  handle = cpu->regs.word[AX];
+
+  cpu->regs.word[AX] = 0x4200;
+  cpu->regs.word[BX] = handle;
+  cpu->regs.word[CX] = 0;
+  cpu->regs.word[DX] = 1;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  assert(cpu->regs.word[AX] == 1 && cpu->regs.word[DX] == 0);
+
+  cpu->regs.word[AX] = 0x3f00;
+  cpu->regs.word[BX] = handle;
+  cpu->regs.word[CX] = 0x100;
+  cpu->regs.word[DX] = 0x400;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  assert(cpu->regs.word[AX] == 4);
+  assert(memcmp(machine.core.memory + (PSP_SEGMENT << 4) + 0x400, "ello", 4) == 0);
+
+  // Files outside of the sandbox are refused.
+  store_string(&machine, 0x200, "..\\SECRET");
+  cpu->regs.word[AX] = 0x3d00;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+  assert(cpu->flags.carry);
+  assert(cpu->regs.word[AX] == de_path_not_found);
+
+  // Files in a directory can be created and deleted.
+  int result = mkdirat(machine.root_fd, "sub", 0700);
+  assert(result == 0);
+  store_string(&machine, 0x200, "\\SUB\\NEW.TXT");
+  cpu->regs.word[AX] = 0x3c00;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  cpu->regs.word[BX] = cpu->regs.word[AX];
+  cpu->regs.word[AX] = 0x3e00;
+  int21(&machine);
+  cpu->regs.word[AX] = 0x4100;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  result = unlinkat(machine.root_fd, "sub", AT_REMOVEDIR);
+  assert(result == 0);
+
+  // Symbolic links are refused, wherever they are in the path.
+  result = symlinkat("..", machine.root_fd, "up");
+  assert(result == 0);
+  result = symlinkat("out.txt", machine.root_fd, "link");
+  assert(result == 0);
+  store_string(&machine, 0x200, "UP\\OUT.TXT");
+  cpu->regs.word[AX] = 0x3d00;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+  assert(cpu->flags.carry);
+
+  store_string(&machine, 0x200, "LINK");
+  cpu->regs.word[AX] = 0x3d00;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+  assert(cpu->flags.carry);
+  result = unlinkat(machine.root_fd, "up", 0);
+  assert(result == 0);
+  result = unlinkat(machine.root_fd, "link", 0);
+  assert(result == 0);
+
+  cpu->regs.word[AX] = 0x3e00;
+  cpu->regs.word[BX] = 12;
+  int21(&machine);
+  assert(cpu->flags.carry);
+  assert(cpu->regs.word[AX] == de_invalid_handle);
+
+  machine_destroy(&machine);
+}
+
+void test_dos_memory_allocation(void) {
+  static const u8 program[] = {0x90};
+
+  struct machine machine;
+  machine_init(&machine, program, sizeof(program));
+  struct cpu *cpu = &machine.core.cpu;
+
+  // The program owns all the memory at first.
+  cpu->regs.word[AX] = 0x4800;
+  cpu->regs.word[BX] = 0x100;
+  int21(&machine);
+  assert(cpu->flags.carry);
+  assert(cpu->regs.word[AX] == de_insufficient_memory);
+  assert(cpu->regs.word[BX] == 0);
+
+  cpu->regs.word[AX] = 0x4a00;
+  cpu->segs[ES] = PSP_SEGMENT;
+  cpu->regs.word[BX] = 0x1000;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+
+  cpu->regs.word[AX] = 0x4800;
+  cpu->regs.word[BX] = 0x100;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  u16 segment = cpu->regs.word[AX];
+  assert(segment == PSP_SEGMENT + 0x1000);
+
+  // The program can not grow into the allocated block any more.
+  cpu->regs.word[AX] = 0x4a00;
+  cpu->segs[ES] = PSP_SEGMENT;
+  cpu->regs.word[BX] = 0x2000;
+  int21(&machine);
+  assert(cpu->flags.carry);
+  assert(cpu->regs.word[BX] == 0x1000);
+
+  cpu->regs.word[AX] = 0x4900;
+  cpu->segs[ES] = segment;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+
+  cpu->regs.word[AX] = 0x4900;
+  cpu->segs[ES] = segment;
+  int21(&machine);
+  assert(cpu->flags.carry);
+  assert(cpu->regs.word[AX] == de_invalid_block);
+
+  machine_destroy(&machine);
+}
+
+void test_dos_duplicate_console_handle(void) {
+  static const u8 program[] = {0x90};
+
+  struct machine machine;
+  machine_init(&machine, program, sizeof(program));
+  struct cpu *cpu = &machine.core.cpu;
+
+  cpu->regs.word[AX] = 0x4500;
+  cpu->regs.word[BX] = 1;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  u16 handle = cpu->regs.word[AX];
+  assert(handle == 5);
+
+  // The duplicate is the console as well, not a file on the default drive.
+  cpu->regs.word[AX] = 0x4400;
+  cpu->regs.word[BX] = handle;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+  assert(cpu->regs.word[DX] == 0x82);
+
+  cpu->regs.word[AX] = 0x3e00;
+  cpu->regs.word[BX] = handle;
+  int21(&machine);
+  assert(!cpu->flags.carry);
+
+  machine_destroy(&machine);
+}
+
+void test_dos_buffered_input(void) {
+  static const u8 program[] = {0x90};
+
+  struct machine machine;
+  machine_init(&machine, program, sizeof(program));
+  struct cpu *cpu = &machine.core.cpu;
+
+  ssize_t written = write(machine.console_in[1], "abcdef\n", 7);
+  assert(written == 7);
+
+  // Room for 3 characters and the carriage return.
+  byte *buffer = machine.core.memory + (PSP_SEGMENT << 4) + 0x200;
+  buffer[0] = 4;
+
+  cpu->regs.word[AX] = 0x0a00;
+  cpu->regs.word[DX] = 0x200;
+  int21(&machine);
+
+  assert(buffer[1] == 3);
+  assert(memcmp(buffer + 2, "abc\r", 4) == 0);
+
+  machine_destroy(&machine);
+}
+
+// Read a key and the time, recording them or replaying them.
+static void read_key_and_time(struct machine *machine, struct replay *replay,
+                              enum replay_mode mode, const char *path, char key) {
+  static const u8 program[] = {0x90};
+  machine_init(machine, program, sizeof(program));
+  bool started = replay_init(replay, &machine->core.cpu, mode, path);
+  assert(started);
+
+  ssize_t written = write(machine->console_in[1], &key, 1);
+  assert(written == 1);
+  machine->core.cpu.regs.word[AX] = 0x0800;
+  int21(machine);
+  machine->core.cpu.regs.byte[BL] = machine->core.cpu.regs.byte[AL];
+
+  machine->core.cpu.regs.word[AX] = 0x2c00;
+  int21(machine);
+
+  replay_destroy(replay);
+}
+
+void test_dos_console_and_time_are_replayed(void) {
+  char path[32];
+  strcpy(path, "/tmp/dos_tests_XXXXXX");
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  struct replay replay;
+  struct machine recorded;
+  read_key_and_time(&recorded, &replay, rm_record, path, 'x');
+  assert(recorded.core.cpu.regs.byte[BL] == 'x');
+
+  struct machine replayed;
+  read_key_and_time(&replayed, &replay, rm_replay, path, 'y');
+  assert(!replay.diverged);
+  assert(replayed.core.cpu.regs.byte[BL] == 'x');
+  assert(replayed.core.cpu.regs.word[CX] == recorded.core.cpu.regs.word[CX]);
+  assert(replayed.core.cpu.regs.word[DX] == recorded.core.cpu.regs.word[DX]);
+
+  machine_destroy(&recorded);
+  machine_destroy(&replayed);
+  unlink(path);
+}
+
+void dos_tests(void) {
+  test_dos_print_and_exit();
+  test_dos_file_round_trip();
+  test_dos_memory_allocation();
+  test_dos_duplicate_console_handle();
+  test_dos_buffered_input();
+  test_dos_console_and_time_are_replayed();
+}
@@ -0,0 +1,8 @@
+void bios_tests(void);
+void dos_tests(void);
+
+int main(int argc, char **argv) {
+  bios_tests();
+  dos_tests();
+  return 0;
+}
@@ -39,6 +39,19 @@ enum indirect_memory_encoding {
   ime_bx,
 };
 
+// The registers an indirect memory encoding adds together to form the effective address, shared by
+// the decoder and the cpu. A missing base or index register is `register_16_count`, which stands
+// for a register that always reads 0.
+struct indirect_memory_registers {
+  enum register_16 base;
+  enum register_16 index;
+
+  // Segment the decoder uses without a segment override prefix.
+  enum segment_register default_segment;
+};
+
+extern const struct indirect_memory_registers indirect_memory_registers_table[ime_bx + 1];
+
 struct operand_displacement {
   enum segment_register seg_reg;
   enum indirect_memory_encoding encoding;
@@ -208,6 +221,9 @@ enum instruction_type {
   it_xlat,
   it_xor,
 
+  // An invalid op code, or more prefixes than `struct instruction` can hold.
+  it_invalid,
+
   instruction_type_count,
 };
 
@@ -223,10 +239,21 @@ enum rep_mode {
   rm_repne,
 };
 
+// Bits of `instruction.prefixes`.
+enum instruction_prefix {
+  ip_lock = 0x01,
+  ip_rep = 0x02,
+  ip_repne = 0x04,
+  ip_segment = 0x08,
+};
+
 struct instruction {
   enum instruction_data_size data_size;
   enum instruction_type type;
 
+  // All the prefixes in front of the op code. Only the last of rep and repne is kept, which also
+  // sets `rep_mode`.
+  u8 prefixes;
   enum rep_mode rep_mode;
 
   struct operand destination;
@@ -2,6 +2,17 @@
 
 #include <assert.h>
 
+const struct indirect_memory_registers indirect_memory_registers_table[ime_bx + 1] = {
+    /* ime_bx_si */ {BX, SI, DS},
+    /* ime_bx_di */ {BX, DI, DS},
+    /* ime_bp_si */ {BP, SI, SS},
+    /* ime_bp_di */ {BP, DI, SS},
+    /* ime_si    */ {SI, register_16_count, DS},
+    /* ime_di    */ {DI, register_16_count, DS},
+    /* ime_bp    */ {BP, register_16_count, SS},
+    /* ime_bx    */ {BX, register_16_count, DS},
+};
+
 void instruction_init(struct instruction *instruction) {
   memset(instruction, 0, sizeof(*instruction));
 }
@@ -17,7 +28,7 @@ const char *instruction_type_to_string(enum instruction_type instruction_type) {
       "loop",  "loope", "loopne", "mov",   "movs",  "mul",   "neg",   "not",   "or",    "out",
       "outs",  "pop",   "popa",   "popf",  "push",  "pusha", "pushf", "rcl",   "rcr",   "ret",
       "retf",  "rol",   "ror",    "sahf",  "salc",  "sar",   "sbb",   "scas",  "shl",   "shr",
-      "stc",   "std",   "sti",    "stos",  "sub",   "test",  "xchg",  "xlat",  "xor",
+      "stc",   "std",   "sti",    "stos",  "sub",   "test",  "xchg",  "xlat",  "xor",   "(bad)",
   };
 
   assert(ARRAY_SIZE(mnemonics) == instruction_type_count);
@@ -0,0 +1,47 @@
+#ifndef LOADER_LOADER_H_
+#define LOADER_LOADER_H_
+
+#include <base/address.h>
+#include <base/platform.h>
+#include <cpu/cpu.h>
+
+// Load DOS programs straight into guest memory, the way DOS' EXEC function would, without DOS
+// itself being present.
+//
+// The program segment prefix (PSP) is built at the given segment and the program follows it: a
+// .COM file at offset 0x100 of the PSP's segment, the load module of an MZ executable in the next
+// paragraph after the PSP with its relocations applied.
+
+// Size of the program segment prefix in paragraphs.
+#define LOADER_PSP_PARAGRAPHS 0x10
+
+// Programs only get conventional memory, even if the bus has more.
+#define LOADER_MEMORY_TOP_SEGMENT 0xa000
+
+enum loader_result {
+  lr_ok,
+  // The file is an MZ executable with a broken header.
+  lr_invalid,
+  // The program or its minimum allocation does not fit in memory.
+  lr_too_large,
+};
+
+struct loader_program {
+  u16 psp_segment;
+  // First segment after the memory given to the program.
+  u16 end_segment;
+
+  struct address entry;
+  struct address stack;
+};
+
+// Build the PSP at `psp_segment` with the given command tail and load the program in `data` behind
+// it. Files starting with the MZ signature are loaded as executables, anything else as a .COM
+// image.
+enum loader_result loader_load(struct bus *bus, const u8 *data, u32 data_size, u16 psp_segment,
+                               const char *command_tail, struct loader_program *program);
+
+// Point the cpu at the program's entry point and stack, with DS and ES on the PSP.
+void loader_start(const struct loader_program *program, struct cpu *cpu);
+
+#endif // LOADER_LOADER_H_
@@ -0,0 +1,64 @@
+#ifndef LOADER_MZ_H_
+#define LOADER_MZ_H_
+
+#include <base/platform.h>
+#include <stdbool.h>
+
+// DOS MZ executables.
+//
+// The file starts with a header, followed by the relocation table and the load module. The load
+// module is copied into memory as is, after which every word listed in the relocation table gets
+// the segment the module was loaded at added to it.
+
+#define MZ_SIGNATURE 0x5a4d
+
+struct executable_header_mz {
+  u16 id;
+  u16 extra_bytes;
+  u16 pages;
+  u16 relocation_items;
+  u16 header_size;
+  u16 minimum_allocation;
+  u16 maximum_allocation;
+  u16 initial_ss;
+  u16 initial_sp;
+  u16 checksum;
+  u16 initial_ip;
+  u16 initial_cs;
+  u16 relocation_table;
+  u16 overlay;
+};
+
+struct mz_relocation {
+  u16 offset;
+  u16 segment;
+};
+
+struct mz_image {
+  struct executable_header_mz header;
+
+  // Offset of the load module in the file and its size. Anything after it, like overlays or debug
+  // information, is not part of the image.
+  u32 load_module_offset;
+  u32 load_module_size;
+
+  // Points into the file data, `header.relocation_items` entries of 4 bytes.
+  const u8 *relocation_table;
+};
+
+static inline struct mz_relocation mz_relocation(const struct mz_image *image, unsigned index) {
+  const u8 *entry = image->relocation_table + index * 4;
+
+  struct mz_relocation result;
+  result.offset = entry[0] | (entry[1] << 8);
+  result.segment = entry[2] | (entry[3] << 8);
+
+  return result;
+}
+
+// Parse the header of an MZ executable. Return false if `data` is not an MZ executable or is
+// truncated in the header or the relocation table. A load module cut short by the end of the file
+// is accepted and only loads what is there.
+bool mz_parse(struct mz_image *image, const u8 *data, u32 data_size);
+
+#endif // LOADER_MZ_H_
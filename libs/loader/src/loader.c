@@ -0,0 +1,137 @@
+#include "loader/loader.h"
+
+#include "loader/mz.h"
+
+#include <string.h>
+
+// Offsets in the program segment prefix.
+#define PSP_MEMORY_TOP 0x02
+#define PSP_COMMAND_TAIL 0x80
+#define PSP_COMMAND_TAIL_SIZE 0x7f
+
+// .COM programs get the whole segment, minus the word on top of the stack.
+#define COM_MAX_SIZE (0x10000 - 0x100 - 2)
+
+static void loader_write(struct bus *bus, u32 addr, const u8 *data, u32 size) {
+  byte *memory = bus_plain_memory_for_store(bus, addr, size);
+  if (memory) {
+    memcpy(memory, data, size);
+    return;
+  }
+
+  for (u32 i = 0; i < size; ++i) {
+    bus_store_byte(bus, addr + i, data[i]);
+  }
+}
+
+static void loader_build_psp(struct bus *bus, const struct loader_program *program,
+                             const char *command_tail) {
+  u8 psp[LOADER_PSP_PARAGRAPHS * 16];
+  memset(psp, 0, sizeof(psp));
+
+  // Returning through offset 0 terminates the program with INT 20h.
+  psp[0x00] = 0xcd;
+  psp[0x01] = 0x20;
+
+  psp[PSP_MEMORY_TOP] = program->end_segment & 0xff;
+  psp[PSP_MEMORY_TOP + 1] = program->end_segment >> 8;
+
+  // The command tail is a length byte followed by the text and a carriage return, which is not
+  // counted.
+  size_t tail_size = command_tail ? strlen(command_tail) : 0;
+  if (tail_size > PSP_COMMAND_TAIL_SIZE - 1) {
+    tail_size = PSP_COMMAND_TAIL_SIZE - 1;
+  }
+  psp[PSP_COMMAND_TAIL] = (u8)tail_size;
+  memcpy(psp + PSP_COMMAND_TAIL + 1, command_tail ? command_tail : "", tail_size);
+  psp[PSP_COMMAND_TAIL + 1 + tail_size] = 0x0d;
+
+  loader_write(bus, program->psp_segment << 4, psp, sizeof(psp));
+}
+
+static enum loader_result loader_load_com(struct bus *bus, const u8 *data, u32 data_size,
+                                          struct loader_program *program) {
+  u32 base = program->psp_segment << 4;
+  if (data_size > COM_MAX_SIZE || base + 0x10000 > (u32)program->end_segment << 4) {
+    return lr_too_large;
+  }
+
+  loader_write(bus, base + 0x100, data, data_size);
+
+  // A near return from the program lands on the INT 20h at the start of the PSP.
+  bus_store_word(bus, base + 0xfffe, 0x0000);
+
+  program->entry = segment_offset(program->psp_segment, 0x100);
+  program->stack = segment_offset(program->psp_segment, 0xfffe);
+
+  return lr_ok;
+}
+
+static enum loader_result loader_load_exe(struct bus *bus, const u8 *data, u32 data_size,
+                                          struct loader_program *program) {
+  struct mz_image image;
+  if (!mz_parse(&image, data, data_size)) {
+    return lr_invalid;
+  }
+
+  u16 load_segment = program->psp_segment + LOADER_PSP_PARAGRAPHS;
+  u32 module_paragraphs = (image.load_module_size + 15) / 16;
+  if (load_segment + module_paragraphs + image.header.minimum_allocation > program->end_segment) {
+    return lr_too_large;
+  }
+
+  loader_write(bus, load_segment << 4, data + image.load_module_offset, image.load_module_size);
+
+  for (unsigned i = 0; i < image.header.relocation_items; ++i) {
+    struct mz_relocation relocation = mz_relocation(&image, i);
+    u32 addr = ((u16)(load_segment + relocation.segment) << 4) + relocation.offset;
+    if (addr + 2 > bus->memory_size) {
+      return lr_invalid;
+    }
+    bus_store_word(bus, addr, bus_fetch_word(bus, addr) + load_segment);
+  }
+
+  program->entry = segment_offset(load_segment + image.header.initial_cs, image.header.initial_ip);
+  program->stack = segment_offset(load_segment + image.header.initial_ss, image.header.initial_sp);
+
+  return lr_ok;
+}
+
+enum loader_result loader_load(struct bus *bus, const u8 *data, u32 data_size, u16 psp_segment,
+                               const char *command_tail, struct loader_program *program) {
+  memset(program, 0, sizeof(*program));
+
+  u32 memory_top = bus->memory_size >> 4;
+  if (memory_top > LOADER_MEMORY_TOP_SEGMENT) {
+    memory_top = LOADER_MEMORY_TOP_SEGMENT;
+  }
+  if ((u32)psp_segment + LOADER_PSP_PARAGRAPHS > memory_top) {
+    return lr_too_large;
+  }
+
+  program->psp_segment = psp_segment;
+  program->end_segment = memory_top;
+
+  enum loader_result result;
+  if (data_size >= 2 && (data[0] | (data[1] << 8)) == MZ_SIGNATURE) {
+    result = loader_load_exe(bus, data, data_size, program);
+  } else {
+    result = loader_load_com(bus, data, data_size, program);
+  }
+
+  if (result == lr_ok) {
+    loader_build_psp(bus, program, command_tail);
+  }
+
+  return result;
+}
+
+void loader_start(const struct loader_program *program, struct cpu *cpu) {
+  cpu->segs[CS] = program->entry.segment;
+  cpu->ip = program->entry.offset;
+  cpu->segs[SS] = program->stack.segment;
+  cpu->regs.word[SP] = program->stack.offset;
+  cpu->segs[DS] = program->psp_segment;
+  cpu->segs[ES] = program->psp_segment;
+  cpu->halted = false;
+}
@@ -0,0 +1,43 @@
+#include "loader/mz.h"
+
+#include <string.h>
+
+bool mz_parse(struct mz_image *image, const u8 *data, u32 data_size) {
+  memset(image, 0, sizeof(*image));
+
+  if (data_size < sizeof(image->header)) {
+    return false;
+  }
+
+  memcpy(&image->header, data, sizeof(image->header));
+  const struct executable_header_mz *header = &image->header;
+
+  if (header->id != MZ_SIGNATURE) {
+    return false;
+  }
+
+  // The last page only holds `extra_bytes` bytes, unless it is 0 and the page is full.
+  u32 file_size = header->pages * 512;
+  if (header->extra_bytes) {
+    file_size -= 512 - (header->extra_bytes & 0x1ff);
+  }
+  if (file_size > data_size) {
+    file_size = data_size;
+  }
+
+  u32 header_size = header->header_size * 16;
+  if (header_size < sizeof(image->header) || header_size > file_size) {
+    return false;
+  }
+
+  u32 relocations_end = header->relocation_table + header->relocation_items * 4;
+  if (header->relocation_items && relocations_end > data_size) {
+    return false;
+  }
+
+  image->load_module_offset = header_size;
+  image->load_module_size = file_size - header_size;
+  image->relocation_table = data + header->relocation_table;
+
+  return true;
+}
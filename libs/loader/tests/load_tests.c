@@ -0,0 +1,114 @@
+#include <assert.h>
+#include <loader/loader.h>
+#include <loader/mz.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMORY_SIZE 0x100000
+#define PSP_SEGMENT 0x1000
+
+static void put_word(u8 *data, u32 offset, u16 value) {
+  data[offset] = value & 0xff;
+  data[offset + 1] = value >> 8;
+}
+
+static u16 get_word(const byte *memory, u32 addr) {
+  return memory[addr] | (memory[addr + 1] << 8);
+}
+
+void test_load_com(void) {
+  byte *memory = calloc(MEMORY_SIZE, 1);
+  struct bus bus;
+  bus_init(&bus, memory, MEMORY_SIZE);
+
+  static const u8 program[] = {0xb4, 0x4c, 0xcd, 0x21};
+
+  struct loader_program loaded;
+  enum loader_result result =
+      loader_load(&bus, program, sizeof(program), PSP_SEGMENT, " hello", &loaded);
+  assert(result == lr_ok);
+
+  u32 psp = PSP_SEGMENT << 4;
+  assert(memcmp(memory + psp + 0x100, program, sizeof(program)) == 0);
+
+  // INT 20h, the top of memory and the command tail.
+  assert(memory[psp] == 0xcd && memory[psp + 1] == 0x20);
+  assert(get_word(memory, psp + 0x02) == LOADER_MEMORY_TOP_SEGMENT);
+  assert(memory[psp + 0x80] == 6);
+  assert(memcmp(memory + psp + 0x81, " hello\r", 7) == 0);
+
+  struct cpu cpu;
+  cpu_init(&cpu, 0, &bus, segment_offset(0xf000, 0xfff0));
+  loader_start(&loaded, &cpu);
+
+  assert(cpu.segs[CS] == PSP_SEGMENT && cpu.ip == 0x100);
+  assert(cpu.segs[SS] == PSP_SEGMENT && cpu.regs.word[SP] == 0xfffe);
+  assert(cpu.segs[DS] == PSP_SEGMENT && cpu.segs[ES] == PSP_SEGMENT);
+
+  free(memory);
+}
+
+void test_load_exe_applies_relocations(void) {
+  byte *memory = calloc(MEMORY_SIZE, 1);
+  struct bus bus;
+  bus_init(&bus, memory, MEMORY_SIZE);
+
+  // Two header paragraphs with one relocation, followed by a 0x30 byte load module.
+  u8 data[0x50];
+  memset(data, 0, sizeof(data));
+  put_word(data, 0x00, MZ_SIGNATURE);
+  put_word(data, 0x02, 0x50);
+  put_word(data, 0x04, 1);
+  put_word(data, 0x06, 1);
+  put_word(data, 0x08, 2);
+  put_word(data, 0x0e, 0x0002);
+  put_word(data, 0x10, 0x0100);
+  put_word(data, 0x14, 0x0002);
+  put_word(data, 0x16, 0x0001);
+  put_word(data, 0x18, 0x1c);
+  put_word(data, 0x1c, 0x0004);
+  put_word(data, 0x1e, 0x0001);
+
+  // The relocated word sits at 0001:0004 in the load module.
+  put_word(data, 0x20 + 0x14, 0x0003);
+
+  struct loader_program loaded;
+  enum loader_result result = loader_load(&bus, data, sizeof(data), PSP_SEGMENT, 0, &loaded);
+  assert(result == lr_ok);
+
+  u16 load_segment = PSP_SEGMENT + LOADER_PSP_PARAGRAPHS;
+  assert(get_word(memory, (load_segment << 4) + 0x14) == load_segment + 3);
+  assert(memory[(PSP_SEGMENT << 4) + 0x80] == 0);
+
+  assert(loaded.entry.segment == load_segment + 1 && loaded.entry.offset == 0x0002);
+  assert(loaded.stack.segment == load_segment + 2 && loaded.stack.offset == 0x0100);
+
+  // Not enough memory for the minimum allocation.
+  put_word(data, 0x0a, 0xa000);
+  result = loader_load(&bus, data, sizeof(data), PSP_SEGMENT, 0, &loaded);
+  assert(result == lr_too_large);
+
+  free(memory);
+}
+
+void test_load_rejects_programs_that_do_not_fit(void) {
+  byte *memory = calloc(0x20000, 1);
+  struct bus bus;
+  bus_init(&bus, memory, 0x20000);
+
+  static const u8 program[] = {0xc3};
+
+  struct loader_program loaded;
+  enum loader_result result = loader_load(&bus, program, sizeof(program), 0x1800, 0, &loaded);
+  assert(result == lr_too_large);
+  result = loader_load(&bus, program, sizeof(program), 0x1000, 0, &loaded);
+  assert(result == lr_ok);
+
+  free(memory);
+}
+
+void load_tests(void) {
+  test_load_com();
+  test_load_exe_applies_relocations();
+  test_load_rejects_programs_that_do_not_fit();
+}
@@ -0,0 +1,8 @@
+void load_tests(void);
+void mz_tests(void);
+
+int main(int argc, char **argv) {
+  load_tests();
+  mz_tests();
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <assert.h>
+#include <loader/mz.h>
+#include <string.h>
+
+static void put_word(u8 *data, u32 offset, u16 value) {
+  data[offset] = value & 0xff;
+  data[offset + 1] = value >> 8;
+}
+
+// Two header paragraphs holding one relocation, followed by a 0x30 byte load module.
+static void build_executable(u8 *data) {
+  memset(data, 0, 0x50);
+
+  put_word(data, 0x00, MZ_SIGNATURE);
+  put_word(data, 0x02, 0x50);
+  put_word(data, 0x04, 1);
+  put_word(data, 0x06, 1);
+  put_word(data, 0x08, 2);
+  put_word(data, 0x18, 0x1c);
+  put_word(data, 0x1c, 0x0004);
+  put_word(data, 0x1e, 0x0001);
+}
+
+void test_mz_parse(void) {
+  u8 data[0x50];
+  build_executable(data);
+
+  struct mz_image image;
+  bool parsed = mz_parse(&image, data, sizeof(data));
+  assert(parsed);
+
+  assert(image.load_module_offset == 0x20);
+  assert(image.load_module_size == 0x30);
+  assert(image.header.relocation_items == 1);
+
+  struct mz_relocation relocation = mz_relocation(&image, 0);
+  assert(relocation.offset == 0x0004);
+  assert(relocation.segment == 0x0001);
+}
+
+void test_mz_parse_full_last_page(void) {
+  u8 data[0x50];
+  build_executable(data);
+
+  // A full last page is stored as 0 extra bytes. The file is shorter than the header claims, so
+  // only what is there is loaded.
+  put_word(data, 0x02, 0);
+
+  struct mz_image image;
+  bool parsed = mz_parse(&image, data, sizeof(data));
+  assert(parsed);
+  assert(image.load_module_size == 0x30);
+}
+
+void test_mz_parse_rejects_broken_files(void) {
+  u8 data[0x50];
+  struct mz_image image;
+
+  build_executable(data);
+  data[0] = 'X';
+  assert(!mz_parse(&image, data, sizeof(data)));
+
+  build_executable(data);
+  assert(!mz_parse(&image, data, 0x10));
+
+  // The relocation table runs past the end of the file.
+  build_executable(data);
+  put_word(data, 0x06, 0x100);
+  assert(!mz_parse(&image, data, sizeof(data)));
+
+  // The header is larger than the file.
+  build_executable(data);
+  put_word(data, 0x08, 0x10);
+  assert(!mz_parse(&image, data, sizeof(data)));
+}
+
+void mz_tests(void) {
+  test_mz_parse();
+  test_mz_parse_full_last_page();
+  test_mz_parse_rejects_broken_files();
+}
@@ -0,0 +1,33 @@
+#ifndef TESTING_MACHINE_H_
+#define TESTING_MACHINE_H_
+
+#include <base/platform.h>
+#include <cpu/cpu.h>
+
+// The part every test machine has: zeroed memory on a bus, an empty set of ports and a cpu. Tests
+// embed it in their own machine along with the devices they exercise.
+struct testing_machine {
+  byte *memory;
+  struct bus bus;
+  struct ports *ports;
+  struct cpu cpu;
+};
+
+// Allocate `memory_size` bytes of memory and start the cpu at `start`.
+void testing_machine_init(struct testing_machine *machine, u32 memory_size, struct address start);
+void testing_machine_destroy(struct testing_machine *machine);
+
+// Move the clock of the cpu forward by `cycles` and run the scheduler events that became due.
+void testing_advance(struct cpu *cpu, u64 cycles);
+
+// Counts the requests a device raises on an interrupt line, with `testing_count_irq` as the raise
+// function of the line.
+struct testing_irq_count {
+  // The line the device is expected to raise.
+  u8 irq;
+  unsigned count;
+};
+
+void testing_count_irq(void *context, u8 irq);
+
+#endif // TESTING_MACHINE_H_
@@ -0,0 +1,30 @@
+#include "testing/machine.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+void testing_machine_init(struct testing_machine *machine, u32 memory_size, struct address start) {
+  machine->memory = calloc(memory_size, 1);
+  bus_init(&machine->bus, machine->memory, memory_size);
+
+  machine->ports = malloc(sizeof(*machine->ports));
+  ports_init(machine->ports);
+
+  cpu_init(&machine->cpu, machine->ports, &machine->bus, start);
+}
+
+void testing_machine_destroy(struct testing_machine *machine) {
+  free(machine->ports);
+  free(machine->memory);
+}
+
+void testing_advance(struct cpu *cpu, u64 cycles) {
+  cpu->cycles += cycles;
+  scheduler_run_due(&cpu->scheduler, cpu->cycles);
+}
+
+void testing_count_irq(void *context, u8 irq) {
+  struct testing_irq_count *counter = context;
+  assert(irq == counter->irq);
+  counter->count += 1;
+}